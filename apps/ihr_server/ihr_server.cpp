@@ -0,0 +1,25 @@
+#include "mme/ihr/ihr.h"
+#include "mme/ihrremote/ihrserver.h"
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+
+	const unsigned short port = argc > 1 ? static_cast<unsigned short>(std::stoi(argv[1])) : 5550;
+	const std::string device = argc > 2 ? argv[2] : "Mono1";
+
+	try
+	{
+		mme::Ihr550 monochromator{ device };
+		mme::Ihr550Server server{ monochromator, port };
+		std::cout << "Serving " << device << " on port " << server.port() << std::endl;
+		server.run();
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <format>
+
+namespace {
+
+	double time_iterations(const std::function<void()>& iteration, size_t num_iterations) {
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < num_iterations; i++) {
+			iteration();
+		}
+		const auto stop = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(stop - start).count();
+	}
+
+	std::string compiler_id() {
+#if defined(__clang__)
+		return std::format("clang {}.{}", __clang_major__, __clang_minor__);
+#elif defined(__GNUC__)
+		return std::format("gcc {}.{}", __GNUC__, __GNUC_MINOR__);
+#elif defined(_MSC_VER)
+		return std::format("msvc {}", _MSC_VER);
+#else
+		return "unknown";
+#endif
+	}
+}
+
+double mme::bench::BenchmarkResult::min_ns() const
+{
+	return *std::ranges::min_element(ns_per_iteration);
+}
+
+double mme::bench::BenchmarkResult::median_ns() const
+{
+	auto sorted = ns_per_iteration;
+	std::ranges::sort(sorted);
+	const auto mid = sorted.size() / 2;
+	return sorted.size() % 2 ? sorted[mid] : 0.5 * (sorted[mid - 1] + sorted[mid]);
+}
+
+double mme::bench::BenchmarkResult::mean_ns() const
+{
+	return std::accumulate(ns_per_iteration.begin(), ns_per_iteration.end(), 0.0) / ns_per_iteration.size();
+}
+
+double mme::bench::BenchmarkResult::stddev_ns() const
+{
+	const auto mean = mean_ns();
+	double sum_sq = 0.0;
+	for (auto ns : ns_per_iteration) {
+		sum_sq += (ns - mean) * (ns - mean);
+	}
+	return ns_per_iteration.size() > 1 ? std::sqrt(sum_sq / (ns_per_iteration.size() - 1)) : 0.0;
+}
+
+void mme::bench::BenchmarkSuite::add(std::string name, std::function<void()> iteration, BenchmarkOptions options)
+{
+	m_benchmarks.push_back(Benchmark{ std::move(name), {}, std::move(iteration), options });
+}
+
+void mme::bench::BenchmarkSuite::add(std::string name, std::function<void()> setup, std::function<void()> iteration, BenchmarkOptions options)
+{
+	m_benchmarks.push_back(Benchmark{ std::move(name), std::move(setup), std::move(iteration), options });
+}
+
+std::vector<mme::bench::BenchmarkResult> mme::bench::BenchmarkSuite::run(const std::string& filter, std::ostream& log) const
+{
+	std::vector<BenchmarkResult> results;
+	for (const auto& benchmark : m_benchmarks) {
+		if (benchmark.name.find(filter) == std::string::npos) {
+			continue;
+		}
+		const auto& options = benchmark.options;
+		if (benchmark.setup) {
+			benchmark.setup();
+		}
+
+		//warm up caches and calibrate how many iterations make up one sample
+		size_t iterations = 1;
+		const double min_sample_ns = std::chrono::duration<double, std::nano>(options.min_sample_time).count();
+		while (iterations < options.max_iterations_per_sample) {
+			const auto ns = time_iterations(benchmark.iteration, iterations);
+			if (ns >= min_sample_ns) {
+				break;
+			}
+			const auto scale = ns > 0.0 ? std::min(10.0, 1.2 * min_sample_ns / ns) : 10.0;
+			iterations = std::min(options.max_iterations_per_sample, static_cast<size_t>(std::ceil(iterations * scale)));
+		}
+
+		BenchmarkResult result{ benchmark.name, iterations, {}, options.bytes_per_iteration };
+		for (size_t sample = 0; sample < options.num_samples; sample++) {
+			result.ns_per_iteration.push_back(time_iterations(benchmark.iteration, iterations) / iterations);
+		}
+
+		log << std::format("{:<48} {:>14.1f} ns  (min {:.1f}, +-{:.1f})", result.name, result.median_ns(), result.min_ns(), result.stddev_ns());
+		if (result.bytes_per_iteration > 0.0) {
+			log << std::format("  {:.2f} GB/s", result.bytes_per_iteration / result.median_ns());
+		}
+		log << std::endl;
+		results.push_back(std::move(result));
+	}
+	return results;
+}
+
+void mme::bench::write_json(std::ostream& os, const std::vector<BenchmarkResult>& results)
+{
+	os << "{\n";
+	os << std::format("  \"context\": {{\"compiler\": \"{}\", \"cxx_standard\": {}}},\n", compiler_id(), __cplusplus);
+	os << "  \"benchmarks\": [";
+	for (size_t i = 0; i < results.size(); i++) {
+		const auto& result = results[i];
+		os << (i == 0 ? "\n" : ",\n");
+		os << std::format("    {{\"name\": \"{}\", \"iterations_per_sample\": {}, \"samples\": {}, "
+			"\"median_ns\": {:.3f}, \"min_ns\": {:.3f}, \"mean_ns\": {:.3f}, \"stddev_ns\": {:.3f}",
+			result.name, result.iterations_per_sample, result.ns_per_iteration.size(),
+			result.median_ns(), result.min_ns(), result.mean_ns(), result.stddev_ns());
+		if (result.bytes_per_iteration > 0.0) {
+			os << std::format(", \"bytes_per_iteration\": {:.0f}, \"gb_per_second\": {:.4f}", result.bytes_per_iteration, result.bytes_per_iteration / result.median_ns());
+		}
+		os << "}";
+	}
+	os << "\n  ]\n}\n";
+}
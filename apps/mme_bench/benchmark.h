@@ -0,0 +1,93 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <concepts>
+#include <memory>
+#include <ostream>
+
+namespace mme::bench {
+
+	template<typename T>
+	inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void* sink;
+		sink = &value;
+#endif
+	}
+
+	//Data a benchmark works on, made by the first benchmark that runs with it, so a filtered run only
+	//sets up what it uses. Copies share the one made.
+	template<typename T>
+	class Fixture {
+	public:
+		template<typename... Args>
+			requires std::constructible_from<T, Args...>
+		explicit Fixture(Args... args)
+			: m_state(std::make_shared<State>([=] { return std::make_unique<T>(args...); }))
+		{
+		}
+
+		void make() const {
+			if (!m_state->value) {
+				m_state->value = m_state->make();
+			}
+		}
+		T& operator*() const {
+			make();
+			return *m_state->value;
+		}
+		T* operator->() const { return &**this; }
+
+	private:
+		struct State {
+			std::function<std::unique_ptr<T>()> make;
+			std::unique_ptr<T> value;
+		};
+		std::shared_ptr<State> m_state;
+	};
+
+	struct BenchmarkOptions {
+		std::chrono::duration<double> min_sample_time{ 0.02 };
+		size_t num_samples = 15;
+		size_t max_iterations_per_sample = 1 << 20;
+		double bytes_per_iteration = 0.0; //enables throughput reporting
+	};
+
+	struct BenchmarkResult {
+		std::string name;
+		size_t iterations_per_sample;
+		std::vector<double> ns_per_iteration; //one entry per sample
+		double bytes_per_iteration;
+
+		double min_ns() const;
+		double median_ns() const;
+		double mean_ns() const;
+		double stddev_ns() const;
+	};
+
+	class BenchmarkSuite {
+	public:
+		void add(std::string name, std::function<void()> iteration, BenchmarkOptions options = BenchmarkOptions{});
+		//setup runs once before the benchmark is timed, and only if it runs
+		void add(std::string name, std::function<void()> setup, std::function<void()> iteration, BenchmarkOptions options = BenchmarkOptions{});
+
+		//runs every benchmark whose name contains filter
+		std::vector<BenchmarkResult> run(const std::string& filter, std::ostream& log) const;
+
+	private:
+		struct Benchmark {
+			std::string name;
+			std::function<void()> setup;
+			std::function<void()> iteration;
+			BenchmarkOptions options;
+		};
+		std::vector<Benchmark> m_benchmarks;
+	};
+
+	void write_json(std::ostream& os, const std::vector<BenchmarkResult>& results);
+
+} //namespace mme::bench
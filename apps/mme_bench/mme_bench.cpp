@@ -0,0 +1,535 @@
+#include "benchmark.h"
+#include "simulateddevices.h"
+#include "mme/imaging/image.h"
+#include "mme/imaging/conversion.h"
+#include "mme/imaging/framecodec.h"
+#include "mme/imaging/framestatistics.h"
+#include "mme/imaging/filters.h"
+#include "mme/registration/registration.h"
+#include "mme/tiling/tilestream.h"
+#include "mme/motion/espdriver.h"
+#if defined(__unix__)
+#include "mme/sharedring/framering.h"
+#endif
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <numeric>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <format>
+#include <utility>
+
+using mme::bench::do_not_optimize;
+
+namespace {
+
+	struct Arguments {
+		std::string filter;
+		std::string json_file;
+		bool quick = false;
+	};
+
+	Arguments parse_arguments(int argc, char* argv[]) {
+		Arguments args;
+		for (int i = 1; i < argc; i++) {
+			const std::string arg = argv[i];
+			if (arg == "--filter" && i + 1 < argc) {
+				args.filter = argv[++i];
+			}
+			else if (arg == "--json" && i + 1 < argc) {
+				args.json_file = argv[++i];
+			}
+			else if (arg == "--quick") {
+				args.quick = true;
+			}
+			else {
+				throw std::invalid_argument(std::format("Unknown argument {}, usage: mme_bench [--filter text] [--json file] [--quick]", arg));
+			}
+		}
+		return args;
+	}
+
+	mme::bench::BenchmarkOptions with_bytes(mme::bench::BenchmarkOptions options, double bytes) {
+		options.bytes_per_iteration = bytes;
+		return options;
+	}
+
+	//the first of a camera's pregenerated frames
+	struct CameraFrame {
+		explicit CameraFrame(mme::ImageSize size) : camera(size), raw(size) {
+			camera.take_fast_frame(raw.pixels());
+		}
+		mme::bench::SimulatedCamera camera;
+		mme::Image<uint16_t> raw;
+	};
+
+	void add_pixel_conversion(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options) {
+		for (size_t side : { 512, 1024, 2048 }) {
+			const mme::ImageSize size{ side, side };
+			const mme::bench::Fixture<CameraFrame> frame{ size };
+			const mme::bench::Fixture<mme::Image<float>> image{ 0.0f, size };
+
+			suite.add(std::format("pixel_conversion/unpack_pf16/{}", side), [frame, image] { frame.make(); image.make(); }, [frame, image] {
+				mme::unpack_pf16(std::as_const(frame->raw).pixels(), image->pixels());
+				do_not_optimize(image->pixels().data());
+			}, with_bytes(options, num_pixels(size) * (sizeof(uint16_t) + sizeof(float))));
+		}
+
+		//what capture_single does around the SDK call
+		const mme::ImageSize size{ 2048, 2048 };
+		const mme::bench::Fixture<mme::bench::SimulatedCamera> camera{ size };
+		auto make_camera = [camera] { camera.make(); };
+		suite.add("pixel_conversion/capture_single_path/2048", make_camera, [camera, size] {
+			mme::Image<uint16_t> raw(size);
+			camera->take_fast_frame(raw.pixels());
+			mme::Image<float> image(size);
+			mme::unpack_pf16(std::as_const(raw).pixels(), image.pixels());
+			do_not_optimize(image.pixels().data());
+		}, with_bytes(options, num_pixels(size) * (sizeof(uint16_t) + sizeof(float))));
+
+		//statistics gathered during the unpack against the separate rescan they replace
+		suite.add("pixel_conversion/capture_with_statistics_path/2048", make_camera, [camera, size] {
+			mme::Image<uint16_t> raw(size);
+			camera->take_fast_frame(raw.pixels());
+			mme::Image<float> image(size);
+			auto statistics = mme::unpack_pf16_with_statistics(std::as_const(raw).as_view(), image.as_view());
+			do_not_optimize(image.pixels().data());
+			do_not_optimize(&statistics);
+		}, with_bytes(options, num_pixels(size) * (sizeof(uint16_t) + sizeof(float))));
+
+		suite.add("pixel_conversion/capture_single_then_rescan/2048", make_camera, [camera, size] {
+			mme::Image<uint16_t> raw(size);
+			camera->take_fast_frame(raw.pixels());
+			mme::Image<float> image(size);
+			mme::unpack_pf16(std::as_const(raw).pixels(), image.pixels());
+			auto [min, max] = std::ranges::minmax_element(image.pixels());
+			const double mean = std::accumulate(image.pixels().begin(), image.pixels().end(), 0.0) / image.pixels().size();
+			const auto saturated = std::ranges::count_if(image.pixels(), [](float pixel) { return pixel >= 4095.0f; });
+			std::vector<uint32_t> histogram(256, 0);
+			for (float pixel : image.pixels()) {
+				histogram[static_cast<size_t>(pixel) >> 4]++;
+			}
+			do_not_optimize(image.pixels().data());
+			do_not_optimize(histogram.data());
+			do_not_optimize(mean + *min + *max + saturated);
+		}, with_bytes(options, num_pixels(size) * (sizeof(uint16_t) + sizeof(float))));
+
+		suite.add("pixel_conversion/capture_raw_path/2048", make_camera, [camera, size] {
+			mme::Image<uint16_t> raw(size);
+			camera->take_fast_frame(raw.pixels());
+			mme::unpack_pf16(raw.pixels());
+			do_not_optimize(raw.pixels().data());
+		}, with_bytes(options, num_pixels(size) * 2 * sizeof(uint16_t)));
+	}
+
+	void add_save_to_numpy(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options, const std::filesystem::path& dir) {
+		const mme::ImageSize size{ 2048, 2048 };
+		const mme::bench::Fixture<mme::Image<float>> float_image{ 1.0f, size };
+		const mme::bench::Fixture<mme::Image<uint16_t>> raw_image{ uint16_t{ 1 }, size };
+		const auto float_file = (dir / "mme_bench_float.npy").string();
+		const auto raw_file = (dir / "mme_bench_u16.npy").string();
+
+		suite.add("save_to_numpy/float/2048", [float_image] { float_image.make(); }, [float_image, float_file] {
+			mme::save_to_numpy(float_file, *float_image);
+		}, with_bytes(options, num_pixels(size) * sizeof(float)));
+		suite.add("save_to_numpy/uint16/2048", [raw_image] { raw_image.make(); }, [raw_image, raw_file] {
+			mme::save_to_numpy(raw_file, *raw_image);
+		}, with_bytes(options, num_pixels(size) * sizeof(uint16_t)));
+	}
+
+	//12 bit camera data as the codecs store it
+	struct CodecFrames {
+		explicit CodecFrames(mme::ImageSize size) : raw(CameraFrame{ size }.raw) {
+			for (auto& pixel : raw.pixels()) {
+				pixel >>= mme::PF16_SHIFT;
+			}
+			for (auto codec : { mme::FrameCodec::Packed12, mme::FrameCodec::DeltaBitPacked }) {
+				encoded.push_back(mme::encode_frame(std::as_const(raw).as_view(), codec));
+			}
+		}
+		mme::Image<uint16_t> raw;
+		std::vector<mme::EncodedFrame> encoded; //Packed12, DeltaBitPacked
+	};
+
+	void add_frame_codec(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options, const std::filesystem::path& dir) {
+		const mme::ImageSize size{ 2048, 2048 };
+		const mme::bench::Fixture<CodecFrames> frames{ size };
+		auto make_frames = [frames] { frames.make(); };
+		const auto bytes = num_pixels(size) * sizeof(uint16_t);
+
+		size_t index = 0;
+		for (auto codec : { mme::FrameCodec::Packed12, mme::FrameCodec::DeltaBitPacked }) {
+			const auto name = codec == mme::FrameCodec::Packed12 ? "packed12" : "delta_bitpacked";
+			suite.add(std::format("frame_codec/encode_{}/2048", name), make_frames, [frames, codec] {
+				auto frame = mme::encode_frame(std::as_const(frames->raw).as_view(), codec);
+				do_not_optimize(frame.data.data());
+			}, with_bytes(options, bytes));
+			suite.add(std::format("frame_codec/decode_{}/2048", name), make_frames, [frames, index] {
+				auto frame = mme::decode_frame(frames->encoded[index]);
+				do_not_optimize(frame.pixels().data());
+			}, with_bytes(options, bytes));
+			index++;
+		}
+
+		suite.add("frame_codec/encode_frames_parallel_16/2048", make_frames, [frames] {
+			const std::vector<mme::ImageView<const uint16_t>> views(16, std::as_const(frames->raw).as_view());
+			auto encoded = mme::encode_frames(views);
+			do_not_optimize(encoded.data());
+		}, with_bytes(options, bytes * 16));
+
+		const auto file = (dir / "mme_bench_frames.mmef").string();
+		suite.add("frame_codec/compressed_writer/2048", make_frames, [frames, file] {
+			mme::CompressedFrameWriter writer(file);
+			writer.write(std::as_const(frames->raw).as_view());
+		}, with_bytes(options, bytes));
+	}
+
+	struct FftData {
+		explicit FftData(mme::ImageSize size) : plan(size), re(num_pixels(size), 1.0f), im(num_pixels(size), 0.0f) {}
+		mme::FftPlan2d plan;
+		std::vector<float> re;
+		std::vector<float> im;
+	};
+
+	//a Mueller set of 16 frames drifting by a fraction of a pixel per state
+	struct DriftingFrames {
+		explicit DriftingFrames(mme::ImageSize size) {
+			const CameraFrame camera_frame{ size };
+			mme::Image<float> reference(size);
+			mme::unpack_pf16(camera_frame.raw.pixels(), reference.pixels());
+			for (size_t i = 0; i < 16; i++) {
+				frames.push_back(mme::translate(reference.as_view(), { 0.3 * i, -0.2 * i }));
+			}
+			for (const auto& frame : frames) {
+				views.push_back(frame.as_view());
+			}
+			correlator = std::make_unique<mme::PhaseCorrelator>(views.front());
+		}
+		std::vector<mme::Image<float>> frames;
+		std::vector<mme::ImageView<const float>> views;
+		std::unique_ptr<mme::PhaseCorrelator> correlator;
+	};
+
+	void add_registration(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options) {
+		const mme::ImageSize size{ 2048, 2048 };
+		const mme::bench::Fixture<FftData> fft{ size };
+		suite.add("registration/fft2d/2048", [fft] { fft.make(); }, [fft] {
+			fft->plan.forward(fft->re, fft->im);
+			do_not_optimize(fft->re.data());
+		}, with_bytes(options, num_pixels(size) * 2 * sizeof(float)));
+
+		const mme::bench::Fixture<DriftingFrames> drifting{ size };
+		auto make_drifting = [drifting] { drifting.make(); };
+		suite.add("registration/estimate_16_frames/2048", make_drifting, [drifting] {
+			do_not_optimize(drifting->correlator->estimate(drifting->views).data());
+		}, with_bytes(options, 16 * num_pixels(size) * sizeof(float)));
+		suite.add("registration/register_frames_16/2048", make_drifting, [drifting] {
+			do_not_optimize(mme::register_frames(drifting->views).data());
+		}, with_bytes(options, 16 * num_pixels(size) * sizeof(float)));
+	}
+
+	//16 planes of a Mueller image and where their filtered versions go
+	struct FilterPlanes {
+		explicit FilterPlanes(mme::ImageSize size) {
+			mme::bench::SimulatedCamera camera{ size };
+			std::vector<uint16_t> raw(num_pixels(size));
+			for (size_t i = 0; i < 16; i++) {
+				camera.take_fast_frame(raw);
+				planes.emplace_back(size);
+				mme::unpack_pf16(raw, planes.back().pixels());
+				filtered.emplace_back(size);
+			}
+			for (size_t i = 0; i < 16; i++) {
+				sources.push_back(std::as_const(planes[i]).as_view());
+				destinations.push_back(filtered[i].as_view());
+			}
+		}
+		std::vector<mme::Image<float>> planes;
+		std::vector<mme::Image<float>> filtered;
+		std::vector<mme::ImageView<const float>> sources;
+		std::vector<mme::ImageView<float>> destinations;
+	};
+
+	//all 16 planes of a Mueller image per call, the way the batch filters are meant to be used
+	void add_filters(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options) {
+		const mme::ImageSize size{ 1024, 1024 };
+		const mme::bench::Fixture<FilterPlanes> planes{ size };
+		auto make_planes = [planes] { planes.make(); };
+		const double bytes = 16 * num_pixels(size) * 2 * sizeof(float);
+		suite.add("filters/gaussian_sigma_1.5_16/1024", make_planes, [planes] {
+			mme::gaussian_filter(planes->sources, planes->destinations, 1.5);
+			do_not_optimize(planes->destinations.front().pixels().data());
+		}, with_bytes(options, bytes));
+		suite.add("filters/box_7x7_16/1024", make_planes, [planes] {
+			mme::box_filter(planes->sources, planes->destinations, 3);
+			do_not_optimize(planes->destinations.front().pixels().data());
+		}, with_bytes(options, bytes));
+		for (size_t radius : { 1, 2, 4 }) {
+			const size_t diameter = 2 * radius + 1;
+			suite.add(std::format("filters/median_{}x{}_16/1024", diameter, diameter), make_planes, [planes, radius] {
+				mme::median_filter(planes->sources, planes->destinations, radius);
+				do_not_optimize(planes->destinations.front().pixels().data());
+			}, with_bytes(options, bytes));
+		}
+	}
+
+	void add_image_view_access(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options) {
+		const mme::ImageSize size{ 2048, 2048 };
+		const mme::bench::Fixture<mme::Image<float>> image{ 1.0f, size };
+		auto make_image = [image] { image.make(); };
+		const double bytes = num_pixels(size) * sizeof(float);
+
+		suite.add("image_view/call_operator_row_major/2048", make_image, [image] {
+			auto view = image->as_view();
+			float sum = 0.0f;
+			for (size_t row = 0; row < view.num_rows(); row++) {
+				for (size_t col = 0; col < view.num_cols(); col++) {
+					sum += view(row, col);
+				}
+			}
+			do_not_optimize(sum);
+		}, with_bytes(options, bytes));
+
+		suite.add("image_view/call_operator_col_major/2048", make_image, [image] {
+			auto view = image->as_view();
+			float sum = 0.0f;
+			for (size_t col = 0; col < view.num_cols(); col++) {
+				for (size_t row = 0; row < view.num_rows(); row++) {
+					sum += view(row, col);
+				}
+			}
+			do_not_optimize(sum);
+		}, with_bytes(options, bytes));
+
+		suite.add("image_view/row_spans/2048", make_image, [image] {
+			auto view = image->as_view();
+			float sum = 0.0f;
+			for (size_t row = 0; row < view.num_rows(); row++) {
+				for (auto pixel : view.row(row)) {
+					sum += pixel;
+				}
+			}
+			do_not_optimize(sum);
+		}, with_bytes(options, bytes));
+
+		suite.add("image_view/sub_view_tiles_64_rows/2048", make_image, [image] {
+			auto view = image->as_view();
+			float sum = 0.0f;
+			constexpr size_t tile_rows = 64;
+			for (size_t row = 0; row < view.num_rows(); row += tile_rows) {
+				auto tile = view.sub_view(row, std::min(tile_rows, view.num_rows() - row));
+				for (auto pixel : tile.pixels()) {
+					sum += pixel;
+				}
+			}
+			do_not_optimize(sum);
+		}, with_bytes(options, bytes));
+	}
+
+	void add_image_allocation(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options) {
+		const mme::ImageSize size{ 2048, 2048 };
+
+		suite.add("image_allocation/zero_filled/2048", [size] {
+			mme::Image<float> image(0.0f, size);
+			do_not_optimize(image.pixels().data());
+		}, options);
+		suite.add("image_allocation/uninitialized/2048", [size] {
+			mme::Image<float> image(size);
+			do_not_optimize(image.pixels().data());
+		}, options);
+
+		//16 frames of a Mueller measurement from one arena, freed in a single release
+		const mme::bench::Fixture<mme::ImageArena> arena{ 16 * num_pixels(size) * sizeof(float) + 16 * mme::IMAGE_ALIGNMENT };
+		suite.add("image_allocation/arena_16_frames/2048", [arena] { arena.make(); }, [arena, size] {
+			{
+				std::vector<mme::Image<float>> frames;
+				frames.reserve(16);
+				for (size_t i = 0; i < 16; i++) {
+					frames.push_back(arena->make_image<float>(size));
+				}
+				do_not_optimize(frames.back().pixels().data());
+			}
+			arena->release();
+		}, options);
+	}
+
+	void add_adc_blocks(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options) {
+		for (size_t num_samples : { 1'000, 100'000 }) {
+			auto source = std::make_shared<std::vector<double>>(num_samples);
+			std::iota(source->begin(), source->end(), 0.0);
+			const double bytes = num_samples * sizeof(double);
+
+			//NidaqAdc::read_data allocates a fresh vector for every block
+			suite.add(std::format("adc/block_allocate_per_read/{}", num_samples), [source] {
+				std::vector<double> block(source->size());
+				std::copy(source->begin(), source->end(), block.begin());
+				do_not_optimize(std::accumulate(block.begin(), block.end(), 0.0));
+			}, with_bytes(options, bytes));
+
+			auto reused = std::make_shared<std::vector<double>>(num_samples);
+			suite.add(std::format("adc/block_reused_buffer/{}", num_samples), [source, reused] {
+				std::copy(source->begin(), source->end(), reused->begin());
+				do_not_optimize(std::accumulate(reused->begin(), reused->end(), 0.0));
+			}, with_bytes(options, bytes));
+		}
+	}
+
+#if defined(__unix__)
+	struct RingPublisher {
+		explicit RingPublisher(mme::ImageSize size)
+			: frame(uint16_t{ 1000 }, size)
+			, publisher("mme_bench_ring", 8, num_pixels(size) * sizeof(uint16_t))
+		{
+		}
+		mme::Image<uint16_t> frame;
+		mme::FrameRingPublisher publisher;
+	};
+
+	//the cost the acquisition thread pays per live frame, readers do not change it
+	void add_shared_ring(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options) {
+		const mme::ImageSize size{ 2048, 2048 };
+		const mme::bench::Fixture<RingPublisher> ring{ size };
+		suite.add("shared_ring/publish_raw/2048", [ring] { ring.make(); }, [ring] {
+			ring->publisher.publish(std::as_const(ring->frame).as_view());
+		}, with_bytes(options, num_pixels(size) * sizeof(uint16_t)));
+	}
+
+	struct EspConnection {
+		EspConnection() : driver(esp.port_name()) {}
+		mme::bench::SimulatedEsp esp;
+		mme::ESPDriver driver;
+	};
+
+	void add_esp(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options) {
+		const mme::bench::Fixture<EspConnection> connection;
+		auto make_connection = [connection] { connection.make(); };
+
+		suite.add("esp/request_round_trip", make_connection, [connection] {
+			do_not_optimize(connection->driver.request("1MD?\r\n"));
+		}, options);
+		suite.add("esp/move_absolute", make_connection, [connection] {
+			connection->driver.move_absolute(1, 10.0);
+		}, options);
+	}
+#endif
+
+	struct TileFiles {
+		TileFiles(mme::ImageSize size, std::filesystem::path input_file, std::filesystem::path output_file)
+			: reader(write_input(size, input_file))
+			, writer(output_file, size, 16)
+		{
+		}
+		static std::filesystem::path write_input(mme::ImageSize size, std::filesystem::path file) {
+			mme::NpyRowWriter writer(file, size, 16);
+			const mme::Image<float> plane(1.0f, size);
+			for (size_t i = 0; i < 16; i++) {
+				writer.write_rows(i, 0, plane.as_view());
+			}
+			return file;
+		}
+		mme::NpyRowReader reader;
+		mme::NpyRowWriter writer;
+	};
+
+	//a 16 plane stack through disk with tile buffers an eighth of its size, reads and writes overlap the scaling
+	void add_tile_streaming(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options, const std::filesystem::path& dir) {
+		const mme::ImageSize size{ 1024, 1024 };
+		const mme::bench::Fixture<TileFiles> files{ size, dir / "mme_bench_tiles_in.npy", dir / "mme_bench_tiles_out.npy" };
+		mme::TileStreamOptions tile_options;
+		tile_options.memory_budget = 16 * num_pixels(size) * sizeof(float) / 8;
+
+		suite.add("tiles/stream_16_planes/1024", [files] { files.make(); }, [files, tile_options] {
+			std::vector<mme::TileInput> inputs;
+			std::vector<mme::TileOutput> outputs;
+			for (size_t i = 0; i < 16; i++) {
+				inputs.push_back({ &files->reader, i });
+				outputs.push_back({ &files->writer, i });
+			}
+			mme::stream_tiles(inputs, outputs, [](const mme::Tile& tile) {
+				for (size_t i = 0; i < tile.inputs.size(); i++) {
+					auto output = tile.outputs[i];
+					std::ranges::transform(tile.inputs[i].pixels(), output.pixels().begin(), [](float pixel) { return 2.0f * pixel; });
+				}
+			}, tile_options);
+		}, with_bytes(options, 2 * 16 * num_pixels(size) * sizeof(float)));
+	}
+
+	void add_end_to_end(mme::bench::BenchmarkSuite& suite, const mme::bench::BenchmarkOptions& options, const std::filesystem::path& dir) {
+		const mme::ImageSize size{ 2048, 2048 };
+		const mme::bench::Fixture<mme::bench::SimulatedCamera> camera{ size };
+		const auto file = (dir / "mme_bench_end_to_end.npy").string();
+
+		suite.add("end_to_end/capture_process_save/2048", [camera] { camera.make(); }, [camera, size, file] {
+			std::vector<uint16_t> bytes(num_pixels(size), 0);
+			camera->take_fast_frame(bytes);
+			mme::Image<float> image(0.0f, size);
+			mme::unpack_pf16(bytes, image.pixels());
+
+			//normalize to the frame mean, standing in for per-frame processing
+			auto pixels = image.pixels();
+			const float mean = std::accumulate(pixels.begin(), pixels.end(), 0.0f) / pixels.size();
+			for (auto& pixel : pixels) {
+				pixel /= mean;
+			}
+			mme::save_to_numpy(file, image);
+		}, with_bytes(options, num_pixels(size) * (sizeof(uint16_t) + sizeof(float))));
+	}
+}
+
+int main(int argc, char* argv[]) {
+
+	try
+	{
+		const auto args = parse_arguments(argc, argv);
+
+		mme::bench::BenchmarkOptions options;
+		if (args.quick) {
+			options.num_samples = 5;
+			options.min_sample_time = std::chrono::milliseconds(5);
+		}
+		const auto dir = std::filesystem::temp_directory_path();
+
+		//opened before the run, so a bad path does not lose its results
+		std::ofstream json;
+		if (!args.json_file.empty()) {
+			json.open(args.json_file);
+			if (!json) {
+				throw std::runtime_error(std::format("Could not open {} for the benchmark results", args.json_file));
+			}
+		}
+
+		mme::bench::BenchmarkSuite suite;
+		add_pixel_conversion(suite, options);
+		add_save_to_numpy(suite, options, dir);
+		add_frame_codec(suite, options, dir);
+		add_registration(suite, options);
+		add_filters(suite, options);
+		add_image_view_access(suite, options);
+		add_image_allocation(suite, options);
+		add_adc_blocks(suite, options);
+#if defined(__unix__)
+		add_shared_ring(suite, options);
+		add_esp(suite, options);
+#endif
+		add_tile_streaming(suite, options, dir);
+		add_end_to_end(suite, options, dir);
+
+		auto results = suite.run(args.filter, std::cout);
+		if (json.is_open()) {
+			mme::bench::write_json(json, results);
+			json.close();
+			if (!json) {
+				throw std::runtime_error(std::format("Could not write the benchmark results to {}", args.json_file));
+			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
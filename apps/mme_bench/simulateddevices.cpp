@@ -0,0 +1,112 @@
+#include "simulateddevices.h"
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <stdlib.h>
+#endif
+
+mme::bench::SimulatedCamera::SimulatedCamera(ImageSize size, uint32_t seed)
+	: m_size(size)
+	, m_next_frame(0)
+{
+	constexpr size_t num_frames = 4;
+	std::mt19937 rng{ seed };
+	std::normal_distribution<float> noise{ 0.0f, 20.0f };
+	for (size_t frame = 0; frame < num_frames; frame++) {
+		std::vector<uint16_t> pixels(num_pixels(size));
+		for (size_t row = 0; row < size.height; row++) {
+			for (size_t col = 0; col < size.width; col++) {
+				//smooth gradient plus shot-like noise, clipped to 12 bits
+				const float signal = 500.0f + 3000.0f * (row + col) / (size.height + size.width);
+				const auto value = std::clamp(signal + noise(rng), 0.0f, 4095.0f);
+				pixels[row * size.width + col] = static_cast<uint16_t>(value) << 4;
+			}
+		}
+		m_frames.push_back(std::move(pixels));
+	}
+}
+
+mme::ImageSize mme::bench::SimulatedCamera::image_size() const
+{
+	return m_size;
+}
+
+void mme::bench::SimulatedCamera::take_fast_frame(std::span<uint16_t> buffer)
+{
+	const auto& frame = m_frames[m_next_frame];
+	std::copy(frame.begin(), frame.end(), buffer.begin());
+	m_next_frame = (m_next_frame + 1) % m_frames.size();
+}
+
+#if defined(__unix__)
+
+mme::bench::SimulatedEsp::SimulatedEsp()
+	: m_master_fd(posix_openpt(O_RDWR | O_NOCTTY))
+{
+	if (m_master_fd < 0 || grantpt(m_master_fd) != 0 || unlockpt(m_master_fd) != 0) {
+		throw std::runtime_error("Could not open a pseudo terminal for the simulated ESP");
+	}
+	m_port_name = ptsname(m_master_fd);
+
+	termios settings{};
+	tcgetattr(m_master_fd, &settings);
+	cfmakeraw(&settings);
+	tcsetattr(m_master_fd, TCSANOW, &settings);
+
+	m_thread = std::jthread([this](std::stop_token stop) { serve(stop); });
+}
+
+mme::bench::SimulatedEsp::~SimulatedEsp()
+{
+	m_thread.request_stop();
+	m_thread.join();
+	close(m_master_fd);
+}
+
+const std::string& mme::bench::SimulatedEsp::port_name() const
+{
+	return m_port_name;
+}
+
+void mme::bench::SimulatedEsp::serve(std::stop_token stop)
+{
+	std::string line;
+	char buffer[256];
+	while (!stop.stop_requested()) {
+		pollfd fd{ m_master_fd, POLLIN, 0 };
+		if (poll(&fd, 1, 50) <= 0 || !(fd.revents & POLLIN)) {
+			continue;
+		}
+		const auto num_read = read(m_master_fd, buffer, sizeof(buffer));
+		if (num_read <= 0) {
+			continue;
+		}
+		line.append(buffer, static_cast<size_t>(num_read));
+
+		size_t end;
+		while ((end = line.find("\r\n")) != std::string::npos) {
+			const auto cmd = line.substr(0, end);
+			line.erase(0, end + 2);
+			if (cmd.empty() || cmd.back() != '?') {
+				continue;
+			}
+			std::string reply = "0\r\n";
+			if (cmd.ends_with("MD?")) {
+				reply = "1\r\n";
+			}
+			else if (cmd == "VE?") {
+				reply = "ESP301 Version 3.0 simulated\r\n";
+			}
+			write(m_master_fd, reply.data(), reply.size());
+		}
+	}
+}
+
+#endif
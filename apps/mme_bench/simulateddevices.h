@@ -0,0 +1,47 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mme::bench {
+
+	//LUCAM_PF_16 style frames (12 bit data in the upper bits) from a fixed seed, so every run sees the same data
+	class SimulatedCamera {
+	public:
+		SimulatedCamera(ImageSize size, uint32_t seed = 1234);
+
+		ImageSize image_size() const;
+		void take_fast_frame(std::span<uint16_t> buffer); //copies the next of a few pregenerated frames
+
+	private:
+		ImageSize m_size;
+		std::vector<std::vector<uint16_t>> m_frames;
+		size_t m_next_frame;
+	};
+
+#if defined(__unix__)
+	//ESP301 on the other end of a pseudo terminal, so the real ESPDriver can be driven without a controller.
+	//Queries ending in '?' get a reply, motion is always reported done.
+	class SimulatedEsp {
+	public:
+		SimulatedEsp();
+		~SimulatedEsp();
+
+		SimulatedEsp(const SimulatedEsp& other) = delete;
+		SimulatedEsp& operator=(const SimulatedEsp& other) = delete;
+
+		const std::string& port_name() const;
+
+	private:
+		void serve(std::stop_token stop);
+
+	private:
+		int m_master_fd;
+		std::string m_port_name;
+		std::jthread m_thread;
+	};
+#endif
+
+} //namespace mme::bench
@@ -0,0 +1,184 @@
+#include "mme/sharding/shardcoordinator.h"
+#include "mme/polarimetry/reconstruction.h"
+#include "mme/polarimetry/decomposition.h"
+#include "mme/imaging/image.h"
+#include "npy.hpp"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <limits>
+
+//Processes a spectral run directory in parallel processes, one wavelength per work item:
+//  <input>/instrument.npy		float32 (2, 4, 4), generator W then analyzer A
+//  <input>/frames_0000.npy		float32 (16, height, width), analyzer major, one file per wavelength
+//and writes <output> as float32 (wavelengths, 4, height, width) with the diattenuation, retardance,
+//orientation and depolarization maps of every wavelength.
+
+namespace {
+
+	struct Arguments {
+		std::filesystem::path input;
+		std::filesystem::path output;
+		size_t num_wavelengths = 0;
+		size_t num_workers = 0;
+	};
+
+	constexpr size_t NUM_MAPS = 4;
+
+	Arguments parse_arguments(int argc, char* argv[]) {
+		Arguments args;
+		for (int i = 1; i < argc; i++) {
+			const std::string arg = argv[i];
+			if (arg == "--input" && i + 1 < argc) {
+				args.input = argv[++i];
+			}
+			else if (arg == "--output" && i + 1 < argc) {
+				args.output = argv[++i];
+			}
+			else if (arg == "--wavelengths" && i + 1 < argc) {
+				args.num_wavelengths = std::stoul(argv[++i]);
+			}
+			else if (arg == "--workers" && i + 1 < argc) {
+				args.num_workers = std::stoul(argv[++i]);
+			}
+			else {
+				throw std::invalid_argument(std::format("Unknown argument {}, usage: mme_shard --input dir --output file.npy --wavelengths n [--workers n]", arg));
+			}
+		}
+		if (args.input.empty() || args.output.empty() || args.num_wavelengths == 0) {
+			throw std::invalid_argument("usage: mme_shard --input dir --output file.npy --wavelengths n [--workers n]");
+		}
+		return args;
+	}
+
+	std::filesystem::path frames_file(const std::filesystem::path& input, size_t wavelength) {
+		return input / std::format("frames_{:04}.npy", wavelength);
+	}
+
+	std::vector<float> load_float_array(const std::filesystem::path& file, std::vector<unsigned long>& shape) {
+		bool fortran_order = false;
+		std::vector<float> data;
+		npy::LoadArrayFromNumpy(file.string(), shape, fortran_order, data);
+		if (fortran_order) {
+			throw std::runtime_error(std::format("{} is in Fortran order, only C order is supported", file.string()));
+		}
+		return data;
+	}
+
+	mme::InstrumentMatrices load_instrument(const std::filesystem::path& input) {
+		std::vector<unsigned long> shape;
+		const auto data = load_float_array(input / "instrument.npy", shape);
+		if (shape != std::vector<unsigned long>{ 2, 4, 4 }) {
+			throw std::runtime_error("instrument.npy must have shape (2, 4, 4)");
+		}
+		mme::InstrumentMatrices instrument;
+		std::copy_n(data.begin(), 16, instrument.generator.elements.begin());
+		std::copy_n(data.begin() + 16, 16, instrument.analyzer.elements.begin());
+		return instrument;
+	}
+
+	mme::ImageSize frame_size(const std::filesystem::path& input) {
+		std::vector<unsigned long> shape;
+		load_float_array(frames_file(input, 0), shape);
+		if (shape.size() != 3 || shape[0] != mme::MUELLER_ELEMENTS) {
+			throw std::runtime_error("Frame files must have shape (16, height, width)");
+		}
+		return { shape[1], shape[2] };
+	}
+
+	//npy version 1.0 header, padded so the data starts on a 64 byte boundary
+	size_t write_npy_header(std::ostream& out, const std::vector<size_t>& shape) {
+		std::string dims;
+		for (auto dim : shape) {
+			dims += std::format("{}, ", dim);
+		}
+		std::string dict = std::format("{{'descr': '<f4', 'fortran_order': False, 'shape': ({}), }}", dims.substr(0, dims.size() - 2));
+		const size_t unpadded = 10 + dict.size() + 1;
+		dict.append((64 - unpadded % 64) % 64, ' ');
+		dict += '\n';
+
+		const auto header_size = static_cast<uint16_t>(dict.size());
+		out.write("\x93NUMPY\x01\x00", 8);
+		const char size_bytes[2] = { static_cast<char>(header_size & 0xff), static_cast<char>(header_size >> 8) };
+		out.write(size_bytes, 2);
+		out.write(dict.data(), dict.size());
+		return 10 + dict.size();
+	}
+}
+
+int main(int argc, char* argv[]) {
+
+	try
+	{
+		const auto args = parse_arguments(argc, argv);
+		const auto instrument = load_instrument(args.input);
+		const auto size = frame_size(args.input);
+		const size_t map_bytes = num_pixels(size) * sizeof(float);
+
+		std::fstream output(args.output, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+		if (!output) {
+			throw std::runtime_error(std::format("Could not open {} for writing", args.output.string()));
+		}
+		const size_t data_offset = write_npy_header(output, { args.num_wavelengths, NUM_MAPS, size.height, size.width });
+
+		mme::ShardingOptions options;
+		options.num_workers = args.num_workers;
+		mme::ShardCoordinator coordinator(args.num_wavelengths, NUM_MAPS * map_bytes, options);
+
+		auto work = [&](size_t wavelength, std::span<std::byte> out) {
+			std::vector<unsigned long> shape;
+			const auto data = load_float_array(frames_file(args.input, wavelength), shape);
+			if (shape != std::vector<unsigned long>{ mme::MUELLER_ELEMENTS, size.height, size.width }) {
+				throw std::runtime_error(std::format("Unexpected frame shape for wavelength {}", wavelength));
+			}
+			std::vector<mme::ImageView<const float>> frames;
+			for (size_t k = 0; k < mme::MUELLER_ELEMENTS; k++) {
+				frames.emplace_back(std::span<const float>(data).subspan(k * num_pixels(size), num_pixels(size)), size);
+			}
+			const auto maps = mme::lu_chipman(mme::reconstruct_mueller(frames, instrument));
+
+			const mme::Image<float>* ordered[NUM_MAPS] = { &maps.diattenuation, &maps.retardance, &maps.orientation, &maps.depolarization };
+			for (size_t m = 0; m < NUM_MAPS; m++) {
+				std::memcpy(out.data() + m * map_bytes, ordered[m]->pixels().data(), map_bytes);
+			}
+		};
+
+		auto write_maps = [&](size_t wavelength, std::span<const std::byte> result) {
+			output.seekp(data_offset + wavelength * result.size());
+			output.write(reinterpret_cast<const char*>(result.data()), result.size());
+		};
+		auto merge = [&](size_t wavelength, std::span<const std::byte> result) {
+			write_maps(wavelength, result);
+			std::cout << "Wavelength " << wavelength << " done" << std::endl;
+		};
+
+		//failed wavelengths keep whatever the file held, NaN them so they cannot be mistaken for data
+		auto report = coordinator.run(work, merge);
+		const std::vector<float> missing(NUM_MAPS * num_pixels(size), std::numeric_limits<float>::quiet_NaN());
+		for (auto wavelength : report.failed_items) {
+			write_maps(wavelength, std::as_bytes(std::span(missing)));
+		}
+		output.close();
+		if (!output) {
+			throw std::runtime_error(std::format("Could not write {}", args.output.string()));
+		}
+
+		std::cout << std::format("Processed {} of {} wavelengths, {} worker restarts, {} steals", report.completed, args.num_wavelengths, report.restarts, report.steals) << std::endl;
+		if (!report.failed_items.empty()) {
+			std::cout << std::format("{} wavelengths failed and are NaN in the output", report.failed_items.size()) << std::endl;
+			return 2;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <Windows.h>
+//Stand-in for the Lumenera LuCam SDK header with the calls the driver uses, see lucamstub.h for the simulated camera
+
+#define LUCAM_FRAME_FORMAT_FLAGS_BINNING 0x0001
+#define LUCAM_PF_8 0
+#define LUCAM_PF_16 1
+#define LUCAM_SHUTTER_TYPE_GLOBAL 0
+#define LUCAM_SHUTTER_TYPE_ROLLING 1
+
+typedef struct LUCAM_FRAME_FORMAT {
+	ULONG xOffset;
+	ULONG yOffset;
+	ULONG width;
+	ULONG height;
+	ULONG pixelFormat;
+	union {
+		USHORT subSampleX;
+		USHORT binningX;
+	};
+	USHORT flagsX;
+	union {
+		USHORT subSampleY;
+		USHORT binningY;
+	};
+	USHORT flagsY;
+} LUCAM_FRAME_FORMAT;
+
+typedef struct LUCAM_SNAPSHOT {
+	FLOAT exposure; //ms
+	FLOAT gain;
+	FLOAT gainRed;
+	FLOAT gainBlue;
+	FLOAT gainGrn1;
+	FLOAT gainGrn2;
+	BOOL useStrobe;
+	FLOAT strobeDelay;
+	BOOL useHwTrigger;
+	FLOAT timeout; //ms
+	LUCAM_FRAME_FORMAT format;
+	ULONG shutterType;
+	FLOAT exposureDelay;
+	union {
+		BOOL bufferlastframe;
+		ULONG ulReserved1;
+	};
+	ULONG ulReserved2;
+	FLOAT flReserved1;
+	FLOAT flReserved2;
+} LUCAM_SNAPSHOT;
+
+extern "C" {
+	HANDLE LucamCameraOpen(ULONG index);
+	BOOL LucamCameraClose(HANDLE hCamera);
+	BOOL LucamEnableFastFrames(HANDLE hCamera, LUCAM_SNAPSHOT* pSettings);
+	BOOL LucamDisableFastFrames(HANDLE hCamera);
+	BOOL LucamTakeFastFrame(HANDLE hCamera, BYTE* pData);
+	BOOL LucamCancelTakeFastFrame(HANDLE hCamera);
+}
@@ -0,0 +1,140 @@
+#include "lucamapi.h"
+#include "lucamstub.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+	struct Camera {
+		std::mutex mutex;
+		std::condition_variable triggered;
+		lucam_stub::CameraSettings settings;
+		bool open = false;
+		bool fast_frames = false;
+		LUCAM_SNAPSHOT snapshot{};
+		uint64_t triggers = 0;
+		uint64_t cancels = 0;
+		std::vector<lucam_stub::ExposedFrame> frames;
+	};
+
+	Camera& camera() {
+		static Camera instance;
+		return instance;
+	}
+
+	std::chrono::duration<double, std::milli> ms(float value) {
+		return std::chrono::duration<double, std::milli>(value);
+	}
+}
+
+void lucam_stub::reset(const CameraSettings& settings)
+{
+	std::scoped_lock lock{ camera().mutex };
+	camera().settings = settings;
+	camera().triggers = 0;
+	camera().frames.clear();
+}
+
+void lucam_stub::trigger()
+{
+	std::scoped_lock lock{ camera().mutex };
+	camera().triggers++;
+	camera().triggered.notify_all();
+}
+
+std::vector<lucam_stub::ExposedFrame> lucam_stub::frames()
+{
+	std::scoped_lock lock{ camera().mutex };
+	return camera().frames;
+}
+
+uint16_t lucam_stub::frame_number(uint16_t pixel)
+{
+	return pixel >> 4;
+}
+
+HANDLE LucamCameraOpen(ULONG index)
+{
+	std::scoped_lock lock{ camera().mutex };
+	if (index != 1 || camera().open) {
+		return NULL;
+	}
+	camera().open = true;
+	return &camera();
+}
+
+BOOL LucamCameraClose(HANDLE hCamera)
+{
+	std::scoped_lock lock{ camera().mutex };
+	if (hCamera != &camera() || !camera().open) {
+		return FALSE;
+	}
+	camera().open = false;
+	camera().fast_frames = false;
+	return TRUE;
+}
+
+BOOL LucamEnableFastFrames(HANDLE hCamera, LUCAM_SNAPSHOT* pSettings)
+{
+	std::scoped_lock lock{ camera().mutex };
+	const auto& format = pSettings->format;
+	if (hCamera != &camera() || !camera().open || camera().fast_frames || format.pixelFormat != LUCAM_PF_16
+		|| format.binningX == 0 || format.binningY == 0 || !(pSettings->exposure > 0.0f)) {
+		return FALSE;
+	}
+	camera().snapshot = *pSettings;
+	camera().fast_frames = true;
+	return TRUE;
+}
+
+BOOL LucamDisableFastFrames(HANDLE hCamera)
+{
+	std::scoped_lock lock{ camera().mutex };
+	if (hCamera != &camera() || !camera().open) {
+		return FALSE;
+	}
+	camera().fast_frames = false;
+	return TRUE;
+}
+
+BOOL LucamTakeFastFrame(HANDLE hCamera, BYTE* pData)
+{
+	std::unique_lock lock{ camera().mutex };
+	auto& cam = camera();
+	if (hCamera != &cam || !cam.fast_frames) {
+		return FALSE;
+	}
+	const auto snapshot = cam.snapshot;
+	if (snapshot.useHwTrigger) {
+		const auto triggers = cam.triggers;
+		const auto cancels = cam.cancels;
+		cam.triggered.wait_for(lock, ms(snapshot.timeout), [&] { return cam.triggers != triggers || cam.cancels != cancels; });
+		if (cam.triggers == triggers) {
+			return FALSE;
+		}
+	}
+	const auto start = lucam_stub::Clock::now();
+	const auto end = start + std::chrono::duration_cast<lucam_stub::Clock::duration>(ms(snapshot.exposure));
+	const auto readout = std::chrono::duration_cast<lucam_stub::Clock::duration>(cam.settings.readout);
+	const auto number = static_cast<uint16_t>(cam.frames.size() % 4096);
+	cam.frames.push_back({ start, end });
+	lock.unlock();
+
+	std::this_thread::sleep_until(end + readout);
+	const size_t num_pixels = static_cast<size_t>(snapshot.format.width / snapshot.format.binningX) * (snapshot.format.height / snapshot.format.binningY);
+	std::fill_n(reinterpret_cast<uint16_t*>(pData), num_pixels, static_cast<uint16_t>(number << 4));
+	return TRUE;
+}
+
+BOOL LucamCancelTakeFastFrame(HANDLE hCamera)
+{
+	std::scoped_lock lock{ camera().mutex };
+	if (hCamera != &camera() || !camera().open) {
+		return FALSE;
+	}
+	camera().cancels++;
+	camera().triggered.notify_all();
+	return TRUE;
+}
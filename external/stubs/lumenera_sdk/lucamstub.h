@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+//The camera behind the stub LuCam SDK. A fast frame exposes from the call for the snapshot exposure, or from the
+//next trigger() with useHwTrigger, and is read out after it. Waiting for the trigger ends without a frame after the
+//snapshot timeout or on LucamCancelTakeFastFrame. Every pixel holds the frame number in the upper 12 bits.
+
+namespace lucam_stub {
+
+	using Clock = std::chrono::steady_clock;
+
+	struct CameraSettings {
+		std::chrono::duration<double> readout{ 0.005 };
+	};
+
+	struct ExposedFrame {
+		Clock::time_point start;
+		Clock::time_point end;
+	};
+
+	void reset(const CameraSettings& settings);
+	void trigger();
+	//every frame taken since the reset, the frame number is the index
+	std::vector<ExposedFrame> frames();
+	uint16_t frame_number(uint16_t pixel);
+
+}
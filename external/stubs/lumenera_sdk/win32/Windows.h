@@ -0,0 +1,20 @@
+#pragma once
+//The few Win32 types the Lucam API is declared with, for building against the stub SDK off Windows
+
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned char UCHAR;
+typedef unsigned short USHORT;
+typedef unsigned long ULONG;
+typedef float FLOAT;
+typedef void* HANDLE;
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef NULL
+#define NULL 0
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+//Stand-in for the Thorlabs FWxC SDK header with the calls the driver uses, see fwxcstub.h for the simulated wheel
+
+extern "C" {
+	int List(unsigned char* serialNo, int length);
+	int Open(char* serialNo, int nBaud, int timeout);
+	int IsOpen(char* serialNo);
+	int Close(int hdl);
+	int SetPosition(int hdl, int pos);
+	int GetPosition(int hdl, int* pos);
+	int GetPositionCount(int hdl, int* poscount);
+}
@@ -0,0 +1,106 @@
+#include "FWxCCommand.h"
+#include "fwxcstub.h"
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+	constexpr int STUB_HANDLE = 1;
+	constexpr char STUB_DEVICES[] = "FWV5KU2V,FW102C";
+
+	struct Wheel {
+		std::mutex mutex;
+		fwxc_stub::WheelSettings settings;
+		std::vector<int> moves;
+		int num_calls = 0;
+	};
+
+	Wheel& wheel() {
+		static Wheel instance;
+		return instance;
+	}
+}
+
+void fwxc_stub::reset(const WheelSettings& settings)
+{
+	std::scoped_lock lock{ wheel().mutex };
+	wheel().settings = settings;
+	wheel().moves.clear();
+	wheel().num_calls = 0;
+}
+
+int fwxc_stub::position()
+{
+	std::scoped_lock lock{ wheel().mutex };
+	return wheel().settings.position;
+}
+
+std::vector<int> fwxc_stub::moves()
+{
+	std::scoped_lock lock{ wheel().mutex };
+	return wheel().moves;
+}
+
+int List(unsigned char* serialNo, int length)
+{
+	if (length < static_cast<int>(sizeof(STUB_DEVICES))) {
+		return -1;
+	}
+	std::memcpy(serialNo, STUB_DEVICES, sizeof(STUB_DEVICES));
+	return 1;
+}
+
+int Open(char*, int, int)
+{
+	return STUB_HANDLE;
+}
+
+int IsOpen(char*)
+{
+	return 1;
+}
+
+int Close(int)
+{
+	return 0;
+}
+
+int SetPosition(int hdl, int pos)
+{
+	int slots = 0;
+	std::chrono::duration<double> travel{ 0.0 };
+	{
+		std::scoped_lock lock{ wheel().mutex };
+		auto& settings = wheel().settings;
+		if (hdl != STUB_HANDLE || pos < 1 || pos > settings.num_positions) {
+			return -1;
+		}
+		if (++wheel().num_calls == settings.failing_move) {
+			return -1;
+		}
+		const int forward = (pos - settings.position + settings.num_positions) % settings.num_positions;
+		const int backward = (settings.num_positions - forward) % settings.num_positions;
+		slots = forward < backward ? forward : -backward;
+		travel = settings.per_slot * std::abs(slots);
+		settings.position = pos;
+		wheel().moves.push_back(slots);
+	}
+	std::this_thread::sleep_for(travel);
+	return 0;
+}
+
+int GetPosition(int hdl, int* pos)
+{
+	std::scoped_lock lock{ wheel().mutex };
+	*pos = wheel().settings.position;
+	return hdl == STUB_HANDLE ? 0 : -1;
+}
+
+int GetPositionCount(int hdl, int* poscount)
+{
+	std::scoped_lock lock{ wheel().mutex };
+	*poscount = wheel().settings.num_positions;
+	return hdl == STUB_HANDLE ? 0 : -1;
+}
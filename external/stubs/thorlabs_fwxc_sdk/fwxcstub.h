@@ -0,0 +1,22 @@
+#pragma once
+#include <chrono>
+#include <vector>
+
+//The filter wheel behind the stub FWxC SDK. SetPosition blocks for the travel time and goes the shorter way round,
+//a half turn always goes backward so the direction of those is only what the driver makes it.
+
+namespace fwxc_stub {
+
+	struct WheelSettings {
+		int num_positions = 6;
+		int position = 1;
+		std::chrono::duration<double> per_slot{ 0.02 };
+		int failing_move = 0; //the SetPosition call since the reset, counting from 1, that fails without moving
+	};
+
+	void reset(const WheelSettings& settings);
+	int position();
+	//slots turned by every SetPosition since the reset, positive towards higher positions
+	std::vector<int> moves();
+
+}
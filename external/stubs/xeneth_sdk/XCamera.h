@@ -0,0 +1,44 @@
+#pragma once
+//Stand-in for the Xeneth SDK header with the calls the driver uses, see xenethstub.h for the simulated camera
+
+typedef int XCHANDLE;
+typedef unsigned long ErrCode;
+typedef unsigned long dword;
+typedef int boole;
+typedef void* XStatus;
+
+enum {
+	I_OK = 0,
+	E_BUG = 10000,
+	E_NOINIT = 10001,
+	E_NOT_STARTED = 10011,
+	E_TIMEOUT = 10022
+};
+
+enum FrameType {
+	FT_NATIVE = 0,
+	FT_8_BPP_GRAY,
+	FT_16_BPP_GRAY,
+	FT_32_BPP_GRAY
+};
+#define FT_16_BPP_GREY FT_16_BPP_GRAY
+
+enum {
+	XGF_Blocking = 1,
+	XGF_NoConversion = 2
+};
+
+extern "C" {
+	XCHANDLE XC_OpenCamera(const char* pCameraName = "cam://default", XStatus pCallBack = 0, void* pUser = 0);
+	void XC_CloseCamera(XCHANDLE hnd);
+	boole XC_IsInitialised(XCHANDLE h);
+	boole XC_IsCapturing(XCHANDLE h);
+	ErrCode XC_StartCapture(XCHANDLE h);
+	ErrCode XC_StopCapture(XCHANDLE h);
+	dword XC_GetWidth(XCHANDLE h);
+	dword XC_GetHeight(XCHANDLE h);
+	ErrCode XC_GetFrame(XCHANDLE h, FrameType type, unsigned long ulFlags, void* buffer, unsigned int size);
+	ErrCode XC_GetPropertyValueF(XCHANDLE h, const char* pPrp, double* pValue);
+	ErrCode XC_SetPropertyValueF(XCHANDLE h, const char* pPrp, double dValue, const char* pUnit);
+	ErrCode XC_ErrorToString(ErrCode e, char* dst, int len);
+}
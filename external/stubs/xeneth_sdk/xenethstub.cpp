@@ -0,0 +1,185 @@
+#include "XCamera.h"
+#include "xenethstub.h"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+	constexpr XCHANDLE STUB_HANDLE = 1;
+
+	struct Camera {
+		std::mutex mutex;
+		xeneth_stub::CameraSettings settings;
+		bool open = false;
+		bool capturing = false;
+		xeneth_stub::Clock::time_point capture_start;
+		xeneth_stub::Clock::duration frame_period{};
+		int64_t next_frame = 0;
+		std::vector<std::pair<uint16_t, xeneth_stub::ExposedFrame>> frames;
+	};
+
+	Camera& camera() {
+		static Camera instance;
+		return instance;
+	}
+
+	bool valid(XCHANDLE h) {
+		return h == STUB_HANDLE && camera().open;
+	}
+
+	//the period changes with the integration time, frames restart from now
+	void restart_frames(Camera& cam) {
+		const std::chrono::duration<double, std::micro> integration{ cam.settings.integration_time_us };
+		cam.frame_period = std::chrono::duration_cast<xeneth_stub::Clock::duration>(integration + cam.settings.readout);
+		cam.capture_start = xeneth_stub::Clock::now();
+		cam.next_frame = 0;
+	}
+}
+
+void xeneth_stub::reset(const CameraSettings& settings)
+{
+	std::scoped_lock lock{ camera().mutex };
+	camera().settings = settings;
+	camera().frames.clear();
+	restart_frames(camera());
+}
+
+std::vector<std::pair<uint16_t, xeneth_stub::ExposedFrame>> xeneth_stub::frames()
+{
+	std::scoped_lock lock{ camera().mutex };
+	return camera().frames;
+}
+
+XCHANDLE XC_OpenCamera(const char* pCameraName, XStatus, void*)
+{
+	std::scoped_lock lock{ camera().mutex };
+	if (camera().open || !std::string_view(pCameraName).starts_with("cam://")) {
+		return 0;
+	}
+	camera().open = true;
+	return STUB_HANDLE;
+}
+
+void XC_CloseCamera(XCHANDLE hnd)
+{
+	std::scoped_lock lock{ camera().mutex };
+	if (valid(hnd)) {
+		camera().open = false;
+		camera().capturing = false;
+	}
+}
+
+boole XC_IsInitialised(XCHANDLE h)
+{
+	std::scoped_lock lock{ camera().mutex };
+	return valid(h);
+}
+
+boole XC_IsCapturing(XCHANDLE h)
+{
+	std::scoped_lock lock{ camera().mutex };
+	return valid(h) && camera().capturing;
+}
+
+ErrCode XC_StartCapture(XCHANDLE h)
+{
+	std::scoped_lock lock{ camera().mutex };
+	if (!valid(h)) {
+		return E_NOINIT;
+	}
+	camera().capturing = true;
+	restart_frames(camera());
+	return I_OK;
+}
+
+ErrCode XC_StopCapture(XCHANDLE h)
+{
+	std::scoped_lock lock{ camera().mutex };
+	if (!valid(h)) {
+		return E_NOINIT;
+	}
+	camera().capturing = false;
+	return I_OK;
+}
+
+dword XC_GetWidth(XCHANDLE)
+{
+	std::scoped_lock lock{ camera().mutex };
+	return camera().settings.width;
+}
+
+dword XC_GetHeight(XCHANDLE)
+{
+	std::scoped_lock lock{ camera().mutex };
+	return camera().settings.height;
+}
+
+ErrCode XC_GetFrame(XCHANDLE h, FrameType type, unsigned long ulFlags, void* buffer, unsigned int size)
+{
+	std::unique_lock lock{ camera().mutex };
+	auto& cam = camera();
+	if (!valid(h)) {
+		return E_NOINIT;
+	}
+	if (!cam.capturing) {
+		return E_NOT_STARTED;
+	}
+	const size_t num_pixels = static_cast<size_t>(cam.settings.width) * cam.settings.height;
+	if (type != FT_16_BPP_GRAY || size != num_pixels * sizeof(uint16_t)) {
+		return E_BUG;
+	}
+	//frame n is read out at start + (n + 1) * period
+	const auto now = xeneth_stub::Clock::now();
+	const int64_t latest_done = (now - cam.capture_start) / cam.frame_period - 1;
+	const int64_t frame = std::max(cam.next_frame, latest_done);
+	const auto start = cam.capture_start + frame * cam.frame_period;
+	const auto readout = std::chrono::duration_cast<xeneth_stub::Clock::duration>(cam.settings.readout);
+	const auto done = start + cam.frame_period;
+	if (done > now && !(ulFlags & XGF_Blocking)) {
+		return E_TIMEOUT;
+	}
+	const auto number = static_cast<uint16_t>(frame);
+	cam.next_frame = frame + 1;
+	cam.frames.push_back({ number, { start, done - readout } });
+	lock.unlock();
+
+	std::this_thread::sleep_until(done);
+	std::fill_n(static_cast<uint16_t*>(buffer), num_pixels, number);
+	return I_OK;
+}
+
+ErrCode XC_GetPropertyValueF(XCHANDLE h, const char* pPrp, double* pValue)
+{
+	std::scoped_lock lock{ camera().mutex };
+	if (!valid(h)) {
+		return E_NOINIT;
+	}
+	if (std::string_view(pPrp) != "IntegrationTime") {
+		return E_BUG;
+	}
+	*pValue = camera().settings.integration_time_us;
+	return I_OK;
+}
+
+ErrCode XC_SetPropertyValueF(XCHANDLE h, const char* pPrp, double dValue, const char*)
+{
+	std::scoped_lock lock{ camera().mutex };
+	if (!valid(h)) {
+		return E_NOINIT;
+	}
+	if (std::string_view(pPrp) != "IntegrationTime" || !(dValue > 0.0)) {
+		return E_BUG;
+	}
+	camera().settings.integration_time_us = dValue;
+	restart_frames(camera());
+	return I_OK;
+}
+
+ErrCode XC_ErrorToString(ErrCode e, char* dst, int len)
+{
+	std::snprintf(dst, static_cast<size_t>(len), "stub Xeneth error %lu", e);
+	return I_OK;
+}
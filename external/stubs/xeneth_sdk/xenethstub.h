@@ -0,0 +1,30 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+//The camera behind the stub Xeneth SDK. Once capturing it free runs, frame n exposing for the IntegrationTime
+//from start + n * (IntegrationTime + readout). A blocking XC_GetFrame returns the next frame not returned yet,
+//or the latest one when the caller fell behind. Every pixel holds the frame number.
+
+namespace xeneth_stub {
+
+	using Clock = std::chrono::steady_clock;
+
+	struct CameraSettings {
+		uint32_t width = 640;
+		uint32_t height = 512;
+		double integration_time_us = 1000.0;
+		std::chrono::duration<double> readout{ 0.002 };
+	};
+
+	struct ExposedFrame {
+		Clock::time_point start;
+		Clock::time_point end;
+	};
+
+	void reset(const CameraSettings& settings);
+	//the exposure of every frame returned since the reset, in order
+	std::vector<std::pair<uint16_t, ExposedFrame>> frames();
+
+}
@@ -6,10 +6,12 @@
 #include <format>
 #include <assert.h>
 #include <utility>
+#include <algorithm>
+#include "mme/tracing/trace.h"
 
 
 mme::Fwxc::Fwxc()
-	:m_handle(0), m_num_filters(0), m_current_position(0)
+	:m_handle(0), m_num_filters(0), m_current_position(0), m_last_rotation(Rotation::None)
 {
 	auto connected_devices = list_connected_devices();
 	if (!connected_devices) {
@@ -30,7 +32,7 @@ mme::Fwxc::Fwxc()
 }
 
 mme::Fwxc::Fwxc(std::string_view serial_num)
-	: m_handle(0), m_num_filters(0), m_current_position(0)
+	: m_handle(0), m_num_filters(0), m_current_position(0), m_last_rotation(Rotation::None)
 {
 	auto possible_handle = connect_to_filter_wheel(serial_num);
 	if (!possible_handle) {
@@ -52,6 +54,7 @@ mme::Fwxc::Fwxc(Fwxc&& other) noexcept
 	m_handle = std::exchange(other.m_handle, -1);
 	m_num_filters = std::exchange(other.m_num_filters, 0);
 	m_current_position = std::exchange(other.m_current_position, 0);
+	m_last_rotation = std::exchange(other.m_last_rotation, Rotation::None);
 }
 
 mme::Fwxc& mme::Fwxc::operator=(Fwxc&& other) noexcept
@@ -60,6 +63,7 @@ mme::Fwxc& mme::Fwxc::operator=(Fwxc&& other) noexcept
 		m_handle = std::exchange(other.m_handle, -1);
 		m_num_filters = std::exchange(other.m_num_filters, 0);
 		m_current_position = std::exchange(other.m_current_position, 0);
+		m_last_rotation = std::exchange(other.m_last_rotation, Rotation::None);
 	}
 	return *this;
 }
@@ -74,14 +78,40 @@ size_t mme::Fwxc::current_filter_position() const
 	return m_current_position;
 }
 
+mme::Rotation mme::Fwxc::last_rotation() const
+{
+	return m_last_rotation;
+}
+
 bool mme::Fwxc::change_filter_position(size_t position)
 {
-	assert(position <= m_num_filters);
-	auto err_code = SetPosition(m_handle, position);
-	if (err_code < 0) {
-		return false;
+	MME_TRACE_SCOPE("Fwxc::change_filter_position");
+	assert(position >= 1 && position <= m_num_filters);
+	if (position == m_current_position) {
+		return true;
 	}
-	m_current_position = position;
+	auto move = shortest_filter_move(m_current_position, position, m_num_filters);
+	//SetPosition leaves the way round to the wheel, which is only unambiguous for less than half a turn,
+	//so longer moves are split at waypoints in the direction of the shortest path
+	const size_t max_leg = std::max<size_t>((m_num_filters - 1) / 2, 1);
+	size_t travelled = 0;
+	while (travelled < move.slots) {
+		travelled += std::min(max_leg, move.slots - travelled);
+		const size_t offset = move.rotation == Rotation::Forward ? travelled : m_num_filters - travelled;
+		const size_t waypoint = (move.from - 1 + offset) % m_num_filters + 1;
+		auto err_code = SetPosition(m_handle, static_cast<int>(waypoint));
+		if (err_code < 0) {
+			//the wheel may have stopped anywhere on the way
+			try {
+				m_current_position = read_current_position();
+			}
+			catch (const std::runtime_error&) {
+			}
+			return false;
+		}
+		m_current_position = waypoint;
+	}
+	m_last_rotation = move.rotation;
 	return true;
 }
 
@@ -128,6 +158,38 @@ void mme::Fwxc::collect_device_info()
 	m_current_position = read_current_position();
 }
 
+mme::FilterMove mme::shortest_filter_move(size_t from, size_t to, size_t num_filters)
+{
+	assert(num_filters > 0);
+	if (from == to) {
+		return FilterMove{ from, to, 0, Rotation::None };
+	}
+	const size_t forward = (to + num_filters - from) % num_filters;
+	const size_t backward = num_filters - forward;
+	if (forward <= backward) {
+		return FilterMove{ from, to, forward, Rotation::Forward };
+	}
+	return FilterMove{ from, to, backward, Rotation::Backward };
+}
+
+std::vector<size_t> mme::shortest_visit_order(size_t start, std::span<const size_t> positions, size_t num_filters)
+{
+	//greedy nearest neighbour around the wheel, starting from the current slot
+	std::vector<size_t> remaining{ positions.begin(), positions.end() };
+	std::vector<size_t> order;
+	order.reserve(remaining.size());
+	size_t current = start;
+	while (!remaining.empty()) {
+		auto nearest = std::ranges::min_element(remaining, {}, [&](size_t pos) {
+			return shortest_filter_move(current, pos, num_filters).slots;
+		});
+		current = *nearest;
+		order.push_back(current);
+		remaining.erase(nearest);
+	}
+	return order;
+}
+
 std::optional<std::vector<std::string>> mme::list_connected_devices()
 {
 	//TODO: the List function returns pairs of "sn,other" not "sn1, sn2, sn3"
@@ -0,0 +1,135 @@
+#include "mme/fwxc/fwxcqueue.h"
+#include <utility>
+#include <cassert>
+
+mme::FwxcQueue::FwxcQueue(Fwxc filter_wheel, FilterTiming timing)
+	: m_filter_wheel(std::move(filter_wheel))
+	, m_timing(timing)
+	, m_num_filters(m_filter_wheel.num_filters())
+	, m_current_position(m_filter_wheel.current_filter_position())
+	, m_last_rotation(m_filter_wheel.last_rotation())
+	, m_worker([this](std::stop_token stop) { run(stop); })
+{
+}
+
+mme::FwxcQueue::~FwxcQueue()
+{
+	//the move in flight is allowed to finish, queued moves are cancelled
+	std::deque<PendingMove> cancelled;
+	{
+		std::scoped_lock lock{ m_mutex };
+		cancelled.swap(m_pending);
+	}
+	for (auto& move : cancelled) {
+		move.done->set_value(false);
+	}
+	m_worker.request_stop();
+}
+
+mme::FilterChange mme::FwxcQueue::change_filter_position(size_t position)
+{
+	assert(position >= 1 && position <= m_num_filters);
+	std::scoped_lock lock{ m_mutex };
+	//a request for the position the wheel is already heading to shares that move
+	if (!m_pending.empty() && m_pending.back().position == position) {
+		return m_pending.back().handle;
+	}
+	if (m_pending.empty() && m_in_flight && m_in_flight->position == position) {
+		return m_in_flight->handle;
+	}
+	auto done = std::make_shared<std::promise<bool>>();
+	FilterChange handle = done->get_future().share();
+	m_pending.push_back(PendingMove{ position, std::move(done), handle });
+	m_queue_changed.notify_one();
+	return handle;
+}
+
+void mme::FwxcQueue::wait_until_idle()
+{
+	std::unique_lock lock{ m_mutex };
+	m_idle.wait(lock, [this] { return m_pending.empty() && !m_in_flight; });
+}
+
+size_t mme::FwxcQueue::num_filters() const
+{
+	return m_num_filters;
+}
+
+size_t mme::FwxcQueue::current_filter_position() const
+{
+	return m_current_position;
+}
+
+size_t mme::FwxcQueue::target_filter_position() const
+{
+	std::scoped_lock lock{ m_mutex };
+	if (!m_pending.empty()) {
+		return m_pending.back().position;
+	}
+	if (m_in_flight) {
+		return m_in_flight->position;
+	}
+	return m_current_position;
+}
+
+mme::Rotation mme::FwxcQueue::last_rotation() const
+{
+	return m_last_rotation;
+}
+
+std::chrono::duration<double> mme::FwxcQueue::estimated_travel_time(size_t from, size_t to) const
+{
+	auto move = shortest_filter_move(from, to, m_num_filters);
+	if (move.slots == 0) {
+		return std::chrono::duration<double>::zero();
+	}
+	return static_cast<double>(move.slots) * m_timing.per_slot + m_timing.settle;
+}
+
+std::chrono::duration<double> mme::FwxcQueue::estimated_time_until_idle() const
+{
+	std::scoped_lock lock{ m_mutex };
+	auto total = std::chrono::duration<double>::zero();
+	size_t position = m_current_position;
+	if (m_in_flight) {
+		total += estimated_travel_time(position, m_in_flight->position);
+		position = m_in_flight->position;
+	}
+	for (const auto& move : m_pending) {
+		total += estimated_travel_time(position, move.position);
+		position = move.position;
+	}
+	return total;
+}
+
+void mme::FwxcQueue::run(std::stop_token stop)
+{
+	while (true) {
+		{
+			std::unique_lock lock{ m_mutex };
+			m_queue_changed.wait(lock, stop, [this] { return !m_pending.empty(); });
+			if (m_pending.empty()) {
+				return; //stop requested
+			}
+			m_in_flight = std::move(m_pending.front());
+			m_pending.pop_front();
+		}
+
+		const bool ok = m_filter_wheel.change_filter_position(m_in_flight->position);
+		//a failed move can still have turned the wheel, the next one plans from where it stopped
+		m_current_position = m_filter_wheel.current_filter_position();
+		if (ok) {
+			m_last_rotation = m_filter_wheel.last_rotation();
+		}
+
+		auto done = std::move(m_in_flight->done);
+		{
+			std::scoped_lock lock{ m_mutex };
+			m_in_flight.reset();
+			if (m_pending.empty()) {
+				m_idle.notify_all();
+			}
+		}
+		done->set_value(ok);
+	}
+}
@@ -3,9 +3,27 @@
 #include <string>
 #include <vector>
 #include <optional>
+#include <span>
 
 namespace mme {
 
+	enum class Rotation {
+		None,
+		Forward,
+		Backward
+	};
+
+	struct FilterMove {
+		size_t from;
+		size_t to;
+		size_t slots;
+		Rotation rotation;
+	};
+
+	//positions are 1-based as reported by the FWxC SDK
+	FilterMove shortest_filter_move(size_t from, size_t to, size_t num_filters);
+	std::vector<size_t> shortest_visit_order(size_t start, std::span<const size_t> positions, size_t num_filters);
+
 	class Fwxc {
 
 	public:
@@ -21,6 +39,8 @@ namespace mme {
 
 		size_t num_filters() const;
 		size_t current_filter_position() const;
+		Rotation last_rotation() const;
+		//turns the shorter way round, forward for half a turn
 		[[nodiscard]] bool change_filter_position(size_t position);
 
 	private:
@@ -33,7 +53,7 @@ namespace mme {
 		int m_handle;
 		size_t m_num_filters;
 		size_t m_current_position;
-		
+		Rotation m_last_rotation;
 	};
 
 	std::optional<std::vector<std::string>> list_connected_devices();
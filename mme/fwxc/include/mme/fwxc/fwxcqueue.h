@@ -0,0 +1,69 @@
+#pragma once
+#include "mme/fwxc/fwxc.h"
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <chrono>
+
+namespace mme {
+
+	//completion handle for a queued filter change, resolves to false if the move failed or was cancelled
+	using FilterChange = std::shared_future<bool>;
+
+	struct FilterTiming {
+		std::chrono::duration<double> per_slot{ 0.5 };
+		std::chrono::duration<double> settle{ 0.0 };
+	};
+
+	class FwxcQueue {
+	public:
+		FwxcQueue(Fwxc filter_wheel, FilterTiming timing = FilterTiming{});
+		~FwxcQueue();
+
+		//not copyable or movable, the worker thread refers to this object
+		FwxcQueue(const FwxcQueue& other) = delete;
+		FwxcQueue& operator=(const FwxcQueue& other) = delete;
+		FwxcQueue(FwxcQueue&& other) = delete;
+		FwxcQueue& operator=(FwxcQueue&& other) = delete;
+
+		//returns immediately, the move starts as soon as the moves queued before it are done.
+		//Use it to prefetch the next filter while the camera exposes on the current one,
+		//but only when the filter wheel is outside the imaging path during the exposure.
+		FilterChange change_filter_position(size_t position);
+		void wait_until_idle();
+
+		size_t num_filters() const;
+		size_t current_filter_position() const;
+		size_t target_filter_position() const;
+		Rotation last_rotation() const;
+		std::chrono::duration<double> estimated_travel_time(size_t from, size_t to) const;
+		std::chrono::duration<double> estimated_time_until_idle() const;
+
+	private:
+		struct PendingMove {
+			size_t position;
+			std::shared_ptr<std::promise<bool>> done;
+			FilterChange handle;
+		};
+		void run(std::stop_token stop);
+
+	private:
+		Fwxc m_filter_wheel;
+		FilterTiming m_timing;
+		const size_t m_num_filters;
+
+		mutable std::mutex m_mutex;
+		std::condition_variable_any m_queue_changed;
+		std::condition_variable m_idle;
+		std::deque<PendingMove> m_pending;
+		std::optional<PendingMove> m_in_flight;
+		std::atomic<size_t> m_current_position;
+		std::atomic<Rotation> m_last_rotation;
+
+		std::jthread m_worker;
+	};
+
+} //namespace mme
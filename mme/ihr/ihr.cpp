@@ -1,13 +1,144 @@
 #include "mme/ihr/ihr.h"
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <initializer_list>
+#include <chrono>
+#include <thread>
+#include <format>
+#include <stdexcept>
+#include <Windows.h>
 #include "combaseapi.h"
 
+static_assert(mme::Monochromator<mme::Ihr550>);
+
+namespace {
+
+	//the JY SDK registers the monochromator as an automation object, its methods are called by name
+	constexpr wchar_t MONO_PROG_ID[] = L"JYMono.Monochromator";
+	constexpr auto BUSY_POLL_INTERVAL = std::chrono::milliseconds(20);
+
+	VARIANT double_arg(double value) {
+		VARIANT arg;
+		VariantInit(&arg);
+		arg.vt = VT_R8;
+		arg.dblVal = value;
+		return arg;
+	}
+
+	VARIANT bool_arg(bool value) {
+		VARIANT arg;
+		VariantInit(&arg);
+		arg.vt = VT_BOOL;
+		arg.boolVal = value ? VARIANT_TRUE : VARIANT_FALSE;
+		return arg;
+	}
+
+	//args in the order of the method signature. The result must be cleared by the caller.
+	VARIANT invoke(IDispatch* mono, std::string_view name, WORD flags, std::initializer_list<VARIANT> args = {}) {
+		if (mono == nullptr) {
+			throw std::runtime_error("Monochromator is not connected");
+		}
+		std::wstring wide_name(name.begin(), name.end());
+		LPOLESTR names[] = { wide_name.data() };
+		DISPID id;
+		if (FAILED(mono->GetIDsOfNames(IID_NULL, names, 1, LOCALE_USER_DEFAULT, &id))) {
+			throw std::runtime_error(std::format("Monochromator has no {}", name));
+		}
+		//IDispatch takes arguments last to first
+		std::vector<VARIANT> reversed(std::rbegin(args), std::rend(args));
+		DISPID put_id = DISPID_PROPERTYPUT;
+		DISPPARAMS params{ reversed.data(), nullptr, static_cast<UINT>(reversed.size()), 0 };
+		if (flags == DISPATCH_PROPERTYPUT) {
+			params.rgdispidNamedArgs = &put_id;
+			params.cNamedArgs = 1;
+		}
+		VARIANT result;
+		VariantInit(&result);
+		EXCEPINFO exception{};
+		auto hr = mono->Invoke(id, IID_NULL, LOCALE_USER_DEFAULT, flags, &params, &result, &exception, nullptr);
+		SysFreeString(exception.bstrSource);
+		SysFreeString(exception.bstrDescription);
+		SysFreeString(exception.bstrHelpFile);
+		if (FAILED(hr)) {
+			throw std::runtime_error(std::format("Monochromator {} failed with HRESULT {:#010x}", name, static_cast<unsigned long>(hr)));
+		}
+		return result;
+	}
+
+	void call(IDispatch* mono, std::string_view name, std::initializer_list<VARIANT> args = {}) {
+		VARIANT result = invoke(mono, name, DISPATCH_METHOD, args);
+		VariantClear(&result);
+	}
+
+	template<VARTYPE Type>
+	VARIANT query(IDispatch* mono, std::string_view name) {
+		VARIANT result = invoke(mono, name, DISPATCH_METHOD | DISPATCH_PROPERTYGET);
+		if (FAILED(VariantChangeType(&result, &result, 0, Type))) {
+			VariantClear(&result);
+			throw std::runtime_error(std::format("Monochromator {} returned an unexpected type", name));
+		}
+		return result;
+	}
+
+	IDispatch* create_mono() {
+		CLSID clsid;
+		if (FAILED(CLSIDFromProgID(MONO_PROG_ID, &clsid))) {
+			throw std::runtime_error("The JY monochromator COM object is not registered, is the Horiba SDK installed?");
+		}
+		IDispatch* mono = nullptr;
+		if (FAILED(CoCreateInstance(clsid, nullptr, CLSCTX_ALL, IID_IDispatch, reinterpret_cast<void**>(&mono)))) {
+			throw std::runtime_error("Could not create the JY monochromator COM object");
+		}
+		return mono;
+	}
+}
+
 mme::Ihr550::Ihr550(std::string device)
+	: m_mono(create_mono())
 {
+	std::wstring wide_device(device.begin(), device.end());
+	VARIANT id;
+	VariantInit(&id);
+	id.vt = VT_BSTR;
+	id.bstrVal = SysAllocString(wide_device.c_str());
+	try {
+		VARIANT result = invoke(m_mono.get(), "Uniqueid", DISPATCH_PROPERTYPUT, { id });
+		VariantClear(&result);
+	}
+	catch (const std::exception& e) {
+		VariantClear(&id);
+		throw std::runtime_error(std::format("Could not select monochromator {}: {}", device, e.what()));
+	}
+	VariantClear(&id);
+	call(m_mono.get(), "Load");
+	call(m_mono.get(), "OpenCommunications");
+}
+
+void mme::Ihr550::initialize(bool forced)
+{
+	//forced, not emulated, not threaded
+	call(m_mono.get(), "Initialize", { bool_arg(forced), bool_arg(false), bool_arg(true) });
+	wait_until_idle();
 }
 
 void mme::Ihr550::change_wavelength(double wavelength)
 {
+	call(m_mono.get(), "MovetoWavelength", { double_arg(wavelength) });
+	wait_until_idle();
+}
+
+double mme::Ihr550::wavelength() const
+{
+	return query<VT_R8>(m_mono.get(), "GetCurrentWavelength").dblVal;
+}
+
+void mme::Ihr550::wait_until_idle() const
+{
+	while (query<VT_BOOL>(m_mono.get(), "IsBusy").boolVal != VARIANT_FALSE) {
+		std::this_thread::sleep_for(BUSY_POLL_INTERVAL);
+	}
 }
 
 void mme::Ihr550::change_slit(double slit_width, PortLocation loc)
@@ -47,6 +178,34 @@ mme::Ihr550::CoInit::~CoInit()
 	}
 }
 
+mme::Ihr550::MonoObject::MonoObject(IDispatch* dispatch)
+	: m_dispatch(dispatch)
+{
+}
+
+mme::Ihr550::MonoObject::~MonoObject()
+{
+	if (m_dispatch) {
+		m_dispatch->Release();
+	}
+}
+
+mme::Ihr550::MonoObject::MonoObject(MonoObject&& other) noexcept
+{
+	m_dispatch = std::exchange(other.m_dispatch, nullptr);
+}
+
+mme::Ihr550::MonoObject& mme::Ihr550::MonoObject::operator=(MonoObject&& other) noexcept
+{
+	if (this != &other) {
+		if (m_dispatch) {
+			m_dispatch->Release();
+		}
+		m_dispatch = std::exchange(other.m_dispatch, nullptr);
+	}
+	return *this;
+}
+
 mme::Ihr550::CoInit::CoInit(CoInit&& other) noexcept
 {
 	m_initialized = std::exchange(other.m_initialized, false);
@@ -1,6 +1,10 @@
 #pragma once
+#include <concepts>
+#include <cstddef>
 #include <string>
 
+struct IDispatch;
+
 namespace mme {
 
 	enum class PortLocation {
@@ -10,6 +14,18 @@ namespace mme {
 		SideExit
 	};
 
+	//what serving and sequencing rely on, an Ihr550, its remote or a stand-in
+	template<typename T>
+	concept Monochromator = requires(T mono, double value, size_t grating, PortLocation loc, bool forced) {
+		mono.initialize(forced);
+		mono.change_wavelength(value);
+		{ mono.wavelength() } -> std::convertible_to<double>;
+		mono.change_slit(value, loc);
+		mono.change_grating(grating);
+		mono.open_port(loc);
+		mono.close_port(loc);
+	};
+
 	class Ihr550 {
 
 	public:
@@ -22,7 +38,9 @@ namespace mme {
 		Ihr550(Ihr550&& other) = default;
 		Ihr550& operator=(Ihr550&& other) = default;
 
-		void change_wavelength(double wavelength);
+		void initialize(bool forced = false);
+		void change_wavelength(double wavelength); //returns once the move is done
+		double wavelength() const; //as reported by the monochromator
 		void change_slit(double slit_width, PortLocation loc);
 		void change_grating(size_t grating_num);
 		void open_port(PortLocation loc);
@@ -39,7 +57,21 @@ namespace mme {
 		private:
 			bool m_initialized{ false };
 		};
+		//the JY SDK monochromator automation object
+		struct MonoObject {
+			MonoObject() = default;
+			explicit MonoObject(IDispatch* dispatch);
+			~MonoObject();
+			MonoObject(const MonoObject& other) = delete;
+			Ihr550::MonoObject& operator=(const MonoObject& other) = delete;
+			MonoObject(MonoObject&& other) noexcept;
+			Ihr550::MonoObject& operator=(MonoObject&& other) noexcept;
+			IDispatch* get() const { return m_dispatch; }
+		private:
+			IDispatch* m_dispatch{ nullptr };
+		};
 	private:
+		void wait_until_idle() const;
 		void get_mono_state();
 		/*double query_wavelength();
 		PortLocation query_entrance_port();
@@ -48,6 +80,7 @@ namespace mme {
 		size_t query_grating();*/
 	private:
 		CoInit m_coinit; //needed for COM
+		MonoObject m_mono;
 	};
 
 
@@ -1 +1,166 @@
-#include "ihrcoms.h"
\ No newline at end of file
+#include "ihrcoms.h"
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <format>
+
+namespace {
+
+	static_assert(std::endian::native == std::endian::little, "Wire format is little endian, add byte swapping for this platform");
+
+	class Writer {
+	public:
+		Writer(std::vector<uint8_t>& out) : m_out(out) {}
+
+		template<typename T>
+		void put(T value) {
+			const auto offset = m_out.size();
+			m_out.resize(offset + sizeof(T));
+			std::memcpy(m_out.data() + offset, &value, sizeof(T));
+		}
+
+		void put(const std::string& value) {
+			put(static_cast<uint32_t>(value.size()));
+			m_out.insert(m_out.end(), value.begin(), value.end());
+		}
+
+		void put(mme::PortLocation location) {
+			put(static_cast<uint8_t>(location));
+		}
+
+	private:
+		std::vector<uint8_t>& m_out;
+	};
+
+	class Reader {
+	public:
+		Reader(std::span<const uint8_t> bytes) : m_bytes(bytes) {}
+
+		template<typename T>
+		T get() {
+			T value;
+			std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+			return value;
+		}
+
+		std::string get_string() {
+			const auto size = get<uint32_t>();
+			auto bytes = take(size);
+			return std::string{ bytes.begin(), bytes.end() };
+		}
+
+		mme::PortLocation get_location() {
+			const auto value = get<uint8_t>();
+			if (value > static_cast<uint8_t>(mme::PortLocation::SideExit)) {
+				throw std::runtime_error(std::format("Invalid port location {} in IHR message", value));
+			}
+			return static_cast<mme::PortLocation>(value);
+		}
+
+	private:
+		std::span<const uint8_t> take(size_t num_bytes) {
+			if (num_bytes > m_bytes.size()) {
+				throw std::runtime_error("Truncated IHR message payload");
+			}
+			auto bytes = m_bytes.first(num_bytes);
+			m_bytes = m_bytes.subspan(num_bytes);
+			return bytes;
+		}
+
+	private:
+		std::span<const uint8_t> m_bytes;
+	};
+
+	struct PayloadEncoder {
+		Writer& writer;
+
+		void operator()(const mme::detail::ChangeWavelength& msg) { writer.put(msg.value); }
+		void operator()(const mme::detail::Wavelength& msg) { writer.put(msg.value); }
+		void operator()(const mme::detail::ReadWavelength&) {}
+		void operator()(const mme::detail::Initialize& msg) { writer.put(static_cast<uint8_t>(msg.forced)); }
+		void operator()(const mme::detail::ChangeSlit& msg) { writer.put(msg.width); writer.put(msg.location); }
+		void operator()(const mme::detail::ChangeGrating& msg) { writer.put(msg.grating); }
+		void operator()(const mme::detail::OpenPort& msg) { writer.put(msg.location); }
+		void operator()(const mme::detail::ClosePort& msg) { writer.put(msg.location); }
+		void operator()(const mme::detail::Acknowledge&) {}
+		void operator()(const mme::detail::Failure& msg) { writer.put(msg.what); }
+	};
+
+	template<size_t Index = 0>
+	mme::detail::Message decode_as(uint8_t type, Reader& reader) {
+		using namespace mme::detail;
+		if constexpr (Index == std::variant_size_v<Message>) {
+			throw std::runtime_error(std::format("Unknown IHR message type {}", type));
+		}
+		else {
+			if (type != Index) {
+				return decode_as<Index + 1>(type, reader);
+			}
+			using T = std::variant_alternative_t<Index, Message>;
+			if constexpr (std::is_same_v<T, ChangeWavelength> || std::is_same_v<T, Wavelength>) {
+				return T{ reader.get<double>() };
+			}
+			else if constexpr (std::is_same_v<T, Initialize>) {
+				return T{ reader.get<uint8_t>() != 0 };
+			}
+			else if constexpr (std::is_same_v<T, ChangeSlit>) {
+				const auto width = reader.get<double>();
+				return T{ width, reader.get_location() };
+			}
+			else if constexpr (std::is_same_v<T, ChangeGrating>) {
+				return T{ reader.get<uint32_t>() };
+			}
+			else if constexpr (std::is_same_v<T, OpenPort> || std::is_same_v<T, ClosePort>) {
+				return T{ reader.get_location() };
+			}
+			else if constexpr (std::is_same_v<T, Failure>) {
+				return T{ reader.get_string() };
+			}
+			else {
+				return T{};
+			}
+		}
+	}
+}
+
+void mme::detail::encode_frame(uint32_t correlation_id, const Message& message, std::vector<uint8_t>& out)
+{
+	const auto header_offset = out.size();
+	Writer writer{ out };
+	writer.put(FRAME_MAGIC);
+	writer.put(PROTOCOL_VERSION);
+	writer.put(static_cast<uint8_t>(message.index()));
+	writer.put(correlation_id);
+	writer.put(uint32_t{ 0 }); //payload size, patched below
+
+	const auto payload_offset = out.size();
+	std::visit(PayloadEncoder{ writer }, message);
+	const auto payload_size = static_cast<uint32_t>(out.size() - payload_offset);
+	std::memcpy(out.data() + header_offset + 8, &payload_size, sizeof(payload_size));
+}
+
+mme::detail::FrameHeader mme::detail::decode_header(std::span<const uint8_t, FRAME_HEADER_SIZE> bytes)
+{
+	Reader reader{ bytes };
+	if (reader.get<uint16_t>() != FRAME_MAGIC) {
+		throw std::runtime_error("Invalid IHR frame header");
+	}
+	const auto version = reader.get<uint8_t>();
+	if (version != PROTOCOL_VERSION) {
+		throw std::runtime_error(std::format("Unsupported IHR protocol version {}", version));
+	}
+	FrameHeader header{};
+	header.type = reader.get<uint8_t>();
+	header.correlation_id = reader.get<uint32_t>();
+	header.payload_size = reader.get<uint32_t>();
+	if (header.payload_size > MAX_PAYLOAD_SIZE) {
+		throw std::runtime_error(std::format("IHR payload of {} bytes exceeds the maximum size", header.payload_size));
+	}
+	return header;
+}
+
+mme::detail::Message mme::detail::decode_payload(uint8_t type, std::span<const uint8_t> payload)
+{
+	Reader reader{ payload };
+	return decode_as(type, reader);
+}
@@ -1,4 +1,11 @@
 #pragma once
+#include "mme/ihr/ihr.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <variant>
+#include <vector>
+#include <span>
 
 namespace mme::detail {
 
@@ -16,4 +23,49 @@ namespace mme::detail {
 		bool forced = false;
 	};
 
-} //namespace mme::detail
\ No newline at end of file
+	struct ChangeSlit {
+		double width;
+		PortLocation location;
+	};
+
+	struct ChangeGrating {
+		uint32_t grating;
+	};
+
+	struct OpenPort {
+		PortLocation location;
+	};
+
+	struct ClosePort {
+		PortLocation location;
+	};
+
+	struct Acknowledge {};
+
+	struct Failure {
+		std::string what;
+	};
+
+	//the variant index is the message type on the wire, only append new messages at the end
+	using Message = std::variant<ChangeWavelength, Wavelength, ReadWavelength, Initialize, ChangeSlit,
+		ChangeGrating, OpenPort, ClosePort, Acknowledge, Failure>;
+
+	//Every message is framed by a fixed 12 byte little endian header:
+	//  u16 magic | u8 version | u8 message type | u32 correlation id | u32 payload size
+	//A reply carries the correlation id of its request, so several requests can be in flight on one connection.
+	inline constexpr uint16_t FRAME_MAGIC = 0x4d49;
+	inline constexpr uint8_t PROTOCOL_VERSION = 1;
+	inline constexpr size_t FRAME_HEADER_SIZE = 12;
+	inline constexpr uint32_t MAX_PAYLOAD_SIZE = 64 * 1024;
+
+	struct FrameHeader {
+		uint8_t type;
+		uint32_t correlation_id;
+		uint32_t payload_size;
+	};
+
+	void encode_frame(uint32_t correlation_id, const Message& message, std::vector<uint8_t>& out);
+	FrameHeader decode_header(std::span<const uint8_t, FRAME_HEADER_SIZE> bytes);
+	Message decode_payload(uint8_t type, std::span<const uint8_t> payload);
+
+} //namespace mme::detail
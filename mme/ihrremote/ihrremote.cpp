@@ -1,25 +1,239 @@
 #include "mme/ihrremote/ihrremote.h"
+#include "ihrcoms.h"
+#include "asio.hpp"
+#include <array>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <stdexcept>
+#include <format>
+
+namespace mme::detail {
+
+	class IhrClient {
+	public:
+		IhrClient(const std::string& device);
+		~IhrClient();
+
+		IhrClient(const IhrClient& other) = delete;
+		IhrClient& operator=(const IhrClient& other) = delete;
+
+		std::future<Message> request(Message message);
+
+	private:
+		void read_replies();
+
+	private:
+		asio::io_context m_io_context;
+		asio::ip::tcp::socket m_socket;
+		std::mutex m_write_mutex;
+		std::vector<uint8_t> m_write_buffer;
+
+		std::mutex m_pending_mutex;
+		std::unordered_map<uint32_t, std::promise<Message>> m_pending;
+		uint32_t m_next_correlation_id{ 1 };
+		bool m_connection_lost{ false };
+
+		std::jthread m_reader;
+	};
+
+}
+
+namespace {
+
+	std::pair<std::string, std::string> split_host_port(const std::string& device)
+	{
+		const auto colon = device.rfind(':');
+		if (colon == std::string::npos || colon == 0 || colon + 1 == device.size()) {
+			throw std::invalid_argument(std::format("IHR device '{}' is not of the form host:port", device));
+		}
+		return { device.substr(0, colon), device.substr(colon + 1) };
+	}
+
+	void throw_if_failure(const mme::detail::Message& reply)
+	{
+		if (auto failure = std::get_if<mme::detail::Failure>(&reply)) {
+			throw std::runtime_error(std::format("IHR server: {}", failure->what));
+		}
+	}
+
+	std::future<void> expect_acknowledge(std::future<mme::detail::Message> reply)
+	{
+		return std::async(std::launch::deferred, [reply = std::move(reply)]() mutable {
+			auto message = reply.get();
+			throw_if_failure(message);
+			if (!std::holds_alternative<mme::detail::Acknowledge>(message)) {
+				throw std::runtime_error("Unexpected reply from IHR server");
+			}
+		});
+	}
+
+	std::future<double> expect_wavelength(std::future<mme::detail::Message> reply)
+	{
+		return std::async(std::launch::deferred, [reply = std::move(reply)]() mutable {
+			auto message = reply.get();
+			throw_if_failure(message);
+			auto wavelength = std::get_if<mme::detail::Wavelength>(&message);
+			if (!wavelength) {
+				throw std::runtime_error("Unexpected reply from IHR server");
+			}
+			return wavelength->value;
+		});
+	}
+}
+
+mme::detail::IhrClient::IhrClient(const std::string& device)
+	: m_io_context()
+	, m_socket(m_io_context)
+{
+	auto [host, port] = split_host_port(device);
+	asio::ip::tcp::resolver resolver{ m_io_context };
+	asio::connect(m_socket, resolver.resolve(host, port));
+	m_socket.set_option(asio::ip::tcp::no_delay(true));
+	m_reader = std::jthread([this] { read_replies(); });
+}
+
+mme::detail::IhrClient::~IhrClient()
+{
+	//shutdown wakes the reader, the socket is only closed once it is joined
+	asio::error_code ignored;
+	m_socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+	m_reader = std::jthread{};
+	m_socket.close(ignored);
+}
+
+std::future<mme::detail::Message> mme::detail::IhrClient::request(Message message)
+{
+	uint32_t correlation_id = 0;
+	std::future<Message> reply;
+	{
+		std::scoped_lock lock{ m_pending_mutex };
+		if (m_connection_lost) {
+			throw std::runtime_error("Connection to IHR server is lost");
+		}
+		correlation_id = m_next_correlation_id++;
+		reply = m_pending[correlation_id].get_future();
+	}
+
+	try {
+		std::scoped_lock lock{ m_write_mutex };
+		m_write_buffer.clear();
+		encode_frame(correlation_id, message, m_write_buffer);
+		asio::write(m_socket, asio::buffer(m_write_buffer));
+	}
+	catch (...) {
+		std::scoped_lock lock{ m_pending_mutex };
+		m_pending.erase(correlation_id);
+		throw;
+	}
+	return reply;
+}
+
+void mme::detail::IhrClient::read_replies()
+{
+	std::array<uint8_t, FRAME_HEADER_SIZE> header_bytes;
+	std::vector<uint8_t> payload;
+	try {
+		while (true) {
+			asio::read(m_socket, asio::buffer(header_bytes));
+			auto header = decode_header(header_bytes);
+			payload.resize(header.payload_size);
+			asio::read(m_socket, asio::buffer(payload));
+			auto message = decode_payload(header.type, payload);
+
+			std::scoped_lock lock{ m_pending_mutex };
+			auto pending = m_pending.find(header.correlation_id);
+			if (pending != m_pending.end()) {
+				pending->second.set_value(std::move(message));
+				m_pending.erase(pending);
+			}
+		}
+	}
+	catch (const std::exception&) {
+		std::scoped_lock lock{ m_pending_mutex };
+		m_connection_lost = true;
+		for (auto& [id, pending] : m_pending) {
+			pending.set_exception(std::make_exception_ptr(std::runtime_error("Connection to IHR server is lost")));
+		}
+		m_pending.clear();
+	}
+}
 
 mme::Ihr550Remote::Ihr550Remote(std::string device)
+	: m_client(std::make_unique<detail::IhrClient>(device))
+{
+}
+
+mme::Ihr550Remote::~Ihr550Remote() = default;
+mme::Ihr550Remote::Ihr550Remote(Ihr550Remote&& other) noexcept = default;
+mme::Ihr550Remote& mme::Ihr550Remote::operator=(Ihr550Remote&& other) noexcept = default;
+
+void mme::Ihr550Remote::initialize(bool forced)
 {
+	initialize_async(forced).get();
 }
 
 void mme::Ihr550Remote::change_wavelength(double wavelength)
 {
+	change_wavelength_async(wavelength).get();
+}
+
+double mme::Ihr550Remote::wavelength()
+{
+	return wavelength_async().get();
 }
 
 void mme::Ihr550Remote::change_slit(double slit_width, PortLocation loc)
 {
+	change_slit_async(slit_width, loc).get();
 }
 
 void mme::Ihr550Remote::change_grating(size_t grating_num)
 {
+	change_grating_async(grating_num).get();
 }
 
 void mme::Ihr550Remote::open_port(PortLocation loc)
 {
+	open_port_async(loc).get();
 }
 
 void mme::Ihr550Remote::close_port(PortLocation loc)
 {
+	close_port_async(loc).get();
+}
+
+std::future<void> mme::Ihr550Remote::initialize_async(bool forced)
+{
+	return expect_acknowledge(m_client->request(detail::Initialize{ forced }));
+}
+
+std::future<void> mme::Ihr550Remote::change_wavelength_async(double wavelength)
+{
+	return expect_acknowledge(m_client->request(detail::ChangeWavelength{ wavelength }));
+}
+
+std::future<double> mme::Ihr550Remote::wavelength_async()
+{
+	return expect_wavelength(m_client->request(detail::ReadWavelength{}));
+}
+
+std::future<void> mme::Ihr550Remote::change_slit_async(double slit_width, PortLocation loc)
+{
+	return expect_acknowledge(m_client->request(detail::ChangeSlit{ slit_width, loc }));
+}
+
+std::future<void> mme::Ihr550Remote::change_grating_async(size_t grating_num)
+{
+	return expect_acknowledge(m_client->request(detail::ChangeGrating{ static_cast<uint32_t>(grating_num) }));
+}
+
+std::future<void> mme::Ihr550Remote::open_port_async(PortLocation loc)
+{
+	return expect_acknowledge(m_client->request(detail::OpenPort{ loc }));
+}
+
+std::future<void> mme::Ihr550Remote::close_port_async(PortLocation loc)
+{
+	return expect_acknowledge(m_client->request(detail::ClosePort{ loc }));
 }
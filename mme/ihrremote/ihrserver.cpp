@@ -0,0 +1,240 @@
+#include "mme/ihrremote/ihrserver.h"
+#include "ihrcoms.h"
+#include "asio.hpp"
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <optional>
+
+namespace mme::detail {
+
+	struct IhrConnection {
+		IhrConnection(asio::ip::tcp::socket s) : socket(std::move(s)) {}
+
+		asio::ip::tcp::socket socket;
+		std::mutex write_mutex;
+		std::vector<uint8_t> write_buffer;
+		std::atomic<bool> closed{ false }; //set once its reader has stopped
+	};
+
+	struct IhrReader {
+		std::shared_ptr<IhrConnection> connection;
+		std::jthread thread;
+	};
+
+	struct IhrRequest {
+		std::shared_ptr<IhrConnection> connection;
+		uint32_t correlation_id;
+		Message message;
+	};
+
+	class IhrServerState {
+	public:
+		IhrServerState(unsigned short port)
+			: io_context()
+			, acceptor(io_context, asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port))
+		{
+		}
+
+		asio::io_context io_context;
+		asio::ip::tcp::acceptor acceptor;
+
+		std::mutex mutex;
+		std::condition_variable requests_changed;
+		std::deque<IhrRequest> requests;
+		std::vector<IhrReader> readers;
+		bool stopping{ false };
+
+		std::jthread accept_thread;
+
+		//joins the readers of closed connections, their threads are done or about to be. Call with mutex held.
+		void prune_readers() {
+			std::erase_if(readers, [](const IhrReader& reader) { return reader.connection->closed.load(); });
+		}
+	};
+
+}
+
+namespace {
+
+	struct RequestHandler {
+		const mme::detail::MonochromatorCalls& monochromator;
+
+		mme::detail::Message operator()(const mme::detail::ChangeWavelength& msg) {
+			monochromator.change_wavelength(msg.value);
+			return mme::detail::Acknowledge{};
+		}
+		mme::detail::Message operator()(const mme::detail::ReadWavelength&) {
+			return mme::detail::Wavelength{ monochromator.wavelength() };
+		}
+		mme::detail::Message operator()(const mme::detail::Initialize& msg) {
+			monochromator.initialize(msg.forced);
+			return mme::detail::Acknowledge{};
+		}
+		mme::detail::Message operator()(const mme::detail::ChangeSlit& msg) {
+			monochromator.change_slit(msg.width, msg.location);
+			return mme::detail::Acknowledge{};
+		}
+		mme::detail::Message operator()(const mme::detail::ChangeGrating& msg) {
+			monochromator.change_grating(msg.grating);
+			return mme::detail::Acknowledge{};
+		}
+		mme::detail::Message operator()(const mme::detail::OpenPort& msg) {
+			monochromator.open_port(msg.location);
+			return mme::detail::Acknowledge{};
+		}
+		mme::detail::Message operator()(const mme::detail::ClosePort& msg) {
+			monochromator.close_port(msg.location);
+			return mme::detail::Acknowledge{};
+		}
+		//replies are never valid requests
+		mme::detail::Message operator()(const mme::detail::Wavelength&) {
+			return mme::detail::Failure{ "Wavelength is a reply, not a request" };
+		}
+		mme::detail::Message operator()(const mme::detail::Acknowledge&) {
+			return mme::detail::Failure{ "Acknowledge is a reply, not a request" };
+		}
+		mme::detail::Message operator()(const mme::detail::Failure&) {
+			return mme::detail::Failure{ "Failure is a reply, not a request" };
+		}
+	};
+
+	void read_requests(mme::detail::IhrServerState& state, std::shared_ptr<mme::detail::IhrConnection> connection)
+	{
+		std::array<uint8_t, mme::detail::FRAME_HEADER_SIZE> header_bytes;
+		std::vector<uint8_t> payload;
+		try {
+			while (true) {
+				asio::read(connection->socket, asio::buffer(header_bytes));
+				auto header = mme::detail::decode_header(header_bytes);
+				payload.resize(header.payload_size);
+				asio::read(connection->socket, asio::buffer(payload));
+				auto message = mme::detail::decode_payload(header.type, payload);
+
+				std::scoped_lock lock{ state.mutex };
+				state.requests.push_back(mme::detail::IhrRequest{ connection, header.correlation_id, std::move(message) });
+				state.requests_changed.notify_one();
+			}
+		}
+		catch (const std::exception&) {
+			//client disconnected or sent garbage, drop the connection. The socket is closed by its last owner.
+			asio::error_code ignored;
+			connection->socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+		}
+		connection->closed = true;
+	}
+
+	void accept_connections(mme::detail::IhrServerState& state)
+	{
+		while (true) {
+			asio::error_code ec;
+			asio::ip::tcp::socket socket{ state.io_context };
+			state.acceptor.accept(socket, ec);
+			if (ec) {
+				return;
+			}
+			socket.set_option(asio::ip::tcp::no_delay(true), ec);
+
+			std::scoped_lock lock{ state.mutex };
+			if (state.stopping) {
+				return;
+			}
+			state.prune_readers();
+			auto connection = std::make_shared<mme::detail::IhrConnection>(std::move(socket));
+			state.readers.push_back({ connection, std::jthread([&state, connection] { read_requests(state, connection); }) });
+		}
+	}
+
+	void send_reply(mme::detail::IhrConnection& connection, uint32_t correlation_id, const mme::detail::Message& reply)
+	{
+		std::scoped_lock lock{ connection.write_mutex };
+		connection.write_buffer.clear();
+		mme::detail::encode_frame(correlation_id, reply, connection.write_buffer);
+		asio::error_code ignored; //a vanished client only loses its own replies
+		asio::write(connection.socket, asio::buffer(connection.write_buffer), ignored);
+	}
+}
+
+mme::Ihr550Server::Ihr550Server(detail::MonochromatorCalls monochromator, unsigned short port)
+	: m_monochromator(std::move(monochromator))
+	, m_state(std::make_unique<detail::IhrServerState>(port))
+{
+}
+
+mme::Ihr550Server::~Ihr550Server()
+{
+	stop();
+	//the accept loop returns on the wake up connection of stop(), only then can the acceptor close
+	m_state->accept_thread = std::jthread{};
+	asio::error_code ignored;
+	m_state->acceptor.close(ignored);
+	//readers must be joined before their sockets and the io_context they use go away
+	for (auto& reader : m_state->readers) {
+		reader.thread = std::jthread{};
+		reader.connection->socket.close(ignored);
+	}
+	m_state->readers.clear();
+}
+
+unsigned short mme::Ihr550Server::port() const
+{
+	return m_state->acceptor.local_endpoint().port();
+}
+
+size_t mme::Ihr550Server::num_connections()
+{
+	std::scoped_lock lock{ m_state->mutex };
+	m_state->prune_readers();
+	return m_state->readers.size();
+}
+
+void mme::Ihr550Server::run()
+{
+	m_state->accept_thread = std::jthread([state = m_state.get()] { accept_connections(*state); });
+
+	RequestHandler handler{ m_monochromator };
+	while (true) {
+		std::optional<detail::IhrRequest> request;
+		{
+			std::unique_lock lock{ m_state->mutex };
+			m_state->requests_changed.wait(lock, [this] { return m_state->stopping || !m_state->requests.empty(); });
+			if (m_state->stopping) {
+				return;
+			}
+			request = std::move(m_state->requests.front());
+			m_state->requests.pop_front();
+		}
+
+		detail::Message reply;
+		try {
+			reply = std::visit(handler, request->message);
+		}
+		catch (const std::exception& e) {
+			reply = detail::Failure{ e.what() };
+		}
+		send_reply(*request->connection, request->correlation_id, reply);
+	}
+}
+
+void mme::Ihr550Server::stop()
+{
+	std::scoped_lock lock{ m_state->mutex };
+	if (m_state->stopping) {
+		return;
+	}
+	m_state->stopping = true;
+	asio::error_code ignored;
+	//a blocking accept is not woken by close on every platform, so give it a connection to return with
+	auto endpoint = m_state->acceptor.local_endpoint(ignored);
+	if (!ignored) {
+		asio::ip::tcp::socket wake_up{ m_state->io_context };
+		wake_up.connect(asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), endpoint.port()), ignored);
+	}
+	for (auto& reader : m_state->readers) {
+		reader.connection->socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+	}
+	m_state->requests_changed.notify_all();
+}
@@ -1,34 +1,49 @@
 #pragma once
 #include <string>
+#include <memory>
+#include <future>
 #include "mme/ihr/ihr.h"
 
 namespace mme {
 
+	namespace detail {
+		class IhrClient;
+	}
+
+	//Talks to an Ihr550Server over one persistent TCP connection.
+	//The *_async calls can be issued back to back, replies are matched to requests by correlation id.
 	class Ihr550Remote {
 
 	public:
+		//device is "host:port" of the machine running the Ihr550Server
 		Ihr550Remote(std::string device);
+		~Ihr550Remote();
 
 		//move only
 		Ihr550Remote(const Ihr550Remote& other) = delete;
 		Ihr550Remote& operator=(const Ihr550Remote& other) = delete;
 
-		Ihr550Remote(Ihr550Remote&& other) = default;
-		Ihr550Remote& operator=(Ihr550Remote&& other) = default;
+		Ihr550Remote(Ihr550Remote&& other) noexcept;
+		Ihr550Remote& operator=(Ihr550Remote&& other) noexcept;
 
+		void initialize(bool forced = false);
 		void change_wavelength(double wavelength);
+		double wavelength();
 		void change_slit(double slit_width, PortLocation loc);
 		void change_grating(size_t grating_num);
 		void open_port(PortLocation loc);
 		void close_port(PortLocation loc);
 
+		std::future<void> initialize_async(bool forced = false);
+		std::future<void> change_wavelength_async(double wavelength);
+		std::future<double> wavelength_async();
+		std::future<void> change_slit_async(double slit_width, PortLocation loc);
+		std::future<void> change_grating_async(size_t grating_num);
+		std::future<void> open_port_async(PortLocation loc);
+		std::future<void> close_port_async(PortLocation loc);
+
 	private:
-		//void get_mono_state();
-		/*double query_wavelength();
-		PortLocation query_entrance_port();
-		PortLocation query_exit_port();
-		double query_slit_width(PortLocation loc);
-		size_t query_grating();*/
+		std::unique_ptr<detail::IhrClient> m_client;
 	};
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include "mme/ihr/ihr.h"
+
+namespace mme {
+
+	namespace detail {
+		class IhrServerState;
+
+		//the calls the server makes, so it can serve an Ihr550 or a stand-in for one
+		struct MonochromatorCalls {
+			std::function<void(bool)> initialize;
+			std::function<void(double)> change_wavelength;
+			std::function<double()> wavelength;
+			std::function<void(double, PortLocation)> change_slit;
+			std::function<void(size_t)> change_grating;
+			std::function<void(PortLocation)> open_port;
+			std::function<void(PortLocation)> close_port;
+		};
+	}
+
+	//Serves an Ihr550 to Ihr550Remote clients.
+	//All monochromator calls are made from the thread that calls run(), which should be the thread owning the COM object.
+	class Ihr550Server {
+	public:
+		template<Monochromator Device>
+		Ihr550Server(Device& monochromator, unsigned short port)
+			: Ihr550Server(detail::MonochromatorCalls{
+				[&monochromator](bool forced) { monochromator.initialize(forced); },
+				[&monochromator](double wavelength) { monochromator.change_wavelength(wavelength); },
+				[&monochromator]() -> double { return monochromator.wavelength(); },
+				[&monochromator](double width, PortLocation loc) { monochromator.change_slit(width, loc); },
+				[&monochromator](size_t grating) { monochromator.change_grating(grating); },
+				[&monochromator](PortLocation loc) { monochromator.open_port(loc); },
+				[&monochromator](PortLocation loc) { monochromator.close_port(loc); } }, port)
+		{
+		}
+		~Ihr550Server();
+
+		Ihr550Server(const Ihr550Server& other) = delete;
+		Ihr550Server& operator=(const Ihr550Server& other) = delete;
+
+		unsigned short port() const;
+		size_t num_connections(); //clients still connected
+		void run(); //blocks until stop() is called
+		void stop();
+
+	private:
+		Ihr550Server(detail::MonochromatorCalls monochromator, unsigned short port);
+
+	private:
+		detail::MonochromatorCalls m_monochromator;
+		std::unique_ptr<detail::IhrServerState> m_state;
+	};
+
+} //namespace mme
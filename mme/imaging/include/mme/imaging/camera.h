@@ -0,0 +1,35 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include <concepts>
+#include <cstdint>
+
+namespace mme {
+
+	struct Exposure {
+		double value; //ms
+
+		bool operator==(const Exposure& other) const = default;
+	};
+
+	struct Binning {
+		size_t value;
+
+		bool operator==(const Binning& other) const = default;
+	};
+
+	enum class TriggerMode {
+		Software,	//a frame is exposed when it is captured
+		Hardware	//capturing waits for the frame exposed on the next external trigger
+	};
+
+	//what processing and capture code may rely on, regardless of vendor
+	template<typename T>
+	concept Camera = requires(T camera, const T const_camera, Exposure exposure) {
+		{ camera.capture_single() } -> std::same_as<Image<float>>;
+		{ camera.capture_raw() } -> std::same_as<Image<uint16_t>>;
+		{ const_camera.image_size() } -> std::same_as<ImageSize>;
+		{ const_camera.exposure() } -> std::same_as<Exposure>;
+		camera.set_exposure(exposure);
+	};
+
+}
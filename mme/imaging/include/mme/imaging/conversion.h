@@ -0,0 +1,56 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/parallel/threadpool.h"
+#include <span>
+#include <cstdint>
+#include <cassert>
+
+namespace mme {
+
+	//LUCAM_PF_16 frames hold the 12 bit sensor value in the upper bits of each 16 bit word
+	inline constexpr unsigned PF16_SHIFT = 4;
+
+	//pixels per thread pool chunk, smaller frames are converted on the calling thread
+	inline constexpr size_t CONVERSION_GRAIN = size_t{ 1 } << 18;
+
+	inline void unpack_pf16(std::span<const uint16_t> raw, std::span<float> pixels) {
+		assert(raw.size() == pixels.size());
+		parallel_for(raw.size(), [&](size_t begin, size_t end) {
+			const uint16_t* src = raw.data();
+			float* dst = pixels.data();
+			for (size_t i = begin; i < end; i++) {
+				dst[i] = static_cast<float>(src[i] >> PF16_SHIFT);
+			}
+		}, CONVERSION_GRAIN);
+	}
+
+	inline void unpack_pf16(std::span<uint16_t> raw) {
+		parallel_for(raw.size(), [&](size_t begin, size_t end) {
+			uint16_t* pixels = raw.data();
+			for (size_t i = begin; i < end; i++) {
+				pixels[i] >>= PF16_SHIFT;
+			}
+		}, CONVERSION_GRAIN);
+	}
+
+	//for processing stages that need float, raw frames stay uint16 until then
+	template<typename Pixel>
+	void convert_pixels(ImageView<const Pixel> source, ImageView<float> destination) {
+		assert(num_pixels(source.size()) == num_pixels(destination.size()));
+		const Pixel* src = source.pixels().data();
+		float* dst = destination.pixels().data();
+		parallel_for(source.pixels().size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				dst[i] = static_cast<float>(src[i]);
+			}
+		}, CONVERSION_GRAIN);
+	}
+
+	template<typename Pixel, typename Allocator>
+	Image<float> to_float(const Image<Pixel, Allocator>& image) {
+		Image<float> converted(image.size());
+		convert_pixels(image.as_view(), converted.as_view());
+		return converted;
+	}
+
+} //namespace mme
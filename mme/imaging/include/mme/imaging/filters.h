@@ -0,0 +1,474 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/parallel/threadpool.h"
+#include "mme/tracing/trace.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+//Spatial filters on ImageView<float>. Borders replicate the edge pixels, destinations must not overlap
+//their sources. Every filter works on tiles of rows, all planes of a batch are filtered tile by tile so
+//the rows of a tile are reused from cache, and tiles are spread over the shared thread pool.
+//NaN pixels spread through the Gaussian and box filters; the median filters assume finite pixels.
+
+namespace mme {
+
+	namespace detail {
+
+		inline constexpr size_t FILTER_TILE_ROWS = 32;
+
+		//calls func(row_start, num_rows, scratch) for tiles of rows on the thread pool, scratch is reused over
+		//the tiles of a chunk
+		template<typename Scratch, typename Func>
+		void parallel_tiles(size_t num_rows, Func&& func) {
+			const size_t num_tiles = (num_rows + FILTER_TILE_ROWS - 1) / FILTER_TILE_ROWS;
+			parallel_for(num_tiles, [&](size_t begin, size_t end) {
+				Scratch scratch;
+				for (size_t tile = begin; tile < end; tile++) {
+					const size_t row_start = tile * FILTER_TILE_ROWS;
+					func(row_start, std::min(FILTER_TILE_ROWS, num_rows - row_start), scratch);
+				}
+			});
+		}
+
+		inline ImageSize check_planes(std::span<const ImageView<const float>> sources, std::span<const ImageView<float>> destinations) {
+			if (sources.size() != destinations.size()) {
+				throw std::invalid_argument(std::format("Filtering {} planes into {} destinations", sources.size(), destinations.size()));
+			}
+			const ImageSize size = sources.empty() ? ImageSize{ 0, 0 } : sources.front().size();
+			for (size_t i = 0; i < sources.size(); i++) {
+				if (sources[i].size() != size || destinations[i].size() != size) {
+					throw std::invalid_argument("All filtered planes and destinations must have the same size");
+				}
+			}
+			return size;
+		}
+
+		inline size_t clamp_row(std::ptrdiff_t row, size_t num_rows) {
+			return static_cast<size_t>(std::clamp<std::ptrdiff_t>(row, 0, static_cast<std::ptrdiff_t>(num_rows) - 1));
+		}
+
+		//row with radius replicated edge pixels on both sides
+		inline void pad_row(std::span<const float> row, size_t radius, float* padded) {
+			std::fill_n(padded, radius, row.front());
+			std::copy(row.begin(), row.end(), padded + radius);
+			std::fill_n(padded + radius + row.size(), radius, row.back());
+		}
+
+		//horizontal pass of a symmetric kernel, tap by tap so the inner loop runs along the row
+		inline void filter_row(const float* padded, std::span<const float> kernel, float* out, size_t width) {
+			std::fill_n(out, width, 0.0f);
+			for (size_t k = 0; k < kernel.size(); k++) {
+				const float weight = kernel[k];
+				const float* taps = padded + k;
+				for (size_t c = 0; c < width; c++) {
+					out[c] += weight * taps[c];
+				}
+			}
+		}
+
+		inline void separable_tile(ImageView<const float> source, ImageView<float> destination, std::span<const float> kernel,
+			size_t row_start, size_t num_rows, std::vector<float>& scratch) {
+			const size_t width = source.num_cols();
+			const size_t radius = kernel.size() / 2;
+			const size_t num_scratch_rows = num_rows + 2 * radius;
+			scratch.resize(num_scratch_rows * width + width + 2 * radius);
+			float* padded = scratch.data() + num_scratch_rows * width;
+			for (size_t i = 0; i < num_scratch_rows; i++) {
+				const auto row = source.row(clamp_row(static_cast<std::ptrdiff_t>(row_start + i) - static_cast<std::ptrdiff_t>(radius), source.num_rows()));
+				pad_row(row, radius, padded);
+				filter_row(padded, kernel, scratch.data() + i * width, width);
+			}
+			for (size_t r = 0; r < num_rows; r++) {
+				auto out = destination.row(row_start + r);
+				std::ranges::fill(out, 0.0f);
+				for (size_t k = 0; k < kernel.size(); k++) {
+					const float weight = kernel[k];
+					const float* taps = scratch.data() + (r + k) * width;
+					for (size_t c = 0; c < width; c++) {
+						out[c] += weight * taps[c];
+					}
+				}
+			}
+		}
+
+		//Running sums in double: a sliding float sum drifts and a float prefix sum over a row of 12 bit
+		//values loses whole counts
+		inline void box_tile(ImageView<const float> source, ImageView<float> destination, size_t radius,
+			size_t row_start, size_t num_rows, std::vector<double>& scratch) {
+			const size_t width = source.num_cols();
+			const size_t diameter = 2 * radius + 1;
+			const size_t num_scratch_rows = num_rows + 2 * radius;
+			scratch.resize(num_scratch_rows * width + width + width + 2 * radius + 1);
+			double* sums = scratch.data() + num_scratch_rows * width;
+			double* prefix = sums + width;
+			const double inverse_area = 1.0 / static_cast<double>(diameter * diameter);
+
+			for (size_t i = 0; i < num_scratch_rows; i++) {
+				const auto row = source.row(clamp_row(static_cast<std::ptrdiff_t>(row_start + i) - static_cast<std::ptrdiff_t>(radius), source.num_rows()));
+				prefix[0] = 0.0;
+				for (size_t c = 0; c < width + 2 * radius; c++) {
+					const size_t source_col = static_cast<size_t>(std::clamp<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(c) - static_cast<std::ptrdiff_t>(radius), 0, static_cast<std::ptrdiff_t>(width) - 1));
+					prefix[c + 1] = prefix[c] + row[source_col];
+				}
+				double* out = scratch.data() + i * width;
+				for (size_t c = 0; c < width; c++) {
+					out[c] = prefix[c + diameter] - prefix[c];
+				}
+			}
+
+			std::fill_n(sums, width, 0.0);
+			for (size_t k = 0; k < diameter; k++) {
+				const double* row = scratch.data() + k * width;
+				for (size_t c = 0; c < width; c++) {
+					sums[c] += row[c];
+				}
+			}
+			for (size_t r = 0; r < num_rows; r++) {
+				auto out = destination.row(row_start + r);
+				for (size_t c = 0; c < width; c++) {
+					out[c] = static_cast<float>(sums[c] * inverse_area);
+				}
+				if (r + 1 < num_rows) {
+					const double* leaving = scratch.data() + r * width;
+					const double* entering = scratch.data() + (r + diameter) * width;
+					for (size_t c = 0; c < width; c++) {
+						sums[c] += entering[c] - leaving[c];
+					}
+				}
+			}
+		}
+
+		struct Comparator {
+			uint8_t low;
+			uint8_t high;
+			bool keep_low; //the minimum is used later on
+			bool keep_high; //the maximum is used later on
+		};
+
+		template<size_t N>
+		struct SelectionNetwork {
+			std::array<Comparator, 1024> comparators{};
+			size_t size = 0;
+		};
+
+		//Batcher's odd-even merge sort for N values, pruned to the comparators the middle element depends
+		//on. Half of the remaining comparators only need one of their outputs.
+		template<size_t N>
+		constexpr SelectionNetwork<N> median_network() {
+			SelectionNetwork<N> sorting;
+			for (size_t p = 1; p < N; p += p) {
+				for (size_t k = p; k > 0; k /= 2) {
+					for (size_t j = k % p; j + k < N; j += k + k) {
+						for (size_t i = 0; i < k && i + j + k < N; i++) {
+							if ((i + j) / (p + p) == (i + j + k) / (p + p)) {
+								sorting.comparators[sorting.size++] = { static_cast<uint8_t>(i + j), static_cast<uint8_t>(i + j + k), true, true };
+							}
+						}
+					}
+				}
+			}
+
+			std::array<bool, N> needed{};
+			needed[N / 2] = true;
+			SelectionNetwork<N> reversed;
+			for (size_t c = sorting.size; c-- > 0;) {
+				auto comparator = sorting.comparators[c];
+				comparator.keep_low = needed[comparator.low];
+				comparator.keep_high = needed[comparator.high];
+				if (comparator.keep_low || comparator.keep_high) {
+					reversed.comparators[reversed.size++] = comparator;
+					needed[comparator.low] = true;
+					needed[comparator.high] = true;
+				}
+			}
+			SelectionNetwork<N> pruned;
+			for (size_t c = reversed.size; c-- > 0;) {
+				pruned.comparators[pruned.size++] = reversed.comparators[c];
+			}
+			return pruned;
+		}
+
+		//std::min and std::max keep GCC on scalar minss and maxss here, the plain compares vectorize
+		template<Comparator C, size_t N>
+		inline void compare_exchange(std::array<float, N>& window) {
+			const float a = window[C.low];
+			const float b = window[C.high];
+			if constexpr (C.keep_low) {
+				window[C.low] = b < a ? b : a;
+			}
+			if constexpr (C.keep_high) {
+				window[C.high] = a < b ? b : a;
+			}
+		}
+
+		//unrolled at compile time so the window stays in registers
+		template<const auto& Network, size_t N, size_t... I>
+		void apply_network(std::array<float, N>& window, std::index_sequence<I...>) {
+			(compare_exchange<Network.comparators[I]>(window), ...);
+		}
+
+		template<size_t Diameter, size_t N, size_t... I>
+		void load_window(const float* padded, size_t stride, std::array<float, N>& window, std::index_sequence<I...>) {
+			((window[I] = padded[(I / Diameter) * stride + I % Diameter]), ...);
+		}
+
+		//One output row. Every column runs the whole network on its own local window, so the column loop is
+		//straight line min and max code the vectorizer runs over as many columns as a register holds.
+		template<size_t Radius>
+		void median_network_row(const float* __restrict padded, size_t stride, float* __restrict out, size_t width) {
+			constexpr size_t DIAMETER = 2 * Radius + 1;
+			constexpr size_t N = DIAMETER * DIAMETER;
+			static constexpr auto network = median_network<N>();
+			for (size_t c = 0; c < width; c++) {
+				std::array<float, N> window;
+				load_window<DIAMETER>(padded + c, stride, window, std::make_index_sequence<N>());
+				apply_network<network>(window, std::make_index_sequence<network.size>());
+				out[c] = window[N / 2];
+			}
+		}
+
+		//Median of a (2 * Radius + 1)^2 window with a selection network over edge padded rows
+		template<size_t Radius>
+		void median_network_tile(ImageView<const float> source, ImageView<float> destination,
+			size_t row_start, size_t num_rows, std::vector<float>& scratch) {
+			const size_t width = source.num_cols();
+			const size_t padded_width = width + 2 * Radius;
+			const size_t num_scratch_rows = num_rows + 2 * Radius;
+			scratch.resize(num_scratch_rows * padded_width);
+			for (size_t i = 0; i < num_scratch_rows; i++) {
+				const auto row = source.row(clamp_row(static_cast<std::ptrdiff_t>(row_start + i) - static_cast<std::ptrdiff_t>(Radius), source.num_rows()));
+				pad_row(row, Radius, scratch.data() + i * padded_width);
+			}
+			for (size_t r = 0; r < num_rows; r++) {
+				median_network_row<Radius>(scratch.data() + r * padded_width, padded_width, destination.row(row_start + r).data(), width);
+			}
+		}
+
+		inline constexpr size_t MEDIAN_LEVELS = 4096;
+
+		struct Quantization {
+			float offset;
+			float step;
+		};
+
+		//Levels over the finite range of all planes. Integer data spanning fewer than MEDIAN_LEVELS values, such
+		//as camera frames of up to 12 bit, get one level per value and an exact median; anything else is spread
+		//over the 4096 levels and rounds to 1/4095 of the range.
+		inline Quantization median_quantization(std::span<const ImageView<const float>> sources) {
+			float low = std::numeric_limits<float>::infinity();
+			float high = -std::numeric_limits<float>::infinity();
+			bool integral = true;
+			for (const auto& source : sources) {
+				for (float pixel : source.pixels()) {
+					if (std::isfinite(pixel)) {
+						low = std::min(low, pixel);
+						high = std::max(high, pixel);
+						integral = integral && std::trunc(pixel) == pixel;
+					}
+				}
+			}
+			if (!(high > low)) {
+				return { std::isfinite(low) ? low : 0.0f, 1.0f };
+			}
+			if (integral && high - low < static_cast<float>(MEDIAN_LEVELS)) {
+				return { low, 1.0f };
+			}
+			return { low, std::max((high - low) / static_cast<float>(MEDIAN_LEVELS - 1), std::numeric_limits<float>::min()) };
+		}
+
+		struct HistogramScratch {
+			std::vector<uint16_t> levels;
+			std::vector<uint32_t> histogram;
+		};
+
+		//Huang's sliding histogram: per output row the window histogram is built once and then moved along
+		//the row by one column out and one column in, the median is tracked by the count below it
+		inline void median_histogram_tile(ImageView<const float> source, ImageView<float> destination, size_t radius, Quantization quantization,
+			size_t row_start, size_t num_rows, HistogramScratch& scratch) {
+			const size_t width = source.num_cols();
+			const size_t diameter = 2 * radius + 1;
+			const size_t padded_width = width + 2 * radius;
+			const size_t num_scratch_rows = num_rows + 2 * radius;
+			const uint32_t half = static_cast<uint32_t>(diameter * diameter / 2);
+			const float scale = 1.0f / quantization.step;
+
+			scratch.levels.resize(num_scratch_rows * padded_width);
+			for (size_t i = 0; i < num_scratch_rows; i++) {
+				const auto row = source.row(clamp_row(static_cast<std::ptrdiff_t>(row_start + i) - static_cast<std::ptrdiff_t>(radius), source.num_rows()));
+				uint16_t* levels = scratch.levels.data() + i * padded_width;
+				for (size_t c = 0; c < padded_width; c++) {
+					const float pixel = row[static_cast<size_t>(std::clamp<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(c) - static_cast<std::ptrdiff_t>(radius), 0, static_cast<std::ptrdiff_t>(width) - 1))];
+					const float level = std::clamp(std::round((pixel - quantization.offset) * scale), 0.0f, static_cast<float>(MEDIAN_LEVELS - 1));
+					levels[c] = static_cast<uint16_t>(level);
+				}
+			}
+
+			auto& histogram = scratch.histogram;
+			for (size_t r = 0; r < num_rows; r++) {
+				histogram.assign(MEDIAN_LEVELS, 0);
+				auto column = [&](size_t c, auto&& visit) {
+					for (size_t dy = 0; dy < diameter; dy++) {
+						visit(scratch.levels[(r + dy) * padded_width + c]);
+					}
+				};
+				for (size_t c = 0; c < diameter; c++) {
+					column(c, [&](uint16_t level) { histogram[level]++; });
+				}
+				size_t median = 0;
+				uint32_t below = 0; //values at levels below median
+				auto out = destination.row(row_start + r);
+				for (size_t c = 0; c < width; c++) {
+					if (c > 0) {
+						column(c - 1, [&](uint16_t level) { histogram[level]--; below -= level < median ? 1 : 0; });
+						column(c + diameter - 1, [&](uint16_t level) { histogram[level]++; below += level < median ? 1 : 0; });
+					}
+					while (below > half) {
+						median--;
+						below -= histogram[median];
+					}
+					while (below + histogram[median] <= half) {
+						below += histogram[median];
+						median++;
+					}
+					out[c] = quantization.offset + static_cast<float>(median) * quantization.step;
+				}
+			}
+		}
+	}
+
+	//normalized, radius ceil(3 sigma)
+	inline std::vector<float> gaussian_kernel(double sigma) {
+		if (!(sigma > 0.0)) {
+			throw std::invalid_argument(std::format("Gaussian sigma must be positive, got {}", sigma));
+		}
+		const size_t radius = static_cast<size_t>(std::ceil(3.0 * sigma));
+		std::vector<double> weights(2 * radius + 1);
+		double total = 0.0;
+		for (size_t i = 0; i < weights.size(); i++) {
+			const double x = static_cast<double>(i) - static_cast<double>(radius);
+			weights[i] = std::exp(-0.5 * x * x / (sigma * sigma));
+			total += weights[i];
+		}
+		std::vector<float> kernel(weights.size());
+		for (size_t i = 0; i < weights.size(); i++) {
+			kernel[i] = static_cast<float>(weights[i] / total);
+		}
+		return kernel;
+	}
+
+	//symmetric kernel of odd length, applied along rows and then columns
+	inline void separable_filter(std::span<const ImageView<const float>> sources, std::span<const ImageView<float>> destinations, std::span<const float> kernel) {
+		MME_TRACE_SCOPE("separable_filter");
+		if (kernel.size() % 2 == 0) {
+			throw std::invalid_argument(std::format("Separable kernels need an odd number of taps, got {}", kernel.size()));
+		}
+		const auto size = detail::check_planes(sources, destinations);
+		if (num_pixels(size) == 0) {
+			return;
+		}
+		detail::parallel_tiles<std::vector<float>>(size.height, [&](size_t row_start, size_t num_rows, std::vector<float>& scratch) {
+			for (size_t plane = 0; plane < sources.size(); plane++) {
+				detail::separable_tile(sources[plane], destinations[plane], kernel, row_start, num_rows, scratch);
+			}
+		});
+	}
+
+	inline void separable_filter(ImageView<const float> source, ImageView<float> destination, std::span<const float> kernel) {
+		separable_filter(std::span(&source, 1), std::span(&destination, 1), kernel);
+	}
+
+	inline void gaussian_filter(std::span<const ImageView<const float>> sources, std::span<const ImageView<float>> destinations, double sigma) {
+		const auto kernel = gaussian_kernel(sigma);
+		separable_filter(sources, destinations, kernel);
+	}
+
+	inline void gaussian_filter(ImageView<const float> source, ImageView<float> destination, double sigma) {
+		gaussian_filter(std::span(&source, 1), std::span(&destination, 1), sigma);
+	}
+
+	inline Image<float> gaussian_filter(ImageView<const float> source, double sigma) {
+		Image<float> filtered(source.size());
+		gaussian_filter(source, filtered.as_view(), sigma);
+		return filtered;
+	}
+
+	//mean of the (2 * radius + 1)^2 window, constant time per pixel in the radius
+	inline void box_filter(std::span<const ImageView<const float>> sources, std::span<const ImageView<float>> destinations, size_t radius) {
+		MME_TRACE_SCOPE("box_filter");
+		const auto size = detail::check_planes(sources, destinations);
+		if (num_pixels(size) == 0) {
+			return;
+		}
+		detail::parallel_tiles<std::vector<double>>(size.height, [&](size_t row_start, size_t num_rows, std::vector<double>& scratch) {
+			for (size_t plane = 0; plane < sources.size(); plane++) {
+				detail::box_tile(sources[plane], destinations[plane], radius, row_start, num_rows, scratch);
+			}
+		});
+	}
+
+	inline void box_filter(ImageView<const float> source, ImageView<float> destination, size_t radius) {
+		box_filter(std::span(&source, 1), std::span(&destination, 1), radius);
+	}
+
+	inline Image<float> box_filter(ImageView<const float> source, size_t radius) {
+		Image<float> filtered(source.size());
+		box_filter(source, filtered.as_view(), radius);
+		return filtered;
+	}
+
+	//Median of the (2 * radius + 1)^2 window. Radius 1 and 2 (3x3, 5x5) are exact selection networks, larger
+	//windows use a sliding histogram of 4096 levels over the finite range of the planes, which is exact for
+	//integer valued planes spanning fewer than 4096 values and otherwise rounds to 1/4095 of that range.
+	inline void median_filter(std::span<const ImageView<const float>> sources, std::span<const ImageView<float>> destinations, size_t radius) {
+		MME_TRACE_SCOPE("median_filter");
+		const auto size = detail::check_planes(sources, destinations);
+		if (num_pixels(size) == 0) {
+			return;
+		}
+		if (radius == 0) {
+			for (size_t plane = 0; plane < sources.size(); plane++) {
+				auto destination = destinations[plane];
+				std::ranges::copy(sources[plane].pixels(), destination.pixels().begin());
+			}
+			return;
+		}
+		if (radius <= 2) {
+			detail::parallel_tiles<std::vector<float>>(size.height, [&](size_t row_start, size_t num_rows, std::vector<float>& scratch) {
+				for (size_t plane = 0; plane < sources.size(); plane++) {
+					if (radius == 1) {
+						detail::median_network_tile<1>(sources[plane], destinations[plane], row_start, num_rows, scratch);
+					}
+					else {
+						detail::median_network_tile<2>(sources[plane], destinations[plane], row_start, num_rows, scratch);
+					}
+				}
+			});
+			return;
+		}
+		const auto quantization = detail::median_quantization(sources);
+		detail::parallel_tiles<detail::HistogramScratch>(size.height, [&](size_t row_start, size_t num_rows, detail::HistogramScratch& scratch) {
+			for (size_t plane = 0; plane < sources.size(); plane++) {
+				detail::median_histogram_tile(sources[plane], destinations[plane], radius, quantization, row_start, num_rows, scratch);
+			}
+		});
+	}
+
+	inline void median_filter(ImageView<const float> source, ImageView<float> destination, size_t radius) {
+		median_filter(std::span(&source, 1), std::span(&destination, 1), radius);
+	}
+
+	inline Image<float> median_filter(ImageView<const float> source, size_t radius) {
+		Image<float> filtered(source.size());
+		median_filter(source, filtered.as_view(), radius);
+		return filtered;
+	}
+
+} //namespace mme
@@ -0,0 +1,422 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/parallel/threadpool.h"
+#include "mme/tracing/trace.h"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <bit>
+#include <format>
+#include <cassert>
+
+//Lossless codecs for 12 bit frames (raw captures, see LumeneraCamera::capture_raw).
+//
+//Packed12:        two pixels in three bytes, little endian: b0 = a[7:0], b1 = a[11:8] | b[3:0] << 4, b2 = b[11:4]
+//DeltaBitPacked:  per row, each pixel minus its left neighbour (the first pixel minus the first pixel of the row above),
+//                 zigzag mapped, then in blocks of 128 residuals: one byte bit width w followed by 128 * w bits, LSB first
+//
+//Compressed frame files hold a sequence of frames, each with a 32 byte little endian header:
+//  char[4] "MMEF" | u8 version | u8 codec | u16 reserved | u32 height | u32 width | u64 payload bytes | u64 reserved
+//followed by the payload.
+
+namespace mme {
+
+	enum class FrameCodec : uint8_t {
+		Packed12 = 1,
+		DeltaBitPacked = 2
+	};
+
+	struct EncodedFrame {
+		ImageSize size;
+		FrameCodec codec;
+		std::vector<uint8_t> data;
+	};
+
+	inline constexpr uint16_t MAX_12BIT_VALUE = 0x0fff;
+
+	constexpr size_t packed_12bit_size(size_t num_pixels) {
+		return (num_pixels * 3 + 1) / 2;
+	}
+
+	namespace detail {
+
+		inline void check_12bit(uint16_t high_bits) {
+			if (high_bits & ~MAX_12BIT_VALUE) {
+				throw std::invalid_argument("Frame has pixel values above 12 bits, it cannot be packed losslessly");
+			}
+		}
+
+		//differences of 12 bit values fit 16 bits, so they are mapped in 16 bit lanes
+		inline uint16_t zigzag(int16_t value) {
+			return static_cast<uint16_t>((value << 1) ^ (value >> 15));
+		}
+
+		inline int16_t unzigzag(uint16_t value) {
+			return static_cast<int16_t>((value >> 1) ^ -(value & 1));
+		}
+
+		inline constexpr size_t DELTA_BLOCK_SIZE = 128;
+	}
+
+	//four pixels at a time through a 64 bit word, so the compiler keeps the loop free of byte shuffling branches
+	inline void pack_12bit(std::span<const uint16_t> pixels, std::span<uint8_t> packed) {
+		assert(packed.size() >= packed_12bit_size(pixels.size()));
+		uint16_t high_bits = 0;
+		size_t i = 0;
+		uint8_t* out = packed.data();
+		for (; i + 4 <= pixels.size(); i += 4, out += 6) {
+			const uint64_t a = pixels[i], b = pixels[i + 1], c = pixels[i + 2], d = pixels[i + 3];
+			high_bits |= static_cast<uint16_t>(a | b | c | d);
+			const uint64_t word = a | (b << 12) | (c << 24) | (d << 36);
+			uint8_t bytes[8];
+			std::memcpy(bytes, &word, sizeof(word));
+			std::memcpy(out, bytes, 6);
+		}
+		for (; i < pixels.size(); i += 2, out += 3) {
+			const uint16_t a = pixels[i];
+			const uint16_t b = i + 1 < pixels.size() ? pixels[i + 1] : 0;
+			high_bits |= a | b;
+			out[0] = static_cast<uint8_t>(a);
+			out[1] = static_cast<uint8_t>((a >> 8) | (b << 4));
+			if (i + 1 < pixels.size()) {
+				out[2] = static_cast<uint8_t>(b >> 4);
+			}
+		}
+		detail::check_12bit(high_bits);
+	}
+
+	inline void unpack_12bit(std::span<const uint8_t> packed, std::span<uint16_t> pixels) {
+		assert(packed.size() >= packed_12bit_size(pixels.size()));
+		size_t i = 0;
+		const uint8_t* in = packed.data();
+		//the 8 byte load needs two bytes of slack after the group
+		for (; i + 4 <= pixels.size() && (in - packed.data()) + 8 <= static_cast<ptrdiff_t>(packed.size()); i += 4, in += 6) {
+			uint64_t word;
+			std::memcpy(&word, in, sizeof(word));
+			pixels[i] = static_cast<uint16_t>(word & MAX_12BIT_VALUE);
+			pixels[i + 1] = static_cast<uint16_t>((word >> 12) & MAX_12BIT_VALUE);
+			pixels[i + 2] = static_cast<uint16_t>((word >> 24) & MAX_12BIT_VALUE);
+			pixels[i + 3] = static_cast<uint16_t>((word >> 36) & MAX_12BIT_VALUE);
+		}
+		for (; i < pixels.size(); i += 2, in += 3) {
+			pixels[i] = static_cast<uint16_t>(in[0] | ((in[1] & 0x0f) << 8));
+			if (i + 1 < pixels.size()) {
+				pixels[i + 1] = static_cast<uint16_t>((in[1] >> 4) | (in[2] << 4));
+			}
+		}
+	}
+
+	namespace detail {
+
+		//residuals of pixels [start, start + residuals.size()): the left neighbour predicts, except at the start of a
+		//row where the pixel above does. The whole block is differenced first and the row starts patched after, so
+		//the main loop has no branch. row_start is the first row start at or after start, it is moved past the block.
+		inline void delta_residuals(std::span<const uint16_t> pixels, size_t width, size_t start, std::span<uint16_t> residuals, size_t& row_start) {
+			const uint16_t* __restrict in = pixels.data() + start;
+			uint16_t* __restrict out = residuals.data();
+			for (size_t j = start == 0 ? 1 : 0; j < residuals.size(); j++) {
+				out[j] = zigzag(static_cast<int16_t>(in[j] - in[j - 1]));
+			}
+			const size_t end = start + residuals.size();
+			for (; row_start < end; row_start += width) {
+				const uint16_t above = row_start >= width ? pixels[row_start - width] : 0;
+				out[row_start - start] = zigzag(static_cast<int16_t>(pixels[row_start] - above));
+			}
+		}
+
+		inline size_t delta_block_bytes(size_t block_size, unsigned bit_width) {
+			return (block_size * bit_width + 7) / 8;
+		}
+
+		//Eight residuals of bit_width bits take exactly bit_width bytes, so a block is packed as groups of eight.
+		//Neighbouring residuals are merged into pairs and the pairs into fours with the same shift for all of them,
+		//so those loops vectorize, then each group stores its two fours as 64 bit words, the second one where the
+		//first ends, carrying its last partial byte. Stores run up to 8 bytes past the last group.
+		inline void pack_block(std::span<const uint16_t, DELTA_BLOCK_SIZE> residuals, unsigned bit_width, uint8_t* out) {
+			alignas(64) std::array<uint32_t, DELTA_BLOCK_SIZE / 2> pairs;
+			alignas(64) std::array<uint64_t, DELTA_BLOCK_SIZE / 4> fours;
+			for (size_t i = 0; i < pairs.size(); i++) {
+				pairs[i] = residuals[2 * i] | static_cast<uint32_t>(residuals[2 * i + 1]) << bit_width;
+			}
+			for (size_t i = 0; i < fours.size(); i++) {
+				fours[i] = pairs[2 * i] | static_cast<uint64_t>(pairs[2 * i + 1]) << (2 * bit_width);
+			}
+			const unsigned four_bits = 4 * bit_width;
+			const unsigned four_bytes = four_bits / 8;
+			for (size_t group = 0; group < DELTA_BLOCK_SIZE / 8; group++, out += bit_width) {
+				const uint64_t low = fours[2 * group];
+				const uint64_t carried = four_bytes < 8 ? low >> (8 * four_bytes) : 0;
+				const uint64_t high = carried | fours[2 * group + 1] << (four_bits % 8);
+				std::memcpy(out, &low, sizeof(low));
+				std::memcpy(out + four_bytes, &high, sizeof(high));
+			}
+		}
+
+		//the reverse of pack_block, reads up to 8 bytes past the last group
+		inline void unpack_block(const uint8_t* in, unsigned bit_width, std::span<uint16_t, DELTA_BLOCK_SIZE> residuals) {
+			alignas(64) std::array<uint32_t, DELTA_BLOCK_SIZE / 2> pairs;
+			alignas(64) std::array<uint64_t, DELTA_BLOCK_SIZE / 4> fours;
+			const unsigned four_bits = 4 * bit_width;
+			const uint64_t four_mask = four_bits < 64 ? (uint64_t{ 1 } << four_bits) - 1 : ~uint64_t{ 0 };
+			for (size_t group = 0; group < DELTA_BLOCK_SIZE / 8; group++, in += bit_width) {
+				uint64_t low, high;
+				std::memcpy(&low, in, sizeof(low));
+				std::memcpy(&high, in + four_bits / 8, sizeof(high));
+				fours[2 * group] = low & four_mask;
+				fours[2 * group + 1] = (high >> (four_bits % 8)) & four_mask;
+			}
+			const uint64_t pair_mask = (uint64_t{ 1 } << (2 * bit_width)) - 1;
+			for (size_t i = 0; i < fours.size(); i++) {
+				pairs[2 * i] = static_cast<uint32_t>(fours[i] & pair_mask);
+				pairs[2 * i + 1] = static_cast<uint32_t>(fours[i] >> (2 * bit_width));
+			}
+			const uint32_t mask = (uint32_t{ 1 } << bit_width) - 1;
+			for (size_t i = 0; i < pairs.size(); i++) {
+				residuals[2 * i] = static_cast<uint16_t>(pairs[i] & mask);
+				residuals[2 * i + 1] = static_cast<uint16_t>(pairs[i] >> bit_width);
+			}
+		}
+	}
+
+	//Residuals of 12 bit pixels have at most 13 bits, the output is sized for that up front with slack for the
+	//stores past the last group. A short last block packs zeros after its residuals, past its last byte.
+	inline std::vector<uint8_t> delta_bitpack(ImageView<const uint16_t> frame) {
+		MME_TRACE_SCOPE("delta_bitpack");
+		constexpr unsigned max_bit_width = 13;
+		const size_t width = frame.num_cols();
+		const auto pixels = frame.pixels();
+		const size_t num_blocks = (pixels.size() + detail::DELTA_BLOCK_SIZE - 1) / detail::DELTA_BLOCK_SIZE;
+		std::vector<uint8_t> out(num_blocks * (1 + detail::delta_block_bytes(detail::DELTA_BLOCK_SIZE, max_bit_width)) + sizeof(uint64_t));
+
+		alignas(64) std::array<uint16_t, detail::DELTA_BLOCK_SIZE> residuals{};
+		size_t pos = 0;
+		size_t row_start = 0;
+		for (size_t start = 0; start < pixels.size(); start += detail::DELTA_BLOCK_SIZE) {
+			const size_t block_size = std::min(detail::DELTA_BLOCK_SIZE, pixels.size() - start);
+			uint16_t high_bits = 0;
+			for (size_t j = 0; j < block_size; j++) {
+				high_bits |= pixels[start + j];
+			}
+			detail::check_12bit(high_bits);
+			std::fill(residuals.begin() + block_size, residuals.end(), uint16_t{ 0 });
+			detail::delta_residuals(pixels, width, start, std::span(residuals).first(block_size), row_start);
+
+			uint16_t all_bits = 0;
+			for (auto residual : residuals) {
+				all_bits |= residual;
+			}
+			const unsigned bit_width = static_cast<unsigned>(std::bit_width(all_bits));
+			out[pos++] = static_cast<uint8_t>(bit_width);
+			if (bit_width == 0) {
+				continue;
+			}
+
+			detail::pack_block(residuals, bit_width, out.data() + pos);
+			//blocks start on a byte boundary
+			pos += detail::delta_block_bytes(block_size, bit_width);
+		}
+		out.resize(pos);
+		return out;
+	}
+
+	//Blocks too close to the end of the data for the loads past their groups are copied out first. Rows are then
+	//summed up from their first pixel, which the pixel above predicts.
+	inline void delta_unpack(std::span<const uint8_t> data, ImageView<uint16_t> frame) {
+		MME_TRACE_SCOPE("delta_unpack");
+		const size_t width = frame.num_cols();
+		auto pixels = frame.pixels();
+		alignas(64) std::array<uint16_t, detail::DELTA_BLOCK_SIZE> residuals;
+		alignas(64) std::array<int16_t, detail::DELTA_BLOCK_SIZE> deltas;
+		std::array<uint8_t, detail::DELTA_BLOCK_SIZE * 2 + sizeof(uint64_t)> tail{};
+
+		size_t pos = 0;
+		size_t row_start = 0;
+		for (size_t start = 0; start < pixels.size(); start += detail::DELTA_BLOCK_SIZE) {
+			const size_t block_size = std::min(detail::DELTA_BLOCK_SIZE, pixels.size() - start);
+			if (pos >= data.size()) {
+				throw std::runtime_error("Truncated delta bit packed frame");
+			}
+			const unsigned bit_width = data[pos++];
+			if (bit_width > 16) {
+				throw std::runtime_error("Corrupt delta bit packed frame");
+			}
+			const size_t block_bytes = detail::delta_block_bytes(block_size, bit_width);
+			if (block_bytes > data.size() - pos) {
+				throw std::runtime_error("Truncated delta bit packed frame");
+			}
+			const uint8_t* block = data.data() + pos;
+			if (data.size() - pos < detail::delta_block_bytes(detail::DELTA_BLOCK_SIZE, bit_width) + sizeof(uint64_t)) {
+				std::copy_n(block, block_bytes, tail.begin());
+				block = tail.data();
+			}
+			pos += block_bytes;
+
+			detail::unpack_block(block, bit_width, residuals);
+			for (size_t j = 0; j < block_size; j++) {
+				deltas[j] = detail::unzigzag(residuals[j]);
+			}
+
+			//sums wrap like the differences did
+			const size_t end = start + block_size;
+			for (size_t i = start; i < end;) {
+				uint16_t previous = 0;
+				if (i == row_start) {
+					previous = static_cast<uint16_t>((i >= width ? pixels[i - width] : 0) + deltas[i - start]);
+					pixels[i++] = previous;
+					row_start += width;
+				}
+				else {
+					previous = pixels[i - 1];
+				}
+				for (const size_t segment_end = std::min(end, row_start); i < segment_end; i++) {
+					previous = static_cast<uint16_t>(previous + deltas[i - start]);
+					pixels[i] = previous;
+				}
+			}
+		}
+	}
+
+	inline EncodedFrame encode_frame(ImageView<const uint16_t> frame, FrameCodec codec = FrameCodec::Packed12) {
+		MME_TRACE_SCOPE("encode_frame");
+		EncodedFrame encoded{ frame.size(), codec, {} };
+		switch (codec) {
+		case FrameCodec::Packed12:
+			encoded.data.resize(packed_12bit_size(num_pixels(frame.size())));
+			pack_12bit(frame.pixels(), encoded.data);
+			break;
+		case FrameCodec::DeltaBitPacked:
+			encoded.data = delta_bitpack(frame);
+			break;
+		default:
+			throw std::invalid_argument("Unknown frame codec");
+		}
+		return encoded;
+	}
+
+	inline Image<uint16_t> decode_frame(const EncodedFrame& encoded) {
+		MME_TRACE_SCOPE("decode_frame");
+		Image<uint16_t> frame(encoded.size);
+		switch (encoded.codec) {
+		case FrameCodec::Packed12:
+			if (encoded.data.size() < packed_12bit_size(num_pixels(encoded.size))) {
+				throw std::runtime_error("Truncated 12 bit packed frame");
+			}
+			unpack_12bit(encoded.data, frame.pixels());
+			break;
+		case FrameCodec::DeltaBitPacked:
+			delta_unpack(encoded.data, frame.as_view());
+			break;
+		default:
+			throw std::runtime_error("Unknown frame codec");
+		}
+		return frame;
+	}
+
+	//frames are independent, so they are encoded one per chunk on the thread pool
+	inline std::vector<EncodedFrame> encode_frames(std::span<const ImageView<const uint16_t>> frames, FrameCodec codec = FrameCodec::Packed12) {
+		MME_TRACE_SCOPE("encode_frames");
+		std::vector<EncodedFrame> encoded(frames.size());
+		parallel_for(frames.size(), [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				encoded[i] = encode_frame(frames[i], codec);
+			}
+		}, 1);
+		return encoded;
+	}
+
+	//appends frames to a compressed frame file, usable wherever frames would otherwise go to save_to_numpy
+	class CompressedFrameWriter {
+	public:
+		CompressedFrameWriter(const std::string& filename, FrameCodec codec = FrameCodec::Packed12)
+			: m_file(filename, std::ios::binary | std::ios::trunc)
+			, m_codec(codec)
+		{
+			if (!m_file) {
+				throw std::runtime_error(std::format("Could not open {} for writing", filename));
+			}
+		}
+
+		void write(ImageView<const uint16_t> frame) {
+			write_encoded(encode_frame(frame, m_codec));
+		}
+
+		void write(std::span<const ImageView<const uint16_t>> frames) {
+			for (const auto& encoded : encode_frames(frames, m_codec)) {
+				write_encoded(encoded);
+			}
+		}
+
+		void write_encoded(const EncodedFrame& encoded) {
+			MME_TRACE_SCOPE("CompressedFrameWriter::write");
+			static_assert(std::endian::native == std::endian::little, "Frame file headers are little endian");
+			uint8_t header[32] = { 'M', 'M', 'E', 'F', 1, static_cast<uint8_t>(encoded.codec) };
+			const auto height = static_cast<uint32_t>(encoded.size.height);
+			const auto width = static_cast<uint32_t>(encoded.size.width);
+			const auto payload_size = static_cast<uint64_t>(encoded.data.size());
+			std::memcpy(header + 8, &height, sizeof(height));
+			std::memcpy(header + 12, &width, sizeof(width));
+			std::memcpy(header + 16, &payload_size, sizeof(payload_size));
+			m_file.write(reinterpret_cast<const char*>(header), sizeof(header));
+			m_file.write(reinterpret_cast<const char*>(encoded.data.data()), encoded.data.size());
+			if (!m_file) {
+				throw std::runtime_error("Could not write compressed frame");
+			}
+		}
+
+	private:
+		std::ofstream m_file;
+		FrameCodec m_codec;
+	};
+
+	//Header fields are checked against the file before anything is allocated for them: the payload must be in the
+	//file and hold at least one bit width byte per block of pixels, which bounds the frame size by the file size.
+	inline std::vector<Image<uint16_t>> load_compressed_frames(const std::string& filename) {
+		std::ifstream file(filename, std::ios::binary | std::ios::ate);
+		if (!file) {
+			throw std::runtime_error(std::format("Could not open {}", filename));
+		}
+		const auto file_size = static_cast<uint64_t>(file.tellg());
+		file.seekg(0);
+		std::vector<Image<uint16_t>> frames;
+		uint8_t header[32];
+		while (file.read(reinterpret_cast<char*>(header), sizeof(header))) {
+			if (std::memcmp(header, "MMEF", 4) != 0 || header[4] != 1) {
+				throw std::runtime_error(std::format("{} is not a compressed frame file", filename));
+			}
+			const auto codec = static_cast<FrameCodec>(header[5]);
+			if (codec != FrameCodec::Packed12 && codec != FrameCodec::DeltaBitPacked) {
+				throw std::runtime_error(std::format("Unknown frame codec {} in {}", header[5], filename));
+			}
+			uint32_t height, width;
+			uint64_t payload_size;
+			std::memcpy(&height, header + 8, sizeof(height));
+			std::memcpy(&width, header + 12, sizeof(width));
+			std::memcpy(&payload_size, header + 16, sizeof(payload_size));
+			const auto remaining = file_size - static_cast<uint64_t>(file.tellg());
+			if (payload_size > remaining) {
+				throw std::runtime_error(std::format("Truncated frame in {}", filename));
+			}
+			const uint64_t frame_pixels = uint64_t{ height } * width;
+			if ((frame_pixels + detail::DELTA_BLOCK_SIZE - 1) / detail::DELTA_BLOCK_SIZE > payload_size) {
+				throw std::runtime_error(std::format("Frame of {}x{} does not fit its {} payload bytes in {}", height, width, payload_size, filename));
+			}
+
+			EncodedFrame encoded{ ImageSize{ height, width }, codec, std::vector<uint8_t>(payload_size) };
+			if (!file.read(reinterpret_cast<char*>(encoded.data.data()), payload_size)) {
+				throw std::runtime_error(std::format("Truncated frame in {}", filename));
+			}
+			frames.push_back(decode_frame(encoded));
+		}
+		if (file.gcount() != 0) {
+			throw std::runtime_error(std::format("Truncated frame header in {}", filename));
+		}
+		return frames;
+	}
+
+} //namespace mme
@@ -0,0 +1,175 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/imaging/conversion.h"
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <format>
+#include <stdexcept>
+
+namespace mme {
+
+	struct Roi {
+		size_t row;
+		size_t col;
+		ImageSize size;
+	};
+
+	struct StatisticsOptions {
+		unsigned bit_depth = 12; //of the converted values
+		unsigned histogram_bits = 8; //2^histogram_bits bins of equal width over the bit depth
+		std::optional<uint16_t> saturation_level; //largest value of the bit depth when empty
+		std::vector<Roi> rois;
+	};
+
+	struct FrameStatistics {
+		uint16_t min = 0;
+		uint16_t max = 0;
+		uint64_t sum = 0;
+		size_t num_pixels = 0;
+		size_t saturated = 0; //pixels at or above the saturation level
+		std::vector<uint32_t> histogram;
+		std::vector<uint64_t> roi_sums; //same order as StatisticsOptions::rois
+
+		double mean() const {
+			return num_pixels > 0 ? static_cast<double>(sum) / num_pixels : 0.0;
+		}
+
+		double saturated_fraction() const {
+			return num_pixels > 0 ? static_cast<double>(saturated) / num_pixels : 0.0;
+		}
+	};
+
+	//a captured frame with the statistics gathered while it was converted
+	template<typename Pixel>
+	struct FrameWithStatistics {
+		Image<Pixel> image;
+		FrameStatistics statistics;
+	};
+
+	namespace detail {
+
+		inline void check_statistics_options(const StatisticsOptions& options, ImageSize size) {
+			if (options.bit_depth == 0 || options.bit_depth > 16 || options.histogram_bits > options.bit_depth) {
+				throw std::invalid_argument(std::format("Invalid statistics options: {} bit values with {} bit histogram", options.bit_depth, options.histogram_bits));
+			}
+			for (const auto& roi : options.rois) {
+				if (roi.row + roi.size.height > size.height || roi.col + roi.size.width > size.width) {
+					throw std::invalid_argument(std::format("ROI at ({}, {}) of {}x{} is outside the {}x{} frame",
+						roi.row, roi.col, roi.size.height, roi.size.width, size.height, size.width));
+				}
+			}
+		}
+
+		//One pass over the frame: every row is converted (value >> Shift) into destination while min, max, sum
+		//and saturation are reduced in the same vectorizable loop. The histogram and ROI sums then read a
+		//uint16 copy of the converted row from L1, so the frame is only streamed from memory once.
+		//source and destination may be the same buffer, a null destination only gathers statistics.
+		template<unsigned Shift, typename Pixel>
+		FrameStatistics convert_with_statistics(const uint16_t* source, Pixel* destination, ImageSize size, const StatisticsOptions& options) {
+			MME_TRACE_SCOPE("convert_with_statistics");
+			check_statistics_options(options, size);
+			const uint16_t saturation_level = options.saturation_level.value_or(static_cast<uint16_t>((1u << options.bit_depth) - 1));
+			const unsigned histogram_shift = options.bit_depth - options.histogram_bits;
+			const size_t num_bins = size_t{ 1 } << options.histogram_bits;
+
+			//interleaved partial histograms so runs of equal values do not serialize on one counter
+			constexpr size_t NUM_PARTIALS = 4;
+			std::vector<uint32_t> partials(NUM_PARTIALS * num_bins, 0);
+			std::vector<uint16_t> values(size.width); //converted row, stays in L1
+
+			FrameStatistics stats;
+			stats.num_pixels = num_pixels(size);
+			stats.roi_sums.assign(options.rois.size(), 0);
+			uint16_t min = std::numeric_limits<uint16_t>::max();
+			uint16_t max = 0;
+			for (size_t row = 0; row < size.height; row++) {
+				const uint16_t* src = source + row * size.width;
+				Pixel* dst = destination ? destination + row * size.width : nullptr;
+
+				uint16_t row_min = std::numeric_limits<uint16_t>::max();
+				uint16_t row_max = 0;
+				uint32_t row_sum = 0; //65535 * 65535 still fits
+				uint32_t row_saturated = 0;
+				auto reduce_row = [&](auto store) {
+					for (size_t col = 0; col < size.width; col++) {
+						const uint16_t value = static_cast<uint16_t>(src[col] >> Shift);
+						store(col, value);
+						values[col] = value;
+						row_min = std::min(row_min, value);
+						row_max = std::max(row_max, value);
+						row_sum += value;
+						row_saturated += value >= saturation_level ? 1 : 0;
+					}
+				};
+				if (dst) {
+					reduce_row([dst](size_t col, uint16_t value) { dst[col] = static_cast<Pixel>(value); });
+				}
+				else {
+					reduce_row([](size_t, uint16_t) {});
+				}
+				min = std::min(min, row_min);
+				max = std::max(max, row_max);
+				stats.sum += row_sum;
+				stats.saturated += row_saturated;
+
+				size_t col = 0;
+				for (; col + NUM_PARTIALS <= size.width; col += NUM_PARTIALS) {
+					for (size_t k = 0; k < NUM_PARTIALS; k++) {
+						partials[k * num_bins + std::min<size_t>(values[col + k] >> histogram_shift, num_bins - 1)]++;
+					}
+				}
+				for (; col < size.width; col++) {
+					partials[std::min<size_t>(values[col] >> histogram_shift, num_bins - 1)]++;
+				}
+
+				for (size_t r = 0; r < options.rois.size(); r++) {
+					const auto& roi = options.rois[r];
+					if (row < roi.row || row >= roi.row + roi.size.height) {
+						continue;
+					}
+					uint64_t roi_sum = 0;
+					for (size_t c = roi.col; c < roi.col + roi.size.width; c++) {
+						roi_sum += values[c];
+					}
+					stats.roi_sums[r] += roi_sum;
+				}
+			}
+			stats.min = stats.num_pixels > 0 ? min : 0;
+			stats.max = max;
+
+			stats.histogram.assign(partials.begin(), partials.begin() + num_bins);
+			for (size_t k = 1; k < NUM_PARTIALS; k++) {
+				for (size_t bin = 0; bin < num_bins; bin++) {
+					stats.histogram[bin] += partials[k * num_bins + bin];
+				}
+			}
+			return stats;
+		}
+	}
+
+	//unpack_pf16 that also gathers the frame statistics
+	inline FrameStatistics unpack_pf16_with_statistics(ImageView<const uint16_t> raw, ImageView<float> pixels, const StatisticsOptions& options = {}) {
+		assert(raw.size() == pixels.size());
+		return detail::convert_with_statistics<PF16_SHIFT>(raw.pixels().data(), pixels.pixels().data(), raw.size(), options);
+	}
+
+	inline FrameStatistics unpack_pf16_with_statistics(ImageView<uint16_t> raw, const StatisticsOptions& options = {}) {
+		return detail::convert_with_statistics<PF16_SHIFT>(raw.pixels().data(), raw.pixels().data(), raw.size(), options);
+	}
+
+	//convert_pixels that also gathers the frame statistics
+	inline FrameStatistics convert_with_statistics(ImageView<const uint16_t> source, ImageView<float> destination, const StatisticsOptions& options = {}) {
+		assert(source.size() == destination.size());
+		return detail::convert_with_statistics<0>(source.pixels().data(), destination.pixels().data(), source.size(), options);
+	}
+
+	//for frames that were already converted, costs a full pass over the frame
+	inline FrameStatistics compute_statistics(ImageView<const uint16_t> image, const StatisticsOptions& options = {}) {
+		return detail::convert_with_statistics<0, uint16_t>(image.pixels().data(), nullptr, image.size(), options);
+	}
+
+} //namespace mme
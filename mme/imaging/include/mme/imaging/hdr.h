@@ -0,0 +1,137 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/imaging/camera.h"
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <format>
+#include <stdexcept>
+
+namespace mme {
+
+	struct HdrOptions {
+		float saturation_level = 4095.0f; //values at or above carry no information
+		float black_level = 0.0f; //subtracted before the exposure is divided out
+	};
+
+	//Streaming exposure fusion. Every frame of a bracket is folded into two running sums, so memory does not
+	//grow with the bracket length:
+	//  radiance = sum(w * (z - black)) / sum(w * t)
+	//with a hat weight w that peaks mid range and is zero for saturated values. For a linear sensor this is
+	//the weighted least squares estimate of counts per ms. Pixels that saturate in every frame get the lower
+	//bound saturation / shortest exposure.
+	class HdrFusion {
+	public:
+		HdrFusion(ImageSize size, HdrOptions options = {})
+			: m_options(options)
+			, m_weighted_counts(0.0f, size)
+			, m_weighted_exposure(0.0f, size)
+		{
+			if (!(m_options.saturation_level > m_options.black_level)) {
+				throw std::invalid_argument(std::format("HDR saturation level {} must be above the black level {}", m_options.saturation_level, m_options.black_level));
+			}
+		}
+
+		void add(ImageView<const uint16_t> frame, Exposure exposure) {
+			accumulate(frame, exposure);
+		}
+
+		void add(ImageView<const float> frame, Exposure exposure) {
+			accumulate(frame, exposure);
+		}
+
+		size_t num_frames() const {
+			return m_num_frames;
+		}
+
+		ImageSize size() const {
+			return m_weighted_counts.size();
+		}
+
+		//counts per ms
+		Image<float> result() const {
+			MME_TRACE_SCOPE("HdrFusion::result");
+			if (m_num_frames == 0) {
+				throw std::logic_error("HDR fusion needs at least one frame");
+			}
+			Image<float> radiance(size());
+			const float saturated = (m_options.saturation_level - m_options.black_level) / static_cast<float>(m_shortest_exposure);
+			const float* counts = m_weighted_counts.pixels().data();
+			const float* exposure = m_weighted_exposure.pixels().data();
+			float* out = radiance.pixels().data();
+			const size_t count = radiance.pixels().size();
+			for (size_t i = 0; i < count; i++) {
+				//counts are 0 wherever the exposure sum is, so this stays a select free of branches
+				const float unmeasured = exposure[i] > 0.0f ? 0.0f : saturated;
+				out[i] = counts[i] / std::max(exposure[i], std::numeric_limits<float>::min()) + unmeasured;
+			}
+			return radiance;
+		}
+
+	private:
+		template<typename Pixel>
+		void accumulate(ImageView<const Pixel> frame, Exposure exposure) {
+			MME_TRACE_SCOPE("HdrFusion::add");
+			if (frame.size() != size()) {
+				throw std::invalid_argument(std::format("HDR frame of {}x{} does not match the fusion size {}x{}",
+					frame.size().height, frame.size().width, size().height, size().width));
+			}
+			if (!(exposure.value > 0.0)) {
+				throw std::invalid_argument(std::format("HDR exposure must be positive, got {} ms", exposure.value));
+			}
+			const float t = static_cast<float>(exposure.value);
+			const float black = m_options.black_level;
+			const float saturation = m_options.saturation_level;
+			const Pixel* src = frame.pixels().data();
+			float* counts = m_weighted_counts.pixels().data();
+			float* exposures = m_weighted_exposure.pixels().data();
+			const size_t count = frame.pixels().size();
+			//branch free so it vectorizes, the +1 keeps dark pixels at a small weight instead of none
+			for (size_t i = 0; i < count; i++) {
+				const float value = static_cast<float>(src[i]);
+				const float z = value - black;
+				const float hat = std::max(std::min(z, saturation - value) + 1.0f, 0.0f);
+				const float w = value < saturation ? hat : 0.0f;
+				counts[i] += w * z;
+				exposures[i] += w * t;
+			}
+			m_shortest_exposure = std::min(m_shortest_exposure, exposure.value);
+			m_num_frames++;
+		}
+
+	private:
+		HdrOptions m_options;
+		Image<float> m_weighted_counts;
+		Image<float> m_weighted_exposure;
+		double m_shortest_exposure = std::numeric_limits<double>::infinity();
+		size_t m_num_frames = 0;
+	};
+
+	//Captures one raw frame per bracket exposure and fuses them as they arrive. The camera exposure is
+	//restored afterwards.
+	template<Camera C>
+	Image<float> capture_hdr(C& camera, std::span<const Exposure> bracket, HdrOptions options = {}) {
+		MME_TRACE_SCOPE("capture_hdr");
+		if (bracket.empty()) {
+			throw std::invalid_argument("HDR bracket needs at least one exposure");
+		}
+		const Exposure previous = camera.exposure();
+		HdrFusion fusion(camera.image_size(), options);
+		try {
+			for (const auto& exposure : bracket) {
+				camera.set_exposure(exposure);
+				const auto frame = camera.capture_raw();
+				fusion.add(frame.as_view(), exposure);
+			}
+		}
+		catch (...) {
+			camera.set_exposure(previous);
+			throw;
+		}
+		camera.set_exposure(previous);
+		return fusion.result();
+	}
+
+} //namespace mme
@@ -4,24 +4,91 @@
 #include <format>
 #include <assert.h>
 #include <string_view>
+#include <memory_resource>
+#include <type_traits>
+#include <concepts>
+#include <algorithm>
+#include <new>
 #include "npy.hpp"
+#include "mme/tracing/trace.h"
 
 namespace mme {
 
 	struct ImageSize {
 		size_t height;
 		size_t width;
+
+		bool operator==(const ImageSize& other) const = default;
 	};
 
 	constexpr size_t num_pixels(const ImageSize& size) {
 		return size.height * size.width;
 	}
 
+	//Pixel storage of an Image starts on a 64 byte boundary (cache line, AVX-512 register).
+	//Rows only stay aligned when width * sizeof(Pixel) is a multiple of it.
+	inline constexpr size_t IMAGE_ALIGNMENT = 64;
+
+	//Allocates from a std::pmr::memory_resource (the global heap by default) with at least Alignment.
+	//Elements are default-initialized, so sized construction of trivial pixel types skips zero-filling.
+	template<typename T, size_t Alignment = IMAGE_ALIGNMENT>
+	class AlignedAllocator {
+	public:
+		using value_type = T;
+
+		template<typename U>
+		struct rebind {
+			using other = AlignedAllocator<U, Alignment>;
+		};
+
+		AlignedAllocator() noexcept : m_resource(std::pmr::new_delete_resource()) {}
+		AlignedAllocator(std::pmr::memory_resource* resource) noexcept : m_resource(resource) {}
+
+		template<typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment>& other) noexcept : m_resource(other.resource()) {}
+
+		T* allocate(size_t n) {
+			return static_cast<T*>(m_resource->allocate(n * sizeof(T), alignment));
+		}
+
+		void deallocate(T* p, size_t n) noexcept {
+			m_resource->deallocate(p, n * sizeof(T), alignment);
+		}
+
+		template<typename U, typename... Args>
+		void construct(U* p, Args&&... args) {
+			if constexpr (sizeof...(Args) == 0) {
+				::new(static_cast<void*>(p)) U;
+			}
+			else {
+				::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+			}
+		}
+
+		std::pmr::memory_resource* resource() const noexcept {
+			return m_resource;
+		}
+
+		template<typename U>
+		bool operator==(const AlignedAllocator<U, Alignment>& other) const noexcept {
+			return m_resource == other.resource() || m_resource->is_equal(*other.resource());
+		}
+
+	private:
+		static constexpr size_t alignment = std::max(Alignment, alignof(T));
+		std::pmr::memory_resource* m_resource;
+	};
+
 	template<typename Pixel>
 	struct ImageView {
 		ImageView() = default;
 		ImageView(std::span<Pixel> pixels, ImageSize size) : m_pixels(pixels), m_size(size) {}
 
+		//ImageView<T> converts to ImageView<const T>
+		template<typename Other>
+			requires std::is_convertible_v<Other(*)[], Pixel(*)[]>
+		ImageView(ImageView<Other> other) : m_pixels(other.pixels()), m_size(other.size()) {}
+
 		Pixel& operator() (size_t row, size_t col) {
 			return m_pixels[linear_index(row, col)];
 		}
@@ -51,14 +118,14 @@ namespace mme {
 		}
 
 		ImageView<const Pixel> sub_view(size_t row_start, size_t num_rows) const {
-			return ImageView<Pixel>(m_pixels.subspan(linear_index(row_start, 0), m_size.width * num_rows), { num_rows, m_size.width });
+			return ImageView<const Pixel>(m_pixels.subspan(linear_index(row_start, 0), m_size.width * num_rows), { num_rows, m_size.width });
 		}
 		ImageView<Pixel> sub_view(size_t row_start) {
-			return ImageView<Pixel>(m_pixels.subspan(row_start, std::dynamic_extent), { m_size.height - row_start, m_size.width });
+			return ImageView<Pixel>(m_pixels.subspan(linear_index(row_start, 0), std::dynamic_extent), { m_size.height - row_start, m_size.width });
 		}
 
 		ImageView<const Pixel> sub_view(size_t row_start) const {
-			return ImageView<Pixel>(m_pixels.subspan(row_start, std::dynamic_extent), { .height = m_size.height - row_start, .width = m_size.width });
+			return ImageView<const Pixel>(m_pixels.subspan(linear_index(row_start, 0), std::dynamic_extent), { .height = m_size.height - row_start, .width = m_size.width });
 		}
 
 		size_t num_rows() const {
@@ -82,7 +149,7 @@ namespace mme {
 		}
 
 	private:
-		size_t linear_index(size_t row, size_t col) {
+		size_t linear_index(size_t row, size_t col) const {
 			return col + row * m_size.width;
 		}
 
@@ -92,29 +159,72 @@ namespace mme {
 	};
 
 
-	template<typename Pixel>
+	template<typename Pixel, typename Allocator = AlignedAllocator<Pixel>>
 	struct Image {
-		Image(std::vector<Pixel> pixels, ImageSize size)
+		using allocator_type = Allocator;
+
+		//takes over the storage, frames built with the image's allocator are never copied
+		Image(std::vector<Pixel, Allocator> pixels, ImageSize size)
 			: m_pixels(std::move(pixels))
 			, m_view(m_pixels, size)
 		{
+			assert(m_pixels.size() == num_pixels(size));
+		}
+		//storage from another allocator has to be copied to be aligned
+		template<typename OtherAllocator> requires (!std::same_as<OtherAllocator, Allocator>)
+		Image(const std::vector<Pixel, OtherAllocator>& pixels, ImageSize size, const Allocator& allocator = Allocator())
+			: m_pixels(pixels.begin(), pixels.end(), allocator)
+			, m_view(m_pixels, size)
+		{
+			assert(m_pixels.size() == num_pixels(size));
 		}
-		Image(std::span<Pixel> pixels, ImageSize size)
-			: m_pixels(pixels.begin(), pixels.end())
+		Image(std::span<const Pixel> pixels, ImageSize size, const Allocator& allocator = Allocator())
+			: m_pixels(pixels.begin(), pixels.end(), allocator)
 			, m_view(m_pixels, size)
 		{
+			assert(m_pixels.size() == num_pixels(size));
 		}
-		Image(Pixel fill_value, ImageSize size)
-			: m_pixels(num_pixels(size), fill_value), m_view(m_pixels, size)
+		Image(Pixel fill_value, ImageSize size, const Allocator& allocator = Allocator())
+			: m_pixels(num_pixels(size), fill_value, allocator), m_view(m_pixels, size)
 		{
 		}
 
-		Image(ImageSize size)
+		//pixels are left uninitialized (default-initialized with AlignedAllocator), for frames that are written right away
+		Image(ImageSize size, const Allocator& allocator = Allocator())
+			: m_pixels(num_pixels(size), allocator), m_view(m_pixels, size)
 		{
-			m_pixels.reserve(num_pixels(size)); //logical length of owning vector is 0
-			m_view = ImageView<Pixel>{ std::span<Pixel>{m_pixels.data(), num_pixels(size)}, size};
 		}
 
+		//the view refers into m_pixels, so it is rebuilt whenever the storage changes hands
+		Image(const Image& other)
+			: m_pixels(other.m_pixels), m_view(m_pixels, other.size())
+		{
+		}
+		Image(Image&& other) noexcept
+			: m_pixels(std::move(other.m_pixels)), m_view(m_pixels, other.size())
+		{
+			other.m_view = ImageView<Pixel>{};
+		}
+		Image& operator=(const Image& other) {
+			if (this != &other) {
+				m_pixels = other.m_pixels;
+				m_view = ImageView<Pixel>(m_pixels, other.size());
+			}
+			return *this;
+		}
+		Image& operator=(Image&& other) noexcept(std::allocator_traits<Allocator>::is_always_equal::value
+			|| std::allocator_traits<Allocator>::propagate_on_container_move_assignment::value) {
+			if (this != &other) {
+				const auto size = other.size();
+				m_pixels = std::move(other.m_pixels);
+				m_view = ImageView<Pixel>(m_pixels, size);
+				other.m_view = ImageView<Pixel>{};
+			}
+			return *this;
+		}
+
+		Allocator get_allocator() const { return m_pixels.get_allocator(); }
+
 		ImageSize size() const { return m_view.size(); }
 		std::span<const Pixel> pixels() const { return m_view.pixels(); }
 		std::span<Pixel> pixels() { return m_view.pixels(); }
@@ -127,21 +237,61 @@ namespace mme {
 			return ImageView<const Pixel>(m_view.pixels(), m_view.size());
 		}
 	private:
-		std::vector<Pixel> m_pixels;
+		std::vector<Pixel, Allocator> m_pixels;
 		ImageView<Pixel> m_view;
 	};
 
+	namespace pmr {
+		template<typename Pixel>
+		using Image = mme::Image<Pixel, std::pmr::polymorphic_allocator<Pixel>>;
+	}
+
+	//Monotonic arena for the frames of a scan: allocation is a pointer bump and everything is freed at once by release().
+	//All images allocated from the arena must be destroyed before release() or the arena itself.
+	class ImageArena {
+	public:
+		ImageArena(size_t initial_bytes = 0)
+			: m_resource(initial_bytes > 0 ? initial_bytes : 1024)
+		{
+		}
+
+		ImageArena(const ImageArena& other) = delete;
+		ImageArena& operator=(const ImageArena& other) = delete;
+
+		template<typename Pixel>
+		Image<Pixel> make_image(ImageSize size) {
+			return Image<Pixel>(size, AlignedAllocator<Pixel>(&m_resource));
+		}
+
+		template<typename Pixel>
+		Image<Pixel> make_image(Pixel fill_value, ImageSize size) {
+			return Image<Pixel>(fill_value, size, AlignedAllocator<Pixel>(&m_resource));
+		}
+
+		std::pmr::memory_resource* resource() {
+			return &m_resource;
+		}
+
+		void release() {
+			m_resource.release();
+		}
+
+	private:
+		std::pmr::monotonic_buffer_resource m_resource;
+	};
+
 
 	template<typename T>
 	void save_to_numpy(const std::string& filename, ImageView<T> image_view) {
+		MME_TRACE_SCOPE("save_to_numpy");
 		const unsigned long num_rows = image_view.size().height;
 		const unsigned long num_cols = image_view.size().width;
 		const unsigned long shape[] = { num_rows, num_cols };
 		npy::SaveArrayAsNumpy(filename, false, 2, shape, image_view.pixels().data());		
 	}
 
-	template<typename T>
-	void save_to_numpy(const std::string& filename, const Image<T>& image) {
+	template<typename T, typename Allocator>
+	void save_to_numpy(const std::string& filename, const Image<T, Allocator>& image) {
 		save_to_numpy(filename, image.as_view());
 	}
 }
\ No newline at end of file
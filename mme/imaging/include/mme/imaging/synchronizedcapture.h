@@ -0,0 +1,153 @@
+#pragma once
+#include "mme/imaging/camera.h"
+#include "mme/tracing/trace.h"
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include <vector>
+#include <cstdint>
+
+namespace mme {
+
+	struct TimestampedFrame {
+		Image<uint16_t> frame;
+		std::chrono::steady_clock::time_point timestamp; //middle of the capture call
+		uint64_t index;
+	};
+
+	struct FramePair {
+		TimestampedFrame first;
+		TimestampedFrame second;
+
+		std::chrono::steady_clock::duration skew() const {
+			return first.timestamp > second.timestamp ? first.timestamp - second.timestamp : second.timestamp - first.timestamp;
+		}
+	};
+
+	namespace detail {
+
+		//frames from one camera, captured on its own thread. Bounded, the oldest frame is dropped when the consumer falls behind
+		template<Camera C>
+		class CameraStream {
+		public:
+			CameraStream(C& camera, size_t max_queued)
+				: m_max_queued(max_queued)
+				, m_thread([this, &camera](std::stop_token stop) { run(camera, stop); })
+			{}
+
+			~CameraStream() {
+				m_thread.request_stop();
+				m_cv.notify_all();
+			}
+
+			TimestampedFrame pop() {
+				std::unique_lock lock(m_mutex);
+				m_cv.wait(lock, [this] { return !m_frames.empty() || m_error; });
+				if (m_error) {
+					std::rethrow_exception(m_error);
+				}
+				auto frame = std::move(m_frames.front());
+				m_frames.pop_front();
+				return frame;
+			}
+
+			uint64_t num_dropped() const {
+				std::scoped_lock lock(m_mutex);
+				return m_dropped;
+			}
+
+		private:
+			void run(C& camera, std::stop_token stop) {
+				uint64_t index = 0;
+				try {
+					while (!stop.stop_requested()) {
+						const auto start = std::chrono::steady_clock::now();
+						auto frame = camera.capture_raw();
+						const auto end = std::chrono::steady_clock::now();
+
+						std::scoped_lock lock(m_mutex);
+						if (m_frames.size() == m_max_queued) {
+							m_frames.pop_front();
+							m_dropped++;
+						}
+						m_frames.push_back({ std::move(frame), start + (end - start) / 2, index++ });
+						m_cv.notify_all();
+					}
+				}
+				catch (...) {
+					std::scoped_lock lock(m_mutex);
+					m_error = std::current_exception();
+					m_cv.notify_all();
+				}
+			}
+
+			size_t m_max_queued;
+			mutable std::mutex m_mutex;
+			std::condition_variable m_cv;
+			std::deque<TimestampedFrame> m_frames;
+			uint64_t m_dropped = 0;
+			std::exception_ptr m_error;
+			std::jthread m_thread; //last, so it starts after the members above exist
+		};
+	}
+
+	//free runs both cameras, each on its own thread, and pairs frames whose timestamps are within the tolerance.
+	//A frame without a partner is dropped, so a slower camera sets the pair rate.
+	//The cameras belong to the capture threads until the SynchronizedCapture is destroyed.
+	template<Camera A, Camera B>
+	class SynchronizedCapture {
+	public:
+		SynchronizedCapture(A& first, B& second, std::chrono::steady_clock::duration tolerance, size_t max_queued = 4)
+			: m_tolerance(tolerance)
+			, m_first(first, max_queued)
+			, m_second(second, max_queued)
+		{}
+
+		FramePair next() {
+			MME_TRACE_SCOPE("SynchronizedCapture::next");
+			auto first = m_first.pop();
+			auto second = m_second.pop();
+			while (true) {
+				const auto difference = first.timestamp - second.timestamp;
+				if (difference <= m_tolerance && -difference <= m_tolerance) {
+					return { std::move(first), std::move(second) };
+				}
+				//the earlier frame cannot match anything later than the current partner, replace it
+				m_unpaired++;
+				if (difference < std::chrono::steady_clock::duration::zero()) {
+					first = m_first.pop();
+				}
+				else {
+					second = m_second.pop();
+				}
+			}
+		}
+
+		std::vector<FramePair> capture(size_t num_pairs) {
+			std::vector<FramePair> pairs;
+			pairs.reserve(num_pairs);
+			for (size_t i = 0; i < num_pairs; i++) {
+				pairs.push_back(next());
+			}
+			return pairs;
+		}
+
+		uint64_t num_unpaired() const {
+			return m_unpaired;
+		}
+
+		uint64_t num_dropped() const {
+			return m_first.num_dropped() + m_second.num_dropped();
+		}
+
+	private:
+		std::chrono::steady_clock::duration m_tolerance;
+		uint64_t m_unpaired = 0;
+		detail::CameraStream<A> m_first;
+		detail::CameraStream<B> m_second;
+	};
+
+}
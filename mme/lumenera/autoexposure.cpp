@@ -0,0 +1,160 @@
+#include "mme/lumenera/autoexposure.h"
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <format>
+#include <utility>
+#include "mme/tracing/trace.h"
+
+mme::ExposureCache mme::ExposureCache::load(const std::filesystem::path& path)
+{
+	ExposureCache cache;
+	std::ifstream file{ path };
+	if (!file) {
+		return cache;
+	}
+	//one "wavelength polarization_state binning exposure" entry per line
+	ExposureKey key{};
+	double exposure = 0.0;
+	while (file >> key.wavelength >> key.polarization_state >> key.binning >> exposure) {
+		cache.store(key, Exposure{ exposure });
+	}
+	return cache;
+}
+
+void mme::ExposureCache::save(const std::filesystem::path& path) const
+{
+	std::ofstream file{ path };
+	if (!file) {
+		throw std::runtime_error(std::format("Could not write exposure cache to {}", path.string()));
+	}
+	for (const auto& [key, exposure] : m_exposures) {
+		const auto& [wavelength_pm, state, binning] = key;
+		file << std::format("{} {} {} {}\n", wavelength_pm / 1000.0, state, binning, exposure);
+	}
+}
+
+std::optional<mme::Exposure> mme::ExposureCache::find(const ExposureKey& key) const
+{
+	auto it = m_exposures.find(make_key(key));
+	if (it == m_exposures.end()) {
+		return std::nullopt;
+	}
+	return Exposure{ it->second };
+}
+
+void mme::ExposureCache::store(const ExposureKey& key, Exposure exposure)
+{
+	m_exposures[make_key(key)] = exposure.value;
+}
+
+size_t mme::ExposureCache::size() const
+{
+	return m_exposures.size();
+}
+
+mme::ExposureCache::Key mme::ExposureCache::make_key(const ExposureKey& key)
+{
+	return { std::llround(key.wavelength * 1000.0), key.polarization_state, key.binning };
+}
+
+namespace {
+
+	template<typename Pixel>
+	mme::ExposureEstimate estimate_from_histogram(mme::ImageView<const Pixel> frame, mme::Exposure current, const mme::AutoExposureSettings& settings)
+	{
+		using namespace mme;
+		MME_TRACE_SCOPE("estimate_exposure");
+		const auto pixels = frame.pixels();
+		if (pixels.empty()) {
+			return { current, false };
+		}
+
+		const size_t num_bins = static_cast<size_t>(settings.full_scale) + 1;
+		std::vector<size_t> histogram(num_bins, 0);
+		for (auto pixel : pixels) {
+			const auto bin = static_cast<size_t>(std::clamp(static_cast<float>(pixel), 0.0f, static_cast<float>(settings.full_scale)));
+			histogram[bin]++;
+		}
+
+		auto clamp_exposure = [&](double exposure) {
+			return Exposure{ std::clamp(exposure, settings.min_exposure.value, settings.max_exposure.value) };
+		};
+
+		const double saturated_fraction = static_cast<double>(histogram.back()) / pixels.size();
+		if (saturated_fraction > settings.max_saturated_fraction) {
+			//the true level is unknown once the sensor clips, back off hard
+			return { clamp_exposure(current.value / 4.0), false };
+		}
+
+		const auto percentile_count = static_cast<size_t>(settings.percentile * pixels.size());
+		size_t cumulative = 0;
+		size_t percentile_bin = 0;
+		for (; percentile_bin < num_bins; percentile_bin++) {
+			cumulative += histogram[percentile_bin];
+			if (cumulative > percentile_count) {
+				break;
+			}
+		}
+
+		const double target = settings.target_level * settings.full_scale;
+		const double level = static_cast<double>(percentile_bin);
+		if (level < 1.0) {
+			return { clamp_exposure(current.value * 8.0), false };
+		}
+
+		const bool converged = std::abs(level / target - 1.0) <= settings.tolerance;
+		auto next = clamp_exposure(current.value * target / level);
+		return { next, converged || next.value == current.value };
+	}
+}
+
+mme::ExposureEstimate mme::estimate_exposure(ImageView<const float> frame, Exposure current, const AutoExposureSettings& settings)
+{
+	return estimate_from_histogram(frame, current, settings);
+}
+
+mme::ExposureEstimate mme::estimate_exposure(ImageView<const uint16_t> frame, Exposure current, const AutoExposureSettings& settings)
+{
+	return estimate_from_histogram(frame, current, settings);
+}
+
+mme::AutoExposure::AutoExposure(LumeneraCamera& camera, ExposureCache& cache, AutoExposureSettings settings)
+	: m_camera(camera)
+	, m_cache(cache)
+	, m_settings(settings)
+	, m_trial_frames(0)
+{
+}
+
+mme::ExposureEstimate mme::AutoExposure::expose_for(double wavelength, size_t polarization_state)
+{
+	MME_TRACE_SCOPE("AutoExposure::expose_for");
+	const ExposureKey key{ wavelength, polarization_state, m_camera.binning().value };
+	if (auto cached = m_cache.find(key)) {
+		m_camera.set_exposure(*cached);
+		return { *cached, true };
+	}
+
+	auto exposure = m_camera.exposure();
+	for (size_t trial = 0; trial < m_settings.max_trials; trial++) {
+		auto frame = m_camera.capture_raw();
+		m_trial_frames++;
+		auto estimate = estimate_exposure(std::as_const(frame).as_view(), exposure, m_settings);
+		if (estimate.converged) {
+			//only exposures a frame has confirmed are worth keeping
+			m_cache.store(key, exposure);
+			return { exposure, true };
+		}
+		exposure = estimate.exposure;
+		m_camera.set_exposure(exposure);
+	}
+	return { exposure, false };
+}
+
+size_t mme::AutoExposure::trial_frames() const
+{
+	return m_trial_frames;
+}
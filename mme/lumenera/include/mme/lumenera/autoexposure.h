@@ -0,0 +1,75 @@
+#pragma once
+#include "mme/lumenera/lumeneracamera.h"
+#include "mme/imaging/image.h"
+#include <filesystem>
+#include <optional>
+#include <map>
+#include <tuple>
+
+namespace mme {
+
+	struct ExposureKey {
+		double wavelength; //nm
+		size_t polarization_state;
+		size_t binning;
+	};
+
+	//Exposures found by the auto-exposure, kept between runs in a small text file
+	class ExposureCache {
+	public:
+		ExposureCache() = default;
+
+		static ExposureCache load(const std::filesystem::path& path); //empty cache if the file does not exist
+		void save(const std::filesystem::path& path) const;
+
+		std::optional<Exposure> find(const ExposureKey& key) const;
+		void store(const ExposureKey& key, Exposure exposure);
+		size_t size() const;
+
+	private:
+		//wavelengths closer than 1 pm share an entry
+		using Key = std::tuple<long long, size_t, size_t>;
+		static Key make_key(const ExposureKey& key);
+
+	private:
+		std::map<Key, double> m_exposures;
+	};
+
+	struct AutoExposureSettings {
+		double full_scale = 4095.0;			//12 bit sensor data
+		double percentile = 0.995;			//the brightest 0.5% of pixels may exceed the target level
+		double target_level = 0.75;			//fraction of full scale the percentile should land on
+		double tolerance = 0.1;				//relative distance to the target that counts as converged
+		double max_saturated_fraction = 0.0005;
+		Exposure min_exposure{ 0.05 };		//ms
+		Exposure max_exposure{ 5000.0 };	//ms
+		size_t max_trials = 8;
+	};
+
+	struct ExposureEstimate {
+		Exposure exposure;
+		bool converged;
+	};
+
+	//next exposure from the histogram of a frame taken at the current exposure, assuming a linear sensor response
+	ExposureEstimate estimate_exposure(ImageView<const float> frame, Exposure current, const AutoExposureSettings& settings = AutoExposureSettings{});
+	ExposureEstimate estimate_exposure(ImageView<const uint16_t> frame, Exposure current, const AutoExposureSettings& settings = AutoExposureSettings{});
+
+	class AutoExposure {
+	public:
+		AutoExposure(LumeneraCamera& camera, ExposureCache& cache, AutoExposureSettings settings = AutoExposureSettings{});
+
+		//sets the camera exposure for this wavelength and polarization state,
+		//trial frames are only captured when the cache has no entry for it.
+		//When max_trials runs out the camera keeps the last exposure tried, which is not cached and not converged.
+		ExposureEstimate expose_for(double wavelength, size_t polarization_state);
+		size_t trial_frames() const;
+
+	private:
+		LumeneraCamera& m_camera;
+		ExposureCache& m_cache;
+		AutoExposureSettings m_settings;
+		size_t m_trial_frames;
+	};
+
+} //namespace mme
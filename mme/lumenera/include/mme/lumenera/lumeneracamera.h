@@ -1,27 +1,25 @@
 #pragma once
 #include "mme/imaging/image.h"
+#include "mme/imaging/camera.h"
+#include "mme/imaging/framestatistics.h"
+#include <chrono>
 #include <memory>
 #include <functional>
 #include <variant>
+#include <vector>
 
 
 
 
 namespace mme {
 
-	struct Exposure {
-		double value;
-	};
-
-	struct Binning {
-		size_t value;
-	};
-
 	class LumeneraCamera {
 	public:
-		using Property = std::variant<Exposure, ImageSize, Binning>;
+		using Property = std::variant<Exposure, ImageSize, Binning, TriggerMode>;
 
 		LumeneraCamera(size_t camera_num = 1);
+		//initial properties go into the same SDK configuration as the defaults
+		LumeneraCamera(size_t camera_num, const std::vector<Property>& initial_properties);
 		
 		LumeneraCamera(const LumeneraCamera& other) = delete;
 		LumeneraCamera& operator=(const LumeneraCamera& other) = delete;
@@ -31,24 +29,47 @@ namespace mme {
 		LumeneraCamera& operator=(LumeneraCamera&& other) = default;
 
 		Image<float> capture_single();
+		Image<uint16_t> capture_raw(); //12 bit values, half the memory of capture_single
+		//statistics are gathered while the frame is unpacked, no extra pass over the image
+		FrameWithStatistics<float> capture_with_statistics(const StatisticsOptions& options = {});
+		FrameWithStatistics<uint16_t> capture_raw_with_statistics(const StatisticsOptions& options = {});
 		ImageSize image_size() const;
+		Exposure exposure() const;
+		Binning binning() const;
+		TriggerMode trigger_mode() const;
+		//how long a capture waits for its frame, in hardware mode including the wait for the trigger
+		std::chrono::duration<double> capture_timeout() const;
 
 		void set_exposure(Exposure exposure);
 		void set_image_size(ImageSize size);
 		void set_binning(Binning bin);
+		//in hardware mode every capture blocks until the camera's trigger input fires, or the SDK timeout passes
+		void set_trigger_mode(TriggerMode mode);
+		void set_capture_timeout(std::chrono::duration<double> timeout);
+		//makes a capture waiting on another thread give up, that capture throws
+		void cancel_capture();
 
-		//void set_properties(const std::vector<Property>& properties);
+		//All or nothing: every property is validated first (later entries win), then the camera is
+		//reconfigured once. On failure the previous configuration is restored. Nothing happens when the
+		//properties already match.
+		void set_properties(const std::vector<Property>& properties);
 
 		struct Properties {
 			Exposure exposure;
-			ImageSize image_size;
+			ImageSize image_size; //sensor region, before binning
 			Binning binning;
+			TriggerMode trigger_mode = TriggerMode::Software;
+			std::chrono::duration<double, std::milli> capture_timeout{ 60000.0 * 60 };
+
+			bool operator==(const Properties& other) const = default;
 		};
 	private:
 		static void close_handle(void* handle);
 		using handle_cleaner_func_t = void(*)(void*);
 
-		bool write_default_camera_settings();
+		static Properties apply(Properties properties, const std::vector<Property>& changes);
+		void configure(const Properties& properties);
+		Image<uint16_t> take_fast_frame();
 
 
 	private:
@@ -1,4 +1,6 @@
 #include "mme/lumenera/lumeneracamera.h"
+#include "mme/imaging/conversion.h"
+#include "mme/imaging/framestatistics.h"
 #include <Windows.h>
 #include "lucamapi.h"
 #include <format>
@@ -6,6 +8,11 @@
 #include <vector>
 #include <stdexcept>
 #include <chrono>
+#include <utility>
+#include <cmath>
+#include "mme/tracing/trace.h"
+
+static_assert(mme::Camera<mme::LumeneraCamera>);
 
 LUCAM_SNAPSHOT default_camera_settings() {
     LUCAM_SNAPSHOT camera_settings;
@@ -53,13 +60,29 @@ LUCAM_SNAPSHOT make_lucam_settings(mme::LumeneraCamera::Properties properties) {
 
     settings.format.height = static_cast<unsigned long>(properties.image_size.height);
     settings.format.width = static_cast<unsigned long>(properties.image_size.width);
+    settings.useHwTrigger = properties.trigger_mode == mme::TriggerMode::Hardware ? TRUE : FALSE;
+    settings.timeout = static_cast<float>(properties.capture_timeout.count());
 
     return settings;
 }
 
+mme::LumeneraCamera::Properties default_properties() {
+    const auto settings = default_camera_settings();
+    return { mme::Exposure{ settings.exposure }, mme::ImageSize{ settings.format.height, settings.format.width }, mme::Binning{ settings.format.binningX },
+        mme::TriggerMode::Software, std::chrono::duration<double, std::milli>(settings.timeout) };
+}
+
 mme::LumeneraCamera::LumeneraCamera(size_t camera_num)
+    : LumeneraCamera(camera_num, {})
+{
+}
+
+mme::LumeneraCamera::LumeneraCamera(size_t camera_num, const std::vector<Property>& initial_properties)
 	: m_camera_handle(nullptr, close_handle)
 {
+    //invalid properties fail before the camera is touched
+    const auto properties = apply(default_properties(), initial_properties);
+
 	auto handle = LucamCameraOpen(camera_num);
 	if (handle == NULL) {
 		throw std::runtime_error(std::format("Lumenera camera with number {} could not be opened, check if it is connected", camera_num));
@@ -68,34 +91,58 @@ mme::LumeneraCamera::LumeneraCamera(size_t camera_num)
 		m_camera_handle = std::unique_ptr<void, handle_cleaner_func_t>(handle, LumeneraCamera::close_handle);
 	}
 
-    if (!write_default_camera_settings()) {
-        throw std::runtime_error("Could not write default camera settings");
+    if (!change_camera_settings(m_camera_handle.get(), make_lucam_settings(properties))) {
+        throw std::runtime_error("Could not write initial camera settings");
     }
+    m_properties = properties;
 }
 
 
 mme::Image<float> mme::LumeneraCamera::capture_single()
 {
-    //TODO: remove unnecessary memory initializations (byte array + image array) 
-    auto size = image_size();
-    std::vector<uint16_t> bytes(size.height * size.width, 0); //here
-    //auto start = std::chrono::steady_clock::now();
-    bool ok = LucamTakeFastFrame(m_camera_handle.get(), reinterpret_cast<uint8_t*>(bytes.data()));
-    //auto stop = std::chrono::steady_clock::now();
-    //std::cout << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << std::endl;
+    MME_TRACE_SCOPE("LumeneraCamera::capture_single");
+    auto raw = take_fast_frame();
+    MME_TRACE_SCOPE("copy and bitshift");
+    Image<float> image(raw.size());
+    unpack_pf16(std::as_const(raw).pixels(), image.pixels());
+    return image;
+}
 
+mme::Image<uint16_t> mme::LumeneraCamera::capture_raw()
+{
+    MME_TRACE_SCOPE("LumeneraCamera::capture_raw");
+    auto raw = take_fast_frame();
+    MME_TRACE_SCOPE("bitshift");
+    unpack_pf16(raw.pixels());
+    return raw;
+}
+
+mme::FrameWithStatistics<float> mme::LumeneraCamera::capture_with_statistics(const StatisticsOptions& options)
+{
+    MME_TRACE_SCOPE("LumeneraCamera::capture_with_statistics");
+    auto raw = take_fast_frame();
+    Image<float> image(raw.size());
+    auto statistics = unpack_pf16_with_statistics(std::as_const(raw).as_view(), image.as_view(), options);
+    return { std::move(image), std::move(statistics) };
+}
+
+mme::FrameWithStatistics<uint16_t> mme::LumeneraCamera::capture_raw_with_statistics(const StatisticsOptions& options)
+{
+    MME_TRACE_SCOPE("LumeneraCamera::capture_raw_with_statistics");
+    auto raw = take_fast_frame();
+    auto statistics = unpack_pf16_with_statistics(raw.as_view(), options);
+    return { std::move(raw), std::move(statistics) };
+}
+
+mme::Image<uint16_t> mme::LumeneraCamera::take_fast_frame()
+{
+    MME_TRACE_SCOPE("LucamTakeFastFrame");
+    Image<uint16_t> raw(image_size()); //filled by the SDK, no need to zero it
+    bool ok = LucamTakeFastFrame(m_camera_handle.get(), reinterpret_cast<uint8_t*>(raw.pixels().data()));
     if (!ok) {
         throw std::runtime_error("Could not capture frame with Lumenera camera");
     }
-    //start = std::chrono::steady_clock::now();
-    Image<float> image(0.0, size);  //here
-    for (size_t i = 0; auto& pixel : image.pixels()) {
-        pixel = static_cast<float>(bytes[i] >> 4);
-        i++;
-    }
-    //stop = std::chrono::steady_clock::now();
-    //std::cout << "copy and bitshift: " << std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count() << std::endl;
-    return image;
+    return raw;
 }
 
 mme::ImageSize mme::LumeneraCamera::image_size() const
@@ -103,43 +150,119 @@ mme::ImageSize mme::LumeneraCamera::image_size() const
     return { m_properties.image_size.height / m_properties.binning.value, m_properties.image_size.width / m_properties.binning.value };
 }
 
-void mme::LumeneraCamera::set_exposure(Exposure exposure)
+mme::Exposure mme::LumeneraCamera::exposure() const
 {
-    auto new_properties = m_properties;
-    new_properties.exposure = exposure;
-    auto lumenera_settings = make_lucam_settings(new_properties);
+    return m_properties.exposure;
+}
 
-    auto ok = change_camera_settings(m_camera_handle.get(), std::move(lumenera_settings));
-    if (!ok) {
-        throw std::runtime_error("Failed to change exposure for Lumenera camera");
-    }
-    m_properties = new_properties;
+mme::Binning mme::LumeneraCamera::binning() const
+{
+    return m_properties.binning;
+}
+
+mme::TriggerMode mme::LumeneraCamera::trigger_mode() const
+{
+    return m_properties.trigger_mode;
+}
+
+std::chrono::duration<double> mme::LumeneraCamera::capture_timeout() const
+{
+    return m_properties.capture_timeout;
+}
+
+void mme::LumeneraCamera::set_exposure(Exposure exposure)
+{
+    set_properties({ exposure });
 }
 
 void mme::LumeneraCamera::set_image_size(ImageSize size)
 {
+    set_properties({ size });
+}
+
+void mme::LumeneraCamera::set_binning(Binning bin)
+{
+    set_properties({ bin });
+}
+
+void mme::LumeneraCamera::set_trigger_mode(TriggerMode mode)
+{
+    set_properties({ mode });
+}
+
+void mme::LumeneraCamera::set_capture_timeout(std::chrono::duration<double> timeout)
+{
+    MME_TRACE_SCOPE("LumeneraCamera::set_capture_timeout");
+    if (!(timeout.count() > 0.0) || !std::isfinite(timeout.count())) {
+        throw std::invalid_argument(std::format("Invalid Lumenera capture timeout of {} s", timeout.count()));
+    }
     auto new_properties = m_properties;
-    new_properties.image_size = size;
-    auto lumenera_settings = make_lucam_settings(new_properties);
+    new_properties.capture_timeout = timeout;
+    if (new_properties == m_properties) {
+        return;
+    }
+    configure(new_properties);
+}
 
-    auto ok = change_camera_settings(m_camera_handle.get(), std::move(lumenera_settings));
-    if (!ok) {
-        throw std::runtime_error("Failed to change exposure for Lumenera camera");
+void mme::LumeneraCamera::cancel_capture()
+{
+    LucamCancelTakeFastFrame(m_camera_handle.get());
+}
+
+void mme::LumeneraCamera::set_properties(const std::vector<Property>& properties)
+{
+    MME_TRACE_SCOPE("LumeneraCamera::set_properties");
+    const auto new_properties = apply(m_properties, properties);
+    if (new_properties == m_properties) {
+        return;
     }
-    m_properties = new_properties;
+    configure(new_properties);
 }
 
-void mme::LumeneraCamera::set_binning(Binning bin)
+mme::LumeneraCamera::Properties mme::LumeneraCamera::apply(Properties properties, const std::vector<Property>& changes)
 {
-    auto new_properties = m_properties;
-    new_properties.binning = bin;
-    auto lumenera_settings = make_lucam_settings(new_properties);
+    for (const auto& change : changes) {
+        if (auto exposure = std::get_if<Exposure>(&change)) {
+            properties.exposure = *exposure;
+        }
+        else if (auto size = std::get_if<ImageSize>(&change)) {
+            properties.image_size = *size;
+        }
+        else if (auto binning = std::get_if<Binning>(&change)) {
+            properties.binning = *binning;
+        }
+        else if (auto trigger_mode = std::get_if<TriggerMode>(&change)) {
+            properties.trigger_mode = *trigger_mode;
+        }
+    }
 
-    auto ok = change_camera_settings(m_camera_handle.get(), std::move(lumenera_settings));
-    if (!ok) {
-        throw std::runtime_error("Failed to change exposure for Lumenera camera");
+    //checked on the combination, so size and binning can change together
+    if (!(properties.exposure.value > 0.0) || !std::isfinite(properties.exposure.value)) {
+        throw std::invalid_argument(std::format("Invalid Lumenera exposure {} ms", properties.exposure.value));
+    }
+    if (properties.binning.value == 0) {
+        throw std::invalid_argument("Lumenera binning must be at least 1");
+    }
+    const auto [height, width] = properties.image_size;
+    if (height == 0 || width == 0 || height % properties.binning.value != 0 || width % properties.binning.value != 0) {
+        throw std::invalid_argument(std::format("Lumenera image size {}x{} is empty or not a multiple of binning {}", height, width, properties.binning.value));
+    }
+    return properties;
+}
+
+void mme::LumeneraCamera::configure(const Properties& properties)
+{
+    MME_TRACE_SCOPE("change_camera_settings");
+    if (change_camera_settings(m_camera_handle.get(), make_lucam_settings(properties))) {
+        m_properties = properties;
+        return;
+    }
+    //fast frames may have been disabled by the failed attempt, go back to what worked
+    const bool restored = change_camera_settings(m_camera_handle.get(), make_lucam_settings(m_properties));
+    if (!restored) {
+        throw std::runtime_error("Failed to change Lumenera camera settings and could not restore the previous settings");
     }
-    m_properties = new_properties;
+    throw std::runtime_error("Failed to change Lumenera camera settings, previous settings restored");
 }
 
 void mme::LumeneraCamera::close_handle(void* handle)
@@ -154,19 +277,3 @@ void mme::LumeneraCamera::close_handle(void* handle)
 		std::cout << "Could not close Lumenera camera handle" << std::endl;
 	}
 }
-
-bool mme::LumeneraCamera::write_default_camera_settings()
-{
-    const bool isDisabled = LucamDisableFastFrames(m_camera_handle.get());
-    auto settings = default_camera_settings();
-    const bool isEnabled = LucamEnableFastFrames(m_camera_handle.get(), &settings);
-
-    if (!isDisabled || !isEnabled) {
-        return false;
-    }
-
-    m_properties.binning = Binning{ settings.format.binningX };
-    m_properties.exposure = Exposure{ settings.exposure };
-    m_properties.image_size = ImageSize{settings.format.height/settings.format.binningY, settings.format.width / settings.format.binningX };
-    return true;
-}
@@ -3,6 +3,8 @@
 #include <istream>
 #include <format>
 #include <ranges>
+#include <stdexcept>
+#include "mme/tracing/trace.h"
 
 mme::ESPDriver::ESPDriver(std::string_view com_port) : m_com_port(com_port), m_io_context(), m_serial_port(m_io_context, m_com_port)
 {
@@ -13,6 +15,7 @@ mme::ESPDriver::ESPDriver(std::string_view com_port) : m_com_port(com_port), m_i
 
 void mme::ESPDriver::command(std::string cmd)
 {
+	MME_TRACE_SCOPE("ESPDriver::command");
 	const auto bytes_to_write = cmd.size();
 	auto bytes_written = asio::write(m_serial_port, asio::buffer(std::move(cmd)));
 	assert(bytes_written == bytes_to_write);
@@ -20,6 +23,7 @@ void mme::ESPDriver::command(std::string cmd)
 
 std::string mme::ESPDriver::request(std::string req)
 {
+	MME_TRACE_SCOPE("ESPDriver::request");
 	//precondition: request only generates 1 reply (1 line)
 	auto bytes_to_write = req.size();
 	auto bytes_written = asio::write(m_serial_port, asio::buffer(std::move(req)));
@@ -30,22 +34,59 @@ std::string mme::ESPDriver::request(std::string req)
 
 void mme::ESPDriver::move_relative(size_t axis, double pos)
 {
+	MME_TRACE_SCOPE("ESPDriver::move_relative");
 	command(move_relative_cmd(axis, pos));
 	wait_for_motion_done(axis);
 }
 
 void mme::ESPDriver::move_absolute(size_t axis, double pos)
 {
+	MME_TRACE_SCOPE("ESPDriver::move_absolute");
 	command(move_absolute_cmd(axis, pos));
 	wait_for_motion_done(axis);
 }
 
 void mme::ESPDriver::home(size_t axis)
 {
+	MME_TRACE_SCOPE("ESPDriver::home");
 	command(home_cmd(axis));
 	wait_for_motion_done(axis);
 }
 
+void mme::ESPDriver::set_velocity(size_t axis, double velocity)
+{
+	MME_TRACE_SCOPE("ESPDriver::set_velocity");
+	if (!(velocity > 0.0)) {
+		throw std::invalid_argument(std::format("ESP velocity must be positive, got {}", velocity));
+	}
+	command(set_velocity_cmd(axis, velocity));
+}
+
+double mme::ESPDriver::velocity(size_t axis)
+{
+	MME_TRACE_SCOPE("ESPDriver::velocity");
+	return std::stod(request(velocity_req(axis)));
+}
+
+void mme::ESPDriver::move_continuous(size_t axis, MotionDirection direction)
+{
+	MME_TRACE_SCOPE("ESPDriver::move_continuous");
+	command(move_continuous_cmd(axis, direction));
+}
+
+void mme::ESPDriver::stop(size_t axis)
+{
+	MME_TRACE_SCOPE("ESPDriver::stop");
+	command(stop_cmd(axis));
+	wait_for_motion_done(axis);
+}
+
+double mme::ESPDriver::position(size_t axis)
+{
+	MME_TRACE_SCOPE("ESPDriver::position");
+	return std::stod(request(position_req(axis)));
+}
+
 //void mme::ESPDriver::move_relative(std::vector<size_t> axes, std::vector<double> positions)
 //{
 //	assert(axes.size() == positions.size());
@@ -76,6 +117,7 @@ std::string mme::ESPDriver::read_line()
 
 void mme::ESPDriver::wait_for_motion_done(size_t axis)
 {
+	MME_TRACE_SCOPE("ESPDriver::wait_for_motion_done");
 	//TODO: Timeout
 	while (true)
 	{
@@ -112,3 +154,27 @@ std::string mme::ESPDriver::home_cmd(size_t axis)
 	return std::format("{}OR2\r\n", axis);
 }
 
+std::string mme::ESPDriver::set_velocity_cmd(size_t axis, double velocity)
+{
+	return std::format("{}VA{}\r\n", axis, velocity);
+}
+
+std::string mme::ESPDriver::velocity_req(size_t axis)
+{
+	return std::format("{}VA?\r\n", axis);
+}
+
+std::string mme::ESPDriver::move_continuous_cmd(size_t axis, MotionDirection direction)
+{
+	return std::format("{}MV{}\r\n", axis, direction == MotionDirection::Positive ? '+' : '-');
+}
+
+std::string mme::ESPDriver::stop_cmd(size_t axis)
+{
+	return std::format("{}ST\r\n", axis);
+}
+
+std::string mme::ESPDriver::position_req(size_t axis)
+{
+	return std::format("{}TP?\r\n", axis);
+}
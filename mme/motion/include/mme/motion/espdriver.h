@@ -6,6 +6,11 @@
 
 namespace mme {
 
+	enum class MotionDirection {
+		Positive,
+		Negative
+	};
+
 	//class ESPDriver;
 
 	//class ESPAxis {
@@ -37,6 +42,15 @@ namespace mme {
 		void move_absolute(size_t axis, double pos);
 		void home(size_t axis);
 
+		//Continuous motion: set_velocity applies to every later move of the axis, move_continuous returns as soon
+		//as the axis starts moving and it keeps going until stop, which waits until it has decelerated.
+		void set_velocity(size_t axis, double velocity);
+		double velocity(size_t axis);
+		void move_continuous(size_t axis, MotionDirection direction);
+		void stop(size_t axis);
+		//encoder position, also while moving
+		double position(size_t axis);
+
 		//void move_relative(std::vector<size_t> axes, std::vector<double> positions);
 		//void move_absolute(std::vector<size_t> axes, std::vector<double> positions);
 		//void home(std::vector<size_t> axes, std::vector<double> positions);
@@ -49,6 +63,11 @@ namespace mme {
 		static std::string move_relative_cmd(size_t axis, double pos);
 		static std::string move_absolute_cmd(size_t axis, double pos);
 		static std::string home_cmd(size_t axis);
+		static std::string set_velocity_cmd(size_t axis, double velocity);
+		static std::string velocity_req(size_t axis);
+		static std::string move_continuous_cmd(size_t axis, MotionDirection direction);
+		static std::string stop_cmd(size_t axis);
+		static std::string position_req(size_t axis);
 
 
 	private:
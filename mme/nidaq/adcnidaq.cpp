@@ -4,6 +4,13 @@
 #include "mme/nidaq/nidaqerrors.h"
 #include <cassert>
 #include <memory>
+#include "mme/tracing/trace.h"
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <cmath>
+#include <format>
 
 
 using namespace std::chrono_literals;
@@ -76,6 +83,7 @@ mme::NidaqAdc::NidaqAdc(std::string channel, SamplingSettings settings)
 
 std::vector<double> mme::NidaqAdc::sample(size_t num_samples)
 {
+	MME_TRACE_SCOPE("NidaqAdc::sample");
 	if (!m_settings.rate) { m_settings.rate = default_sampling_rate(); }
 
 	throw_if_error(DAQmxCfgSampClkTiming(m_task.handle(), NULL, m_settings.rate->value, DAQmx_Val_Rising, DAQmx_Val_FiniteSamps, num_samples));
@@ -119,6 +127,7 @@ mme::SamplingRate mme::NidaqAdc::default_sampling_rate()
 
 std::vector<double> mme::NidaqAdc::read_data(size_t num_samples, std::chrono::duration<double> timeout)
 {
+	MME_TRACE_SCOPE("NidaqAdc::read_data");
 	std::vector<double> buffer(num_samples);
 	int32 num_samples_read = 0;
 	throw_if_error(DAQmxReadAnalogF64(m_task.handle(), -1, timeout.count(), DAQmx_Val_GroupByChannel, buffer.data(), buffer.size(), &num_samples_read, NULL));
@@ -128,6 +137,53 @@ std::vector<double> mme::NidaqAdc::read_data(size_t num_samples, std::chrono::du
 }
 
 
+struct mme::detail::RecordAcquisition {
+	size_t num_records = 0;
+	size_t samples_per_record = 0;
+	std::vector<double> buffer;
+	RecordCallback on_record;
+
+	mutable std::mutex mutex;
+	std::condition_variable done;
+	size_t completed = 0;
+	std::exception_ptr error;
+};
+
+namespace {
+
+	//DAQmx calls this on its own thread every samples_per_record acquired samples, i.e. once per record
+	int32 CVICALLBACK on_record_acquired(TaskHandle task, int32, uInt32, void* data)
+	{
+		auto& acquisition = *static_cast<mme::detail::RecordAcquisition*>(data);
+		MME_TRACE_SCOPE("NidaqTriggeredAdc record");
+		try {
+			size_t record = 0;
+			{
+				std::scoped_lock lock(acquisition.mutex);
+				if (acquisition.completed >= acquisition.num_records || acquisition.error) {
+					return 0;
+				}
+				record = acquisition.completed;
+			}
+			double* destination = acquisition.buffer.data() + record * acquisition.samples_per_record;
+			int32 num_samples_read = 0;
+			mme::throw_if_error(DAQmxReadAnalogF64(task, static_cast<int32>(acquisition.samples_per_record), 0.0, DAQmx_Val_GroupByChannel,
+				destination, static_cast<uInt32>(acquisition.samples_per_record), &num_samples_read, NULL));
+			if (acquisition.on_record) {
+				acquisition.on_record(record, std::span<const double>(destination, acquisition.samples_per_record));
+			}
+			std::scoped_lock lock(acquisition.mutex);
+			acquisition.completed++;
+		}
+		catch (...) {
+			std::scoped_lock lock(acquisition.mutex);
+			acquisition.error = std::current_exception();
+		}
+		acquisition.done.notify_all();
+		return 0;
+	}
+}
+
 mme::NidaqTriggeredAdc::NidaqTriggeredAdc(std::string channel, TriggerSettings trigger_settings, SamplingSettings sampling_settings)
 	:m_task()
 	,m_sampling_settings(std::move(sampling_settings))
@@ -138,14 +194,26 @@ mme::NidaqTriggeredAdc::NidaqTriggeredAdc(std::string channel, TriggerSettings t
 	throw_if_error(DAQmxCreateAIVoltageChan(m_task.handle(), channel.c_str(), "TEST", DAQmx_Val_Diff, m_sampling_settings.voltage_range.min, m_sampling_settings.voltage_range.max, DAQmx_Val_Volts, NULL));
 	int code{};
 	switch (m_trigger_settings.edge) {
-		case TriggerEdge::Rising: code = DAQmxCfgDigEdgeStartTrig(m_task.handle(), m_trigger_settings.source.c_str(), DAQmx_Val_Rising);
-		case TriggerEdge::Falling: code = DAQmxCfgDigEdgeStartTrig(m_task.handle(), m_trigger_settings.source.c_str(), DAQmx_Val_Falling);
+		case TriggerEdge::Rising: code = DAQmxCfgDigEdgeStartTrig(m_task.handle(), m_trigger_settings.source.c_str(), DAQmx_Val_Rising); break;
+		case TriggerEdge::Falling: code = DAQmxCfgDigEdgeStartTrig(m_task.handle(), m_trigger_settings.source.c_str(), DAQmx_Val_Falling); break;
 	}
 	throw_if_error(code);
 }
 
+mme::NidaqTriggeredAdc::NidaqTriggeredAdc(NidaqTriggeredAdc&& other) noexcept = default;
+mme::NidaqTriggeredAdc& mme::NidaqTriggeredAdc::operator=(NidaqTriggeredAdc&& other) noexcept = default;
+
+mme::NidaqTriggeredAdc::~NidaqTriggeredAdc()
+{
+	//the driver must not call back into a destroyed acquisition
+	if (m_records && m_is_armed) {
+		DAQmxStopTask(m_task.handle());
+	}
+}
+
 void mme::NidaqTriggeredAdc::sample_on_trigger(size_t num_samples)
 {
+	MME_TRACE_SCOPE("NidaqTriggeredAdc::sample_on_trigger");
 	if (m_is_armed) { return; } //TODO: log
 	if (!m_sampling_settings.rate) { m_sampling_settings.rate = DEFAULT_SAMPLING_RATE; }
 
@@ -192,6 +260,7 @@ std::optional<std::vector<double>> mme::NidaqTriggeredAdc::retrieve_samples(std:
 
 std::vector<double> mme::NidaqTriggeredAdc::read_data(size_t num_samples, std::chrono::duration<double> timeout)
 {
+	MME_TRACE_SCOPE("NidaqTriggeredAdc::read_data");
 	std::vector<double> buffer(num_samples);
 	int32 num_samples_read = 0;
 	throw_if_error(DAQmxReadAnalogF64(m_task.handle(), -1, timeout.count(), DAQmx_Val_GroupByChannel, buffer.data(), buffer.size(), &num_samples_read, NULL));
@@ -199,3 +268,96 @@ std::vector<double> mme::NidaqTriggeredAdc::read_data(size_t num_samples, std::c
 	assert(num_samples == num_samples_read);
 	return buffer;
 }
+
+
+void mme::NidaqTriggeredAdc::sample_records_on_trigger(size_t num_records, size_t samples_per_record, RecordCallback on_record)
+{
+	MME_TRACE_SCOPE("NidaqTriggeredAdc::sample_records_on_trigger");
+	if (m_is_armed) {
+		throw std::runtime_error("NidaqTriggeredAdc is already armed");
+	}
+	if (num_records == 0 || samples_per_record == 0) {
+		throw std::invalid_argument("Multi-record acquisition needs at least one record of one sample");
+	}
+	if (!m_sampling_settings.rate) { m_sampling_settings.rate = DEFAULT_SAMPLING_RATE; }
+
+	m_records = std::make_unique<detail::RecordAcquisition>();
+	m_records->num_records = num_records;
+	m_records->samples_per_record = samples_per_record;
+	m_records->buffer.resize(num_records * samples_per_record);
+	m_records->on_record = std::move(on_record);
+
+	//every trigger acquires one finite record, the driver buffer holds all of them in case the callback falls behind
+	throw_if_error(DAQmxCfgSampClkTiming(m_task.handle(), NULL, m_sampling_settings.rate->value, DAQmx_Val_Rising, DAQmx_Val_FiniteSamps, samples_per_record));
+	throw_if_error(DAQmxSetStartTrigRetriggerable(m_task.handle(), 1));
+	throw_if_error(DAQmxCfgInputBuffer(m_task.handle(), static_cast<uInt32>(num_records * samples_per_record)));
+	throw_if_error(DAQmxRegisterEveryNSamplesEvent(m_task.handle(), DAQmx_Val_Acquired_Into_Buffer, static_cast<uInt32>(samples_per_record), 0, on_record_acquired, m_records.get()));
+	throw_if_error(DAQmxStartTask(m_task.handle()));
+	m_is_armed = true;
+}
+
+void mme::NidaqTriggeredAdc::sample_records_on_trigger(size_t num_records, size_t samples_per_record, SamplingRate rate, RecordCallback on_record)
+{
+	if (m_is_armed) {
+		throw std::runtime_error("NidaqTriggeredAdc is already armed");
+	}
+	//the task's channels bound the sample clock, checked before the settings change
+	float64 max_rate = 0.0;
+	throw_if_error(DAQmxGetSampClkMaxRate(m_task.handle(), &max_rate));
+	if (!std::isfinite(rate.value) || rate.value <= 0.0 || rate.value > max_rate) {
+		throw std::invalid_argument(std::format("Sampling rate of {} Hz is outside of (0, {}] Hz", rate.value, max_rate));
+	}
+	m_sampling_settings.rate = rate;
+	sample_records_on_trigger(num_records, samples_per_record, std::move(on_record));
+}
+
+bool mme::NidaqTriggeredAdc::wait_for_records(std::chrono::duration<double> timeout)
+{
+	MME_TRACE_SCOPE("NidaqTriggeredAdc::wait_for_records");
+	if (!m_records) { return false; }
+	{
+		std::unique_lock lock(m_records->mutex);
+		const bool finished = m_records->done.wait_for(lock, timeout, [this] {
+			return m_records->completed == m_records->num_records || m_records->error;
+		});
+		if (m_records->error) {
+			auto error = m_records->error;
+			lock.unlock();
+			//the acquisition error is what the caller needs, a failing cleanup must not replace it
+			try {
+				stop_records();
+			}
+			catch (...) {
+			}
+			std::rethrow_exception(error);
+		}
+		if (!finished) {
+			return false;
+		}
+	}
+	stop_records();
+	return true;
+}
+
+size_t mme::NidaqTriggeredAdc::records_completed() const
+{
+	if (!m_records) { return 0; }
+	std::scoped_lock lock(m_records->mutex);
+	return m_records->completed;
+}
+
+std::span<const double> mme::NidaqTriggeredAdc::records() const
+{
+	if (!m_records) { return {}; }
+	return m_records->buffer;
+}
+
+void mme::NidaqTriggeredAdc::stop_records()
+{
+	if (!m_records || !m_is_armed) { return; }
+	m_is_armed = false;
+	throw_if_error(DAQmxStopTask(m_task.handle()));
+	//back to single record behaviour for sample_on_trigger, the callback would otherwise steal its samples
+	throw_if_error(DAQmxRegisterEveryNSamplesEvent(m_task.handle(), DAQmx_Val_Acquired_Into_Buffer, static_cast<uInt32>(m_records->samples_per_record), 0, NULL, NULL));
+	throw_if_error(DAQmxSetStartTrigRetriggerable(m_task.handle(), 0));
+}
@@ -7,6 +7,8 @@
 #include <chrono>
 #include <memory>
 #include <atomic>
+#include <functional>
+#include <span>
 
 namespace mme 
 {
@@ -32,6 +34,8 @@ namespace mme
 			std::unique_ptr<void, cleanup_func_t> m_handle;
 			inline static std::atomic<size_t> s_tasks_created = 0;
 		};
+
+		struct RecordAcquisition;
 	}
 
 	bool is_error(int nidaq_error_code);
@@ -66,6 +70,9 @@ namespace mme
 
 	inline constexpr SamplingRate DEFAULT_SAMPLING_RATE{ 100'000 };
 
+	//record index and its samples, called on the driver's callback thread
+	using RecordCallback = std::function<void(size_t record, std::span<const double> samples)>;
+
 	class NidaqAdc {
 	public:
 		NidaqAdc(std::string channel, SamplingSettings settings = SamplingSettings{});
@@ -95,14 +102,29 @@ namespace mme
 		//Move only type
 		NidaqTriggeredAdc(const NidaqTriggeredAdc& other) = delete;
 		NidaqTriggeredAdc& operator=(const NidaqTriggeredAdc& other) = delete;
-		NidaqTriggeredAdc(NidaqTriggeredAdc&& other) = default;
-		NidaqTriggeredAdc& operator=(NidaqTriggeredAdc&& other) = default;
+		NidaqTriggeredAdc(NidaqTriggeredAdc&& other) noexcept;
+		NidaqTriggeredAdc& operator=(NidaqTriggeredAdc&& other) noexcept;
+		~NidaqTriggeredAdc();
 
 		void sample_on_trigger(size_t num_samples);
 		void sample_on_trigger(std::chrono::duration<double> duration);
 		void sample_on_trigger(size_t num_samples, SamplingRate rate);
 		void sample_on_trigger(std::chrono::duration<double> duration, SamplingRate rate);
 		std::optional<std::vector<double>> retrieve_samples(std::chrono::duration<double> timeout);
+
+		//Multi-record mode: arms once for num_records retriggerable records. Each record is read into its row of
+		//a preallocated num_records x samples_per_record buffer by the driver as soon as it completes, so triggers
+		//can come faster than software could re-arm. on_record runs on the driver's thread and should be quick.
+		void sample_records_on_trigger(size_t num_records, size_t samples_per_record, RecordCallback on_record = {});
+		//throws std::invalid_argument for a rate the task's sample clock cannot run at
+		void sample_records_on_trigger(size_t num_records, size_t samples_per_record, SamplingRate rate, RecordCallback on_record = {});
+		//true once every record arrived, the acquisition is stopped then. Rethrows errors from the callback thread
+		bool wait_for_records(std::chrono::duration<double> timeout);
+		size_t records_completed() const;
+		//row major records, valid until the next sample_records_on_trigger
+		std::span<const double> records() const;
+		//stops early, records that completed stay readable
+		void stop_records();
 	private:
 		std::vector<double> read_data(size_t num_samples, std::chrono::duration<double> timeout);
 	private:
@@ -111,6 +133,7 @@ namespace mme
 		TriggerSettings m_trigger_settings;
 		bool m_is_armed;
 		size_t m_samples_to_read;
+		std::unique_ptr<detail::RecordAcquisition> m_records; //stable address for the driver callback
 	};
 
 } //namespace mme
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include "mme/nidaq/adcnidaq.h"
+#include <chrono>
+#include <string>
+
+namespace mme {
+
+	struct PulseTrainSettings {
+		std::string counter = "/Dev1/ctr0";
+		//empty keeps the counter's default output terminal, e.g. /Dev1/PFI12 for ctr0
+		std::string output_terminal;
+		double duty_cycle = 0.5;
+	};
+
+	//Counter output generating a finite train of hardware timed pulses, for triggering cameras and ADCs at a
+	//fixed rate without software in the loop. Wire output_terminal to the trigger inputs, an ADC on the same
+	//device can also use the counter's internal output (/Dev1/Ctr0InternalOutput) as trigger source.
+	class NidaqPulseTrain {
+	public:
+		NidaqPulseTrain(PulseTrainSettings settings = PulseTrainSettings{});
+
+		//Move only type
+		NidaqPulseTrain(const NidaqPulseTrain& other) = delete;
+		NidaqPulseTrain& operator=(const NidaqPulseTrain& other) = delete;
+		NidaqPulseTrain(NidaqPulseTrain&& other) = default;
+		NidaqPulseTrain& operator=(NidaqPulseTrain&& other) = default;
+
+		//returns once the counter runs, rising edges follow right away and then every 1 / frequency
+		void start(size_t num_pulses, double frequency);
+		bool is_done();
+		//true once every pulse went out, the counter is stopped then
+		bool wait_until_done(std::chrono::duration<double> timeout);
+		void stop();
+
+	private:
+		detail::NidaqTask m_task;
+		PulseTrainSettings m_settings;
+		bool m_is_running;
+	};
+
+} //namespace mme
@@ -0,0 +1,65 @@
+#include "mme/nidaq/pulsetrain.h"
+#include "NIDAQmx.h"
+#include "mme/nidaq/nidaqerrors.h"
+#include <cmath>
+#include <format>
+#include <stdexcept>
+#include "mme/tracing/trace.h"
+
+mme::NidaqPulseTrain::NidaqPulseTrain(PulseTrainSettings settings)
+	:m_task()
+	,m_settings(std::move(settings))
+	,m_is_running(false)
+{
+	if (!(m_settings.duty_cycle > 0.0 && m_settings.duty_cycle < 1.0)) {
+		throw std::invalid_argument(std::format("Pulse train duty cycle must be between 0 and 1, got {}", m_settings.duty_cycle));
+	}
+	//the frequency is set again for every train, minimal initial delay so the first edge comes at start
+	throw_if_error(DAQmxCreateCOPulseChanFreq(m_task.handle(), m_settings.counter.c_str(), "", DAQmx_Val_Hz, DAQmx_Val_Low, 0.0, 1000.0, m_settings.duty_cycle));
+	if (!m_settings.output_terminal.empty()) {
+		throw_if_error(DAQmxSetCOPulseTerm(m_task.handle(), m_settings.counter.c_str(), m_settings.output_terminal.c_str()));
+	}
+}
+
+void mme::NidaqPulseTrain::start(size_t num_pulses, double frequency)
+{
+	MME_TRACE_SCOPE("NidaqPulseTrain::start");
+	if (m_is_running) {
+		throw std::runtime_error(std::format("Pulse train on {} is already running", m_settings.counter));
+	}
+	if (num_pulses == 0 || !(frequency > 0.0) || !std::isfinite(frequency)) {
+		throw std::invalid_argument(std::format("Invalid pulse train of {} pulses at {} Hz", num_pulses, frequency));
+	}
+	throw_if_error(DAQmxSetCOPulseFreq(m_task.handle(), m_settings.counter.c_str(), frequency));
+	throw_if_error(DAQmxCfgImplicitTiming(m_task.handle(), DAQmx_Val_FiniteSamps, num_pulses));
+	throw_if_error(DAQmxStartTask(m_task.handle()));
+	m_is_running = true;
+}
+
+bool mme::NidaqPulseTrain::is_done()
+{
+	if (!m_is_running) { return true; }
+	bool32 done = 0;
+	throw_if_error(DAQmxIsTaskDone(m_task.handle(), &done));
+	return done != 0;
+}
+
+bool mme::NidaqPulseTrain::wait_until_done(std::chrono::duration<double> timeout)
+{
+	MME_TRACE_SCOPE("NidaqPulseTrain::wait_until_done");
+	if (!m_is_running) { return true; }
+	const int code = DAQmxWaitUntilTaskDone(m_task.handle(), timeout.count());
+	if (code == DAQmxErrorWaitUntilDoneDoesNotIndicateDone) {
+		return false;
+	}
+	throw_if_error(code);
+	stop();
+	return true;
+}
+
+void mme::NidaqPulseTrain::stop()
+{
+	if (!m_is_running) { return; }
+	m_is_running = false;
+	throw_if_error(DAQmxStopTask(m_task.handle()));
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace mme {
+
+	struct ThreadPoolOptions {
+		size_t num_threads = 0;		//0 for hardware_concurrency, counting the thread that calls parallel_for
+		bool pin_threads = true;	//worker i to cpu i + 1, Linux only
+	};
+
+	//Fixed set of worker threads with one deque of chunks each. parallel_for pushes its chunks, then runs
+	//chunks itself until all of them are done: workers pop their own deque from the back and steal from the
+	//front of the others. Calling parallel_for from inside a chunk is fine, the nested chunks go to the
+	//calling worker's deque and idle workers steal them.
+	class ThreadPool {
+	public:
+		explicit ThreadPool(ThreadPoolOptions options = {});
+		~ThreadPool();
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		//workers plus the calling thread
+		size_t num_threads() const { return m_workers.size() + 1; }
+
+		//Calls body(begin, end) for consecutive chunks of [0, count) of grain items, 0 for about four chunks per
+		//thread. Returns once every chunk has run, rethrowing the first exception a chunk threw.
+		void parallel_for(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body);
+
+		//shared by all of mme, started on first use so processes can still fork before that
+		static ThreadPool& global();
+
+		//options global() starts with, throws std::logic_error once it has started
+		static void configure_global(ThreadPoolOptions options);
+
+	private:
+		struct Job;
+		struct Chunk;
+		struct Queue;
+
+		void worker_main(size_t index);
+		//pops from own_queue first, then steals, false if every queue was empty
+		bool run_one(size_t own_queue);
+
+	private:
+		std::vector<std::unique_ptr<Queue>> m_queues; //one per worker
+		std::vector<std::thread> m_workers;
+		std::atomic<size_t> m_queued{ 0 };
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		bool m_stop = false;
+	};
+
+	//on the global pool, func(begin, end)
+	template<typename Func>
+	void parallel_for(size_t count, Func&& func, size_t grain = 0) {
+		ThreadPool::global().parallel_for(count, grain, func);
+	}
+
+	//func(row_start, num_rows) for tiles of tile_rows rows
+	template<typename Func>
+	void parallel_for_rows(size_t num_rows, size_t tile_rows, Func&& func) {
+		const size_t num_tiles = (num_rows + tile_rows - 1) / tile_rows;
+		parallel_for(num_tiles, [&](size_t begin, size_t end) {
+			for (size_t tile = begin; tile < end; tile++) {
+				const size_t row_start = tile * tile_rows;
+				func(row_start, std::min(tile_rows, num_rows - row_start));
+			}
+		}, 1);
+	}
+
+	//func(tile, row_start) for row tiles of an image view
+	template<typename View, typename Func>
+		requires requires(View view) { view.sub_view(size_t{}, size_t{}); view.num_rows(); }
+	void parallel_for_rows(View view, size_t tile_rows, Func&& func) {
+		parallel_for_rows(view.num_rows(), tile_rows, [&](size_t row_start, size_t num_rows) {
+			func(view.sub_view(row_start, num_rows), row_start);
+		});
+	}
+
+	//func(block, offset) for blocks of block_size samples, the last block may be shorter
+	template<typename T, typename Func>
+	void parallel_for_blocks(std::span<T> samples, size_t block_size, Func&& func) {
+		const size_t num_blocks = (samples.size() + block_size - 1) / block_size;
+		parallel_for(num_blocks, [&](size_t begin, size_t end) {
+			for (size_t block = begin; block < end; block++) {
+				const size_t offset = block * block_size;
+				func(samples.subspan(offset, std::min(block_size, samples.size() - offset)), offset);
+			}
+		}, 1);
+	}
+
+}
@@ -0,0 +1,220 @@
+#include "mme/parallel/threadpool.h"
+#include "mme/tracing/trace.h"
+#include <deque>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct mme::ThreadPool::Job {
+	const std::function<void(size_t, size_t)>* body;
+	std::atomic<size_t> remaining;
+	std::mutex mutex;
+	std::condition_variable done;
+	std::exception_ptr error;
+};
+
+struct mme::ThreadPool::Chunk {
+	Job* job;
+	size_t begin;
+	size_t end;
+};
+
+struct mme::ThreadPool::Queue {
+	std::mutex mutex;
+	std::deque<Chunk> chunks;
+};
+
+namespace {
+
+	//the pool and queue of the worker running on this thread, so nested calls push to their own queue
+	thread_local const mme::ThreadPool* t_pool = nullptr;
+	thread_local size_t t_queue = 0;
+
+	constexpr size_t NO_QUEUE = static_cast<size_t>(-1);
+
+	std::mutex g_global_mutex;
+	mme::ThreadPoolOptions g_global_options;
+	bool g_global_started = false;
+
+	void pin_to_cpu(std::thread& thread, size_t cpu) {
+#if defined(__linux__)
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(static_cast<int>(cpu), &cpus);
+		//best effort, a restricted affinity mask just leaves the thread unpinned
+		pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus);
+#else
+		(void)thread;
+		(void)cpu;
+#endif
+	}
+}
+
+mme::ThreadPool::ThreadPool(ThreadPoolOptions options)
+{
+	const size_t num_cpus = std::max(1u, std::thread::hardware_concurrency());
+	const size_t num_threads = options.num_threads > 0 ? options.num_threads : num_cpus;
+	for (size_t i = 0; i + 1 < num_threads; i++) {
+		m_queues.push_back(std::make_unique<Queue>());
+	}
+	for (size_t i = 0; i + 1 < num_threads; i++) {
+		m_workers.emplace_back([this, i] { worker_main(i); });
+		if (options.pin_threads) {
+			//cpu 0 is left to the calling thread
+			pin_to_cpu(m_workers.back(), (i + 1) % num_cpus);
+		}
+	}
+}
+
+mme::ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+mme::ThreadPool& mme::ThreadPool::global()
+{
+	static ThreadPool pool([] {
+		std::lock_guard lock(g_global_mutex);
+		g_global_started = true;
+		return g_global_options;
+	}());
+	return pool;
+}
+
+void mme::ThreadPool::configure_global(ThreadPoolOptions options)
+{
+	std::lock_guard lock(g_global_mutex);
+	if (g_global_started) {
+		throw std::logic_error("The global thread pool has already started");
+	}
+	g_global_options = options;
+}
+
+void mme::ThreadPool::parallel_for(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body)
+{
+	if (count == 0) {
+		return;
+	}
+	if (grain == 0) {
+		grain = std::max<size_t>(1, (count + 4 * num_threads() - 1) / (4 * num_threads()));
+	}
+	const size_t num_chunks = (count + grain - 1) / grain;
+	if (m_workers.empty() || num_chunks == 1) {
+		for (size_t begin = 0; begin < count; begin += grain) {
+			body(begin, std::min(begin + grain, count));
+		}
+		return;
+	}
+	MME_TRACE_SCOPE("ThreadPool::parallel_for");
+
+	Job job;
+	job.body = &body;
+	job.remaining = num_chunks;
+	//counted before they are pushed so a pop can never take the count below zero
+	m_queued += num_chunks;
+	const size_t own_queue = t_pool == this ? t_queue : NO_QUEUE;
+	if (own_queue != NO_QUEUE) {
+		std::lock_guard lock(m_queues[own_queue]->mutex);
+		for (size_t begin = 0; begin < count; begin += grain) {
+			m_queues[own_queue]->chunks.push_back({ &job, begin, std::min(begin + grain, count) });
+		}
+	}
+	else {
+		//contiguous ranges of chunks per worker, like a static schedule until somebody runs dry
+		for (size_t q = 0; q < m_queues.size(); q++) {
+			const size_t first = num_chunks * q / m_queues.size();
+			const size_t last = num_chunks * (q + 1) / m_queues.size();
+			std::lock_guard lock(m_queues[q]->mutex);
+			for (size_t chunk = first; chunk < last; chunk++) {
+				m_queues[q]->chunks.push_back({ &job, chunk * grain, std::min((chunk + 1) * grain, count) });
+			}
+		}
+	}
+	{
+		//orders the push against workers that are about to sleep
+		std::lock_guard lock(m_mutex);
+	}
+	m_wake.notify_all();
+
+	//help until nothing is left to take, the remaining chunks are then running on other threads
+	while (job.remaining.load() > 0 && run_one(own_queue)) {
+	}
+	{
+		//also makes sure the last chunk has released the job before it goes out of scope
+		std::unique_lock lock(job.mutex);
+		job.done.wait(lock, [&] { return job.remaining.load() == 0; });
+	}
+	if (job.error) {
+		std::rethrow_exception(job.error);
+	}
+}
+
+bool mme::ThreadPool::run_one(size_t own_queue)
+{
+	std::optional<Chunk> chunk;
+	if (own_queue != NO_QUEUE) {
+		auto& queue = *m_queues[own_queue];
+		std::lock_guard lock(queue.mutex);
+		if (!queue.chunks.empty()) {
+			chunk = queue.chunks.back();
+			queue.chunks.pop_back();
+		}
+	}
+	for (size_t i = 0; !chunk && i < m_queues.size(); i++) {
+		//start stealing after the own queue so thieves spread over their victims
+		const size_t victim = own_queue != NO_QUEUE ? (own_queue + 1 + i) % m_queues.size() : i;
+		auto& queue = *m_queues[victim];
+		std::lock_guard lock(queue.mutex);
+		if (!queue.chunks.empty()) {
+			chunk = queue.chunks.front();
+			queue.chunks.pop_front();
+		}
+	}
+	if (!chunk) {
+		return false;
+	}
+	m_queued--;
+
+	Job& job = *chunk->job;
+	try {
+		(*job.body)(chunk->begin, chunk->end);
+	}
+	catch (...) {
+		std::lock_guard lock(job.mutex);
+		if (!job.error) {
+			job.error = std::current_exception();
+		}
+	}
+	std::lock_guard lock(job.mutex);
+	if (--job.remaining == 0) {
+		job.done.notify_all();
+	}
+	return true;
+}
+
+void mme::ThreadPool::worker_main(size_t index)
+{
+	t_pool = this;
+	t_queue = index;
+	while (true) {
+		if (run_one(index)) {
+			continue;
+		}
+		std::unique_lock lock(m_mutex);
+		m_wake.wait(lock, [&] { return m_stop || m_queued.load() > 0; });
+		if (m_stop) {
+			return;
+		}
+	}
+}
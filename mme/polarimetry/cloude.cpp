@@ -0,0 +1,197 @@
+#include "mme/polarimetry/cloude.h"
+#include "mme/polarimetry/hermitianeigen.h"
+#include "mme/parallel/threadpool.h"
+#include "mme/tracing/trace.h"
+#include <array>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <algorithm>
+
+namespace {
+
+	constexpr size_t BATCH_SIZE = 16;
+	constexpr size_t TILE_ROWS = 16;
+
+	using Complex = std::complex<float>;
+	using Basis = std::array<std::array<Complex, 16>, mme::MUELLER_ELEMENTS>;
+
+	//sigma_i kron conj(sigma_j) for the Pauli matrices in Stokes order (I, Q, U, V).
+	//With this ordering the identity Mueller matrix has a rank one coherency matrix.
+	Basis make_basis() {
+		const Complex i{ 0.0f, 1.0f };
+		const std::array<std::array<Complex, 4>, 4> pauli{ {
+			{ 1.0f, 0.0f, 0.0f, 1.0f },
+			{ 1.0f, 0.0f, 0.0f, -1.0f },
+			{ 0.0f, 1.0f, 1.0f, 0.0f },
+			{ 0.0f, -i, i, 0.0f }
+		} };
+		Basis basis{};
+		for (size_t s1 = 0; s1 < 4; s1++) {
+			for (size_t s2 = 0; s2 < 4; s2++) {
+				auto& b = basis[s1 * 4 + s2];
+				for (size_t a = 0; a < 2; a++) {
+					for (size_t bb = 0; bb < 2; bb++) {
+						for (size_t c = 0; c < 2; c++) {
+							for (size_t d = 0; d < 2; d++) {
+								b[(a * 2 + bb) * 4 + c * 2 + d] = pauli[s1][a * 2 + c] * std::conj(pauli[s2][bb * 2 + d]);
+							}
+						}
+					}
+				}
+			}
+		}
+		return basis;
+	}
+
+	const Basis& basis() {
+		static const Basis basis = make_basis();
+		return basis;
+	}
+
+	struct PixelBatch {
+		std::array<std::array<float, BATCH_SIZE>, mme::MUELLER_ELEMENTS> mueller;
+		std::array<float, BATCH_SIZE> entropy;
+		std::array<float, BATCH_SIZE> purity;
+	};
+
+	void filter_batch(PixelBatch& batch) {
+		const auto& b = basis();
+		mme::Hermitian4Batch<BATCH_SIZE> h{};
+		for (size_t e = 0; e < 16; e++) {
+			h.re[e].fill(0.0f);
+			h.im[e].fill(0.0f);
+			for (size_t m = 0; m < mme::MUELLER_ELEMENTS; m++) {
+				const float b_re = 0.25f * b[m][e].real();
+				const float b_im = 0.25f * b[m][e].imag();
+				if (b_re == 0.0f && b_im == 0.0f) {
+					continue;
+				}
+				for (size_t l = 0; l < BATCH_SIZE; l++) {
+					h.re[e][l] += b_re * batch.mueller[m][l];
+					h.im[e][l] += b_im * batch.mueller[m][l];
+				}
+			}
+		}
+
+		mme::Hermitian4Batch<BATCH_SIZE> v;
+		mme::hermitian_eigen(h, v);
+
+		//clip, normalize for entropy and purity
+		std::array<std::array<float, BATCH_SIZE>, 4> eigenvalues;
+		std::array<float, BATCH_SIZE> total{};
+		for (size_t k = 0; k < 4; k++) {
+			for (size_t l = 0; l < BATCH_SIZE; l++) {
+				eigenvalues[k][l] = std::max(h.re[k * 5][l], 0.0f);
+				total[l] += eigenvalues[k][l];
+			}
+		}
+		for (size_t l = 0; l < BATCH_SIZE; l++) {
+			float entropy = 0.0f;
+			float squares = 0.0f;
+			for (size_t k = 0; k < 4; k++) {
+				const float p = total[l] > 0.0f ? eigenvalues[k][l] / total[l] : 0.25f;
+				entropy -= p > 0.0f ? p * std::log(p) : 0.0f;
+				squares += p * p;
+			}
+			batch.entropy[l] = entropy / std::log(4.0f);
+			batch.purity[l] = std::sqrt(std::max((4.0f * squares - 1.0f) / 3.0f, 0.0f));
+		}
+
+		//H = V diag(lambda) V^H, then m_ij = tr(H B_ij) = sum_rc H_rc B_ij,cr
+		mme::Hermitian4Batch<BATCH_SIZE> rebuilt;
+		for (size_t r = 0; r < 4; r++) {
+			for (size_t c = 0; c < 4; c++) {
+				auto& out_re = rebuilt.re[r * 4 + c];
+				auto& out_im = rebuilt.im[r * 4 + c];
+				out_re.fill(0.0f);
+				out_im.fill(0.0f);
+				for (size_t k = 0; k < 4; k++) {
+					const auto& rk_re = v.re[r * 4 + k];
+					const auto& rk_im = v.im[r * 4 + k];
+					const auto& ck_re = v.re[c * 4 + k];
+					const auto& ck_im = v.im[c * 4 + k];
+					for (size_t l = 0; l < BATCH_SIZE; l++) {
+						//v_rk conj(v_ck) lambda_k
+						out_re[l] += eigenvalues[k][l] * (rk_re[l] * ck_re[l] + rk_im[l] * ck_im[l]);
+						out_im[l] += eigenvalues[k][l] * (rk_im[l] * ck_re[l] - rk_re[l] * ck_im[l]);
+					}
+				}
+			}
+		}
+		for (size_t m = 0; m < mme::MUELLER_ELEMENTS; m++) {
+			auto& out = batch.mueller[m];
+			out.fill(0.0f);
+			for (size_t r = 0; r < 4; r++) {
+				for (size_t c = 0; c < 4; c++) {
+					//real part of H_rc B_cr, the imaginary parts cancel over the sum
+					const float b_re = b[m][c * 4 + r].real();
+					const float b_im = b[m][c * 4 + r].imag();
+					if (b_re == 0.0f && b_im == 0.0f) {
+						continue;
+					}
+					for (size_t l = 0; l < BATCH_SIZE; l++) {
+						out[l] += rebuilt.re[r * 4 + c][l] * b_re - rebuilt.im[r * 4 + c][l] * b_im;
+					}
+				}
+			}
+		}
+	}
+}
+
+mme::CloudeFilterResult mme::cloude_filter(const MuellerImage& mueller)
+{
+	MME_TRACE_SCOPE("cloude_filter");
+	const auto size = mueller.size();
+	CloudeFilterResult result{ MuellerImage(size), Image<float>(size), Image<float>(size) };
+	constexpr float NaN = std::numeric_limits<float>::quiet_NaN();
+
+	parallel_for_rows(size.height, TILE_ROWS, [&](size_t row_start, size_t num_rows) {
+		MME_TRACE_SCOPE("cloude_filter tile");
+		std::array<std::span<const float>, MUELLER_ELEMENTS> in;
+		std::array<std::span<float>, MUELLER_ELEMENTS> out;
+		for (size_t m = 0; m < MUELLER_ELEMENTS; m++) {
+			in[m] = mueller.plane(m).sub_view(row_start, num_rows).pixels();
+			out[m] = result.filtered.plane(m).sub_view(row_start, num_rows).pixels();
+		}
+		auto entropy = result.entropy.as_view().sub_view(row_start, num_rows).pixels();
+		auto purity = result.purity.as_view().sub_view(row_start, num_rows).pixels();
+
+		PixelBatch batch;
+		for (size_t start = 0; start < entropy.size(); start += BATCH_SIZE) {
+			const size_t count = std::min(BATCH_SIZE, entropy.size() - start);
+			std::array<bool, BATCH_SIZE> valid;
+			valid.fill(false);
+			for (size_t m = 0; m < MUELLER_ELEMENTS; m++) {
+				for (size_t l = 0; l < BATCH_SIZE; l++) {
+					batch.mueller[m][l] = l < count ? in[m][start + l] : 0.0f;
+				}
+			}
+			//lanes are independent, a non finite pixel is zeroed for the batch and reported as NaN afterwards
+			for (size_t l = 0; l < count; l++) {
+				valid[l] = true;
+				for (size_t m = 0; m < MUELLER_ELEMENTS; m++) {
+					valid[l] = valid[l] && std::isfinite(batch.mueller[m][l]);
+				}
+				if (!valid[l]) {
+					for (size_t m = 0; m < MUELLER_ELEMENTS; m++) {
+						batch.mueller[m][l] = 0.0f;
+					}
+				}
+			}
+
+			filter_batch(batch);
+
+			for (size_t m = 0; m < MUELLER_ELEMENTS; m++) {
+				for (size_t l = 0; l < count; l++) {
+					out[m][start + l] = valid[l] ? batch.mueller[m][l] : NaN;
+				}
+			}
+			for (size_t l = 0; l < count; l++) {
+				entropy[start + l] = valid[l] ? batch.entropy[l] : NaN;
+				purity[start + l] = valid[l] ? batch.purity[l] : NaN;
+			}
+		}
+	});
+	return result;
+}
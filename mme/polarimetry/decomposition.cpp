@@ -0,0 +1,154 @@
+#include "mme/polarimetry/decomposition.h"
+#include "mme/polarimetry/matrix.h"
+#include "mme/parallel/threadpool.h"
+#include "mme/tracing/trace.h"
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <algorithm>
+
+namespace {
+
+	using Mat3 = mme::Matrix<double, 3, 3>;
+
+	constexpr float NaN = std::numeric_limits<float>::quiet_NaN();
+	constexpr double EPSILON = 1e-9;
+	constexpr size_t TILE_ROWS = 16;
+
+	//closed form (trigonometric) eigenvalues of a symmetric positive semi-definite 3x3 matrix
+	std::array<double, 3> symmetric_eigenvalues(const Mat3& s) {
+		const double off_diagonal = s[1] * s[1] + s[2] * s[2] + s[5] * s[5];
+		const double q = (s[0] + s[4] + s[8]) / 3.0;
+		const double diagonal = (s[0] - q) * (s[0] - q) + (s[4] - q) * (s[4] - q) + (s[8] - q) * (s[8] - q);
+		const double p = std::sqrt((diagonal + 2.0 * off_diagonal) / 6.0);
+		if (p < EPSILON) {
+			return { q, q, q };
+		}
+		Mat3 b = s;
+		b[0] -= q;
+		b[4] -= q;
+		b[8] -= q;
+		const double r = std::clamp(determinant(b) / (2.0 * p * p * p), -1.0, 1.0);
+		const double phi = std::acos(r) / 3.0;
+		const double e1 = q + 2.0 * p * std::cos(phi);
+		const double e3 = q + 2.0 * p * std::cos(phi + 2.0 * std::numbers::pi / 3.0);
+		const double e2 = 3.0 * q - e1 - e3;
+		return { std::max(e1, 0.0), std::max(e2, 0.0), std::max(e3, 0.0) };
+	}
+}
+
+mme::LuChipmanPixel mme::lu_chipman(std::span<const float, MUELLER_ELEMENTS> mueller)
+{
+	double sum = 0.0;
+	for (float element : mueller) {
+		sum += element;
+	}
+	const double m00 = mueller[0];
+	if (!(m00 > 0.0) || !std::isfinite(sum)) {
+		return { NaN, NaN, NaN, NaN };
+	}
+	auto m = [&](size_t row, size_t col) { return mueller[row * 4 + col] / m00; };
+
+	//diattenuator from the first row
+	const std::array<double, 3> d{ m(0, 1), m(0, 2), m(0, 3) };
+	const double diattenuation_squared = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+	const double diattenuation = std::sqrt(diattenuation_squared);
+	const double a_squared = 1.0 - diattenuation_squared;
+	if (a_squared < EPSILON) {
+		return { static_cast<float>(std::min(diattenuation, 1.0)), NaN, NaN, NaN };
+	}
+	const double a = std::sqrt(a_squared);
+
+	//M_D(d)^-1 = M_D(-d) / a^2, with m_D = a I + (1 - a) d d^T / D^2
+	const Vector<double, 3> d_vector{ d };
+	Mat3 m_d = a * Mat3::identity();
+	if (diattenuation > EPSILON) {
+		m_d = m_d + ((1.0 - a) / diattenuation_squared) * (d_vector * transpose(d_vector));
+	}
+
+	//lower right 3x3 of M' = M M_D^-1 = M_delta M_R, the polarizance column times -d^T plus m times m_D
+	Mat3 m_lower;
+	Vector<double, 3> polarizance;
+	for (size_t i = 0; i < 3; i++) {
+		polarizance[i] = m(i + 1, 0);
+		for (size_t j = 0; j < 3; j++) {
+			m_lower(i, j) = m(i + 1, j + 1);
+		}
+	}
+	const Mat3 m_prime = (1.0 / a_squared) * (m_lower * m_d - polarizance * transpose(d_vector));
+
+	//m_delta = +-[m' m'^T + (sqrt(l1 l2) + sqrt(l2 l3) + sqrt(l3 l1)) I]^-1 [(sqrt(l1) + sqrt(l2) + sqrt(l3)) m' m'^T + sqrt(l1 l2 l3) I]
+	const Mat3 s = m_prime * transpose(m_prime);
+	const auto [l1, l2, l3] = symmetric_eigenvalues(s);
+	const double root_sum = std::sqrt(l1) + std::sqrt(l2) + std::sqrt(l3);
+	if (root_sum < EPSILON) {
+		//completely depolarizing, there is no retarder to speak of
+		return { static_cast<float>(diattenuation), NaN, NaN, 1.0f };
+	}
+	const double pair_sum = std::sqrt(l1 * l2) + std::sqrt(l2 * l3) + std::sqrt(l3 * l1);
+	const double root_product = std::sqrt(l1 * l2 * l3);
+
+	const Mat3 lhs = s + pair_sum * Mat3::identity();
+	const Mat3 rhs = root_sum * s + root_product * Mat3::identity();
+	const double lhs_det = determinant(lhs);
+	if (std::abs(lhs_det) < EPSILON) {
+		return { static_cast<float>(diattenuation), NaN, NaN, NaN };
+	}
+	const double sign = determinant(m_prime) < 0.0 ? -1.0 : 1.0;
+	const Mat3 m_delta = sign * (inverse(lhs) * rhs);
+	const double depolarization = 1.0 - std::abs(m_delta.trace()) / 3.0;
+
+	//m_R = m_delta^-1 m', undefined when the depolarizer removes a whole axis
+	const double delta_det = determinant(m_delta);
+	if (std::abs(delta_det) < EPSILON) {
+		return { static_cast<float>(diattenuation), NaN, NaN, static_cast<float>(depolarization) };
+	}
+	const Mat3 m_r = inverse(m_delta) * m_prime;
+	const double retardance = std::acos(std::clamp((m_r.trace() - 1.0) / 2.0, -1.0, 1.0));
+
+	//linear retardance vector components, both scaled by 2 sin(R)
+	const double r1 = m_r(1, 2) - m_r(2, 1);
+	const double r2 = m_r(2, 0) - m_r(0, 2);
+	const bool has_axis = std::abs(std::sin(retardance)) > 1e-6 && (r1 * r1 + r2 * r2) > EPSILON;
+	const double orientation = has_axis ? 0.5 * std::atan2(r2, r1) : std::numeric_limits<double>::quiet_NaN();
+
+	return {
+		static_cast<float>(diattenuation),
+		static_cast<float>(retardance),
+		static_cast<float>(orientation),
+		static_cast<float>(depolarization)
+	};
+}
+
+mme::LuChipmanMaps mme::lu_chipman(const MuellerImage& mueller)
+{
+	MME_TRACE_SCOPE("lu_chipman");
+	const auto size = mueller.size();
+	LuChipmanMaps maps{ Image<float>(size), Image<float>(size), Image<float>(size), Image<float>(size) };
+
+	parallel_for_rows(size.height, TILE_ROWS, [&](size_t row_start, size_t num_rows) {
+		MME_TRACE_SCOPE("lu_chipman tile");
+		std::array<std::span<const float>, MUELLER_ELEMENTS> planes;
+		for (size_t k = 0; k < MUELLER_ELEMENTS; k++) {
+			planes[k] = mueller.plane(k).sub_view(row_start, num_rows).pixels();
+		}
+		auto diattenuation = maps.diattenuation.as_view().sub_view(row_start, num_rows).pixels();
+		auto retardance = maps.retardance.as_view().sub_view(row_start, num_rows).pixels();
+		auto orientation = maps.orientation.as_view().sub_view(row_start, num_rows).pixels();
+		auto depolarization = maps.depolarization.as_view().sub_view(row_start, num_rows).pixels();
+
+		std::array<float, MUELLER_ELEMENTS> pixel;
+		for (size_t i = 0; i < diattenuation.size(); i++) {
+			for (size_t k = 0; k < MUELLER_ELEMENTS; k++) {
+				pixel[k] = planes[k][i];
+			}
+			const auto result = lu_chipman(pixel);
+			diattenuation[i] = result.diattenuation;
+			retardance[i] = result.retardance;
+			orientation[i] = result.orientation;
+			depolarization[i] = result.depolarization;
+		}
+	});
+	return maps;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/polarimetry/muellerimage.h"
+
+namespace mme {
+
+	struct CloudeFilterResult {
+		MuellerImage filtered;
+		Image<float> entropy;	//of the normalized coherency eigenvalues, log base 4: 0 pure, 1 ideal depolarizer
+		Image<float> purity;	//sqrt((4 sum p_i^2 - 1) / 3): 1 pure, 0 ideal depolarizer
+	};
+
+	//Cloude filtering: the coherency matrix H = 1/4 sum m_ij (sigma_i kron conj(sigma_j)) of every pixel is
+	//eigendecomposed, negative eigenvalues are clipped to zero and the Mueller matrix is rebuilt from the
+	//physically realizable H. Pixels with a non finite element come out as NaN.
+	CloudeFilterResult cloude_filter(const MuellerImage& mueller);
+
+}
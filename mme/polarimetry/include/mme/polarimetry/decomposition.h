@@ -0,0 +1,30 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/polarimetry/muellerimage.h"
+#include <span>
+
+namespace mme {
+
+	struct LuChipmanPixel {
+		float diattenuation;
+		float retardance;		//rad, total retardance of the retarder
+		float orientation;		//rad, fast axis of the linear part of the retarder
+		float depolarization;	//1 - |tr(m_delta)| / 3
+	};
+
+	struct LuChipmanMaps {
+		Image<float> diattenuation;
+		Image<float> retardance;
+		Image<float> orientation;
+		Image<float> depolarization;
+	};
+
+	//Lu-Chipman polar decomposition M = M_delta M_R M_D of a single Mueller matrix (row major).
+	//Quantities that are undefined for a pixel are NaN: everything when m00 <= 0 or an element is not finite,
+	//retardance and depolarization for an ideal polarizer (D = 1), orientation when the retardance is 0 or pi.
+	LuChipmanPixel lu_chipman(std::span<const float, MUELLER_ELEMENTS> mueller);
+
+	//lu_chipman for every pixel, row tiles are processed in parallel
+	LuChipmanMaps lu_chipman(const MuellerImage& mueller);
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+namespace mme {
+
+	//N Hermitian 4x4 matrices, structure of arrays: re[row * 4 + col][lane]
+	template<size_t N>
+	struct Hermitian4Batch {
+		std::array<std::array<float, N>, 16> re;
+		std::array<std::array<float, N>, 16> im;
+	};
+
+	namespace detail {
+
+		//x_p, x_q <- c x_p - s w x_q, s x_p + c w x_q lane by lane. Goes through locals so the compiler
+		//does not have to prove the four rows are distinct before vectorizing
+		template<size_t N>
+		void rotate_pair(std::array<float, N>& p_re, std::array<float, N>& p_im, std::array<float, N>& q_re, std::array<float, N>& q_im,
+			const std::array<float, N>& c, const std::array<float, N>& s, const std::array<float, N>& w_re, const std::array<float, N>& w_im)
+		{
+			std::array<float, N> new_p_re, new_p_im, new_q_re, new_q_im;
+			for (size_t l = 0; l < N; l++) {
+				const float wq_re = q_re[l] * w_re[l] - q_im[l] * w_im[l];
+				const float wq_im = q_re[l] * w_im[l] + q_im[l] * w_re[l];
+				new_p_re[l] = c[l] * p_re[l] - s[l] * wq_re;
+				new_p_im[l] = c[l] * p_im[l] - s[l] * wq_im;
+				new_q_re[l] = s[l] * p_re[l] + c[l] * wq_re;
+				new_q_im[l] = s[l] * p_im[l] + c[l] * wq_im;
+			}
+			p_re = new_p_re;
+			p_im = new_p_im;
+			q_re = new_q_re;
+			q_im = new_q_im;
+		}
+	}
+
+	//Eigenvalues are left on the diagonal of matrices, eigenvectors in the columns of vectors (unsorted).
+	//Cyclic complex Jacobi with a fixed number of sweeps and no data dependent branches, so every step is a
+	//loop over the lanes the compiler can vectorize. 4x4 converges quadratically, 4 sweeps reach float precision.
+	template<size_t N, size_t Sweeps = 4>
+	void hermitian_eigen(Hermitian4Batch<N>& matrices, Hermitian4Batch<N>& vectors) {
+		auto& a_re = matrices.re;
+		auto& a_im = matrices.im;
+		auto& v_re = vectors.re;
+		auto& v_im = vectors.im;
+		for (size_t i = 0; i < 16; i++) {
+			v_re[i].fill(i % 5 == 0 ? 1.0f : 0.0f);
+			v_im[i].fill(0.0f);
+		}
+
+		//relative to the diagonal, so converged lanes stop rotating instead of grinding through denormals
+		constexpr float TOLERANCE = 1e-9f;
+		for (size_t sweep = 0; sweep < Sweeps; sweep++) {
+			for (size_t p = 0; p < 3; p++) {
+				for (size_t q = p + 1; q < 4; q++) {
+					//U = diag(phase) * Givens, chosen so that (U^H A U)_pq = 0:
+					//U_pp = c, U_pq = s, U_qp = -s e^-i phi, U_qq = c e^-i phi with a_pq = r e^i phi
+					std::array<float, N> c, s, phase_re, phase_im;
+					for (size_t l = 0; l < N; l++) {
+						const float apq_re = a_re[p * 4 + q][l];
+						const float apq_im = a_im[p * 4 + q][l];
+						const float r = std::sqrt(apq_re * apq_re + apq_im * apq_im);
+						const bool rotate = r > TOLERANCE * (std::abs(a_re[p * 5][l]) + std::abs(a_re[q * 5][l])) && r > 0.0f;
+						const float r_safe = rotate ? r : 1.0f;
+						const float theta = (a_re[q * 5][l] - a_re[p * 5][l]) / (2.0f * r_safe);
+						const float t = std::copysign(1.0f, theta) / (std::abs(theta) + std::sqrt(theta * theta + 1.0f));
+						c[l] = rotate ? 1.0f / std::sqrt(t * t + 1.0f) : 1.0f;
+						s[l] = rotate ? t * c[l] : 0.0f;
+						phase_re[l] = rotate ? apq_re / r_safe : 1.0f; //e^-i phi
+						phase_im[l] = rotate ? -apq_im / r_safe : 0.0f;
+					}
+
+					std::array<float, N> conj_re = phase_re, conj_im;
+					for (size_t l = 0; l < N; l++) {
+						conj_im[l] = -phase_im[l];
+					}
+					//columns p, q of A U and V U, then rows p, q of U^H (A U)
+					for (size_t k = 0; k < 4; k++) {
+						detail::rotate_pair(a_re[k * 4 + p], a_im[k * 4 + p], a_re[k * 4 + q], a_im[k * 4 + q], c, s, phase_re, phase_im);
+						detail::rotate_pair(v_re[k * 4 + p], v_im[k * 4 + p], v_re[k * 4 + q], v_im[k * 4 + q], c, s, phase_re, phase_im);
+					}
+					for (size_t k = 0; k < 4; k++) {
+						detail::rotate_pair(a_re[p * 4 + k], a_im[p * 4 + k], a_re[q * 4 + k], a_im[q * 4 + k], c, s, conj_re, conj_im);
+					}
+					//zero by construction, rounding would leave noise there
+					a_re[p * 4 + q].fill(0.0f);
+					a_im[p * 4 + q].fill(0.0f);
+					a_re[q * 4 + p].fill(0.0f);
+					a_im[q * 4 + p].fill(0.0f);
+				}
+			}
+		}
+	}
+
+}
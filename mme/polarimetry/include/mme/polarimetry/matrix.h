@@ -0,0 +1,256 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+namespace mme {
+
+	//N values of T operated on element by element. As the element type of a Matrix it turns the matrix into a
+	//structure of arrays batch (lanes of one element contiguous), so code written for Matrix<float, ...> runs
+	//unchanged at vector width on Matrix<Lanes<float, N>, ...>. Only branch free algorithms work on lanes.
+	template<typename T, size_t N>
+	struct Lanes {
+		std::array<T, N> values;
+
+		constexpr Lanes() = default;
+		constexpr Lanes(T value) { values.fill(value); }
+
+		constexpr T& operator[](size_t lane) { return values[lane]; }
+		constexpr const T& operator[](size_t lane) const { return values[lane]; }
+
+		static constexpr size_t size() { return N; }
+	};
+
+	namespace detail {
+		template<typename T>
+		struct is_lanes : std::false_type {
+			static constexpr size_t count = 0;
+		};
+
+		template<typename T, size_t N>
+		struct is_lanes<Lanes<T, N>> : std::true_type {
+			static constexpr size_t count = N;
+		};
+
+		template<typename T>
+		constexpr auto lane_value(const T& value, size_t) { return value; }
+
+		template<typename T, size_t N>
+		constexpr T lane_value(const Lanes<T, N>& value, size_t lane) { return value[lane]; }
+
+		template<typename A, typename B, typename Op>
+		constexpr auto lanewise(const A& a, const B& b, Op op) {
+			constexpr size_t N = is_lanes<A>::value ? is_lanes<A>::count : is_lanes<B>::count;
+			using T = decltype(op(lane_value(a, 0), lane_value(b, 0)));
+			Lanes<T, N> result;
+			for (size_t l = 0; l < N; l++) {
+				result[l] = op(lane_value(a, l), lane_value(b, l));
+			}
+			return result;
+		}
+
+		template<typename A, typename B>
+		concept lanes_operands = is_lanes<A>::value || is_lanes<B>::value;
+
+		//calls func(std::integral_constant<size_t, I>{}) for I in [0, N), expanded at compile time
+		template<size_t N, typename Func>
+		constexpr void unroll(Func&& func) {
+			[&]<size_t... I>(std::index_sequence<I...>) {
+				(func(std::integral_constant<size_t, I>{}), ...);
+			}(std::make_index_sequence<N>{});
+		}
+	}
+
+	template<typename A, typename B> requires detail::lanes_operands<A, B>
+	constexpr auto operator+(const A& a, const B& b) { return detail::lanewise(a, b, [](auto x, auto y) { return x + y; }); }
+	template<typename A, typename B> requires detail::lanes_operands<A, B>
+	constexpr auto operator-(const A& a, const B& b) { return detail::lanewise(a, b, [](auto x, auto y) { return x - y; }); }
+	template<typename A, typename B> requires detail::lanes_operands<A, B>
+	constexpr auto operator*(const A& a, const B& b) { return detail::lanewise(a, b, [](auto x, auto y) { return x * y; }); }
+	template<typename A, typename B> requires detail::lanes_operands<A, B>
+	constexpr auto operator/(const A& a, const B& b) { return detail::lanewise(a, b, [](auto x, auto y) { return x / y; }); }
+
+	template<typename T, size_t N>
+	constexpr Lanes<T, N> operator-(const Lanes<T, N>& a) {
+		Lanes<T, N> result;
+		for (size_t l = 0; l < N; l++) {
+			result[l] = -a[l];
+		}
+		return result;
+	}
+
+	//row major, fixed size
+	template<typename T, size_t Rows, size_t Cols>
+	struct Matrix {
+		using value_type = T;
+		static constexpr size_t rows = Rows;
+		static constexpr size_t cols = Cols;
+
+		std::array<T, Rows * Cols> elements{};
+
+		static constexpr Matrix identity() requires (Rows == Cols) {
+			Matrix result;
+			detail::unroll<Rows>([&](auto i) { result(i, i) = T(1); });
+			return result;
+		}
+
+		constexpr T trace() const requires (Rows == Cols) {
+			T sum = (*this)(0, 0);
+			detail::unroll<Rows - 1>([&](auto i) { sum = sum + (*this)(i + 1, i + 1); });
+			return sum;
+		}
+
+		constexpr T& operator()(size_t row, size_t col) { return elements[row * Cols + col]; }
+		constexpr const T& operator()(size_t row, size_t col) const { return elements[row * Cols + col]; }
+
+		constexpr T& operator[](size_t index) { return elements[index]; }
+		constexpr const T& operator[](size_t index) const { return elements[index]; }
+	};
+
+	template<typename T, size_t N>
+	using Vector = Matrix<T, N, 1>;
+
+	using Mat4 = Matrix<float, 4, 4>;
+	using Vec4 = Vector<float, 4>;
+
+	template<size_t N>
+	using Mat4Batch = Matrix<Lanes<float, N>, 4, 4>;
+	template<size_t N>
+	using Vec4Batch = Vector<Lanes<float, N>, 4>;
+
+	template<typename A, typename B, size_t R, size_t K, size_t C>
+	constexpr auto operator*(const Matrix<A, R, K>& a, const Matrix<B, K, C>& b) {
+		Matrix<decltype(a[0] * b[0]), R, C> result;
+		detail::unroll<R>([&](auto i) {
+			detail::unroll<C>([&](auto j) {
+				auto sum = a(i, 0) * b(0, j);
+				detail::unroll<K - 1>([&](auto k) { sum = sum + a(i, k + 1) * b(k + 1, j); });
+				result(i, j) = sum;
+			});
+		});
+		return result;
+	}
+
+	template<typename A, typename B, size_t R, size_t C>
+	constexpr auto operator+(const Matrix<A, R, C>& a, const Matrix<B, R, C>& b) {
+		Matrix<decltype(a[0] + b[0]), R, C> result;
+		detail::unroll<R * C>([&](auto i) { result[i] = a[i] + b[i]; });
+		return result;
+	}
+
+	template<typename A, typename B, size_t R, size_t C>
+	constexpr auto operator-(const Matrix<A, R, C>& a, const Matrix<B, R, C>& b) {
+		Matrix<decltype(a[0] - b[0]), R, C> result;
+		detail::unroll<R * C>([&](auto i) { result[i] = a[i] - b[i]; });
+		return result;
+	}
+
+	template<typename T, typename S, size_t R, size_t C>
+	constexpr auto operator*(const S& scalar, const Matrix<T, R, C>& m) {
+		Matrix<decltype(scalar * m[0]), R, C> result;
+		detail::unroll<R * C>([&](auto i) { result[i] = scalar * m[i]; });
+		return result;
+	}
+
+	template<typename T, size_t R, size_t C>
+	constexpr Matrix<T, C, R> transpose(const Matrix<T, R, C>& m) {
+		Matrix<T, C, R> result;
+		detail::unroll<R>([&](auto i) {
+			detail::unroll<C>([&](auto j) { result(j, i) = m(i, j); });
+		});
+		return result;
+	}
+
+	//cofactor expansions, branch free so they also run on lanes
+	template<typename T>
+	constexpr T determinant(const Matrix<T, 2, 2>& m) {
+		return m[0] * m[3] - m[1] * m[2];
+	}
+
+	template<typename T>
+	constexpr T determinant(const Matrix<T, 3, 3>& m) {
+		return m[0] * (m[4] * m[8] - m[5] * m[7]) - m[1] * (m[3] * m[8] - m[5] * m[6]) + m[2] * (m[3] * m[7] - m[4] * m[6]);
+	}
+
+	template<typename T>
+	constexpr T determinant(const Matrix<T, 4, 4>& m) {
+		//2x2 minors of the lower two rows
+		const T s0 = m[8] * m[13] - m[9] * m[12];
+		const T s1 = m[8] * m[14] - m[10] * m[12];
+		const T s2 = m[8] * m[15] - m[11] * m[12];
+		const T s3 = m[9] * m[14] - m[10] * m[13];
+		const T s4 = m[9] * m[15] - m[11] * m[13];
+		const T s5 = m[10] * m[15] - m[11] * m[14];
+		return m[0] * (m[5] * s5 - m[6] * s4 + m[7] * s3)
+			- m[1] * (m[4] * s5 - m[6] * s2 + m[7] * s1)
+			+ m[2] * (m[4] * s4 - m[5] * s2 + m[7] * s0)
+			- m[3] * (m[4] * s3 - m[5] * s1 + m[6] * s0);
+	}
+
+	//adjugate over determinant, singular matrices give inf or NaN, check determinant() where that matters
+	template<typename T>
+	constexpr Matrix<T, 2, 2> inverse(const Matrix<T, 2, 2>& m) {
+		const T inv_det = T(1) / determinant(m);
+		return { { m[3] * inv_det, -m[1] * inv_det, -m[2] * inv_det, m[0] * inv_det } };
+	}
+
+	template<typename T>
+	constexpr Matrix<T, 3, 3> inverse(const Matrix<T, 3, 3>& m) {
+		const T inv_det = T(1) / determinant(m);
+		return { {
+			(m[4] * m[8] - m[5] * m[7]) * inv_det, (m[2] * m[7] - m[1] * m[8]) * inv_det, (m[1] * m[5] - m[2] * m[4]) * inv_det,
+			(m[5] * m[6] - m[3] * m[8]) * inv_det, (m[0] * m[8] - m[2] * m[6]) * inv_det, (m[2] * m[3] - m[0] * m[5]) * inv_det,
+			(m[3] * m[7] - m[4] * m[6]) * inv_det, (m[1] * m[6] - m[0] * m[7]) * inv_det, (m[0] * m[4] - m[1] * m[3]) * inv_det
+		} };
+	}
+
+	template<typename T>
+	constexpr Matrix<T, 4, 4> inverse(const Matrix<T, 4, 4>& m) {
+		//Laplace expansion with 2x2 minors of the upper (s) and lower (c) row pairs
+		const T s0 = m[0] * m[5] - m[4] * m[1];
+		const T s1 = m[0] * m[6] - m[4] * m[2];
+		const T s2 = m[0] * m[7] - m[4] * m[3];
+		const T s3 = m[1] * m[6] - m[5] * m[2];
+		const T s4 = m[1] * m[7] - m[5] * m[3];
+		const T s5 = m[2] * m[7] - m[6] * m[3];
+		const T c5 = m[10] * m[15] - m[14] * m[11];
+		const T c4 = m[9] * m[15] - m[13] * m[11];
+		const T c3 = m[9] * m[14] - m[13] * m[10];
+		const T c2 = m[8] * m[15] - m[12] * m[11];
+		const T c1 = m[8] * m[14] - m[12] * m[10];
+		const T c0 = m[8] * m[13] - m[12] * m[9];
+		const T inv_det = T(1) / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+
+		return { {
+			(m[5] * c5 - m[6] * c4 + m[7] * c3) * inv_det,
+			(-m[1] * c5 + m[2] * c4 - m[3] * c3) * inv_det,
+			(m[13] * s5 - m[14] * s4 + m[15] * s3) * inv_det,
+			(-m[9] * s5 + m[10] * s4 - m[11] * s3) * inv_det,
+
+			(-m[4] * c5 + m[6] * c2 - m[7] * c1) * inv_det,
+			(m[0] * c5 - m[2] * c2 + m[3] * c1) * inv_det,
+			(-m[12] * s5 + m[14] * s2 - m[15] * s1) * inv_det,
+			(m[8] * s5 - m[10] * s2 + m[11] * s1) * inv_det,
+
+			(m[4] * c4 - m[5] * c2 + m[7] * c0) * inv_det,
+			(-m[0] * c4 + m[1] * c2 - m[3] * c0) * inv_det,
+			(m[12] * s4 - m[13] * s2 + m[15] * s0) * inv_det,
+			(-m[8] * s4 + m[9] * s2 - m[11] * s0) * inv_det,
+
+			(-m[4] * c3 + m[5] * c1 - m[6] * c0) * inv_det,
+			(m[0] * c3 - m[1] * c1 + m[2] * c0) * inv_det,
+			(-m[12] * s3 + m[13] * s1 - m[14] * s0) * inv_det,
+			(m[8] * s3 - m[9] * s1 + m[10] * s0) * inv_det
+		} };
+	}
+
+	//Moore-Penrose pseudo-inverse (A^T A)^-1 A^T of a full column rank matrix, e.g. an instrument matrix
+	//with more measurements than Stokes parameters
+	template<typename T, size_t R, size_t C> requires (R >= C && C <= 4)
+	constexpr Matrix<T, C, R> pseudo_inverse(const Matrix<T, R, C>& m) {
+		const auto m_t = transpose(m);
+		return inverse(m_t * m) * m_t;
+	}
+
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include <vector>
+#include <format>
+#include <stdexcept>
+
+namespace mme {
+
+	inline constexpr size_t MUELLER_SIZE = 4;
+	inline constexpr size_t MUELLER_ELEMENTS = MUELLER_SIZE * MUELLER_SIZE;
+
+	//Mueller matrix per pixel, stored as 16 separate planes (structure of arrays) so per pixel kernels
+	//read contiguous memory for every element. Planes are in row major element order, m00, m01, ... m33.
+	class MuellerImage {
+	public:
+		explicit MuellerImage(ImageSize size) : m_size(size) {
+			m_elements.reserve(MUELLER_ELEMENTS);
+			for (size_t i = 0; i < MUELLER_ELEMENTS; i++) {
+				m_elements.emplace_back(size);
+			}
+		}
+
+		explicit MuellerImage(std::vector<Image<float>> elements) : m_elements(std::move(elements)) {
+			if (m_elements.size() != MUELLER_ELEMENTS) {
+				throw std::invalid_argument(std::format("A Mueller image needs {} element planes, got {}", MUELLER_ELEMENTS, m_elements.size()));
+			}
+			m_size = m_elements.front().size();
+			for (const auto& element : m_elements) {
+				if (element.size() != m_size) {
+					throw std::invalid_argument("All Mueller element planes must have the same size");
+				}
+			}
+		}
+
+		ImageSize size() const { return m_size; }
+
+		ImageView<float> element(size_t row, size_t col) { return plane(row * MUELLER_SIZE + col); }
+		ImageView<const float> element(size_t row, size_t col) const { return plane(row * MUELLER_SIZE + col); }
+
+		ImageView<float> plane(size_t index) { return m_elements.at(index).as_view(); }
+		ImageView<const float> plane(size_t index) const { return m_elements.at(index).as_view(); }
+
+	private:
+		ImageSize m_size;
+		std::vector<Image<float>> m_elements;
+	};
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/polarimetry/muellerimage.h"
+#include "mme/polarimetry/matrix.h"
+#include <span>
+
+namespace mme {
+
+	//Polarization state generator W (columns are the generated Stokes vectors) and analyzer A (rows are the
+	//analyzed states), so the 4x4 intensity matrix of a pixel is I = A M W.
+	struct InstrumentMatrices {
+		Mat4 generator;
+		Mat4 analyzer;
+	};
+
+	//M = A^-1 I W^-1 for every pixel. frames holds the 16 intensity frames analyzer major:
+	//frame a * 4 + g was taken with analyzer state a and generator state g.
+	MuellerImage reconstruct_mueller(std::span<const ImageView<const float>> frames, const InstrumentMatrices& instrument);
+	//the same into 16 planes of the frames' size, in MuellerImage plane order, e.g. the tiles of a larger result
+	void reconstruct_mueller(std::span<const ImageView<const float>> frames, const InstrumentMatrices& instrument, std::span<const ImageView<float>> destination);
+
+}
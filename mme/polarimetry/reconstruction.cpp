@@ -0,0 +1,76 @@
+#include "mme/polarimetry/reconstruction.h"
+#include "mme/parallel/threadpool.h"
+#include "mme/tracing/trace.h"
+#include <array>
+#include <cmath>
+#include <format>
+#include <stdexcept>
+#include <algorithm>
+
+namespace {
+	constexpr size_t BATCH_SIZE = 16;
+	constexpr size_t TILE_ROWS = 16;
+}
+
+mme::MuellerImage mme::reconstruct_mueller(std::span<const ImageView<const float>> frames, const InstrumentMatrices& instrument)
+{
+	if (frames.empty()) {
+		throw std::invalid_argument(std::format("Mueller reconstruction needs {} frames, got none", MUELLER_ELEMENTS));
+	}
+	MuellerImage mueller(frames.front().size());
+	std::array<ImageView<float>, MUELLER_ELEMENTS> planes;
+	for (size_t k = 0; k < MUELLER_ELEMENTS; k++) {
+		planes[k] = mueller.plane(k);
+	}
+	reconstruct_mueller(frames, instrument, planes);
+	return mueller;
+}
+
+void mme::reconstruct_mueller(std::span<const ImageView<const float>> frames, const InstrumentMatrices& instrument, std::span<const ImageView<float>> destination)
+{
+	MME_TRACE_SCOPE("reconstruct_mueller");
+	if (frames.size() != MUELLER_ELEMENTS) {
+		throw std::invalid_argument(std::format("Mueller reconstruction needs {} frames, got {}", MUELLER_ELEMENTS, frames.size()));
+	}
+	const auto size = frames.front().size();
+	for (const auto& frame : frames) {
+		if (frame.size() != size) {
+			throw std::invalid_argument("All frames of a Mueller reconstruction must have the same size");
+		}
+	}
+	if (destination.size() != MUELLER_ELEMENTS || std::ranges::any_of(destination, [&](const auto& plane) { return plane.size() != size; })) {
+		throw std::invalid_argument(std::format("Mueller reconstruction needs {} destination planes of the frames' size", MUELLER_ELEMENTS));
+	}
+	if (std::abs(determinant(instrument.generator)) < 1e-6f || std::abs(determinant(instrument.analyzer)) < 1e-6f) {
+		throw std::invalid_argument("Instrument matrices are singular, the Mueller matrix cannot be reconstructed");
+	}
+	const Mat4 analyzer_inverse = inverse(instrument.analyzer);
+	const Mat4 generator_inverse = inverse(instrument.generator);
+
+	parallel_for_rows(size.height, TILE_ROWS, [&](size_t row_start, size_t num_rows) {
+		std::array<std::span<const float>, MUELLER_ELEMENTS> in;
+		std::array<std::span<float>, MUELLER_ELEMENTS> out;
+		for (size_t k = 0; k < MUELLER_ELEMENTS; k++) {
+			in[k] = frames[k].sub_view(row_start, num_rows).pixels();
+			auto plane = destination[k];
+			out[k] = plane.sub_view(row_start, num_rows).pixels();
+		}
+		const size_t count = in[0].size();
+
+		Mat4Batch<BATCH_SIZE> intensities;
+		for (size_t start = 0; start < count; start += BATCH_SIZE) {
+			const size_t lanes = std::min(BATCH_SIZE, count - start);
+			for (size_t k = 0; k < MUELLER_ELEMENTS; k++) {
+				for (size_t l = 0; l < BATCH_SIZE; l++) {
+					intensities[k][l] = l < lanes ? in[k][start + l] : 0.0f;
+				}
+			}
+			const auto m = analyzer_inverse * intensities * generator_inverse;
+			for (size_t k = 0; k < MUELLER_ELEMENTS; k++) {
+				for (size_t l = 0; l < lanes; l++) {
+					out[k][start + l] = m[k][l];
+				}
+			}
+		}
+	});
+}
@@ -0,0 +1,217 @@
+#include "mme/registration/fft.h"
+#include <numbers>
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+	//columns per strip of the 2D transform, a strip of 2048 rows is 256 kB of scratch
+	constexpr size_t COLUMN_STRIP = 16;
+
+	//the pointers never overlap, saying so lets the loop vectorize without a pile of runtime alias checks
+	void butterflies(float* __restrict ar, float* __restrict ai, float* __restrict br, float* __restrict bi,
+		const float* __restrict wr, const float* __restrict wi, size_t count) {
+		for (size_t j = 0; j < count; j++) {
+			const float tr = br[j] * wr[j] - bi[j] * wi[j];
+			const float ti = br[j] * wi[j] + bi[j] * wr[j];
+			br[j] = ar[j] - tr;
+			bi[j] = ai[j] - ti;
+			ar[j] += tr;
+			ai[j] += ti;
+		}
+	}
+
+	//a fixed count for full strips turns each row into a few vector moves instead of a memmove call
+	void copy_rows(const float* from, size_t from_stride, float* to, size_t to_stride, size_t num_rows, size_t num_cols) {
+		if (num_cols == COLUMN_STRIP) {
+			for (size_t row = 0; row < num_rows; row++) {
+				std::copy_n(from + row * from_stride, COLUMN_STRIP, to + row * to_stride);
+			}
+			return;
+		}
+		for (size_t row = 0; row < num_rows; row++) {
+			std::copy_n(from + row * from_stride, num_cols, to + row * to_stride);
+		}
+	}
+
+	void check_sizes(size_t re, size_t im, size_t expected) {
+		if (re != expected || im != expected) {
+			throw std::invalid_argument(std::format("FFT of {} real and {} imaginary values with a plan for {}", re, im, expected));
+		}
+	}
+}
+
+mme::FftPlan::FftPlan(size_t size)
+	: m_size(size)
+	, m_bit_reverse(size)
+	, m_twiddle_re(std::max<size_t>(size, 1) - 1)
+	, m_twiddle_im(std::max<size_t>(size, 1) - 1)
+	, m_inverse_twiddle_im(std::max<size_t>(size, 1) - 1)
+{
+	if (!is_power_of_two(size) || size > (size_t{ 1 } << 31)) {
+		throw std::invalid_argument(std::format("FFT size must be a power of two, got {}", size));
+	}
+	size_t bits = 0;
+	while ((size_t{ 1 } << bits) < size) {
+		bits++;
+	}
+	for (size_t i = 0; i < size; i++) {
+		size_t reversed = 0;
+		for (size_t b = 0; b < bits; b++) {
+			reversed |= ((i >> b) & 1) << (bits - 1 - b);
+		}
+		m_bit_reverse[i] = static_cast<uint32_t>(reversed);
+	}
+	for (size_t half = 1; half < size; half *= 2) {
+		for (size_t j = 0; j < half; j++) {
+			const double angle = -std::numbers::pi * static_cast<double>(j) / static_cast<double>(half);
+			m_twiddle_re[half - 1 + j] = static_cast<float>(std::cos(angle));
+			m_twiddle_im[half - 1 + j] = static_cast<float>(std::sin(angle));
+			m_inverse_twiddle_im[half - 1 + j] = -m_twiddle_im[half - 1 + j];
+		}
+	}
+}
+
+void mme::FftPlan::forward(std::span<float> re, std::span<float> im) const
+{
+	check_sizes(re.size(), im.size(), m_size);
+	transform(re.data(), im.data(), false);
+}
+
+void mme::FftPlan::inverse(std::span<float> re, std::span<float> im) const
+{
+	check_sizes(re.size(), im.size(), m_size);
+	transform(re.data(), im.data(), true);
+}
+
+void mme::FftPlan::forward(float* re, float* im, size_t batch) const
+{
+	transform(re, im, batch, false);
+}
+
+void mme::FftPlan::inverse(float* re, float* im, size_t batch) const
+{
+	transform(re, im, batch, true);
+}
+
+void mme::FftPlan::transform(float* re, float* im, bool inverse) const
+{
+	const size_t n = m_size;
+	for (size_t i = 0; i < n; i++) {
+		const size_t j = m_bit_reverse[i];
+		if (i < j) {
+			std::swap(re[i], re[j]);
+			std::swap(im[i], im[j]);
+		}
+	}
+
+	//the first two stages as one radix-4 pass, their twiddles are 1 and -i (+i for the inverse)
+	if (n == 2) {
+		const float ar = re[0], ai = im[0];
+		re[0] = ar + re[1]; im[0] = ai + im[1];
+		re[1] = ar - re[1]; im[1] = ai - im[1];
+		return;
+	}
+	const float sign = inverse ? -1.0f : 1.0f;
+	for (size_t i = 0; i + 3 < n; i += 4) {
+		const float ar = re[i] + re[i + 1], ai = im[i] + im[i + 1];
+		const float br = re[i] - re[i + 1], bi = im[i] - im[i + 1];
+		const float cr = re[i + 2] + re[i + 3], ci = im[i + 2] + im[i + 3];
+		const float dr = re[i + 2] - re[i + 3], di = im[i + 2] - im[i + 3];
+		//d * -i for the forward transform
+		const float er = sign * di, ei = -sign * dr;
+		re[i] = ar + cr; im[i] = ai + ci;
+		re[i + 1] = br + er; im[i + 1] = bi + ei;
+		re[i + 2] = ar - cr; im[i + 2] = ai - ci;
+		re[i + 3] = br - er; im[i + 3] = bi - ei;
+	}
+
+	const float* twiddle_im = inverse ? m_inverse_twiddle_im.data() : m_twiddle_im.data();
+	for (size_t half = 4; half < n; half *= 2) {
+		const float* wr = m_twiddle_re.data() + half - 1;
+		const float* wi = twiddle_im + half - 1;
+		for (size_t start = 0; start < n; start += 2 * half) {
+			butterflies(re + start, im + start, re + start + half, im + start + half, wr, wi, half);
+		}
+	}
+}
+
+void mme::FftPlan::transform(float* re, float* im, size_t batch, bool inverse) const
+{
+	const size_t n = m_size;
+	for (size_t i = 0; i < n; i++) {
+		const size_t j = m_bit_reverse[i];
+		if (i < j) {
+			std::swap_ranges(re + i * batch, re + (i + 1) * batch, re + j * batch);
+			std::swap_ranges(im + i * batch, im + (i + 1) * batch, im + j * batch);
+		}
+	}
+
+	//the same butterflies with every value widened to batch lanes that vectorize together
+	const float* twiddle_im = inverse ? m_inverse_twiddle_im.data() : m_twiddle_im.data();
+	for (size_t half = 1; half < n; half *= 2) {
+		for (size_t start = 0; start < n; start += 2 * half) {
+			for (size_t j = 0; j < half; j++) {
+				const float wr = m_twiddle_re[half - 1 + j];
+				const float wi = twiddle_im[half - 1 + j];
+				float* ar = re + (start + j) * batch;
+				float* ai = im + (start + j) * batch;
+				float* br = re + (start + j + half) * batch;
+				float* bi = im + (start + j + half) * batch;
+				for (size_t b = 0; b < batch; b++) {
+					const float tr = br[b] * wr - bi[b] * wi;
+					const float ti = br[b] * wi + bi[b] * wr;
+					br[b] = ar[b] - tr;
+					bi[b] = ai[b] - ti;
+					ar[b] += tr;
+					ai[b] += ti;
+				}
+			}
+		}
+	}
+}
+
+mme::FftPlan2d::FftPlan2d(ImageSize size)
+	: m_rows(size.width)
+	, m_columns(size.height)
+{
+}
+
+void mme::FftPlan2d::forward(std::span<float> re, std::span<float> im) const
+{
+	transform(re, im, false);
+}
+
+void mme::FftPlan2d::inverse(std::span<float> re, std::span<float> im) const
+{
+	transform(re, im, true);
+}
+
+void mme::FftPlan2d::transform(std::span<float> re, std::span<float> im, bool inverse) const
+{
+	const size_t width = m_rows.size();
+	const size_t height = m_columns.size();
+	check_sizes(re.size(), im.size(), width * height);
+
+	for (size_t row = 0; row < height; row++) {
+		auto row_re = re.subspan(row * width, width);
+		auto row_im = im.subspan(row * width, width);
+		inverse ? m_rows.inverse(row_re, row_im) : m_rows.forward(row_re, row_im);
+	}
+
+	//a strip is copied out so its rows are contiguous, in place they are a power of two apart and
+	//compete for the same cache sets
+	std::vector<float> strip_re(COLUMN_STRIP * height);
+	std::vector<float> strip_im(COLUMN_STRIP * height);
+	for (size_t col_start = 0; col_start < width; col_start += COLUMN_STRIP) {
+		const size_t num_cols = std::min(COLUMN_STRIP, width - col_start);
+		copy_rows(re.data() + col_start, width, strip_re.data(), num_cols, height, num_cols);
+		copy_rows(im.data() + col_start, width, strip_im.data(), num_cols, height, num_cols);
+		inverse ? m_columns.inverse(strip_re.data(), strip_im.data(), num_cols) : m_columns.forward(strip_re.data(), strip_im.data(), num_cols);
+		copy_rows(strip_re.data(), num_cols, re.data() + col_start, width, height, num_cols);
+		copy_rows(strip_im.data(), num_cols, im.data() + col_start, width, height, num_cols);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include <span>
+#include <vector>
+#include <cstdint>
+
+namespace mme {
+
+	constexpr bool is_power_of_two(size_t value) {
+		return value > 0 && (value & (value - 1)) == 0;
+	}
+
+	constexpr size_t next_power_of_two(size_t value) {
+		size_t result = 1;
+		while (result < value) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	//Radix-2 complex FFT for power of two sizes on split real and imaginary arrays, which keeps every
+	//butterfly loop a plain vectorizable loop over floats. The twiddle and bit reversal tables are built
+	//once and the plan is immutable afterwards, so threads can share one plan for different buffers.
+	//The inverse is unscaled, divide by size() to invert forward.
+	class FftPlan {
+	public:
+		explicit FftPlan(size_t size);
+
+		size_t size() const { return m_size; }
+
+		void forward(std::span<float> re, std::span<float> im) const;
+		void inverse(std::span<float> re, std::span<float> im) const;
+
+		//batch transforms stored interleaved: value k of transform b is at k * batch + b
+		void forward(float* re, float* im, size_t batch) const;
+		void inverse(float* re, float* im, size_t batch) const;
+
+	private:
+		void transform(float* re, float* im, bool inverse) const;
+		void transform(float* re, float* im, size_t batch, bool inverse) const;
+
+	private:
+		size_t m_size;
+		std::vector<uint32_t> m_bit_reverse;
+		//stage major, the twiddles of the butterflies of length 2 * half start at half - 1
+		std::vector<float> m_twiddle_re;
+		std::vector<float> m_twiddle_im; //forward sign, negated for the inverse
+		std::vector<float> m_inverse_twiddle_im;
+	};
+
+	//Row major 2D FFT on split arrays: rows one at a time, columns in cache sized strips that are
+	//transformed as a batch. The inverse is unscaled, divide by num_pixels(size()) to invert forward.
+	class FftPlan2d {
+	public:
+		explicit FftPlan2d(ImageSize size);
+
+		ImageSize size() const { return { m_columns.size(), m_rows.size() }; }
+
+		void forward(std::span<float> re, std::span<float> im) const;
+		void inverse(std::span<float> re, std::span<float> im) const;
+
+	private:
+		void transform(std::span<float> re, std::span<float> im, bool inverse) const;
+
+	private:
+		FftPlan m_rows; //length width
+		FftPlan m_columns; //length height
+	};
+
+} //namespace mme
@@ -0,0 +1,470 @@
+#include "mme/registration/registration.h"
+#include "mme/parallel/threadpool.h"
+#include "mme/tracing/trace.h"
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <limits>
+#include <numbers>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+	size_t previous_power_of_two(size_t value) {
+		size_t result = 1;
+		while (result * 2 <= value) {
+			result *= 2;
+		}
+		return result;
+	}
+
+	std::vector<float> hann_window(size_t size, bool apodize) {
+		std::vector<float> window(size, 1.0f);
+		if (apodize) {
+			for (size_t i = 0; i < size; i++) {
+				window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(size)));
+			}
+		}
+		return window;
+	}
+
+	//grain that splits count items into num_threads chunks of the thread pool (0 for one per pool thread), so at
+	//most that many run at once
+	size_t chunk_grain(size_t count, size_t num_threads) {
+		if (num_threads == 0) {
+			num_threads = mme::ThreadPool::global().num_threads();
+		}
+		return std::max<size_t>(1, (count + num_threads - 1) / num_threads);
+	}
+
+	//e^(+i 2 pi k x / n) of the inverse transform at a position x off the sample grid, k taken in [-n/2, n/2) so
+	//this is the band limited interpolation. The Nyquist term is split between +n/2 and -n/2, which keeps the
+	//interpolation of a Hermitian spectrum real.
+	void inverse_twiddles(size_t n, double x, std::span<float> re, std::span<float> im) {
+		const double step = 2.0 * std::numbers::pi * x / static_cast<double>(n);
+		for (size_t k = 0; k < n; k++) {
+			const double frequency = k < n / 2 ? static_cast<double>(k) : static_cast<double>(k) - static_cast<double>(n);
+			re[k] = static_cast<float>(std::cos(step * frequency));
+			im[k] = static_cast<float>(std::sin(step * frequency));
+		}
+		if (n > 1) {
+			re[n / 2] = static_cast<float>(std::cos(std::numbers::pi * x));
+			im[n / 2] = 0.0f;
+		}
+	}
+
+	//Refines an integer correlation peak by evaluating the inverse transform of the cross power spectrum
+	//between the samples. Its maximum is where the shift is whatever the shape of the peak, which narrows to
+	//a sinc for clean frames and widens when noise leaves only the low frequencies coherent, so interpolating
+	//three samples with an assumed shape would be biased by either. The spectrum is collapsed along one axis
+	//at the current position of the other, the remaining line is cheap to evaluate and is searched for its
+	//maximum, alternating columns, rows and columns again.
+	class PeakRefiner {
+	public:
+		PeakRefiner(std::span<const float> spectrum_re, std::span<const float> spectrum_im, mme::ImageSize size)
+			: m_re(spectrum_re)
+			, m_im(spectrum_im)
+			, m_size(size)
+			, m_line_re(std::max(size.height, size.width))
+			, m_line_im(std::max(size.height, size.width))
+			, m_twiddle_re(std::max(size.height, size.width))
+			, m_twiddle_im(std::max(size.height, size.width))
+		{
+		}
+
+		//sub-pixel offset of the maximum from the integer peak at (row, col), imaginary selects the second frame of
+		//a pair whose correlation is the imaginary part
+		mme::Translation refine(size_t row, size_t col, bool imaginary) {
+			collapse_rows(static_cast<double>(row));
+			double c = line_maximum(m_size.width, static_cast<double>(col), imaginary);
+			collapse_columns(c);
+			const double r = line_maximum(m_size.height, static_cast<double>(row), imaginary);
+			collapse_rows(r);
+			c = line_maximum(m_size.width, static_cast<double>(col), imaginary);
+			return { r - static_cast<double>(row), c - static_cast<double>(col) };
+		}
+
+	private:
+		//line[v] = sum over u of spectrum[u][v] e^(i 2 pi u row / height)
+		void collapse_rows(double row) {
+			const size_t width = m_size.width;
+			inverse_twiddles(m_size.height, row, m_twiddle_re, m_twiddle_im);
+			float* __restrict line_re = m_line_re.data();
+			float* __restrict line_im = m_line_im.data();
+			std::fill_n(line_re, width, 0.0f);
+			std::fill_n(line_im, width, 0.0f);
+			for (size_t u = 0; u < m_size.height; u++) {
+				const float wr = m_twiddle_re[u];
+				const float wi = m_twiddle_im[u];
+				const float* __restrict zr = m_re.data() + u * width;
+				const float* __restrict zi = m_im.data() + u * width;
+				for (size_t v = 0; v < width; v++) {
+					line_re[v] += wr * zr[v] - wi * zi[v];
+					line_im[v] += wr * zi[v] + wi * zr[v];
+				}
+			}
+		}
+
+		//line[u] = sum over v of spectrum[u][v] e^(i 2 pi v col / width)
+		void collapse_columns(double col) {
+			const size_t width = m_size.width;
+			inverse_twiddles(width, col, m_twiddle_re, m_twiddle_im);
+			const float* __restrict wr = m_twiddle_re.data();
+			const float* __restrict wi = m_twiddle_im.data();
+			for (size_t u = 0; u < m_size.height; u++) {
+				const float* __restrict zr = m_re.data() + u * width;
+				const float* __restrict zi = m_im.data() + u * width;
+				//separate partial sums, a single accumulator would serialize the loop without -ffast-math
+				float sum_re[LANES] = {};
+				float sum_im[LANES] = {};
+				size_t v = 0;
+				for (; v + LANES <= width; v += LANES) {
+					for (size_t lane = 0; lane < LANES; lane++) {
+						sum_re[lane] += wr[v + lane] * zr[v + lane] - wi[v + lane] * zi[v + lane];
+						sum_im[lane] += wr[v + lane] * zi[v + lane] + wi[v + lane] * zr[v + lane];
+					}
+				}
+				for (; v < width; v++) {
+					sum_re[0] += wr[v] * zr[v] - wi[v] * zi[v];
+					sum_im[0] += wr[v] * zi[v] + wi[v] * zr[v];
+				}
+				m_line_re[u] = std::accumulate(std::begin(sum_re), std::end(sum_re), 0.0f);
+				m_line_im[u] = std::accumulate(std::begin(sum_im), std::end(sum_im), 0.0f);
+			}
+		}
+
+		double line_value(size_t n, double x, bool imaginary) {
+			inverse_twiddles(n, x, m_twiddle_re, m_twiddle_im);
+			double value = 0.0;
+			for (size_t k = 0; k < n; k++) {
+				value += imaginary
+					? m_line_re[k] * m_twiddle_im[k] + m_line_im[k] * m_twiddle_re[k]
+					: m_line_re[k] * m_twiddle_re[k] - m_line_im[k] * m_twiddle_im[k];
+			}
+			return value;
+		}
+
+		//golden section search within three quarters of a pixel of the integer peak, the true maximum is at most
+		//half a pixel away and the main lobe of a sinc is wider than that on either side
+		double line_maximum(size_t n, double center, bool imaginary) {
+			constexpr double ratio = 0.6180339887498949;
+			double low = center - 0.75;
+			double high = center + 0.75;
+			double x1 = high - ratio * (high - low);
+			double x2 = low + ratio * (high - low);
+			double f1 = line_value(n, x1, imaginary);
+			double f2 = line_value(n, x2, imaginary);
+			while (high - low > 1e-4) {
+				if (f1 < f2) {
+					low = x1;
+					x1 = x2;
+					f1 = f2;
+					x2 = low + ratio * (high - low);
+					f2 = line_value(n, x2, imaginary);
+				}
+				else {
+					high = x2;
+					x2 = x1;
+					f2 = f1;
+					x1 = high - ratio * (high - low);
+					f1 = line_value(n, x1, imaginary);
+				}
+			}
+			return 0.5 * (low + high);
+		}
+
+	private:
+		static constexpr size_t LANES = 8;
+
+		std::span<const float> m_re;
+		std::span<const float> m_im;
+		mme::ImageSize m_size;
+		std::vector<float> m_line_re;
+		std::vector<float> m_line_im;
+		std::vector<float> m_twiddle_re;
+		std::vector<float> m_twiddle_im;
+	};
+
+	mme::Translation find_peak(std::span<const float> correlation, mme::ImageSize size, PeakRefiner& refiner, bool imaginary) {
+		const auto peak = std::distance(correlation.begin(), std::ranges::max_element(correlation));
+		const size_t row = static_cast<size_t>(peak) / size.width;
+		const size_t col = static_cast<size_t>(peak) % size.width;
+		const auto offset = refiner.refine(row, col, imaginary);
+		auto wrapped = [](size_t index, size_t extent) {
+			return index > extent / 2 ? static_cast<double>(index) - static_cast<double>(extent) : static_cast<double>(index);
+		};
+		return { wrapped(row, size.height) + offset.row, wrapped(col, size.width) + offset.col };
+	}
+
+	//Keys cubic convolution kernel, a = -0.5
+	float cubic_weight(double x) {
+		x = std::abs(x);
+		if (x <= 1.0) {
+			return static_cast<float>((1.5 * x - 2.5) * x * x + 1.0);
+		}
+		if (x < 2.0) {
+			return static_cast<float>(((-0.5 * x + 2.5) * x - 4.0) * x + 2.0);
+		}
+		return 0.0f;
+	}
+
+	struct CubicTaps {
+		std::ptrdiff_t first; //source offset of the first of four taps
+		float weights[4];
+	};
+
+	CubicTaps cubic_taps(double shift) {
+		const double whole = std::floor(shift);
+		const double fraction = shift - whole;
+		return { static_cast<std::ptrdiff_t>(whole) - 1, { cubic_weight(1.0 + fraction), cubic_weight(fraction), cubic_weight(1.0 - fraction), cubic_weight(2.0 - fraction) } };
+	}
+
+	//[first, last) of the destination indices whose source position index + shift lies inside [0, extent - 1]
+	std::pair<size_t, size_t> valid_range(double shift, size_t extent) {
+		const double first = std::ceil(-shift);
+		const double last = std::floor(static_cast<double>(extent) - 1.0 - shift) + 1.0;
+		auto clamp = [extent](double value) { return static_cast<size_t>(std::clamp(value, 0.0, static_cast<double>(extent))); };
+		return { clamp(first), std::max(clamp(first), clamp(last)) };
+	}
+}
+
+mme::PhaseCorrelator::PhaseCorrelator(ImageView<const float> reference, RegistrationOptions options)
+	: m_options(options)
+	, m_frame_size(reference.size())
+	, m_plan([&] {
+		if (reference.size().height < 2 || reference.size().width < 2) {
+			throw std::invalid_argument(std::format("Cannot register {}x{} frames", reference.size().height, reference.size().width));
+		}
+		ImageSize window{ previous_power_of_two(reference.size().height), previous_power_of_two(reference.size().width) };
+		if (options.max_window > 0) {
+			const size_t cap = previous_power_of_two(std::max<size_t>(options.max_window, 2));
+			window = { std::min(window.height, cap), std::min(window.width, cap) };
+		}
+		return window;
+	}())
+	, m_window_top((m_frame_size.height - window_size().height) / 2)
+	, m_window_left((m_frame_size.width - window_size().width) / 2)
+	, m_row_window(hann_window(window_size().height, options.apodize))
+	, m_col_window(hann_window(window_size().width, options.apodize))
+	, m_reference_re(num_pixels(window_size()))
+	, m_reference_im(num_pixels(window_size()), 0.0f)
+{
+	MME_TRACE_SCOPE("PhaseCorrelator");
+	load_window(reference, m_reference_re);
+	m_plan.forward(m_reference_re, m_reference_im);
+}
+
+void mme::PhaseCorrelator::load_window(ImageView<const float> frame, std::span<float> destination) const
+{
+	if (frame.size() != m_frame_size) {
+		throw std::invalid_argument(std::format("Frame of {}x{} does not match the {}x{} reference",
+			frame.size().height, frame.size().width, m_frame_size.height, m_frame_size.width));
+	}
+	const auto window = window_size();
+	double sum = 0.0;
+	for (size_t r = 0; r < window.height; r++) {
+		const auto row = frame.row(m_window_top + r).subspan(m_window_left, window.width);
+		for (float pixel : row) {
+			sum += pixel;
+		}
+	}
+	//without the mean the window itself would correlate
+	const float mean = static_cast<float>(sum / static_cast<double>(num_pixels(window)));
+	for (size_t r = 0; r < window.height; r++) {
+		const auto row = frame.row(m_window_top + r).subspan(m_window_left, window.width);
+		float* out = destination.data() + r * window.width;
+		const float row_weight = m_row_window[r];
+		for (size_t c = 0; c < window.width; c++) {
+			out[c] = (row[c] - mean) * row_weight * m_col_window[c];
+		}
+	}
+}
+
+void mme::PhaseCorrelator::estimate_pair(ImageView<const float> first, const ImageView<const float>* second, Translation& first_shift, Translation& second_shift, Scratch& scratch) const
+{
+	MME_TRACE_SCOPE("PhaseCorrelator::estimate_pair");
+	const auto window = window_size();
+	const size_t count = num_pixels(window);
+	//kept across the frames of a thread, fresh buffers of this size are mostly page faults
+	scratch.z_re.resize(count);
+	scratch.z_im.resize(count);
+	scratch.c_re.resize(count);
+	scratch.c_im.resize(count);
+	auto& z_re = scratch.z_re;
+	auto& z_im = scratch.z_im;
+	auto& c_re = scratch.c_re;
+	auto& c_im = scratch.c_im;
+	load_window(first, z_re);
+	if (second) {
+		load_window(*second, z_im);
+	}
+	else {
+		std::ranges::fill(z_im, 0.0f);
+	}
+	m_plan.forward(z_re, z_im);
+
+	//Both frames are real, so their spectra separate from Z = A + iB through Z(-k):
+	//  A(k) = (Z(k) + conj(Z(-k))) / 2, B(k) = (Z(k) - conj(Z(-k))) / 2i
+	//Their normalized cross power spectra are Hermitian again and share one inverse transform as C_A + i C_B.
+	constexpr float tiny = std::numeric_limits<float>::min();
+	for (size_t u = 0; u < window.height; u++) {
+		const size_t mirrored_u = (window.height - u) & (window.height - 1);
+		for (size_t v = 0; v < window.width; v++) {
+			const size_t k = u * window.width + v;
+			const size_t m = mirrored_u * window.width + ((window.width - v) & (window.width - 1));
+			const float ar = 0.5f * (z_re[k] + z_re[m]);
+			const float ai = 0.5f * (z_im[k] - z_im[m]);
+			const float br = 0.5f * (z_im[k] + z_im[m]);
+			const float bi = -0.5f * (z_re[k] - z_re[m]);
+			const float rr = m_reference_re[k];
+			const float ri = m_reference_im[k];
+
+			float car = ar * rr + ai * ri;
+			float cai = ai * rr - ar * ri;
+			const float a_norm = 1.0f / std::max(std::sqrt(car * car + cai * cai), tiny);
+			car *= a_norm;
+			cai *= a_norm;
+			float cbr = br * rr + bi * ri;
+			float cbi = bi * rr - br * ri;
+			const float b_norm = 1.0f / std::max(std::sqrt(cbr * cbr + cbi * cbi), tiny);
+			cbr *= b_norm;
+			cbi *= b_norm;
+
+			c_re[k] = car - cbi;
+			c_im[k] = cai + cbr;
+		}
+	}
+	//the frames' spectra are done with, their buffers keep the cross power spectrum for the sub-pixel refinement
+	std::ranges::copy(c_re, z_re.begin());
+	std::ranges::copy(c_im, z_im.begin());
+	m_plan.inverse(c_re, c_im);
+
+	PeakRefiner refiner(z_re, z_im, window);
+	first_shift = find_peak(c_re, window, refiner, false);
+	if (second) {
+		second_shift = find_peak(c_im, window, refiner, true);
+	}
+}
+
+mme::Translation mme::PhaseCorrelator::estimate(ImageView<const float> frame) const
+{
+	Translation shift;
+	Scratch scratch;
+	estimate_pair(frame, nullptr, shift, shift, scratch);
+	return shift;
+}
+
+std::vector<mme::Translation> mme::PhaseCorrelator::estimate(std::span<const ImageView<const float>> frames) const
+{
+	MME_TRACE_SCOPE("PhaseCorrelator::estimate");
+	std::vector<Translation> shifts(frames.size());
+	const size_t num_pairs = (frames.size() + 1) / 2;
+	parallel_for(num_pairs, [&](size_t begin, size_t end) {
+		Scratch scratch;
+		for (size_t pair = begin; pair < end; pair++) {
+			const size_t i = 2 * pair;
+			const ImageView<const float>* second = i + 1 < frames.size() ? &frames[i + 1] : nullptr;
+			Translation unused;
+			estimate_pair(frames[i], second, shifts[i], second ? shifts[i + 1] : unused, scratch);
+		}
+	}, chunk_grain(num_pairs, m_options.num_threads));
+	return shifts;
+}
+
+void mme::translate(ImageView<const float> frame, Translation shift, ImageView<float> destination)
+{
+	MME_TRACE_SCOPE("translate");
+	const auto size = frame.size();
+	if (destination.size() != size) {
+		throw std::invalid_argument(std::format("Cannot translate a {}x{} frame into {}x{}", size.height, size.width, destination.size().height, destination.size().width));
+	}
+	if (!std::isfinite(shift.row) || !std::isfinite(shift.col)) {
+		throw std::invalid_argument("Translation must be finite");
+	}
+	const auto row_taps = cubic_taps(shift.row);
+	const auto col_taps = cubic_taps(shift.col);
+	const auto [first_row, last_row] = valid_range(shift.row, size.height);
+	const auto [first_col, last_col] = valid_range(shift.col, size.width);
+	constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+
+	auto clamp_index = [](std::ptrdiff_t index, size_t extent) {
+		return static_cast<size_t>(std::clamp<std::ptrdiff_t>(index, 0, static_cast<std::ptrdiff_t>(extent) - 1));
+	};
+
+	//horizontal pass over the source rows the vertical taps need; the weights are the same for every pixel,
+	//so away from the borders both passes are plain vectorizable four tap loops
+	Image<float> horizontal(size);
+	const size_t width = size.width;
+	const std::ptrdiff_t col_first = col_taps.first;
+	const size_t interior_first = static_cast<size_t>(std::clamp<std::ptrdiff_t>(-col_first, 0, static_cast<std::ptrdiff_t>(width)));
+	const size_t interior_last = static_cast<size_t>(std::clamp<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(width) - 3 - col_first, static_cast<std::ptrdiff_t>(interior_first), static_cast<std::ptrdiff_t>(width)));
+	for (size_t r = 0; r < size.height; r++) {
+		const auto src = frame.row(r);
+		auto out = horizontal.as_view().row(r);
+		auto edge_pixel = [&](size_t c) {
+			float value = 0.0f;
+			for (size_t k = 0; k < 4; k++) {
+				value += col_taps.weights[k] * src[clamp_index(static_cast<std::ptrdiff_t>(c) + col_first + static_cast<std::ptrdiff_t>(k), width)];
+			}
+			return value;
+		};
+		for (size_t c = 0; c < interior_first; c++) {
+			out[c] = edge_pixel(c);
+		}
+		const float* base = src.data() + col_first;
+		for (size_t c = interior_first; c < interior_last; c++) {
+			out[c] = col_taps.weights[0] * base[c] + col_taps.weights[1] * base[c + 1] + col_taps.weights[2] * base[c + 2] + col_taps.weights[3] * base[c + 3];
+		}
+		for (size_t c = interior_last; c < width; c++) {
+			out[c] = edge_pixel(c);
+		}
+	}
+
+	for (size_t r = 0; r < size.height; r++) {
+		auto out = destination.row(r);
+		if (r < first_row || r >= last_row) {
+			std::ranges::fill(out, nan);
+			continue;
+		}
+		const float* taps[4];
+		for (size_t k = 0; k < 4; k++) {
+			taps[k] = horizontal.as_view().row(clamp_index(static_cast<std::ptrdiff_t>(r) + row_taps.first + static_cast<std::ptrdiff_t>(k), size.height)).data();
+		}
+		for (size_t c = 0; c < width; c++) {
+			out[c] = row_taps.weights[0] * taps[0][c] + row_taps.weights[1] * taps[1][c] + row_taps.weights[2] * taps[2][c] + row_taps.weights[3] * taps[3][c];
+		}
+		std::fill(out.begin(), out.begin() + first_col, nan);
+		std::fill(out.begin() + last_col, out.end(), nan);
+	}
+}
+
+mme::Image<float> mme::translate(ImageView<const float> frame, Translation shift)
+{
+	Image<float> translated(frame.size());
+	translate(frame, shift, translated.as_view());
+	return translated;
+}
+
+std::vector<mme::Image<float>> mme::register_frames(std::span<const ImageView<const float>> frames, size_t reference, RegistrationOptions options)
+{
+	MME_TRACE_SCOPE("register_frames");
+	if (reference >= frames.size()) {
+		throw std::out_of_range(std::format("Reference frame {} of {} frames", reference, frames.size()));
+	}
+	const PhaseCorrelator correlator(frames[reference], options);
+	auto shifts = correlator.estimate(frames);
+	shifts[reference] = Translation{};
+
+	std::vector<Image<float>> registered;
+	registered.reserve(frames.size());
+	for (const auto& frame : frames) {
+		registered.emplace_back(frame.size());
+	}
+	parallel_for(frames.size(), [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			translate(frames[i], shifts[i], registered[i].as_view());
+		}
+	}, chunk_grain(frames.size(), options.num_threads));
+	return registered;
+}
@@ -0,0 +1,93 @@
+#include "mme/sequencer/deviceoperations.h"
+#include "mme/motion/espdriver.h"
+#include "mme/fwxc/fwxc.h"
+#include "mme/ihr/ihr.h"
+#include "mme/lumenera/lumeneracamera.h"
+#include "mme/nidaq/adcnidaq.h"
+#include <format>
+#include <stdexcept>
+
+mme::Operation mme::move_absolute(ESPDriver& esp, size_t axis, double position, std::string device)
+{
+	return Operation{
+		.name = std::format("move axis {} to {}", axis, position),
+		.device = std::move(device),
+		.action = [&esp, axis, position]() { esp.move_absolute(axis, position); }
+	};
+}
+
+mme::Operation mme::move_relative(ESPDriver& esp, size_t axis, double distance, std::string device)
+{
+	return Operation{
+		.name = std::format("move axis {} by {}", axis, distance),
+		.device = std::move(device),
+		.action = [&esp, axis, distance]() { esp.move_relative(axis, distance); }
+	};
+}
+
+mme::Operation mme::home(ESPDriver& esp, size_t axis, std::string device)
+{
+	return Operation{
+		.name = std::format("home axis {}", axis),
+		.device = std::move(device),
+		.action = [&esp, axis]() { esp.home(axis); }
+	};
+}
+
+mme::Operation mme::change_filter(Fwxc& filter_wheel, size_t position, std::string device)
+{
+	return Operation{
+		.name = std::format("change filter to {}", position),
+		.device = std::move(device),
+		.action = [&filter_wheel, position]() {
+			if (!filter_wheel.change_filter_position(position)) {
+				throw std::runtime_error(std::format("Could not change filter wheel to position {}", position));
+			}
+		}
+	};
+}
+
+mme::Operation mme::change_wavelength(Ihr550& monochromator, double wavelength, std::string device)
+{
+	return Operation{
+		.name = std::format("change wavelength to {}", wavelength),
+		.device = std::move(device),
+		.action = [&monochromator, wavelength]() { monochromator.change_wavelength(wavelength); }
+	};
+}
+
+mme::Operation mme::capture(LumeneraCamera& camera, ImageSink sink, std::string device)
+{
+	return Operation{
+		.name = "capture",
+		.device = std::move(device),
+		.action = [&camera, sink = std::move(sink)]() { sink(camera.capture_single()); }
+	};
+}
+
+mme::Operation mme::capture_raw(LumeneraCamera& camera, RawImageSink sink, std::string device)
+{
+	return Operation{
+		.name = "capture raw",
+		.device = std::move(device),
+		.action = [&camera, sink = std::move(sink)]() { sink(camera.capture_raw()); }
+	};
+}
+
+mme::Operation mme::capture_hdr(LumeneraCamera& camera, std::vector<Exposure> bracket, ImageSink sink, HdrOptions options, std::string device)
+{
+	return Operation{
+		.name = std::format("capture hdr of {} exposures", bracket.size()),
+		.device = std::move(device),
+		.action = [&camera, bracket = std::move(bracket), options, sink = std::move(sink)]() { sink(mme::capture_hdr(camera, bracket, options)); }
+	};
+}
+
+mme::Operation mme::read_adc(NidaqAdc& adc, size_t num_samples, SampleSink sink, std::string device)
+{
+	return Operation{
+		.name = std::format("read {} samples", num_samples),
+		.device = std::move(device),
+		.action = [&adc, num_samples, sink = std::move(sink)]() { sink(adc.sample(num_samples)); }
+	};
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "mme/sequencer/sequencer.h"
+#include "mme/imaging/image.h"
+#include "mme/imaging/hdr.h"
+#include <functional>
+#include <vector>
+#include <string>
+
+namespace mme {
+
+	class ESPDriver;
+	class Fwxc;
+	class Ihr550;
+	class LumeneraCamera;
+	class NidaqAdc;
+
+	using ImageSink = std::function<void(Image<float>)>;
+	using RawImageSink = std::function<void(Image<uint16_t>)>;
+	using SampleSink = std::function<void(std::vector<double>)>;
+
+	//the device name decides which operations are serialized, give each physical instrument its own name
+	Operation move_absolute(ESPDriver& esp, size_t axis, double position, std::string device = "esp");
+	Operation move_relative(ESPDriver& esp, size_t axis, double distance, std::string device = "esp");
+	Operation home(ESPDriver& esp, size_t axis, std::string device = "esp");
+	Operation change_filter(Fwxc& filter_wheel, size_t position, std::string device = "filter_wheel");
+	Operation change_wavelength(Ihr550& monochromator, double wavelength, std::string device = "monochromator");
+	Operation capture(LumeneraCamera& camera, ImageSink sink, std::string device = "camera");
+	Operation capture_raw(LumeneraCamera& camera, RawImageSink sink, std::string device = "camera");
+	//fused counts per ms of the whole bracket, see HdrFusion
+	Operation capture_hdr(LumeneraCamera& camera, std::vector<Exposure> bracket, ImageSink sink, HdrOptions options = {}, std::string device = "camera");
+	Operation read_adc(NidaqAdc& adc, size_t num_samples, SampleSink sink, std::string device = "adc");
+
+} //namespace mme
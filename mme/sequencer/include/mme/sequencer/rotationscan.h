@@ -0,0 +1,55 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include <chrono>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace mme {
+
+	class ESPDriver;
+	class LumeneraCamera;
+	class NidaqPulseTrain;
+	class NidaqTriggeredAdc;
+
+	//On-the-fly scan: the axis turns at constant velocity through start + k * step while a counter pulse train
+	//triggers the detector every |step| / velocity seconds, so exposures happen during the motion.
+	struct RotationScanSettings {
+		size_t axis = 1;
+		double start = 0.0; //position of the first trigger, in the axis' units
+		double step = 1.0; //between triggers, negative scans backwards
+		size_t num_points = 360;
+		double velocity = 10.0; //units per second while triggering
+		double run_up = 2.0; //distance before start in which the axis gets up to velocity
+	};
+
+	struct PositionReading {
+		std::chrono::duration<double> time; //relative to the first trigger
+		double position;
+	};
+
+	struct RotationScanReport {
+		//encoder position at each trigger, interpolated from the readings around it
+		std::vector<double> positions;
+		//what the controller reported while the triggers went out, timed at the middle of each request
+		std::vector<PositionReading> readings;
+		std::chrono::duration<double> period;
+		std::chrono::duration<double> total;
+	};
+
+	//linear between the readings around time and extrapolated from the first or last two outside them
+	double interpolate_position(std::span<const PositionReading> readings, std::chrono::duration<double> time);
+
+	using IndexedRawImageSink = std::function<void(size_t index, Image<uint16_t>)>;
+
+	//The camera is put in hardware trigger mode for the scan, its trigger input wired to the pulse train output.
+	//sink runs on a capture thread as frames arrive. The period must be longer than the exposure. A capture
+	//gives up on a missed trigger after the run up time and a period, one still waiting when the scan fails is
+	//cancelled.
+	RotationScanReport scan_rotation(ESPDriver& esp, NidaqPulseTrain& triggers, LumeneraCamera& camera,
+		const RotationScanSettings& settings, IndexedRawImageSink sink);
+	//adc must trigger on the pulse train, its records (one row per trigger) are in adc.records() afterwards
+	RotationScanReport scan_rotation(ESPDriver& esp, NidaqPulseTrain& triggers, NidaqTriggeredAdc& adc, size_t samples_per_record,
+		const RotationScanSettings& settings);
+
+} //namespace mme
@@ -0,0 +1,64 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <span>
+#include <functional>
+#include <chrono>
+
+namespace mme {
+
+	using OperationId = size_t;
+
+	struct Operation {
+		std::string name;
+		std::string device; //operations on the same device never run concurrently
+		std::function<void()> action;
+	};
+
+	class MeasurementGraph {
+	public:
+		//dependencies must already be part of the graph, which keeps the graph acyclic
+		OperationId add(Operation operation, std::vector<OperationId> dependencies = {});
+
+		size_t size() const;
+		const Operation& operation(OperationId id) const;
+		std::span<const OperationId> dependencies(OperationId id) const;
+
+	private:
+		std::vector<Operation> m_operations;
+		std::vector<std::vector<OperationId>> m_dependencies;
+	};
+
+	struct OperationTiming {
+		OperationId id;
+		std::string name;
+		std::string device;
+		std::chrono::duration<double> start; //relative to start of run
+		std::chrono::duration<double> stop;
+		size_t worker;
+
+		std::chrono::duration<double> duration() const { return stop - start; }
+	};
+
+	struct SequenceReport {
+		std::vector<OperationTiming> timings; //indexed by OperationId
+		std::vector<std::vector<OperationId>> dependencies;
+		std::chrono::duration<double> total;
+
+		//chain of operations that determined the total run time, first to last
+		std::vector<OperationId> critical_path() const;
+	};
+
+	class Sequencer {
+	public:
+		Sequencer(size_t num_workers = 4);
+
+		//runs every operation once, as soon as its dependencies are done and its device is free.
+		//If an operation throws, no new operations are started and the first exception is rethrown.
+		SequenceReport run(const MeasurementGraph& graph);
+
+	private:
+		size_t m_num_workers;
+	};
+
+} //namespace mme
@@ -0,0 +1,229 @@
+#include "mme/sequencer/rotationscan.h"
+#include "mme/motion/espdriver.h"
+#include "mme/lumenera/lumeneracamera.h"
+#include "mme/nidaq/adcnidaq.h"
+#include "mme/nidaq/pulsetrain.h"
+#include "mme/tracing/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <format>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+	using Seconds = std::chrono::duration<double>;
+
+	//beyond the time the motion or the triggers should take
+	constexpr Seconds SCAN_TIMEOUT_MARGIN{ 5.0 };
+
+	void validate(const mme::RotationScanSettings& settings) {
+		if (settings.num_points == 0 || settings.step == 0.0 || !std::isfinite(settings.step)) {
+			throw std::invalid_argument(std::format("A rotation scan needs points and a step, got {} points of {}", settings.num_points, settings.step));
+		}
+		if (!(settings.velocity > 0.0) || !std::isfinite(settings.velocity) || !(settings.run_up >= 0.0)) {
+			throw std::invalid_argument(std::format("Invalid rotation scan velocity {} or run up {}", settings.velocity, settings.run_up));
+		}
+	}
+
+	Seconds trigger_period(const mme::RotationScanSettings& settings) {
+		return Seconds(std::abs(settings.step) / settings.velocity);
+	}
+
+	//from the start of the continuous motion until the axis passes start, after which the scan gives up
+	Seconds run_up_timeout(const mme::RotationScanSettings& settings) {
+		return Seconds(settings.run_up / settings.velocity) * 2 + SCAN_TIMEOUT_MARGIN;
+	}
+
+	//position and the middle of the request in time
+	std::pair<Clock::time_point, double> read_position(mme::ESPDriver& esp, size_t axis) {
+		const auto before = Clock::now();
+		const double position = esp.position(axis);
+		const auto after = Clock::now();
+		return { before + (after - before) / 2, position };
+	}
+
+	//on_run_up is called once the axis starts its run up towards start
+	mme::RotationScanReport run_scan(mme::ESPDriver& esp, mme::NidaqPulseTrain& triggers, const mme::RotationScanSettings& settings,
+		const std::function<void()>& on_run_up = {}) {
+		MME_TRACE_SCOPE("scan_rotation");
+		const auto scan_start = Clock::now();
+		const double direction = settings.step > 0.0 ? 1.0 : -1.0;
+		const Seconds period = trigger_period(settings);
+		const double previous_velocity = esp.velocity(settings.axis);
+
+		mme::RotationScanReport report;
+		report.period = period;
+		try {
+			esp.move_absolute(settings.axis, settings.start - direction * settings.run_up);
+			esp.set_velocity(settings.axis, settings.velocity);
+			esp.move_continuous(settings.axis, direction > 0.0 ? mme::MotionDirection::Positive : mme::MotionDirection::Negative);
+			if (on_run_up) {
+				on_run_up();
+			}
+
+			//triggers start once the axis passes start, where it moves at constant velocity
+			const auto run_up_deadline = Clock::now() + run_up_timeout(settings);
+			while (true) {
+				const auto [time, position] = read_position(esp, settings.axis);
+				if (direction * (position - settings.start) >= 0.0) {
+					break;
+				}
+				if (time > run_up_deadline) {
+					throw std::runtime_error(std::format("Axis {} did not reach {} in time, it is at {}", settings.axis, settings.start, position));
+				}
+			}
+
+			const auto before_start = Clock::now();
+			triggers.start(settings.num_points, 1.0 / period.count());
+			const auto first_trigger = before_start + (Clock::now() - before_start) / 2;
+
+			//readings continue past the last trigger so every trigger lies between two of them
+			const Seconds last_trigger = period * static_cast<double>(settings.num_points - 1);
+			const auto trigger_deadline = first_trigger + last_trigger + SCAN_TIMEOUT_MARGIN;
+			while (true) {
+				const auto [time, position] = read_position(esp, settings.axis);
+				report.readings.push_back({ time - first_trigger, position });
+				if (report.readings.back().time > last_trigger && triggers.is_done()) {
+					break;
+				}
+				if (time > trigger_deadline) {
+					throw std::runtime_error(std::format("The {} triggers of the rotation scan did not finish in time", settings.num_points));
+				}
+			}
+			triggers.stop();
+			esp.stop(settings.axis);
+			esp.set_velocity(settings.axis, previous_velocity);
+		}
+		catch (...) {
+			//leave nothing turning or triggering, the original error is the one that matters
+			try {
+				triggers.stop();
+				esp.stop(settings.axis);
+				esp.set_velocity(settings.axis, previous_velocity);
+			}
+			catch (...) {
+			}
+			throw;
+		}
+
+		report.positions.resize(settings.num_points);
+		for (size_t i = 0; i < settings.num_points; i++) {
+			report.positions[i] = mme::interpolate_position(report.readings, period * static_cast<double>(i));
+		}
+		report.total = Clock::now() - scan_start;
+		return report;
+	}
+}
+
+double mme::interpolate_position(std::span<const PositionReading> readings, std::chrono::duration<double> time)
+{
+	if (readings.empty()) {
+		throw std::invalid_argument("Cannot interpolate a position without readings");
+	}
+	if (readings.size() == 1) {
+		return readings.front().position;
+	}
+	//first reading after time, clamped so there is always a pair to interpolate or extrapolate from
+	auto after = std::ranges::upper_bound(readings, time, {}, &PositionReading::time);
+	after = std::clamp(after, readings.begin() + 1, readings.end() - 1);
+	const auto& [t0, p0] = *(after - 1);
+	const auto& [t1, p1] = *after;
+	if (t1 <= t0) {
+		return p1;
+	}
+	return p0 + (p1 - p0) * ((time - t0) / (t1 - t0));
+}
+
+mme::RotationScanReport mme::scan_rotation(ESPDriver& esp, NidaqPulseTrain& triggers, LumeneraCamera& camera,
+	const RotationScanSettings& settings, IndexedRawImageSink sink)
+{
+	validate(settings);
+	const Seconds period = trigger_period(settings);
+	const Seconds exposure = std::chrono::duration<double, std::milli>(camera.exposure().value);
+	if (period <= exposure) {
+		throw std::invalid_argument(std::format("Triggers every {} s at velocity {} are too fast for the {} s exposure",
+			period.count(), settings.velocity, exposure.count()));
+	}
+
+	const TriggerMode previous_mode = camera.trigger_mode();
+	const Seconds previous_timeout = camera.capture_timeout();
+	//the first capture waits through the run up, the others one period, instead of the camera's default hour
+	camera.set_capture_timeout(run_up_timeout(settings) + period + exposure);
+	camera.set_trigger_mode(TriggerMode::Hardware);
+
+	//armed once the run up starts, each capture takes the frame of the next trigger
+	std::promise<void> run_up;
+	std::atomic<bool> cancelled = false;
+	std::exception_ptr capture_error;
+	std::jthread capture_thread([&, run_up_started = run_up.get_future()]() {
+		run_up_started.wait();
+		try {
+			for (size_t i = 0; i < settings.num_points && !cancelled; i++) {
+				sink(i, camera.capture_raw());
+			}
+		}
+		catch (...) {
+			if (!cancelled) {
+				capture_error = std::current_exception();
+			}
+		}
+	});
+
+	RotationScanReport report;
+	std::exception_ptr scan_error;
+	bool capturing = false;
+	try {
+		report = run_scan(esp, triggers, settings, [&] {
+			run_up.set_value();
+			capturing = true;
+		});
+	}
+	catch (...) {
+		scan_error = std::current_exception();
+		//no more triggers come, the capture waiting for one would otherwise sit out its timeout
+		cancelled = true;
+		if (capturing) {
+			camera.cancel_capture();
+		}
+		else {
+			run_up.set_value();
+		}
+	}
+	capture_thread.join();
+	camera.set_trigger_mode(previous_mode);
+	camera.set_capture_timeout(previous_timeout);
+	if (scan_error) {
+		std::rethrow_exception(scan_error);
+	}
+	if (capture_error) {
+		std::rethrow_exception(capture_error);
+	}
+	return report;
+}
+
+mme::RotationScanReport mme::scan_rotation(ESPDriver& esp, NidaqPulseTrain& triggers, NidaqTriggeredAdc& adc, size_t samples_per_record,
+	const RotationScanSettings& settings)
+{
+	validate(settings);
+	adc.sample_records_on_trigger(settings.num_points, samples_per_record);
+	RotationScanReport report;
+	try {
+		report = run_scan(esp, triggers, settings);
+	}
+	catch (...) {
+		adc.stop_records();
+		throw;
+	}
+	//the last record was triggered already, only its samples can still be arriving
+	if (!adc.wait_for_records(trigger_period(settings) + SCAN_TIMEOUT_MARGIN)) {
+		adc.stop_records();
+		throw std::runtime_error(std::format("Only {} of {} ADC records arrived during the rotation scan", adc.records_completed(), settings.num_points));
+	}
+	return report;
+}
@@ -0,0 +1,191 @@
+#include "mme/sequencer/sequencer.h"
+#include <stdexcept>
+#include <format>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <set>
+#include <optional>
+#include <algorithm>
+#include <exception>
+
+mme::OperationId mme::MeasurementGraph::add(Operation operation, std::vector<OperationId> dependencies)
+{
+	const OperationId id = m_operations.size();
+	for (auto dependency : dependencies) {
+		if (dependency >= id) {
+			throw std::invalid_argument(std::format("Operation '{}' depends on unknown operation {}", operation.name, dependency));
+		}
+	}
+	m_operations.push_back(std::move(operation));
+	m_dependencies.push_back(std::move(dependencies));
+	return id;
+}
+
+size_t mme::MeasurementGraph::size() const
+{
+	return m_operations.size();
+}
+
+const mme::Operation& mme::MeasurementGraph::operation(OperationId id) const
+{
+	return m_operations.at(id);
+}
+
+std::span<const mme::OperationId> mme::MeasurementGraph::dependencies(OperationId id) const
+{
+	return m_dependencies.at(id);
+}
+
+std::vector<mme::OperationId> mme::SequenceReport::critical_path() const
+{
+	if (timings.empty()) {
+		return {};
+	}
+
+	//an operation was held back either by a dependency or by the previous operation on its device,
+	//whichever of them finished last
+	auto blocking_predecessor = [this](OperationId id) -> std::optional<OperationId> {
+		const auto& op = timings[id];
+		std::optional<OperationId> blocker;
+		auto consider = [&](OperationId candidate) {
+			if (timings[candidate].stop > op.start) {
+				return;
+			}
+			if (!blocker || timings[candidate].stop > timings[*blocker].stop) {
+				blocker = candidate;
+			}
+		};
+		for (auto dependency : dependencies[id]) {
+			consider(dependency);
+		}
+		for (const auto& other : timings) {
+			if (other.id != id && other.device == op.device) {
+				consider(other.id);
+			}
+		}
+		return blocker;
+	};
+
+	auto last = std::ranges::max_element(timings, {}, &OperationTiming::stop);
+	std::vector<OperationId> path{ last->id };
+	while (auto predecessor = blocking_predecessor(path.back())) {
+		path.push_back(*predecessor);
+	}
+	std::ranges::reverse(path);
+	return path;
+}
+
+mme::Sequencer::Sequencer(size_t num_workers)
+	: m_num_workers(std::max<size_t>(num_workers, 1))
+{
+}
+
+mme::SequenceReport mme::Sequencer::run(const MeasurementGraph& graph)
+{
+	const size_t num_operations = graph.size();
+
+	SequenceReport report;
+	report.timings.resize(num_operations);
+	report.dependencies.resize(num_operations);
+
+	std::vector<size_t> unfinished_dependencies(num_operations);
+	std::vector<std::vector<OperationId>> dependents(num_operations);
+	std::set<OperationId> ready;
+	for (OperationId id = 0; id < num_operations; id++) {
+		auto dependencies = graph.dependencies(id);
+		report.dependencies[id].assign(dependencies.begin(), dependencies.end());
+		unfinished_dependencies[id] = dependencies.size();
+		for (auto dependency : dependencies) {
+			dependents[dependency].push_back(id);
+		}
+		if (dependencies.empty()) {
+			ready.insert(id);
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable state_changed;
+	std::set<std::string> busy_devices;
+	size_t num_finished = 0;
+	std::exception_ptr failure;
+
+	const auto run_start = std::chrono::steady_clock::now();
+	auto since_start = [run_start]() {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start);
+	};
+
+	auto worker_loop = [&](size_t worker) {
+		std::unique_lock lock{ mutex };
+		while (true) {
+			std::optional<OperationId> next;
+			state_changed.wait(lock, [&] {
+				if (failure || num_finished == num_operations) {
+					return true;
+				}
+				auto it = std::ranges::find_if(ready, [&](OperationId id) {
+					return !busy_devices.contains(graph.operation(id).device);
+				});
+				if (it != ready.end()) {
+					next = *it;
+					ready.erase(it);
+					return true;
+				}
+				return false;
+			});
+			if (!next) {
+				return;
+			}
+
+			const auto& operation = graph.operation(*next);
+			busy_devices.insert(operation.device);
+			auto& timing = report.timings[*next];
+			timing.id = *next;
+			timing.name = operation.name;
+			timing.device = operation.device;
+			timing.worker = worker;
+			timing.start = since_start();
+
+			lock.unlock();
+			std::exception_ptr error;
+			try {
+				operation.action();
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+			lock.lock();
+
+			timing.stop = since_start();
+			busy_devices.erase(operation.device);
+			if (error) {
+				if (!failure) {
+					failure = error;
+				}
+			}
+			else {
+				num_finished++;
+				for (auto dependent : dependents[*next]) {
+					if (--unfinished_dependencies[dependent] == 0) {
+						ready.insert(dependent);
+					}
+				}
+			}
+			state_changed.notify_all();
+		}
+	};
+
+	{
+		std::vector<std::jthread> workers;
+		const size_t num_workers = std::min(m_num_workers, std::max<size_t>(num_operations, 1));
+		for (size_t worker = 0; worker < num_workers; worker++) {
+			workers.emplace_back(worker_loop, worker);
+		}
+	}
+
+	if (failure) {
+		std::rethrow_exception(failure);
+	}
+	report.total = since_start();
+	return report;
+}
@@ -0,0 +1,328 @@
+#pragma once
+#include "mme/session/session.h"
+#include "mme/imaging/camera.h"
+#include "mme/imaging/framestatistics.h"
+#include <chrono>
+#include <exception>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+//Wrappers that forward to a real device and log every call to a SessionWriter. They are templates on the device
+//so the session library itself never links a vendor SDK; use them as RecordingCamera<LumeneraCamera>,
+//RecordingAdc<NidaqAdc>, RecordingEsp<ESPDriver> and RecordingFilterWheel<Fwxc>. The request and reply
+//encodings here are what replay.h expects.
+
+namespace mme {
+
+	namespace detail {
+
+		//Times func, logs its reply (encoded by encode_reply) or the message of what it threw, and forwards either
+		template<typename Func, typename EncodeReply>
+		auto record_call(SessionWriter& writer, uint16_t device, std::string_view call, const SessionEncoder& request,
+			Func&& func, EncodeReply&& encode_reply)
+		{
+			using Result = std::invoke_result_t<Func&>;
+			const int64_t start_ns = writer.now_ns();
+			auto record_failure = [&](std::string_view message) {
+				writer.write_call(device, call, start_ns, writer.now_ns(), request.bytes(), std::as_bytes(std::span(message)), true);
+			};
+
+			if constexpr (std::is_void_v<Result>) {
+				try {
+					func();
+				}
+				catch (const std::exception& e) {
+					record_failure(e.what());
+					throw;
+				}
+				writer.write_call(device, call, start_ns, writer.now_ns(), request.bytes(), {});
+			}
+			else {
+				std::optional<Result> result;
+				try {
+					result.emplace(func());
+				}
+				catch (const std::exception& e) {
+					record_failure(e.what());
+					throw;
+				}
+				//encoding can take longer than the call itself, it is not part of it
+				const int64_t stop_ns = writer.now_ns();
+				SessionEncoder reply;
+				encode_reply(reply, *result);
+				writer.write_call(device, call, start_ns, stop_ns, request.bytes(), reply.bytes());
+				return std::move(*result);
+			}
+		}
+
+		template<typename T>
+		auto put_value() {
+			return [](SessionEncoder& reply, const T& value) { reply.put(value); };
+		}
+
+		inline constexpr auto no_reply = [](SessionEncoder&) {};
+	}
+
+	template<typename Device>
+	class RecordingCamera {
+	public:
+		RecordingCamera(Device& camera, SessionWriter& writer, std::string_view name = "camera")
+			: m_camera(camera), m_writer(writer), m_device(writer.add_device(name, "camera")) {}
+
+		Image<float> capture_single() {
+			return record("capture_single", {}, [&] { return m_camera.capture_single(); },
+				[](detail::SessionEncoder& reply, const Image<float>& frame) { reply.put_frame(frame.as_view()); });
+		}
+
+		Image<uint16_t> capture_raw() {
+			return record("capture_raw", {}, [&] { return m_camera.capture_raw(); },
+				[](detail::SessionEncoder& reply, const Image<uint16_t>& frame) { reply.put_frame(frame.as_view()); });
+		}
+
+		FrameWithStatistics<float> capture_with_statistics(const StatisticsOptions& options = {}) {
+			detail::SessionEncoder request;
+			request.put_statistics_options(options);
+			return record("capture_with_statistics", request, [&] { return m_camera.capture_with_statistics(options); },
+				[](detail::SessionEncoder& reply, const FrameWithStatistics<float>& frame) {
+					reply.put_frame(frame.image.as_view()).put_statistics(frame.statistics);
+				});
+		}
+
+		ImageSize image_size() const {
+			return record("image_size", {}, [&] { return m_camera.image_size(); }, detail::put_value<ImageSize>());
+		}
+
+		Exposure exposure() const {
+			return record("exposure", {}, [&] { return m_camera.exposure(); }, detail::put_value<Exposure>());
+		}
+
+		Binning binning() const {
+			return record("binning", {}, [&] { return m_camera.binning(); }, detail::put_value<Binning>());
+		}
+
+		TriggerMode trigger_mode() const {
+			return record("trigger_mode", {}, [&] { return m_camera.trigger_mode(); }, detail::put_value<TriggerMode>());
+		}
+
+		void set_exposure(Exposure exposure) {
+			detail::SessionEncoder request;
+			request.put(exposure);
+			record("set_exposure", request, [&] { m_camera.set_exposure(exposure); }, detail::no_reply);
+		}
+
+		void set_image_size(ImageSize size) {
+			detail::SessionEncoder request;
+			request.put(size);
+			record("set_image_size", request, [&] { m_camera.set_image_size(size); }, detail::no_reply);
+		}
+
+		void set_binning(Binning bin) {
+			detail::SessionEncoder request;
+			request.put(bin);
+			record("set_binning", request, [&] { m_camera.set_binning(bin); }, detail::no_reply);
+		}
+
+		void set_trigger_mode(TriggerMode mode) {
+			detail::SessionEncoder request;
+			request.put(mode);
+			record("set_trigger_mode", request, [&] { m_camera.set_trigger_mode(mode); }, detail::no_reply);
+		}
+
+		//Property is the device's variant of property values, e.g. LumeneraCamera::Property
+		template<typename Property>
+		void set_properties(const std::vector<Property>& properties) {
+			detail::SessionEncoder request;
+			request.put_properties(std::span(properties));
+			record("set_properties", request, [&] { m_camera.set_properties(properties); }, detail::no_reply);
+		}
+
+	private:
+		template<typename Func, typename EncodeReply>
+		auto record(std::string_view call, const detail::SessionEncoder& request, Func&& func, EncodeReply&& encode_reply) const {
+			return detail::record_call(m_writer, m_device, call, request, std::forward<Func>(func), std::forward<EncodeReply>(encode_reply));
+		}
+
+	private:
+		Device& m_camera;
+		SessionWriter& m_writer;
+		uint16_t m_device;
+	};
+
+	//sample request: u8 form (0 sample count, 1 duration) | u64 count or f64 seconds | f64 rate in Hz, 0 for the default rate
+	template<typename Device>
+	class RecordingAdc {
+	public:
+		RecordingAdc(Device& adc, SessionWriter& writer, std::string_view name = "adc")
+			: m_adc(adc), m_writer(writer), m_device(writer.add_device(name, "adc")) {}
+
+		std::vector<double> sample(size_t num_samples) {
+			return record(request(num_samples, 0.0), [&] { return m_adc.sample(num_samples); });
+		}
+
+		std::vector<double> sample(std::chrono::duration<double> duration) {
+			return record(request(duration, 0.0), [&] { return m_adc.sample(duration); });
+		}
+
+		template<typename Rate>
+		std::vector<double> sample(size_t num_samples, Rate rate) {
+			return record(request(num_samples, rate.value), [&] { return m_adc.sample(num_samples, rate); });
+		}
+
+		template<typename Rate>
+		std::vector<double> sample(std::chrono::duration<double> duration, Rate rate) {
+			return record(request(duration, rate.value), [&] { return m_adc.sample(duration, rate); });
+		}
+
+	private:
+		static detail::SessionEncoder request(size_t num_samples, double rate) {
+			detail::SessionEncoder request;
+			request.put(uint8_t{ 0 }).put(static_cast<uint64_t>(num_samples)).put(rate);
+			return request;
+		}
+
+		static detail::SessionEncoder request(std::chrono::duration<double> duration, double rate) {
+			detail::SessionEncoder request;
+			request.put(uint8_t{ 1 }).put(duration.count()).put(rate);
+			return request;
+		}
+
+		template<typename Func>
+		std::vector<double> record(const detail::SessionEncoder& request, Func&& func) {
+			return detail::record_call(m_writer, m_device, "sample", request, std::forward<Func>(func),
+				[](detail::SessionEncoder& reply, const std::vector<double>& samples) { reply.put_samples(samples); });
+		}
+
+	private:
+		Device& m_adc;
+		SessionWriter& m_writer;
+		uint16_t m_device;
+	};
+
+	template<typename Device>
+	class RecordingEsp {
+	public:
+		RecordingEsp(Device& esp, SessionWriter& writer, std::string_view name = "esp")
+			: m_esp(esp), m_writer(writer), m_device(writer.add_device(name, "esp")) {}
+
+		void command(std::string cmd) {
+			detail::SessionEncoder request;
+			request.put_string(cmd);
+			record("command", request, [&] { m_esp.command(cmd); }, detail::no_reply);
+		}
+
+		std::string request(std::string req) {
+			detail::SessionEncoder encoded;
+			encoded.put_string(req);
+			return record("request", encoded, [&] { return m_esp.request(req); },
+				[](detail::SessionEncoder& reply, const std::string& text) { reply.put_string(text); });
+		}
+
+		void move_relative(size_t axis, double pos) {
+			record("move_relative", motion(axis, pos), [&] { m_esp.move_relative(axis, pos); }, detail::no_reply);
+		}
+
+		void move_absolute(size_t axis, double pos) {
+			record("move_absolute", motion(axis, pos), [&] { m_esp.move_absolute(axis, pos); }, detail::no_reply);
+		}
+
+		void home(size_t axis) {
+			record("home", of_axis(axis), [&] { m_esp.home(axis); }, detail::no_reply);
+		}
+
+		void set_velocity(size_t axis, double velocity) {
+			record("set_velocity", motion(axis, velocity), [&] { m_esp.set_velocity(axis, velocity); }, detail::no_reply);
+		}
+
+		double velocity(size_t axis) {
+			return record("velocity", of_axis(axis), [&] { return m_esp.velocity(axis); }, detail::put_value<double>());
+		}
+
+		//directions are logged as their underlying value
+		template<typename Direction>
+		void move_continuous(size_t axis, Direction direction) {
+			detail::SessionEncoder request;
+			request.put(static_cast<uint64_t>(axis)).put(static_cast<int32_t>(direction));
+			record("move_continuous", request, [&] { m_esp.move_continuous(axis, direction); }, detail::no_reply);
+		}
+
+		void stop(size_t axis) {
+			record("stop", of_axis(axis), [&] { m_esp.stop(axis); }, detail::no_reply);
+		}
+
+		double position(size_t axis) {
+			return record("position", of_axis(axis), [&] { return m_esp.position(axis); }, detail::put_value<double>());
+		}
+
+	private:
+		static detail::SessionEncoder of_axis(size_t axis) {
+			detail::SessionEncoder request;
+			request.put(static_cast<uint64_t>(axis));
+			return request;
+		}
+
+		static detail::SessionEncoder motion(size_t axis, double pos) {
+			detail::SessionEncoder request;
+			request.put(static_cast<uint64_t>(axis)).put(pos);
+			return request;
+		}
+
+		template<typename Func, typename EncodeReply>
+		auto record(std::string_view call, const detail::SessionEncoder& request, Func&& func, EncodeReply&& encode_reply) {
+			return detail::record_call(m_writer, m_device, call, request, std::forward<Func>(func), std::forward<EncodeReply>(encode_reply));
+		}
+
+	private:
+		Device& m_esp;
+		SessionWriter& m_writer;
+		uint16_t m_device;
+	};
+
+	//rotations are logged as their underlying value
+	template<typename Device>
+	class RecordingFilterWheel {
+	public:
+		RecordingFilterWheel(Device& wheel, SessionWriter& writer, std::string_view name = "filter_wheel")
+			: m_wheel(wheel), m_writer(writer), m_device(writer.add_device(name, "filter_wheel")) {}
+
+		size_t num_filters() const {
+			return record("num_filters", {}, [&] { return m_wheel.num_filters(); }, put_size);
+		}
+
+		size_t current_filter_position() const {
+			return record("current_filter_position", {}, [&] { return m_wheel.current_filter_position(); }, put_size);
+		}
+
+		auto last_rotation() const {
+			return record("last_rotation", {}, [&] { return m_wheel.last_rotation(); },
+				[](detail::SessionEncoder& reply, auto rotation) { reply.put(static_cast<int32_t>(rotation)); });
+		}
+
+		[[nodiscard]] bool change_filter_position(size_t position) {
+			detail::SessionEncoder request;
+			request.put(static_cast<uint64_t>(position));
+			return record("change_filter_position", request, [&] { return m_wheel.change_filter_position(position); },
+				[](detail::SessionEncoder& reply, bool changed) { reply.put(static_cast<uint8_t>(changed)); });
+		}
+
+	private:
+		static void put_size(detail::SessionEncoder& reply, size_t value) {
+			reply.put(static_cast<uint64_t>(value));
+		}
+
+		template<typename Func, typename EncodeReply>
+		auto record(std::string_view call, const detail::SessionEncoder& request, Func&& func, EncodeReply&& encode_reply) const {
+			return detail::record_call(m_writer, m_device, call, request, std::forward<Func>(func), std::forward<EncodeReply>(encode_reply));
+		}
+
+	private:
+		Device& m_wheel;
+		SessionWriter& m_writer;
+		uint16_t m_device;
+	};
+
+}
@@ -0,0 +1,160 @@
+#pragma once
+#include "mme/session/session.h"
+#include "mme/imaging/camera.h"
+#include "mme/imaging/framestatistics.h"
+#include <chrono>
+#include <concepts>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+//Stand-ins for LumeneraCamera, NidaqAdc, ESPDriver and Fwxc that serve a session recorded through recording.h,
+//so code templated on a device (or written against the Camera concept) runs on any machine without the
+//hardware or its SDKs. Queries repeat their last recorded reply once exhausted, queries with arguments per
+//argument. Other calls with arguments must be made as they were recorded, otherwise the session has diverged
+//and they throw.
+
+namespace mme {
+
+	namespace detail {
+		//throws unless the replayed call was recorded with the same arguments
+		void check_request(const ReplayedCall& replayed, std::span<const std::byte> request, std::string_view call);
+	}
+
+	class ReplayCamera {
+	public:
+		//the same variant as LumeneraCamera::Property
+		using Property = std::variant<Exposure, ImageSize, Binning, TriggerMode>;
+
+		explicit ReplayCamera(SessionPlayer& player, std::string_view name = "camera");
+
+		Image<float> capture_single();
+		Image<uint16_t> capture_raw();
+		FrameWithStatistics<float> capture_with_statistics(const StatisticsOptions& options = {});
+		ImageSize image_size() const;
+		Exposure exposure() const;
+		Binning binning() const;
+		TriggerMode trigger_mode() const;
+
+		void set_exposure(Exposure exposure);
+		void set_image_size(ImageSize size);
+		void set_binning(Binning bin);
+		void set_trigger_mode(TriggerMode mode);
+		void set_properties(const std::vector<Property>& properties);
+
+	private:
+		void replay_setter(std::string_view call, const detail::SessionEncoder& request);
+
+	private:
+		SessionPlayer& m_player;
+		uint16_t m_device;
+	};
+
+	static_assert(Camera<ReplayCamera>);
+
+	class ReplayAdc {
+	public:
+		explicit ReplayAdc(SessionPlayer& player, std::string_view name = "adc");
+
+		std::vector<double> sample(size_t num_samples);
+		std::vector<double> sample(std::chrono::duration<double> duration);
+		//rate is an mme::SamplingRate, taken by its value so replay does not need the NI-DAQmx headers
+		template<typename Rate>
+			requires requires(Rate rate) { { rate.value } -> std::convertible_to<double>; }
+		std::vector<double> sample(size_t num_samples, Rate rate) {
+			return sample_at(num_samples, rate.value);
+		}
+		template<typename Rate>
+			requires requires(Rate rate) { { rate.value } -> std::convertible_to<double>; }
+		std::vector<double> sample(std::chrono::duration<double> duration, Rate rate) {
+			return sample_at(duration, rate.value);
+		}
+
+	private:
+		std::vector<double> sample_at(size_t num_samples, double rate);
+		std::vector<double> sample_at(std::chrono::duration<double> duration, double rate);
+		std::vector<double> replay(const detail::SessionEncoder& request);
+
+	private:
+		SessionPlayer& m_player;
+		uint16_t m_device;
+	};
+
+	class ReplayEsp {
+	public:
+		explicit ReplayEsp(SessionPlayer& player, std::string_view name = "esp");
+
+		void command(std::string cmd);
+		//served the recorded replies to the same query text in order, so queries asked in another order than
+		//recorded still match, and the last one is repeated once exhausted
+		std::string request(std::string req);
+
+		void move_relative(size_t axis, double pos);
+		void move_absolute(size_t axis, double pos);
+		void home(size_t axis);
+
+		void set_velocity(size_t axis, double velocity);
+		double velocity(size_t axis);
+		//Direction is mme::MotionDirection from espdriver.h, a parameter like the filter wheel's Rotation
+		template<typename Direction>
+			requires std::is_enum_v<Direction>
+		void move_continuous(size_t axis, Direction direction) {
+			detail::SessionEncoder request;
+			request.put(static_cast<uint64_t>(axis)).put(static_cast<int32_t>(direction));
+			replay_command("move_continuous", request);
+		}
+		void stop(size_t axis);
+		double position(size_t axis);
+
+	private:
+		void replay_command(std::string_view call, const detail::SessionEncoder& request);
+		double replay_axis_query(std::string_view call, size_t axis);
+
+	private:
+		SessionPlayer& m_player;
+		uint16_t m_device;
+	};
+
+	//Rotation is mme::Rotation from fwxc.h, a parameter so replay does not need the FWxC SDK
+	template<typename Rotation>
+	class ReplayFilterWheel {
+	public:
+		explicit ReplayFilterWheel(SessionPlayer& player, std::string_view name = "filter_wheel")
+			: m_player(player), m_device(player.device(name)) {}
+
+		size_t num_filters() const {
+			return static_cast<size_t>(query<uint64_t>("num_filters"));
+		}
+
+		size_t current_filter_position() const {
+			return static_cast<size_t>(query<uint64_t>("current_filter_position"));
+		}
+
+		Rotation last_rotation() const {
+			return static_cast<Rotation>(query<int32_t>("last_rotation"));
+		}
+
+		[[nodiscard]] bool change_filter_position(size_t position) {
+			detail::SessionEncoder request;
+			request.put(static_cast<uint64_t>(position));
+			const auto replayed = m_player.next(m_device, "change_filter_position");
+			detail::check_request(replayed, request.bytes(), "change_filter_position");
+			return detail::SessionDecoder(replayed.reply).get<uint8_t>() != 0;
+		}
+
+	private:
+		template<typename T>
+		T query(std::string_view call) const {
+			const auto replayed = m_player.next_or_last(m_device, call);
+			return detail::SessionDecoder(replayed.reply).get<T>();
+		}
+
+	private:
+		SessionPlayer& m_player;
+		uint16_t m_device;
+	};
+
+}
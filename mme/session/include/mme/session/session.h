@@ -0,0 +1,200 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/imaging/framestatistics.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+//Device sessions: every call on a recorded device, with its arguments, its reply or error and when it ran,
+//so the session can be served back later without the hardware (see recording.h and replay.h).
+//
+//Session file, native byte order (little endian):
+//  char[8] "MMESESS1" | u32 version | u32 reserved | i64 start, ns since the Unix epoch
+//then records, each a 40 byte header followed by three byte strings:
+//  u8 type | u8 failed | u16 device | u16 name bytes | u16 reserved | i64 start ns | i64 stop ns | u64 request bytes | u64 reply bytes
+//  type 1 declares a device: name is the device name, request its type, times are 0
+//  type 2 is a call: name is the call, request the arguments, reply the return value or the error message when
+//  failed, times are since the session start
+//Frames in replies are delta bit packed when they hold 12 bit values, see framecodec.h, and otherwise stored
+//raw in their own pixel type.
+
+namespace mme {
+
+	namespace detail {
+
+		//appends values for a session record
+		class SessionEncoder {
+		public:
+			template<typename T>
+				requires std::is_trivially_copyable_v<T>
+			SessionEncoder& put(const T& value) {
+				return put_bytes(std::as_bytes(std::span(&value, 1)));
+			}
+
+			SessionEncoder& put_bytes(std::span<const std::byte> bytes);
+			SessionEncoder& put_string(std::string_view text);
+			SessionEncoder& put_samples(std::span<const double> samples);
+			SessionEncoder& put_frame(ImageView<const uint16_t> frame);
+			SessionEncoder& put_frame(ImageView<const float> frame);
+			SessionEncoder& put_statistics(const FrameStatistics& statistics);
+			SessionEncoder& put_statistics_options(const StatisticsOptions& options);
+
+			//u64 count, then the alternative's u8 index and its value for every property
+			template<typename... Alternatives>
+				requires (std::is_trivially_copyable_v<Alternatives> && ...)
+			SessionEncoder& put_properties(std::span<const std::variant<Alternatives...>> properties) {
+				put(static_cast<uint64_t>(properties.size()));
+				for (const auto& property : properties) {
+					put(static_cast<uint8_t>(property.index()));
+					std::visit([this](const auto& value) { put(value); }, property);
+				}
+				return *this;
+			}
+
+			std::span<const std::byte> bytes() const { return m_bytes; }
+
+		private:
+			std::vector<std::byte> m_bytes;
+		};
+
+		//reads back what SessionEncoder wrote, throws on truncated data
+		class SessionDecoder {
+		public:
+			explicit SessionDecoder(std::span<const std::byte> bytes) : m_bytes(bytes) {}
+
+			template<typename T>
+				requires std::is_trivially_copyable_v<T>
+			T get() {
+				T value;
+				std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+				return value;
+			}
+
+			std::string get_string();
+			std::vector<double> get_samples();
+			Image<uint16_t> get_frame16();
+			Image<float> get_frame();
+			FrameStatistics get_statistics();
+
+		private:
+			std::span<const std::byte> take(size_t size);
+			Image<uint16_t> get_encoded_frame();
+			Image<uint16_t> get_raw16_frame();
+			Image<float> get_float_frame();
+
+		private:
+			std::span<const std::byte> m_bytes;
+			size_t m_offset = 0;
+		};
+	}
+
+	//Thread safe, devices used from several threads can share one writer
+	class SessionWriter {
+	public:
+		explicit SessionWriter(const std::filesystem::path& file);
+
+		SessionWriter(const SessionWriter&) = delete;
+		SessionWriter& operator=(const SessionWriter&) = delete;
+
+		//names must be unique within a session, they are how replay devices find their calls
+		uint16_t add_device(std::string_view name, std::string_view type);
+
+		//ns since the session started
+		int64_t now_ns() const;
+
+		void write_call(uint16_t device, std::string_view call, int64_t start_ns, int64_t stop_ns,
+			std::span<const std::byte> request, std::span<const std::byte> reply, bool failed = false);
+
+	private:
+		void write_record(uint8_t type, bool failed, uint16_t device, std::string_view name, int64_t start_ns, int64_t stop_ns,
+			std::span<const std::byte> request, std::span<const std::byte> reply);
+
+	private:
+		std::mutex m_mutex;
+		std::ofstream m_file;
+		std::chrono::steady_clock::time_point m_start;
+		std::vector<std::string> m_devices;
+	};
+
+	enum class ReplayTiming {
+		Original,			//a call returns when it returned in the recording, counted from the player's start
+		AsFastAsPossible
+	};
+
+	struct ReplayedCall {
+		std::vector<std::byte> request;
+		std::vector<std::byte> reply;
+	};
+
+	//Serves the calls of a session file back. Calls are replayed in recorded order per device and call name, so
+	//devices and threads that interleaved differently than in the recording still get their own replies.
+	//Payloads are read from the file on demand. Thread safe.
+	class SessionPlayer {
+	public:
+		explicit SessionPlayer(const std::filesystem::path& file, ReplayTiming timing = ReplayTiming::AsFastAsPossible);
+
+		SessionPlayer(const SessionPlayer&) = delete;
+		SessionPlayer& operator=(const SessionPlayer&) = delete;
+
+		std::vector<std::string> device_names() const;
+		//throws if the session has no such device
+		uint16_t device(std::string_view name) const;
+		const std::string& device_type(uint16_t device) const;
+
+		//The next recorded call. Throws when the recording has no further such call, and rethrows a recorded
+		//failure as std::runtime_error with the recorded message.
+		ReplayedCall next(uint16_t device, std::string_view call);
+		//for queries, which may be asked more often than during the recording: repeats the last reply once exhausted
+		ReplayedCall next_or_last(uint16_t device, std::string_view call);
+		//For queries with arguments: the next recorded call made with this request, skipping those with other
+		//requests, so differently interleaved queries still get their own replies. Repeats the last reply to the
+		//request once exhausted and throws if it was never recorded.
+		ReplayedCall next_or_last(uint16_t device, std::string_view call, std::span<const std::byte> request);
+
+		//replays every call again from the beginning, with the clock restarted
+		void restart();
+
+	private:
+		struct Call {
+			int64_t stop_ns;
+			bool failed;
+			uint64_t offset; //of the request, the reply follows it
+			uint64_t request_bytes;
+			uint64_t reply_bytes;
+		};
+
+		struct Calls {
+			std::vector<Call> calls;
+			size_t next = 0;
+			std::map<std::vector<std::byte>, size_t> next_by_request; //one past the last call served for a request
+		};
+
+		ReplayedCall replay(uint16_t device, std::string_view call, bool repeat_last);
+		Calls& recorded_calls(uint16_t device, std::string_view call);
+		//reads the payloads of a call, with the mutex held
+		ReplayedCall read(const Call& recorded, std::string_view call);
+		//waits for the recorded return time and rethrows a recorded failure, without the mutex
+		ReplayedCall finish(const Call& recorded, ReplayedCall replayed, std::chrono::steady_clock::time_point done) const;
+
+	private:
+		std::filesystem::path m_path;
+		ReplayTiming m_timing;
+		std::mutex m_mutex;
+		std::ifstream m_file;
+		std::chrono::steady_clock::time_point m_start;
+		std::vector<std::pair<std::string, std::string>> m_devices; //name and type
+		std::map<std::pair<uint16_t, std::string>, Calls> m_calls;
+	};
+
+}
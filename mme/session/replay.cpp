@@ -0,0 +1,217 @@
+#include "mme/session/replay.h"
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+void mme::detail::check_request(const ReplayedCall& replayed, std::span<const std::byte> request, std::string_view call)
+{
+	if (!std::ranges::equal(replayed.request, request)) {
+		throw std::runtime_error(std::format("Session diverged: {} was called with other arguments than in the recording", call));
+	}
+}
+
+mme::ReplayCamera::ReplayCamera(SessionPlayer& player, std::string_view name)
+	: m_player(player), m_device(player.device(name))
+{
+}
+
+mme::Image<float> mme::ReplayCamera::capture_single()
+{
+	const auto replayed = m_player.next(m_device, "capture_single");
+	return detail::SessionDecoder(replayed.reply).get_frame();
+}
+
+mme::Image<uint16_t> mme::ReplayCamera::capture_raw()
+{
+	const auto replayed = m_player.next(m_device, "capture_raw");
+	return detail::SessionDecoder(replayed.reply).get_frame16();
+}
+
+mme::FrameWithStatistics<float> mme::ReplayCamera::capture_with_statistics(const StatisticsOptions& options)
+{
+	detail::SessionEncoder request;
+	request.put_statistics_options(options);
+	const auto replayed = m_player.next(m_device, "capture_with_statistics");
+	detail::check_request(replayed, request.bytes(), "capture_with_statistics");
+	detail::SessionDecoder reply(replayed.reply);
+	auto image = reply.get_frame();
+	return { std::move(image), reply.get_statistics() };
+}
+
+mme::ImageSize mme::ReplayCamera::image_size() const
+{
+	const auto replayed = m_player.next_or_last(m_device, "image_size");
+	return detail::SessionDecoder(replayed.reply).get<ImageSize>();
+}
+
+mme::Exposure mme::ReplayCamera::exposure() const
+{
+	const auto replayed = m_player.next_or_last(m_device, "exposure");
+	return detail::SessionDecoder(replayed.reply).get<Exposure>();
+}
+
+mme::Binning mme::ReplayCamera::binning() const
+{
+	const auto replayed = m_player.next_or_last(m_device, "binning");
+	return detail::SessionDecoder(replayed.reply).get<Binning>();
+}
+
+mme::TriggerMode mme::ReplayCamera::trigger_mode() const
+{
+	const auto replayed = m_player.next_or_last(m_device, "trigger_mode");
+	return detail::SessionDecoder(replayed.reply).get<TriggerMode>();
+}
+
+void mme::ReplayCamera::set_exposure(Exposure exposure)
+{
+	detail::SessionEncoder request;
+	request.put(exposure);
+	replay_setter("set_exposure", request);
+}
+
+void mme::ReplayCamera::set_image_size(ImageSize size)
+{
+	detail::SessionEncoder request;
+	request.put(size);
+	replay_setter("set_image_size", request);
+}
+
+void mme::ReplayCamera::set_binning(Binning bin)
+{
+	detail::SessionEncoder request;
+	request.put(bin);
+	replay_setter("set_binning", request);
+}
+
+void mme::ReplayCamera::set_trigger_mode(TriggerMode mode)
+{
+	detail::SessionEncoder request;
+	request.put(mode);
+	replay_setter("set_trigger_mode", request);
+}
+
+void mme::ReplayCamera::set_properties(const std::vector<Property>& properties)
+{
+	detail::SessionEncoder request;
+	request.put_properties(std::span(properties));
+	replay_setter("set_properties", request);
+}
+
+void mme::ReplayCamera::replay_setter(std::string_view call, const detail::SessionEncoder& request)
+{
+	detail::check_request(m_player.next(m_device, call), request.bytes(), call);
+}
+
+mme::ReplayAdc::ReplayAdc(SessionPlayer& player, std::string_view name)
+	: m_player(player), m_device(player.device(name))
+{
+}
+
+std::vector<double> mme::ReplayAdc::sample(size_t num_samples)
+{
+	return sample_at(num_samples, 0.0);
+}
+
+std::vector<double> mme::ReplayAdc::sample(std::chrono::duration<double> duration)
+{
+	return sample_at(duration, 0.0);
+}
+
+//same request encoding as RecordingAdc
+std::vector<double> mme::ReplayAdc::sample_at(size_t num_samples, double rate)
+{
+	detail::SessionEncoder request;
+	request.put(uint8_t{ 0 }).put(static_cast<uint64_t>(num_samples)).put(rate);
+	return replay(request);
+}
+
+std::vector<double> mme::ReplayAdc::sample_at(std::chrono::duration<double> duration, double rate)
+{
+	detail::SessionEncoder request;
+	request.put(uint8_t{ 1 }).put(duration.count()).put(rate);
+	return replay(request);
+}
+
+std::vector<double> mme::ReplayAdc::replay(const detail::SessionEncoder& request)
+{
+	const auto replayed = m_player.next(m_device, "sample");
+	detail::check_request(replayed, request.bytes(), "sample");
+	return detail::SessionDecoder(replayed.reply).get_samples();
+}
+
+mme::ReplayEsp::ReplayEsp(SessionPlayer& player, std::string_view name)
+	: m_player(player), m_device(player.device(name))
+{
+}
+
+void mme::ReplayEsp::command(std::string cmd)
+{
+	detail::SessionEncoder request;
+	request.put_string(cmd);
+	replay_command("command", request);
+}
+
+std::string mme::ReplayEsp::request(std::string req)
+{
+	detail::SessionEncoder encoded;
+	encoded.put_string(req);
+	const auto replayed = m_player.next_or_last(m_device, "request", encoded.bytes());
+	return detail::SessionDecoder(replayed.reply).get_string();
+}
+
+void mme::ReplayEsp::move_relative(size_t axis, double pos)
+{
+	detail::SessionEncoder request;
+	request.put(static_cast<uint64_t>(axis)).put(pos);
+	replay_command("move_relative", request);
+}
+
+void mme::ReplayEsp::move_absolute(size_t axis, double pos)
+{
+	detail::SessionEncoder request;
+	request.put(static_cast<uint64_t>(axis)).put(pos);
+	replay_command("move_absolute", request);
+}
+
+void mme::ReplayEsp::home(size_t axis)
+{
+	detail::SessionEncoder request;
+	request.put(static_cast<uint64_t>(axis));
+	replay_command("home", request);
+}
+
+void mme::ReplayEsp::set_velocity(size_t axis, double velocity)
+{
+	detail::SessionEncoder request;
+	request.put(static_cast<uint64_t>(axis)).put(velocity);
+	replay_command("set_velocity", request);
+}
+
+double mme::ReplayEsp::velocity(size_t axis)
+{
+	return replay_axis_query("velocity", axis);
+}
+
+void mme::ReplayEsp::stop(size_t axis)
+{
+	detail::SessionEncoder request;
+	request.put(static_cast<uint64_t>(axis));
+	replay_command("stop", request);
+}
+
+double mme::ReplayEsp::position(size_t axis)
+{
+	return replay_axis_query("position", axis);
+}
+
+void mme::ReplayEsp::replay_command(std::string_view call, const detail::SessionEncoder& request)
+{
+	detail::check_request(m_player.next(m_device, call), request.bytes(), call);
+}
+
+double mme::ReplayEsp::replay_axis_query(std::string_view call, size_t axis)
+{
+	detail::SessionEncoder request;
+	request.put(static_cast<uint64_t>(axis));
+	return detail::SessionDecoder(m_player.next_or_last(m_device, call, request.bytes()).reply).get<double>();
+}
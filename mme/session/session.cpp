@@ -0,0 +1,461 @@
+#include "mme/session/session.h"
+#include "mme/imaging/framecodec.h"
+#include "mme/imaging/conversion.h"
+#include "mme/tracing/trace.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <format>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+	constexpr char SESSION_MAGIC[8] = { 'M', 'M', 'E', 'S', 'E', 'S', 'S', '1' };
+	constexpr uint32_t SESSION_VERSION = 1;
+
+	constexpr uint8_t DEVICE_RECORD = 1;
+	constexpr uint8_t CALL_RECORD = 2;
+
+	//how a frame reply is stored
+	constexpr uint8_t ENCODED_FRAME = 1;
+	constexpr uint8_t FLOAT_FRAME = 2;
+	constexpr uint8_t RAW16_FRAME = 3;
+
+	struct RecordHeader {
+		uint8_t type;
+		uint8_t failed;
+		uint16_t device;
+		uint16_t name_bytes;
+		uint16_t reserved;
+		int64_t start_ns;
+		int64_t stop_ns;
+		uint64_t request_bytes;
+		uint64_t reply_bytes;
+	};
+	static_assert(sizeof(RecordHeader) == 40);
+	static_assert(std::endian::native == std::endian::little, "Session files are little endian");
+
+	//Lumenera frames converted to float still hold 12 bit integers, those compress like raw frames
+	bool holds_12bit_values(std::span<const float> pixels) {
+		return std::all_of(pixels.begin(), pixels.end(), [](float pixel) {
+			return pixel >= 0.0f && pixel <= static_cast<float>(mme::MAX_12BIT_VALUE) && std::floor(pixel) == pixel;
+		});
+	}
+
+	bool holds_12bit_values(std::span<const uint16_t> pixels) {
+		return std::all_of(pixels.begin(), pixels.end(), [](uint16_t pixel) { return pixel <= mme::MAX_12BIT_VALUE; });
+	}
+
+	void put_encoded(mme::detail::SessionEncoder& encoder, const mme::EncodedFrame& encoded) {
+		encoder.put(ENCODED_FRAME).put(encoded.codec).put(static_cast<uint64_t>(encoded.size.height)).put(static_cast<uint64_t>(encoded.size.width));
+		encoder.put(static_cast<uint64_t>(encoded.data.size())).put_bytes(std::as_bytes(std::span(encoded.data)));
+	}
+}
+
+mme::detail::SessionEncoder& mme::detail::SessionEncoder::put_bytes(std::span<const std::byte> bytes)
+{
+	m_bytes.insert(m_bytes.end(), bytes.begin(), bytes.end());
+	return *this;
+}
+
+mme::detail::SessionEncoder& mme::detail::SessionEncoder::put_string(std::string_view text)
+{
+	return put(static_cast<uint64_t>(text.size())).put_bytes(std::as_bytes(std::span(text)));
+}
+
+mme::detail::SessionEncoder& mme::detail::SessionEncoder::put_samples(std::span<const double> samples)
+{
+	return put(static_cast<uint64_t>(samples.size())).put_bytes(std::as_bytes(samples));
+}
+
+mme::detail::SessionEncoder& mme::detail::SessionEncoder::put_frame(ImageView<const uint16_t> frame)
+{
+	if (holds_12bit_values(frame.pixels())) {
+		put_encoded(*this, encode_frame(frame, FrameCodec::DeltaBitPacked));
+		return *this;
+	}
+	//not 12 bit, kept as the raw values at half the size of float
+	return put(RAW16_FRAME).put(static_cast<uint64_t>(frame.num_rows())).put(static_cast<uint64_t>(frame.num_cols())).put_bytes(std::as_bytes(frame.pixels()));
+}
+
+mme::detail::SessionEncoder& mme::detail::SessionEncoder::put_frame(ImageView<const float> frame)
+{
+	if (holds_12bit_values(frame.pixels())) {
+		Image<uint16_t> values(frame.size());
+		std::transform(frame.pixels().begin(), frame.pixels().end(), values.pixels().begin(), [](float pixel) { return static_cast<uint16_t>(pixel); });
+		put_encoded(*this, encode_frame(std::as_const(values).as_view(), FrameCodec::DeltaBitPacked));
+		return *this;
+	}
+	return put(FLOAT_FRAME).put(static_cast<uint64_t>(frame.num_rows())).put(static_cast<uint64_t>(frame.num_cols())).put_bytes(std::as_bytes(frame.pixels()));
+}
+
+mme::detail::SessionEncoder& mme::detail::SessionEncoder::put_statistics(const FrameStatistics& statistics)
+{
+	put(statistics.min).put(statistics.max).put(statistics.sum);
+	put(static_cast<uint64_t>(statistics.num_pixels)).put(static_cast<uint64_t>(statistics.saturated));
+	put(static_cast<uint64_t>(statistics.histogram.size())).put_bytes(std::as_bytes(std::span(statistics.histogram)));
+	return put(static_cast<uint64_t>(statistics.roi_sums.size())).put_bytes(std::as_bytes(std::span(statistics.roi_sums)));
+}
+
+mme::detail::SessionEncoder& mme::detail::SessionEncoder::put_statistics_options(const StatisticsOptions& options)
+{
+	put(static_cast<uint32_t>(options.bit_depth)).put(static_cast<uint32_t>(options.histogram_bits));
+	put(static_cast<uint8_t>(options.saturation_level.has_value())).put(options.saturation_level.value_or(0));
+	put(static_cast<uint64_t>(options.rois.size()));
+	for (const auto& roi : options.rois) {
+		put(static_cast<uint64_t>(roi.row)).put(static_cast<uint64_t>(roi.col));
+		put(static_cast<uint64_t>(roi.size.height)).put(static_cast<uint64_t>(roi.size.width));
+	}
+	return *this;
+}
+
+std::span<const std::byte> mme::detail::SessionDecoder::take(size_t size)
+{
+	if (size > m_bytes.size() - m_offset) {
+		throw std::runtime_error(std::format("Truncated session record, {} bytes needed but {} left", size, m_bytes.size() - m_offset));
+	}
+	const auto bytes = m_bytes.subspan(m_offset, size);
+	m_offset += size;
+	return bytes;
+}
+
+std::string mme::detail::SessionDecoder::get_string()
+{
+	const auto bytes = take(static_cast<size_t>(get<uint64_t>()));
+	return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+std::vector<double> mme::detail::SessionDecoder::get_samples()
+{
+	const size_t count = static_cast<size_t>(get<uint64_t>());
+	const auto bytes = take(count * sizeof(double));
+	std::vector<double> samples(count);
+	std::memcpy(samples.data(), bytes.data(), bytes.size());
+	return samples;
+}
+
+mme::Image<uint16_t> mme::detail::SessionDecoder::get_encoded_frame()
+{
+	EncodedFrame encoded;
+	encoded.codec = get<FrameCodec>();
+	encoded.size.height = static_cast<size_t>(get<uint64_t>());
+	encoded.size.width = static_cast<size_t>(get<uint64_t>());
+	const auto bytes = take(static_cast<size_t>(get<uint64_t>()));
+	encoded.data.resize(bytes.size());
+	std::memcpy(encoded.data.data(), bytes.data(), bytes.size());
+	return decode_frame(encoded);
+}
+
+mme::Image<uint16_t> mme::detail::SessionDecoder::get_raw16_frame()
+{
+	ImageSize size;
+	size.height = static_cast<size_t>(get<uint64_t>());
+	size.width = static_cast<size_t>(get<uint64_t>());
+	const auto bytes = take(num_pixels(size) * sizeof(uint16_t));
+	Image<uint16_t> frame(size);
+	std::memcpy(frame.pixels().data(), bytes.data(), bytes.size());
+	return frame;
+}
+
+mme::Image<float> mme::detail::SessionDecoder::get_float_frame()
+{
+	ImageSize size;
+	size.height = static_cast<size_t>(get<uint64_t>());
+	size.width = static_cast<size_t>(get<uint64_t>());
+	const auto bytes = take(num_pixels(size) * sizeof(float));
+	Image<float> frame(size);
+	std::memcpy(frame.pixels().data(), bytes.data(), bytes.size());
+	return frame;
+}
+
+mme::Image<uint16_t> mme::detail::SessionDecoder::get_frame16()
+{
+	const auto stored = get<uint8_t>();
+	if (stored == ENCODED_FRAME) {
+		return get_encoded_frame();
+	}
+	if (stored == RAW16_FRAME) {
+		return get_raw16_frame();
+	}
+	const auto frame = get_float_frame();
+	Image<uint16_t> values(frame.size());
+	std::transform(frame.pixels().begin(), frame.pixels().end(), values.pixels().begin(), [](float pixel) { return static_cast<uint16_t>(pixel); });
+	return values;
+}
+
+mme::Image<float> mme::detail::SessionDecoder::get_frame()
+{
+	const auto stored = get<uint8_t>();
+	if (stored == FLOAT_FRAME) {
+		return get_float_frame();
+	}
+	const auto values = stored == RAW16_FRAME ? get_raw16_frame() : get_encoded_frame();
+	Image<float> frame(values.size());
+	convert_pixels(values.as_view(), frame.as_view());
+	return frame;
+}
+
+mme::FrameStatistics mme::detail::SessionDecoder::get_statistics()
+{
+	FrameStatistics statistics;
+	statistics.min = get<uint16_t>();
+	statistics.max = get<uint16_t>();
+	statistics.sum = get<uint64_t>();
+	statistics.num_pixels = static_cast<size_t>(get<uint64_t>());
+	statistics.saturated = static_cast<size_t>(get<uint64_t>());
+	const auto histogram = take(static_cast<size_t>(get<uint64_t>()) * sizeof(uint32_t));
+	statistics.histogram.resize(histogram.size() / sizeof(uint32_t));
+	std::memcpy(statistics.histogram.data(), histogram.data(), histogram.size());
+	const auto roi_sums = take(static_cast<size_t>(get<uint64_t>()) * sizeof(uint64_t));
+	statistics.roi_sums.resize(roi_sums.size() / sizeof(uint64_t));
+	std::memcpy(statistics.roi_sums.data(), roi_sums.data(), roi_sums.size());
+	return statistics;
+}
+
+mme::SessionWriter::SessionWriter(const std::filesystem::path& file)
+	: m_file(file, std::ios::binary | std::ios::trunc)
+	, m_start(std::chrono::steady_clock::now())
+{
+	if (!m_file) {
+		throw std::runtime_error(std::format("Could not open session file {} for writing", file.string()));
+	}
+	const int64_t start = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	const uint32_t header[2] = { SESSION_VERSION, 0 };
+	m_file.write(SESSION_MAGIC, sizeof(SESSION_MAGIC));
+	m_file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	m_file.write(reinterpret_cast<const char*>(&start), sizeof(start));
+}
+
+uint16_t mme::SessionWriter::add_device(std::string_view name, std::string_view type)
+{
+	std::lock_guard lock(m_mutex);
+	if (std::find(m_devices.begin(), m_devices.end(), name) != m_devices.end()) {
+		throw std::invalid_argument(std::format("The session already has a device named {}", name));
+	}
+	const auto id = static_cast<uint16_t>(m_devices.size());
+	m_devices.emplace_back(name);
+	write_record(DEVICE_RECORD, false, id, name, 0, 0, std::as_bytes(std::span(type)), {});
+	return id;
+}
+
+int64_t mme::SessionWriter::now_ns() const
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+void mme::SessionWriter::write_call(uint16_t device, std::string_view call, int64_t start_ns, int64_t stop_ns,
+	std::span<const std::byte> request, std::span<const std::byte> reply, bool failed)
+{
+	MME_TRACE_SCOPE("SessionWriter::write_call");
+	std::lock_guard lock(m_mutex);
+	if (device >= m_devices.size()) {
+		throw std::invalid_argument(std::format("Session device {} was never added", device));
+	}
+	write_record(CALL_RECORD, failed, device, call, start_ns, stop_ns, request, reply);
+}
+
+void mme::SessionWriter::write_record(uint8_t type, bool failed, uint16_t device, std::string_view name, int64_t start_ns, int64_t stop_ns,
+	std::span<const std::byte> request, std::span<const std::byte> reply)
+{
+	const RecordHeader header{ type, static_cast<uint8_t>(failed ? 1 : 0), device, static_cast<uint16_t>(name.size()), 0,
+		start_ns, stop_ns, request.size(), reply.size() };
+	m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	m_file.write(name.data(), name.size());
+	m_file.write(reinterpret_cast<const char*>(request.data()), request.size());
+	m_file.write(reinterpret_cast<const char*>(reply.data()), reply.size());
+	//flushed per record so a crashing acquisition still leaves everything up to the crash
+	m_file.flush();
+	if (!m_file) {
+		throw std::runtime_error("Could not write session record");
+	}
+}
+
+mme::SessionPlayer::SessionPlayer(const std::filesystem::path& file, ReplayTiming timing)
+	: m_path(file)
+	, m_timing(timing)
+	, m_file(file, std::ios::binary)
+{
+	MME_TRACE_SCOPE("SessionPlayer index");
+	if (!m_file) {
+		throw std::runtime_error(std::format("Could not open session file {}", file.string()));
+	}
+	char magic[sizeof(SESSION_MAGIC)];
+	uint32_t header[2];
+	int64_t start;
+	m_file.read(magic, sizeof(magic));
+	m_file.read(reinterpret_cast<char*>(header), sizeof(header));
+	m_file.read(reinterpret_cast<char*>(&start), sizeof(start));
+	if (!m_file || std::memcmp(magic, SESSION_MAGIC, sizeof(magic)) != 0 || header[0] != SESSION_VERSION) {
+		throw std::runtime_error(std::format("{} is not a version {} session file", file.string(), SESSION_VERSION));
+	}
+
+	//only the record headers are read, payloads stay in the file until they are replayed
+	RecordHeader record;
+	while (m_file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+		std::string name(record.name_bytes, '\0');
+		if (!m_file.read(name.data(), name.size())) {
+			break;
+		}
+		const auto offset = static_cast<uint64_t>(m_file.tellg());
+		if (record.type == DEVICE_RECORD) {
+			std::string type(record.request_bytes, '\0');
+			m_file.read(type.data(), type.size());
+			if (record.device != m_devices.size()) {
+				throw std::runtime_error(std::format("Session file {} declares device {} out of order", file.string(), record.device));
+			}
+			m_devices.emplace_back(std::move(name), std::move(type));
+		}
+		else if (record.type == CALL_RECORD) {
+			m_calls[{ record.device, std::move(name) }].calls.push_back({ record.stop_ns, record.failed != 0, offset, record.request_bytes, record.reply_bytes });
+		}
+		//a record cut short by a crash ends the session
+		if (!m_file.seekg(static_cast<std::streamoff>(offset + record.request_bytes + record.reply_bytes))) {
+			break;
+		}
+	}
+	m_file.clear();
+	m_start = std::chrono::steady_clock::now();
+}
+
+std::vector<std::string> mme::SessionPlayer::device_names() const
+{
+	std::vector<std::string> names;
+	for (const auto& [name, type] : m_devices) {
+		names.push_back(name);
+	}
+	return names;
+}
+
+uint16_t mme::SessionPlayer::device(std::string_view name) const
+{
+	for (size_t i = 0; i < m_devices.size(); i++) {
+		if (m_devices[i].first == name) {
+			return static_cast<uint16_t>(i);
+		}
+	}
+	throw std::invalid_argument(std::format("Session {} has no device named {}", m_path.string(), name));
+}
+
+const std::string& mme::SessionPlayer::device_type(uint16_t device) const
+{
+	return m_devices.at(device).second;
+}
+
+mme::ReplayedCall mme::SessionPlayer::next(uint16_t device, std::string_view call)
+{
+	return replay(device, call, false);
+}
+
+mme::ReplayedCall mme::SessionPlayer::next_or_last(uint16_t device, std::string_view call)
+{
+	return replay(device, call, true);
+}
+
+mme::ReplayedCall mme::SessionPlayer::next_or_last(uint16_t device, std::string_view call, std::span<const std::byte> request)
+{
+	MME_TRACE_SCOPE("SessionPlayer::replay");
+	Call recorded;
+	ReplayedCall replayed;
+	std::chrono::steady_clock::time_point done;
+	{
+		std::lock_guard lock(m_mutex);
+		auto& calls = recorded_calls(device, call);
+		auto& next = calls.next_by_request[std::vector<std::byte>(request.begin(), request.end())];
+		//requests are compared from the file, they are small and a query is rarely far ahead of its match
+		std::vector<std::byte> candidate;
+		size_t found = calls.calls.size();
+		for (size_t i = next; i < calls.calls.size(); i++) {
+			candidate.resize(calls.calls[i].request_bytes);
+			m_file.seekg(static_cast<std::streamoff>(calls.calls[i].offset));
+			m_file.read(reinterpret_cast<char*>(candidate.data()), candidate.size());
+			if (!m_file) {
+				m_file.clear();
+				throw std::runtime_error(std::format("Could not read a {} call from session {}", call, m_path.string()));
+			}
+			if (std::ranges::equal(candidate, request)) {
+				found = i;
+				break;
+			}
+		}
+		if (found < calls.calls.size()) {
+			next = found + 1;
+		}
+		else if (next == 0) {
+			throw std::runtime_error(std::format("Session diverged: {} was never called with these arguments on device {}", call, m_devices.at(device).first));
+		}
+		recorded = calls.calls[next - 1];
+		replayed = read(recorded, call);
+		done = m_start + std::chrono::nanoseconds(recorded.stop_ns);
+	}
+	return finish(recorded, std::move(replayed), done);
+}
+
+void mme::SessionPlayer::restart()
+{
+	std::lock_guard lock(m_mutex);
+	for (auto& [key, calls] : m_calls) {
+		calls.next = 0;
+		calls.next_by_request.clear();
+	}
+	m_start = std::chrono::steady_clock::now();
+}
+
+mme::SessionPlayer::Calls& mme::SessionPlayer::recorded_calls(uint16_t device, std::string_view call)
+{
+	const auto found = m_calls.find({ device, std::string(call) });
+	if (found == m_calls.end() || found->second.calls.empty()) {
+		throw std::runtime_error(std::format("Session {} has no {} calls on device {}", m_path.string(), call, m_devices.at(device).first));
+	}
+	return found->second;
+}
+
+mme::ReplayedCall mme::SessionPlayer::read(const Call& recorded, std::string_view call)
+{
+	ReplayedCall replayed;
+	replayed.request.resize(recorded.request_bytes);
+	replayed.reply.resize(recorded.reply_bytes);
+	m_file.seekg(static_cast<std::streamoff>(recorded.offset));
+	m_file.read(reinterpret_cast<char*>(replayed.request.data()), replayed.request.size());
+	m_file.read(reinterpret_cast<char*>(replayed.reply.data()), replayed.reply.size());
+	if (!m_file) {
+		m_file.clear();
+		throw std::runtime_error(std::format("Could not read a {} call from session {}", call, m_path.string()));
+	}
+	return replayed;
+}
+
+mme::ReplayedCall mme::SessionPlayer::finish(const Call& recorded, ReplayedCall replayed, std::chrono::steady_clock::time_point done) const
+{
+	if (m_timing == ReplayTiming::Original) {
+		std::this_thread::sleep_until(done);
+	}
+	if (recorded.failed) {
+		throw std::runtime_error(std::string(reinterpret_cast<const char*>(replayed.reply.data()), replayed.reply.size()));
+	}
+	return replayed;
+}
+
+mme::ReplayedCall mme::SessionPlayer::replay(uint16_t device, std::string_view call, bool repeat_last)
+{
+	MME_TRACE_SCOPE("SessionPlayer::replay");
+	Call recorded;
+	ReplayedCall replayed;
+	std::chrono::steady_clock::time_point done;
+	{
+		std::lock_guard lock(m_mutex);
+		auto& calls = recorded_calls(device, call);
+		if (calls.next == calls.calls.size()) {
+			if (!repeat_last) {
+				throw std::runtime_error(std::format("Session {} has no more than {} {} calls on device {}", m_path.string(), calls.calls.size(), call, m_devices.at(device).first));
+			}
+			recorded = calls.calls.back();
+		}
+		else {
+			recorded = calls.calls[calls.next++];
+		}
+		replayed = read(recorded, call);
+		done = m_start + std::chrono::nanoseconds(recorded.stop_ns);
+	}
+	return finish(recorded, std::move(replayed), done);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace mme {
+
+	//Work item i (e.g. a wavelength) is processed by a worker process into its shared memory output slot,
+	//the coordinator then hands the slot to the merge function. Throwing from work fails the attempt.
+	using ShardWork = std::function<void(size_t item, std::span<std::byte> output)>;
+	using ShardMerge = std::function<void(size_t item, std::span<const std::byte> output)>;
+
+	struct ShardingOptions {
+		size_t num_workers = 0;			//0 for one per hardware thread
+		size_t max_attempts = 3;		//per item, over crashes and exceptions
+		size_t max_restarts = 16;		//of crashed worker processes, over the whole run
+	};
+
+	struct ShardReport {
+		size_t completed = 0;
+		size_t restarts = 0;
+		size_t steals = 0;
+		std::vector<size_t> failed_items;
+	};
+
+	//Shards num_items across forked worker processes. Each worker starts with a contiguous range of items;
+	//a worker that runs dry steals from the back of the largest remaining range. Workers talk to the
+	//coordinator over Unix socket pairs and write outputs to one shared memory slot each, so a crashing
+	//worker only loses its current item, which is retried on a restarted worker.
+	//merge is called in the coordinator process in completion order.
+	//Fork before starting threads: run is meant to be called from a single threaded process.
+	class ShardCoordinator {
+	public:
+		ShardCoordinator(size_t num_items, size_t output_bytes_per_item, ShardingOptions options = {});
+
+		ShardReport run(const ShardWork& work, const ShardMerge& merge);
+
+	private:
+		size_t m_num_items;
+		size_t m_output_bytes;
+		ShardingOptions m_options;
+	};
+
+}
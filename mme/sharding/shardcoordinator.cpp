@@ -0,0 +1,317 @@
+#include "mme/sharding/shardcoordinator.h"
+#include "mme/parallel/threadpool.h"
+#include "mme/tracing/trace.h"
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <algorithm>
+
+namespace {
+
+	//fixed size messages over a stream socket
+	struct Assignment {
+		uint64_t item;
+	};
+	constexpr uint64_t STOP_ITEM = UINT64_MAX;
+
+	struct Completion {
+		uint64_t item;
+		int64_t status; //0 on success
+	};
+
+	bool write_all(int fd, const void* data, size_t size) {
+		auto bytes = static_cast<const char*>(data);
+		while (size > 0) {
+#if defined(MSG_NOSIGNAL)
+			const ssize_t written = ::send(fd, bytes, size, MSG_NOSIGNAL);
+#else
+			const ssize_t written = ::send(fd, bytes, size, 0);
+#endif
+			if (written < 0 && errno == EINTR) {
+				continue;
+			}
+			if (written <= 0) {
+				return false;
+			}
+			bytes += written;
+			size -= static_cast<size_t>(written);
+		}
+		return true;
+	}
+
+	//false on end of stream or error
+	bool read_all(int fd, void* data, size_t size) {
+		auto bytes = static_cast<char*>(data);
+		while (size > 0) {
+			const ssize_t received = ::read(fd, bytes, size);
+			if (received < 0 && errno == EINTR) {
+				continue;
+			}
+			if (received <= 0) {
+				return false;
+			}
+			bytes += received;
+			size -= static_cast<size_t>(received);
+		}
+		return true;
+	}
+
+	class SharedMemory {
+	public:
+		explicit SharedMemory(size_t size) : m_size(std::max<size_t>(size, 1)) {
+			m_data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+			if (m_data == MAP_FAILED) {
+				throw std::runtime_error(std::format("Could not map {} bytes of shared memory: {}", m_size, std::strerror(errno)));
+			}
+		}
+		~SharedMemory() {
+			::munmap(m_data, m_size);
+		}
+		SharedMemory(const SharedMemory&) = delete;
+		SharedMemory& operator=(const SharedMemory&) = delete;
+
+		std::byte* data() { return static_cast<std::byte*>(m_data); }
+
+	private:
+		size_t m_size;
+		void* m_data;
+	};
+
+	struct Worker {
+		pid_t pid = -1;
+		int socket = -1;
+		std::optional<size_t> in_flight;
+		bool running = false;
+	};
+
+	//kills and reaps the workers still running when run unwinds, a clean run has retired all of them
+	struct WorkerProcesses {
+		std::vector<Worker> workers;
+
+		explicit WorkerProcesses(size_t count) : workers(count) {}
+		~WorkerProcesses() {
+			for (const auto& worker : workers) {
+				if (worker.running) {
+					::kill(worker.pid, SIGKILL);
+					::close(worker.socket);
+					int status = 0;
+					::waitpid(worker.pid, &status, 0);
+				}
+			}
+		}
+		WorkerProcesses(const WorkerProcesses&) = delete;
+		WorkerProcesses& operator=(const WorkerProcesses&) = delete;
+	};
+
+	[[noreturn]] void worker_main(int socket, std::span<std::byte> slot, const mme::ShardWork& work, size_t num_threads) {
+		//the workers share the machine, unpinned so their pools do not all pile onto the same cpus
+		try {
+			mme::ThreadPool::configure_global({ num_threads, false });
+		}
+		catch (const std::logic_error&) {
+			//the coordinator started its pool before forking, the work runs on the copy it left behind
+		}
+		Assignment assignment;
+		while (read_all(socket, &assignment, sizeof(assignment)) && assignment.item != STOP_ITEM) {
+			Completion completion{ assignment.item, 0 };
+			try {
+				work(static_cast<size_t>(assignment.item), slot);
+			}
+			catch (...) {
+				completion.status = 1;
+			}
+			if (!write_all(socket, &completion, sizeof(completion))) {
+				break;
+			}
+		}
+		::close(socket);
+		//skip atexit handlers and static destructors that belong to the coordinator
+		::_exit(0);
+	}
+}
+
+mme::ShardCoordinator::ShardCoordinator(size_t num_items, size_t output_bytes_per_item, ShardingOptions options)
+	: m_num_items(num_items)
+	, m_output_bytes(output_bytes_per_item)
+	, m_options(options)
+{
+	if (m_options.num_workers == 0) {
+		m_options.num_workers = std::max(1u, std::thread::hardware_concurrency());
+	}
+	m_options.num_workers = std::max<size_t>(1, std::min(m_options.num_workers, m_num_items));
+	m_options.max_attempts = std::max<size_t>(m_options.max_attempts, 1);
+}
+
+mme::ShardReport mme::ShardCoordinator::run(const ShardWork& work, const ShardMerge& merge)
+{
+	MME_TRACE_SCOPE("ShardCoordinator::run");
+	ShardReport report;
+	if (m_num_items == 0) {
+		return report;
+	}
+	const size_t num_workers = m_options.num_workers;
+	SharedMemory slots(num_workers * m_output_bytes);
+	auto slot = [&](size_t w) { return std::span<std::byte>(slots.data() + w * m_output_bytes, m_output_bytes); };
+
+	//contiguous shards, the first num_items % num_workers get one extra item
+	std::vector<std::deque<size_t>> shards(num_workers);
+	for (size_t w = 0, item = 0; w < num_workers; w++) {
+		const size_t count = m_num_items / num_workers + (w < m_num_items % num_workers ? 1 : 0);
+		for (size_t i = 0; i < count; i++) {
+			shards[w].push_back(item++);
+		}
+	}
+	std::vector<size_t> attempts(m_num_items, 0);
+	WorkerProcesses processes(num_workers);
+	auto& workers = processes.workers;
+	const size_t threads_per_worker = std::max<size_t>(1, std::thread::hardware_concurrency() / num_workers);
+
+	auto spawn = [&](size_t w) {
+		int sockets[2];
+		if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+			throw std::runtime_error(std::format("Could not create worker socket pair: {}", std::strerror(errno)));
+		}
+		const pid_t pid = ::fork();
+		if (pid < 0) {
+			::close(sockets[0]);
+			::close(sockets[1]);
+			throw std::runtime_error(std::format("Could not fork worker process: {}", std::strerror(errno)));
+		}
+		if (pid == 0) {
+			::close(sockets[0]);
+			for (const auto& other : workers) {
+				if (other.socket >= 0) {
+					::close(other.socket);
+				}
+			}
+			worker_main(sockets[1], slot(w), work, threads_per_worker);
+		}
+		::close(sockets[1]);
+		workers[w] = Worker{ pid, sockets[0], std::nullopt, true };
+	};
+
+	auto next_item = [&](size_t w) -> std::optional<size_t> {
+		if (!shards[w].empty()) {
+			const size_t item = shards[w].front();
+			shards[w].pop_front();
+			return item;
+		}
+		auto largest = std::max_element(shards.begin(), shards.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+		if (largest->empty()) {
+			return std::nullopt;
+		}
+		const size_t item = largest->back();
+		largest->pop_back();
+		report.steals++;
+		return item;
+	};
+
+	auto retire = [&](size_t w) {
+		::close(workers[w].socket);
+		int status = 0;
+		::waitpid(workers[w].pid, &status, 0);
+		workers[w] = Worker{};
+	};
+
+	auto assign = [&](size_t w) {
+		auto item = next_item(w);
+		Assignment assignment{ item ? *item : STOP_ITEM };
+		workers[w].in_flight = item;
+		if (!write_all(workers[w].socket, &assignment, sizeof(assignment)) && item) {
+			//the worker is gone, the item goes back and the crash shows up on the next poll
+			shards[w].push_front(*item);
+			workers[w].in_flight.reset();
+		}
+		if (!item) {
+			retire(w);
+		}
+	};
+
+	auto requeue_or_fail = [&](size_t w, size_t item) {
+		if (++attempts[item] < m_options.max_attempts) {
+			shards[w].push_front(item);
+		}
+		else {
+			report.failed_items.push_back(item);
+		}
+	};
+
+	for (size_t w = 0; w < num_workers; w++) {
+		spawn(w);
+		assign(w);
+	}
+
+	std::vector<pollfd> fds;
+	std::vector<size_t> fd_workers;
+	while (true) {
+		fds.clear();
+		fd_workers.clear();
+		for (size_t w = 0; w < num_workers; w++) {
+			if (workers[w].running) {
+				fds.push_back({ workers[w].socket, POLLIN, 0 });
+				fd_workers.push_back(w);
+			}
+		}
+		if (fds.empty()) {
+			break;
+		}
+		if (::poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(std::format("Polling worker sockets failed: {}", std::strerror(errno)));
+		}
+
+		for (size_t i = 0; i < fds.size(); i++) {
+			if (fds[i].revents == 0) {
+				continue;
+			}
+			const size_t w = fd_workers[i];
+			Completion completion;
+			if (read_all(workers[w].socket, &completion, sizeof(completion))) {
+				const size_t item = static_cast<size_t>(completion.item);
+				workers[w].in_flight.reset();
+				if (completion.status == 0) {
+					MME_TRACE_SCOPE("ShardCoordinator merge");
+					merge(item, slot(w));
+					report.completed++;
+				}
+				else {
+					requeue_or_fail(w, item);
+				}
+				assign(w);
+				continue;
+			}
+
+			//crashed or killed, the current item is retried and the worker replaced
+			const auto lost = workers[w].in_flight;
+			retire(w);
+			if (lost) {
+				requeue_or_fail(w, *lost);
+			}
+			if (report.restarts < m_options.max_restarts) {
+				report.restarts++;
+				spawn(w);
+				assign(w);
+			}
+		}
+	}
+
+	//items left in shards of workers that could not be restarted
+	for (const auto& shard : shards) {
+		report.failed_items.insert(report.failed_items.end(), shard.begin(), shard.end());
+	}
+	std::sort(report.failed_items.begin(), report.failed_items.end());
+	return report;
+}
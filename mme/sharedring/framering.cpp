@@ -0,0 +1,232 @@
+#include "mme/sharedring/framering.h"
+#include "mme/tracing/trace.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+namespace {
+
+	constexpr size_t SLOT_ALIGNMENT = 64;
+
+	std::string object_name(std::string name) {
+		if (name.empty() || name.front() != '/') {
+			name.insert(name.begin(), '/');
+		}
+		return name;
+	}
+
+	mme::detail::RingHeader& header(std::byte* data) {
+		return *reinterpret_cast<mme::detail::RingHeader*>(data);
+	}
+
+	const mme::detail::RingHeader& header(const std::byte* data) {
+		return *reinterpret_cast<const mme::detail::RingHeader*>(data);
+	}
+
+	size_t slot_offset(const std::byte* data, uint64_t sequence) {
+		const auto& ring = header(data);
+		return sizeof(mme::detail::RingHeader) + static_cast<size_t>((sequence - 1) % ring.num_slots) * ring.slot_stride;
+	}
+
+	mme::detail::RingSlotHeader& slot(std::byte* data, uint64_t sequence) {
+		return *reinterpret_cast<mme::detail::RingSlotHeader*>(data + slot_offset(data, sequence));
+	}
+
+	const mme::detail::RingSlotHeader& slot(const std::byte* data, uint64_t sequence) {
+		return *reinterpret_cast<const mme::detail::RingSlotHeader*>(data + slot_offset(data, sequence));
+	}
+
+	int64_t unix_time_ns() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+}
+
+mme::FrameRingPublisher::FrameRingPublisher(std::string name, size_t num_slots, size_t slot_capacity)
+	: m_name(object_name(std::move(name)))
+{
+	if (num_slots == 0 || slot_capacity == 0) {
+		throw std::invalid_argument(std::format("Ring {} needs at least one slot of at least one byte", m_name));
+	}
+	const size_t stride = (sizeof(detail::RingSlotHeader) + slot_capacity + SLOT_ALIGNMENT - 1) / SLOT_ALIGNMENT * SLOT_ALIGNMENT;
+	m_size = sizeof(detail::RingHeader) + num_slots * stride;
+
+	//a publisher that crashed leaves its object behind
+	::shm_unlink(m_name.c_str());
+	const int fd = ::shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0) {
+		throw std::runtime_error(std::format("Could not create shared memory {}: {}", m_name, std::strerror(errno)));
+	}
+	if (::ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+		const int error = errno;
+		::close(fd);
+		::shm_unlink(m_name.c_str());
+		throw std::runtime_error(std::format("Could not size shared memory {} to {} bytes: {}", m_name, m_size, std::strerror(error)));
+	}
+	void* data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	const int error = errno;
+	::close(fd);
+	if (data == MAP_FAILED) {
+		::shm_unlink(m_name.c_str());
+		throw std::runtime_error(std::format("Could not map shared memory {}: {}", m_name, std::strerror(error)));
+	}
+	m_data = static_cast<std::byte*>(data);
+
+	//ftruncate zero fills, so every slot starts out empty with sequence number 0
+	auto& ring = header(m_data);
+	ring.version = detail::RING_VERSION;
+	ring.header_bytes = sizeof(detail::RingHeader);
+	ring.num_slots = num_slots;
+	ring.slot_stride = stride;
+	ring.slot_capacity = slot_capacity;
+	ring.last_sequence.store(0, std::memory_order_relaxed);
+	//readers check the magic last
+	std::atomic_thread_fence(std::memory_order_release);
+	std::memcpy(ring.magic, detail::RING_MAGIC, sizeof(ring.magic));
+}
+
+mme::FrameRingPublisher::~FrameRingPublisher()
+{
+	::munmap(m_data, m_size);
+	::shm_unlink(m_name.c_str());
+}
+
+uint64_t mme::FrameRingPublisher::publish(ImageView<const uint16_t> frame)
+{
+	return publish(RingRecordKind::Frame, RingElementType::UInt16, frame.num_rows(), frame.num_cols(), std::as_bytes(frame.pixels()));
+}
+
+uint64_t mme::FrameRingPublisher::publish(ImageView<const float> frame)
+{
+	return publish(RingRecordKind::Frame, RingElementType::Float32, frame.num_rows(), frame.num_cols(), std::as_bytes(frame.pixels()));
+}
+
+uint64_t mme::FrameRingPublisher::publish_samples(std::span<const double> samples, size_t num_channels)
+{
+	if (num_channels == 0 || samples.size() % num_channels != 0) {
+		throw std::invalid_argument(std::format("{} samples do not split into {} channels", samples.size(), num_channels));
+	}
+	return publish(RingRecordKind::Samples, RingElementType::Float64, num_channels, samples.size() / num_channels, std::as_bytes(samples));
+}
+
+uint64_t mme::FrameRingPublisher::last_sequence() const
+{
+	return header(m_data).last_sequence.load(std::memory_order_acquire);
+}
+
+uint64_t mme::FrameRingPublisher::publish(RingRecordKind kind, RingElementType element_type, size_t rows, size_t cols, std::span<const std::byte> payload)
+{
+	MME_TRACE_SCOPE("FrameRingPublisher::publish");
+	auto& ring = header(m_data);
+	if (payload.size() > ring.slot_capacity) {
+		throw std::invalid_argument(std::format("A record of {} bytes does not fit the {} byte slots of ring {}", payload.size(), ring.slot_capacity, m_name));
+	}
+	const uint64_t sequence = ring.last_sequence.load(std::memory_order_relaxed) + 1;
+	auto& target = slot(m_data, sequence);
+
+	//invalidate first so a reader still on the previous record of this slot sees it change
+	target.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	target.kind = kind;
+	target.element_type = element_type;
+	target.rows = rows;
+	target.cols = cols;
+	target.payload_bytes = payload.size();
+	target.timestamp_ns = unix_time_ns();
+	std::memcpy(reinterpret_cast<std::byte*>(&target) + sizeof(detail::RingSlotHeader), payload.data(), payload.size());
+	target.sequence.store(sequence, std::memory_order_release);
+	ring.last_sequence.store(sequence, std::memory_order_release);
+	return sequence;
+}
+
+mme::FrameRingReader::FrameRingReader(std::string name)
+	: m_name(object_name(std::move(name)))
+{
+	const int fd = ::shm_open(m_name.c_str(), O_RDONLY, 0);
+	if (fd < 0) {
+		throw std::runtime_error(std::format("Could not open shared memory {}: {}", m_name, std::strerror(errno)));
+	}
+	struct stat status;
+	if (::fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(detail::RingHeader)) {
+		::close(fd);
+		throw std::runtime_error(std::format("Shared memory {} is too small to hold a frame ring", m_name));
+	}
+	m_size = static_cast<size_t>(status.st_size);
+	void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+	const int error = errno;
+	::close(fd);
+	if (data == MAP_FAILED) {
+		throw std::runtime_error(std::format("Could not map shared memory {}: {}", m_name, std::strerror(error)));
+	}
+	m_data = static_cast<const std::byte*>(data);
+
+	const auto& ring = header(m_data);
+	const bool valid = std::memcmp(ring.magic, detail::RING_MAGIC, sizeof(ring.magic)) == 0;
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!valid || ring.version != detail::RING_VERSION || ring.num_slots == 0
+		|| sizeof(detail::RingHeader) + ring.num_slots * ring.slot_stride > m_size) {
+		::munmap(const_cast<std::byte*>(m_data), m_size);
+		throw std::runtime_error(std::format("Shared memory {} is not a version {} frame ring", m_name, detail::RING_VERSION));
+	}
+}
+
+mme::FrameRingReader::~FrameRingReader()
+{
+	::munmap(const_cast<std::byte*>(m_data), m_size);
+}
+
+uint64_t mme::FrameRingReader::last_sequence() const
+{
+	return header(m_data).last_sequence.load(std::memory_order_acquire);
+}
+
+size_t mme::FrameRingReader::num_slots() const
+{
+	return static_cast<size_t>(header(m_data).num_slots);
+}
+
+bool mme::FrameRingReader::view(uint64_t sequence, const std::function<void(const RingRecordInfo& info, std::span<const std::byte> payload)>& func) const
+{
+	if (sequence == 0) {
+		return false;
+	}
+	const auto& source = slot(m_data, sequence);
+	if (source.sequence.load(std::memory_order_acquire) != sequence) {
+		return false;
+	}
+	const RingRecordInfo info{ sequence, source.kind, source.element_type, static_cast<size_t>(source.rows), static_cast<size_t>(source.cols), source.timestamp_ns };
+	const size_t payload_bytes = std::min<size_t>(source.payload_bytes, header(m_data).slot_capacity);
+	func(info, std::span(reinterpret_cast<const std::byte*>(&source) + sizeof(detail::RingSlotHeader), payload_bytes));
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return source.sequence.load(std::memory_order_relaxed) == sequence;
+}
+
+std::optional<mme::RingRecord> mme::FrameRingReader::read(uint64_t sequence) const
+{
+	RingRecord record;
+	const bool valid = view(sequence, [&](const RingRecordInfo& info, std::span<const std::byte> payload) {
+		record.info = info;
+		record.payload.assign(payload.begin(), payload.end());
+	});
+	if (!valid) {
+		return std::nullopt;
+	}
+	return record;
+}
+
+std::optional<mme::RingRecord> mme::FrameRingReader::read_latest() const
+{
+	//only fails when the publisher laps the whole ring during one copy, then the next latest is newer
+	for (size_t attempt = 0; attempt < 3; attempt++) {
+		if (auto record = read(last_sequence())) {
+			return record;
+		}
+	}
+	return std::nullopt;
+}
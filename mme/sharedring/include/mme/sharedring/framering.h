@@ -0,0 +1,154 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+//Live frames and sample blocks for other local processes, without going through disk. The publisher owns a
+//POSIX shared memory object /name holding a ring of slots that it overwrites in order and never waits for
+//readers. Layout, native byte order (little endian on every supported platform), offsets in bytes:
+//
+//  ring header, 64 bytes
+//     0  char[8]  magic "MMERING1"
+//     8  u32      version, 1
+//    12  u32      ring header bytes, 64
+//    16  u64      number of slots
+//    24  u64      slot stride in bytes, a multiple of 64
+//    32  u64      payload capacity of a slot in bytes
+//    40  u64      sequence number of the last published record, 0 before the first
+//    48  u64[2]   reserved
+//
+//  slot k at byte 64 + k * stride, the record with sequence number s (counting from 1) goes to slot (s - 1) % slots
+//     0  u64      sequence number of the record in the slot, 0 while it is being written
+//     8  u32      kind: 1 frame, 2 sample block
+//    12  u32      element type: 1 uint16, 2 float32, 3 float64
+//    16  u64      rows: frame height, or channels of a sample block
+//    24  u64      columns: frame width, or samples per channel
+//    32  u64      payload bytes
+//    40  i64      publish time in ns since the Unix epoch
+//    48  u64[2]   reserved
+//    64  payload, row major (channel major for sample blocks)
+//
+//To read record s: load the slot sequence number and give up unless it is s, use the slot, then load the
+//sequence number again. What was read is only valid if it is still s, otherwise the publisher has lapped the
+//reader and it should continue at the last published sequence number.
+
+namespace mme {
+
+	enum class RingRecordKind : uint32_t {
+		Frame = 1,
+		Samples = 2
+	};
+
+	enum class RingElementType : uint32_t {
+		UInt16 = 1,
+		Float32 = 2,
+		Float64 = 3
+	};
+
+	namespace detail {
+
+		inline constexpr char RING_MAGIC[8] = { 'M', 'M', 'E', 'R', 'I', 'N', 'G', '1' };
+		inline constexpr uint32_t RING_VERSION = 1;
+
+		struct RingHeader {
+			char magic[8];
+			uint32_t version;
+			uint32_t header_bytes;
+			uint64_t num_slots;
+			uint64_t slot_stride;
+			uint64_t slot_capacity;
+			std::atomic<uint64_t> last_sequence;
+			uint64_t reserved[2];
+		};
+
+		struct RingSlotHeader {
+			std::atomic<uint64_t> sequence;
+			RingRecordKind kind;
+			RingElementType element_type;
+			uint64_t rows;
+			uint64_t cols;
+			uint64_t payload_bytes;
+			int64_t timestamp_ns;
+			uint64_t reserved[2];
+		};
+
+		static_assert(sizeof(RingHeader) == 64 && sizeof(RingSlotHeader) == 64);
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "Ring sequence numbers are shared between processes");
+	}
+
+	struct RingRecordInfo {
+		uint64_t sequence = 0;
+		RingRecordKind kind = RingRecordKind::Frame;
+		RingElementType element_type = RingElementType::UInt16;
+		size_t rows = 0;
+		size_t cols = 0;
+		int64_t timestamp_ns = 0;
+	};
+
+	struct RingRecord {
+		RingRecordInfo info;
+		std::vector<std::byte> payload;
+	};
+
+	//Creates the shared memory object, replacing a stale one of the same name, and removes it again on
+	//destruction. Readers that still have it mapped keep their mapping. publish is for one thread at a time.
+	class FrameRingPublisher {
+	public:
+		//name is prefixed with / if it does not start with one, slot_capacity is the largest payload in bytes
+		FrameRingPublisher(std::string name, size_t num_slots, size_t slot_capacity);
+		~FrameRingPublisher();
+		FrameRingPublisher(const FrameRingPublisher&) = delete;
+		FrameRingPublisher& operator=(const FrameRingPublisher&) = delete;
+
+		//return the sequence number of the published record
+		uint64_t publish(ImageView<const uint16_t> frame);
+		uint64_t publish(ImageView<const float> frame);
+		//num_channels blocks of samples.size() / num_channels samples
+		uint64_t publish_samples(std::span<const double> samples, size_t num_channels = 1);
+
+		uint64_t last_sequence() const;
+		const std::string& name() const { return m_name; }
+
+	private:
+		uint64_t publish(RingRecordKind kind, RingElementType element_type, size_t rows, size_t cols, std::span<const std::byte> payload);
+
+	private:
+		std::string m_name;
+		size_t m_size;
+		std::byte* m_data;
+	};
+
+	//Maps a ring read only. Reading never blocks or disturbs the publisher.
+	class FrameRingReader {
+	public:
+		explicit FrameRingReader(std::string name);
+		~FrameRingReader();
+		FrameRingReader(const FrameRingReader&) = delete;
+		FrameRingReader& operator=(const FrameRingReader&) = delete;
+
+		uint64_t last_sequence() const;
+		size_t num_slots() const;
+
+		//Calls func with the record in place, without copying. Returns false if the record is not in the ring
+		//(not yet published or already overwritten), or was overwritten while func ran, in which case
+		//whatever func read must be discarded.
+		bool view(uint64_t sequence, const std::function<void(const RingRecordInfo& info, std::span<const std::byte> payload)>& func) const;
+
+		//copies, empty if the record is not in the ring
+		std::optional<RingRecord> read(uint64_t sequence) const;
+		//newest record, retried if it is overwritten while being copied
+		std::optional<RingRecord> read_latest() const;
+
+	private:
+		std::string m_name;
+		size_t m_size;
+		const std::byte* m_data;
+	};
+
+}
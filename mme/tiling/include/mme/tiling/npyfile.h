@@ -0,0 +1,84 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+//Row access to .npy files on disk, so frames and Mueller planes far larger than memory can be processed a band
+//of rows at a time. Files are C order, little endian 2D (height, width) arrays or 3D (planes, height, width)
+//stacks of uint16, float32 or float64. Rows are always handed out as float, converted on the way.
+
+namespace mme {
+
+	enum class NpyElementType {
+		UInt16,
+		Float32,
+		Float64
+	};
+
+	namespace detail {
+		struct NpyLayout {
+			NpyElementType element_type = NpyElementType::Float32;
+			size_t num_planes = 1;
+			ImageSize size{ 0, 0 };
+			uint64_t data_offset = 0;
+
+			size_t element_bytes() const;
+			uint64_t row_offset(size_t plane, size_t row) const;
+		};
+	}
+
+	//One thread at a time
+	class NpyRowReader {
+	public:
+		explicit NpyRowReader(const std::filesystem::path& file);
+
+		NpyRowReader(const NpyRowReader&) = delete;
+		NpyRowReader& operator=(const NpyRowReader&) = delete;
+		NpyRowReader(NpyRowReader&&) = default;
+		NpyRowReader& operator=(NpyRowReader&&) = default;
+
+		ImageSize size() const { return m_layout.size; }
+		size_t num_planes() const { return m_layout.num_planes; }
+		NpyElementType element_type() const { return m_layout.element_type; }
+
+		//destination.num_rows() rows from row_start on, destination must be as wide as the file
+		void read_rows(size_t plane, size_t row_start, ImageView<float> destination);
+
+	private:
+		std::filesystem::path m_path;
+		std::ifstream m_file;
+		detail::NpyLayout m_layout;
+		std::vector<std::byte> m_buffer; //rows as stored, when they need converting
+	};
+
+	//Writes the header and sizes the whole file on construction, rows can then be written in any order.
+	//Rows never written read back as zero. One thread at a time.
+	class NpyRowWriter {
+	public:
+		//num_planes 1 writes a 2D array, more a 3D stack
+		NpyRowWriter(const std::filesystem::path& file, ImageSize size, size_t num_planes = 1, NpyElementType element_type = NpyElementType::Float32);
+
+		NpyRowWriter(const NpyRowWriter&) = delete;
+		NpyRowWriter& operator=(const NpyRowWriter&) = delete;
+		NpyRowWriter(NpyRowWriter&&) = default;
+		NpyRowWriter& operator=(NpyRowWriter&&) = default;
+
+		ImageSize size() const { return m_layout.size; }
+		size_t num_planes() const { return m_layout.num_planes; }
+		NpyElementType element_type() const { return m_layout.element_type; }
+
+		//uint16 files get the values rounded and clamped to 0..65535, NaN as 0
+		void write_rows(size_t plane, size_t row_start, ImageView<const float> source);
+		void flush();
+
+	private:
+		std::filesystem::path m_path;
+		std::ofstream m_file;
+		detail::NpyLayout m_layout;
+		std::vector<std::byte> m_buffer;
+	};
+
+}
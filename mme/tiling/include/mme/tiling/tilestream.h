@@ -0,0 +1,56 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/tiling/npyfile.h"
+#include <chrono>
+#include <functional>
+#include <span>
+
+//Out-of-core execution of per pixel pipelines: bands of rows (tiles) of every input plane are read from disk,
+//processed and written out while one background thread reads the next tile and writes the previous one.
+//Only tile buffers are held, so memory follows the budget instead of the dataset size.
+
+namespace mme {
+
+	struct TileStreamOptions {
+		size_t memory_budget = size_t{ 1 } << 30; //bytes for all tile buffers together
+		size_t max_tile_rows = 0; //0 leaves the tile height to the budget
+	};
+
+	struct TileInput {
+		NpyRowReader* file;
+		size_t plane = 0;
+	};
+
+	struct TileOutput {
+		NpyRowWriter* file;
+		size_t plane = 0;
+	};
+
+	//views of num_rows full width rows starting at row_start, in the order inputs and outputs were given
+	struct Tile {
+		size_t row_start;
+		size_t num_rows;
+		std::span<const ImageView<const float>> inputs;
+		std::span<const ImageView<float>> outputs;
+	};
+
+	struct TileStreamReport {
+		ImageSize size{ 0, 0 };
+		size_t tile_rows = 0;
+		size_t num_tiles = 0;
+		size_t buffer_bytes = 0; //peak of the tile buffers, within the budget
+		std::chrono::duration<double> compute{ 0 };
+		std::chrono::duration<double> io_wait{ 0 }; //compute waiting for reads and writes, 0 when they keep up
+	};
+
+	//rows per tile that fit the budget with every input and output double buffered, throws if not even one does
+	size_t tile_rows_for_budget(size_t width, size_t num_inputs, size_t num_outputs, const TileStreamOptions& options);
+
+	//Calls process once per tile, in order, on the calling thread. process may use the thread pool but should
+	//write its results into the output views rather than allocate tile sized images, those do not count
+	//towards the budget (see reconstruct_mueller with destination). All planes must have the same size.
+	//Neighbourhood operations need the rows around a tile and are not supported.
+	TileStreamReport stream_tiles(std::span<const TileInput> inputs, std::span<const TileOutput> outputs,
+		const std::function<void(const Tile& tile)>& process, const TileStreamOptions& options = {});
+
+}
@@ -0,0 +1,238 @@
+#include "mme/tiling/npyfile.h"
+#include "mme/tracing/trace.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace {
+
+	constexpr char NPY_MAGIC[6] = { '\x93', 'N', 'U', 'M', 'P', 'Y' };
+	//numpy pads the header so the data starts aligned
+	constexpr size_t NPY_HEADER_ALIGNMENT = 64;
+	static_assert(std::endian::native == std::endian::little, "npy files are read and written as little endian");
+
+	std::string_view descr(mme::NpyElementType element_type) {
+		switch (element_type) {
+		case mme::NpyElementType::UInt16: return "<u2";
+		case mme::NpyElementType::Float32: return "<f4";
+		case mme::NpyElementType::Float64: return "<f8";
+		}
+		throw std::invalid_argument("Unknown npy element type");
+	}
+
+	//the text after 'key': in the header dictionary
+	std::string_view header_value(std::string_view header, std::string_view key, const std::filesystem::path& file) {
+		const auto quoted = std::format("'{}':", key);
+		const auto found = header.find(quoted);
+		if (found == std::string_view::npos) {
+			throw std::runtime_error(std::format("npy file {} has no {} in its header", file.string(), key));
+		}
+		auto value = header.substr(found + quoted.size());
+		return value.substr(std::min(value.find_first_not_of(' '), value.size()));
+	}
+
+	mme::detail::NpyLayout parse_header(std::string_view header, const std::filesystem::path& file) {
+		mme::detail::NpyLayout layout;
+		const auto type = header_value(header, "descr", file);
+		if (type.starts_with("'<u2'")) { layout.element_type = mme::NpyElementType::UInt16; }
+		else if (type.starts_with("'<f4'")) { layout.element_type = mme::NpyElementType::Float32; }
+		else if (type.starts_with("'<f8'")) { layout.element_type = mme::NpyElementType::Float64; }
+		else {
+			throw std::runtime_error(std::format("npy file {} holds {}, only uint16, float32 and float64 are supported", file.string(), type.substr(0, type.find(','))));
+		}
+		if (!header_value(header, "fortran_order", file).starts_with("False")) {
+			throw std::runtime_error(std::format("npy file {} is in Fortran order, rows are not contiguous", file.string()));
+		}
+
+		auto shape = header_value(header, "shape", file);
+		shape = shape.substr(1, shape.find(')') - 1);
+		std::vector<size_t> dims;
+		while (!shape.empty()) {
+			const auto end = std::min(shape.find(','), shape.size());
+			const auto dim = shape.substr(0, end);
+			if (dim.find_first_not_of(' ') != std::string_view::npos) {
+				dims.push_back(std::stoull(std::string(dim)));
+			}
+			shape.remove_prefix(std::min(end + 1, shape.size()));
+		}
+		if (dims.size() == 2) {
+			layout.size = { dims[0], dims[1] };
+		}
+		else if (dims.size() == 3) {
+			layout.num_planes = dims[0];
+			layout.size = { dims[1], dims[2] };
+		}
+		else {
+			throw std::runtime_error(std::format("npy file {} has {} dimensions, rows need 2 or 3", file.string(), dims.size()));
+		}
+		return layout;
+	}
+
+	void check_rows(const mme::detail::NpyLayout& layout, size_t plane, size_t row_start, mme::ImageSize rows, const std::filesystem::path& file) {
+		if (plane >= layout.num_planes || row_start + rows.height > layout.size.height || rows.width != layout.size.width) {
+			throw std::out_of_range(std::format("Rows {}..{} of {} wide plane {} are outside npy file {} of {} planes {}x{}",
+				row_start, row_start + rows.height, rows.width, plane, file.string(), layout.num_planes, layout.size.height, layout.size.width));
+		}
+	}
+}
+
+size_t mme::detail::NpyLayout::element_bytes() const
+{
+	switch (element_type) {
+	case NpyElementType::UInt16: return sizeof(uint16_t);
+	case NpyElementType::Float32: return sizeof(float);
+	case NpyElementType::Float64: return sizeof(double);
+	}
+	return 0;
+}
+
+uint64_t mme::detail::NpyLayout::row_offset(size_t plane, size_t row) const
+{
+	return data_offset + (static_cast<uint64_t>(plane) * size.height + row) * size.width * element_bytes();
+}
+
+mme::NpyRowReader::NpyRowReader(const std::filesystem::path& file)
+	: m_path(file), m_file(file, std::ios::binary)
+{
+	if (!m_file) {
+		throw std::runtime_error(std::format("Could not open npy file {}", file.string()));
+	}
+	char magic[sizeof(NPY_MAGIC)];
+	uint8_t version[2];
+	m_file.read(magic, sizeof(magic));
+	m_file.read(reinterpret_cast<char*>(version), sizeof(version));
+	if (!m_file || std::memcmp(magic, NPY_MAGIC, sizeof(magic)) != 0 || version[0] < 1 || version[0] > 3) {
+		throw std::runtime_error(std::format("{} is not an npy file", file.string()));
+	}
+	//version 1 has a 16 bit header length, 2 and 3 a 32 bit one
+	uint32_t header_bytes = 0;
+	if (version[0] == 1) {
+		uint16_t short_length = 0;
+		m_file.read(reinterpret_cast<char*>(&short_length), sizeof(short_length));
+		header_bytes = short_length;
+	}
+	else {
+		m_file.read(reinterpret_cast<char*>(&header_bytes), sizeof(header_bytes));
+	}
+	std::string header(header_bytes, ' ');
+	m_file.read(header.data(), header.size());
+	if (!m_file) {
+		throw std::runtime_error(std::format("npy file {} has a truncated header", file.string()));
+	}
+	m_layout = parse_header(header, file);
+	m_layout.data_offset = static_cast<uint64_t>(m_file.tellg());
+}
+
+void mme::NpyRowReader::read_rows(size_t plane, size_t row_start, ImageView<float> destination)
+{
+	MME_TRACE_SCOPE("NpyRowReader::read_rows");
+	check_rows(m_layout, plane, row_start, destination.size(), m_path);
+	const size_t count = destination.pixels().size();
+	const size_t bytes = count * m_layout.element_bytes();
+	char* target = reinterpret_cast<char*>(destination.pixels().data());
+	if (m_layout.element_type != NpyElementType::Float32) {
+		m_buffer.resize(bytes);
+		target = reinterpret_cast<char*>(m_buffer.data());
+	}
+	m_file.seekg(static_cast<std::streamoff>(m_layout.row_offset(plane, row_start)));
+	m_file.read(target, static_cast<std::streamsize>(bytes));
+	if (!m_file) {
+		m_file.clear();
+		throw std::runtime_error(std::format("Could not read {} rows from npy file {}, it is shorter than its header says", destination.num_rows(), m_path.string()));
+	}
+
+	auto pixels = destination.pixels();
+	if (m_layout.element_type == NpyElementType::UInt16) {
+		for (size_t i = 0; i < count; i++) {
+			uint16_t value;
+			std::memcpy(&value, m_buffer.data() + i * sizeof(value), sizeof(value));
+			pixels[i] = value;
+		}
+	}
+	else if (m_layout.element_type == NpyElementType::Float64) {
+		for (size_t i = 0; i < count; i++) {
+			double value;
+			std::memcpy(&value, m_buffer.data() + i * sizeof(value), sizeof(value));
+			pixels[i] = static_cast<float>(value);
+		}
+	}
+}
+
+mme::NpyRowWriter::NpyRowWriter(const std::filesystem::path& file, ImageSize size, size_t num_planes, NpyElementType element_type)
+	: m_path(file), m_file(file, std::ios::binary | std::ios::trunc)
+{
+	if (!m_file) {
+		throw std::runtime_error(std::format("Could not create npy file {}", file.string()));
+	}
+	if (num_planes == 0 || size.height == 0 || size.width == 0) {
+		throw std::invalid_argument(std::format("npy file {} would be empty: {} planes of {}x{}", file.string(), num_planes, size.height, size.width));
+	}
+	m_layout.element_type = element_type;
+	m_layout.num_planes = num_planes;
+	m_layout.size = size;
+
+	const auto shape = num_planes == 1 ? std::format("({}, {})", size.height, size.width) : std::format("({}, {}, {})", num_planes, size.height, size.width);
+	std::string header = std::format("{{'descr': '{}', 'fortran_order': False, 'shape': {}, }}", descr(element_type), shape);
+	//magic, version and length take 10 bytes, the header ends in a newline
+	const size_t padded = (10 + header.size() + 1 + NPY_HEADER_ALIGNMENT - 1) / NPY_HEADER_ALIGNMENT * NPY_HEADER_ALIGNMENT;
+	header.resize(padded - 10 - 1, ' ');
+	header.push_back('\n');
+	const uint8_t version[2] = { 1, 0 };
+	const uint16_t header_bytes = static_cast<uint16_t>(header.size());
+	m_file.write(NPY_MAGIC, sizeof(NPY_MAGIC));
+	m_file.write(reinterpret_cast<const char*>(version), sizeof(version));
+	m_file.write(reinterpret_cast<const char*>(&header_bytes), sizeof(header_bytes));
+	m_file.write(header.data(), header.size());
+	m_layout.data_offset = padded;
+
+	//full size up front, the filesystem fills the gap with zeros (sparse where supported)
+	m_file.seekp(static_cast<std::streamoff>(m_layout.row_offset(num_planes, 0) - 1));
+	m_file.put('\0');
+	if (!m_file) {
+		throw std::runtime_error(std::format("Could not size npy file {} to {} bytes", file.string(), m_layout.row_offset(num_planes, 0)));
+	}
+}
+
+void mme::NpyRowWriter::write_rows(size_t plane, size_t row_start, ImageView<const float> source)
+{
+	MME_TRACE_SCOPE("NpyRowWriter::write_rows");
+	check_rows(m_layout, plane, row_start, source.size(), m_path);
+	const auto pixels = source.pixels();
+	const size_t bytes = pixels.size() * m_layout.element_bytes();
+	const char* data = reinterpret_cast<const char*>(pixels.data());
+	if (m_layout.element_type == NpyElementType::UInt16) {
+		m_buffer.resize(bytes);
+		for (size_t i = 0; i < pixels.size(); i++) {
+			const float clamped = std::isnan(pixels[i]) ? 0.0f : std::clamp(std::round(pixels[i]), 0.0f, 65535.0f);
+			const uint16_t value = static_cast<uint16_t>(clamped);
+			std::memcpy(m_buffer.data() + i * sizeof(value), &value, sizeof(value));
+		}
+		data = reinterpret_cast<const char*>(m_buffer.data());
+	}
+	else if (m_layout.element_type == NpyElementType::Float64) {
+		m_buffer.resize(bytes);
+		for (size_t i = 0; i < pixels.size(); i++) {
+			const double value = pixels[i];
+			std::memcpy(m_buffer.data() + i * sizeof(value), &value, sizeof(value));
+		}
+		data = reinterpret_cast<const char*>(m_buffer.data());
+	}
+	m_file.seekp(static_cast<std::streamoff>(m_layout.row_offset(plane, row_start)));
+	m_file.write(data, static_cast<std::streamsize>(bytes));
+	if (!m_file) {
+		throw std::runtime_error(std::format("Could not write {} rows to npy file {}", source.num_rows(), m_path.string()));
+	}
+}
+
+void mme::NpyRowWriter::flush()
+{
+	m_file.flush();
+	if (!m_file) {
+		throw std::runtime_error(std::format("Could not flush npy file {}", m_path.string()));
+	}
+}
@@ -0,0 +1,226 @@
+#include "mme/tiling/tilestream.h"
+#include "mme/tracing/trace.h"
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <exception>
+#include <format>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+
+	//one set of tile buffers, the stream alternates between two
+	struct TileBuffers {
+		std::vector<mme::Image<float>> inputs;
+		std::vector<mme::Image<float>> outputs;
+	};
+
+	//One thread for the reads and writes of a whole stream, running one job at a time
+	class IoThread {
+	public:
+		IoThread() : m_thread([this] { run(); }) {}
+
+		~IoThread() {
+			{
+				std::lock_guard lock(m_mutex);
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			m_thread.join();
+		}
+
+		IoThread(const IoThread&) = delete;
+		IoThread& operator=(const IoThread&) = delete;
+
+		//the previous job must have been waited for
+		void start(std::function<void()> job) {
+			{
+				std::lock_guard lock(m_mutex);
+				m_job = std::move(job);
+			}
+			m_wake.notify_all();
+		}
+
+		//waits for the current job, rethrowing what it threw
+		void wait() {
+			std::unique_lock lock(m_mutex);
+			m_wake.wait(lock, [this] { return !m_job; });
+			if (m_error) {
+				std::rethrow_exception(std::exchange(m_error, nullptr));
+			}
+		}
+
+	private:
+		void run() {
+			std::unique_lock lock(m_mutex);
+			while (true) {
+				m_wake.wait(lock, [this] { return m_stop || m_job; });
+				if (!m_job) {
+					return;
+				}
+				lock.unlock();
+				std::exception_ptr error;
+				try {
+					m_job();
+				}
+				catch (...) {
+					error = std::current_exception();
+				}
+				lock.lock();
+				m_error = error;
+				m_job = nullptr;
+				m_wake.notify_all();
+			}
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::function<void()> m_job;
+		std::exception_ptr m_error;
+		bool m_stop = false;
+		std::thread m_thread; //last, it uses the members above
+	};
+
+	template<typename Planes>
+	mme::ImageSize common_size(const Planes& planes, mme::ImageSize size, bool& first) {
+		for (const auto& plane : planes) {
+			if (plane.file == nullptr) {
+				throw std::invalid_argument("Tile stream planes need a file");
+			}
+			if (plane.plane >= plane.file->num_planes()) {
+				throw std::out_of_range(std::format("Tile stream plane {} is outside a file of {} planes", plane.plane, plane.file->num_planes()));
+			}
+			if (first) {
+				size = plane.file->size();
+				first = false;
+			}
+			else if (plane.file->size() != size) {
+				throw std::invalid_argument(std::format("Tile stream planes must all have the same size, got {}x{} and {}x{}",
+					size.height, size.width, plane.file->size().height, plane.file->size().width));
+			}
+		}
+		return size;
+	}
+
+	void read_tile(std::span<const mme::TileInput> inputs, TileBuffers& buffers, size_t row_start, size_t num_rows) {
+		MME_TRACE_SCOPE("read_tile");
+		for (size_t i = 0; i < inputs.size(); i++) {
+			inputs[i].file->read_rows(inputs[i].plane, row_start, buffers.inputs[i].as_view().sub_view(0, num_rows));
+		}
+	}
+
+	void write_tile(std::span<const mme::TileOutput> outputs, const TileBuffers& buffers, size_t row_start, size_t num_rows) {
+		MME_TRACE_SCOPE("write_tile");
+		for (size_t i = 0; i < outputs.size(); i++) {
+			outputs[i].file->write_rows(outputs[i].plane, row_start, buffers.outputs[i].as_view().sub_view(0, num_rows));
+		}
+	}
+}
+
+size_t mme::tile_rows_for_budget(size_t width, size_t num_inputs, size_t num_outputs, const TileStreamOptions& options)
+{
+	const size_t row_bytes = 2 * (num_inputs + num_outputs) * width * sizeof(float);
+	const size_t rows = row_bytes == 0 ? 0 : options.memory_budget / row_bytes;
+	if (rows == 0) {
+		throw std::invalid_argument(std::format("A memory budget of {} bytes does not hold one double buffered row of {} planes {} wide",
+			options.memory_budget, num_inputs + num_outputs, width));
+	}
+	return options.max_tile_rows > 0 ? std::min(rows, options.max_tile_rows) : rows;
+}
+
+mme::TileStreamReport mme::stream_tiles(std::span<const TileInput> inputs, std::span<const TileOutput> outputs,
+	const std::function<void(const Tile& tile)>& process, const TileStreamOptions& options)
+{
+	MME_TRACE_SCOPE("stream_tiles");
+	if (inputs.empty() && outputs.empty()) {
+		throw std::invalid_argument("A tile stream needs inputs or outputs");
+	}
+	bool first = true;
+	ImageSize size = common_size(inputs, { 0, 0 }, first);
+	size = common_size(outputs, size, first);
+	if (size.height == 0 || size.width == 0) {
+		throw std::invalid_argument(std::format("Tile stream planes are empty: {}x{}", size.height, size.width));
+	}
+
+	TileStreamReport report;
+	report.size = size;
+	report.tile_rows = std::min(tile_rows_for_budget(size.width, inputs.size(), outputs.size(), options), size.height);
+	report.num_tiles = (size.height + report.tile_rows - 1) / report.tile_rows;
+	report.buffer_bytes = 2 * (inputs.size() + outputs.size()) * report.tile_rows * size.width * sizeof(float);
+
+	const ImageSize tile_size{ report.tile_rows, size.width };
+	std::array<TileBuffers, 2> buffers;
+	for (auto& buffer : buffers) {
+		for (size_t i = 0; i < inputs.size(); i++) {
+			buffer.inputs.emplace_back(tile_size);
+		}
+		for (size_t i = 0; i < outputs.size(); i++) {
+			buffer.outputs.emplace_back(tile_size);
+		}
+	}
+	auto tile_rows = [&](size_t tile) { return std::min(report.tile_rows, size.height - tile * report.tile_rows); };
+
+	auto wait_start = Clock::now();
+	read_tile(inputs, buffers[0], 0, tile_rows(0));
+	report.io_wait += Clock::now() - wait_start;
+
+	std::vector<ImageView<const float>> input_views(inputs.size());
+	std::vector<ImageView<float>> output_views(outputs.size());
+	IoThread io;
+	for (size_t tile = 0; tile < report.num_tiles; tile++) {
+		const size_t row_start = tile * report.tile_rows;
+		const size_t num_rows = tile_rows(tile);
+		auto& current = buffers[tile % 2];
+		auto& other = buffers[(tile + 1) % 2];
+
+		//the other buffers hold the outputs of the previous tile and take the inputs of the next one
+		io.start([&, tile]() {
+			if (tile > 0) {
+				write_tile(outputs, other, (tile - 1) * report.tile_rows, tile_rows(tile - 1));
+			}
+			if (tile + 1 < report.num_tiles) {
+				read_tile(inputs, other, (tile + 1) * report.tile_rows, tile_rows(tile + 1));
+			}
+		});
+
+		const auto compute_start = Clock::now();
+		for (size_t i = 0; i < inputs.size(); i++) {
+			input_views[i] = std::as_const(current.inputs[i]).as_view().sub_view(0, num_rows);
+		}
+		for (size_t i = 0; i < outputs.size(); i++) {
+			output_views[i] = current.outputs[i].as_view().sub_view(0, num_rows);
+		}
+		try {
+			process(Tile{ row_start, num_rows, input_views, output_views });
+		}
+		catch (...) {
+			//the background reads and writes use the buffers, they must finish first
+			try {
+				io.wait();
+			}
+			catch (...) {
+			}
+			throw;
+		}
+		wait_start = Clock::now();
+		report.compute += wait_start - compute_start;
+		io.wait();
+		report.io_wait += Clock::now() - wait_start;
+	}
+
+	wait_start = Clock::now();
+	const size_t last = report.num_tiles - 1;
+	write_tile(outputs, buffers[last % 2], last * report.tile_rows, tile_rows(last));
+	for (const auto& output : outputs) {
+		output.file->flush();
+	}
+	report.io_wait += Clock::now() - wait_start;
+	return report;
+}
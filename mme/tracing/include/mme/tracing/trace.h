@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+
+//Scoped spans that can be dumped as a Chrome/Perfetto trace (chrome://tracing, ui.perfetto.dev).
+//Spans are recorded into per-thread buffers without locking, and cost one relaxed load while tracing is disabled.
+//Configure with -DMME_TRACING=OFF to compile them out entirely.
+
+namespace mme::trace {
+
+	namespace detail {
+		inline std::atomic<bool> s_enabled{ false };
+
+		int64_t now_ns();
+		void record(const char* name, int64_t start_ns, int64_t stop_ns) noexcept;
+	}
+
+	inline bool is_enabled() {
+		return detail::s_enabled.load(std::memory_order_relaxed);
+	}
+
+	void enable();
+	void disable();
+
+	//drops all recorded spans, only call while no spans are being recorded
+	void clear();
+
+	//spans that did not fit in a thread's buffer. A buffer holds 65536 spans and passes to a new thread when its thread exits.
+	size_t num_dropped();
+
+	void write_chrome_trace(std::ostream& os);
+	void write_chrome_trace(const std::filesystem::path& filename);
+
+	class Span {
+	public:
+		//name must outlive the trace, pass a string literal
+		explicit Span(const char* name) noexcept
+			: m_name(is_enabled() ? name : nullptr)
+			, m_start_ns(m_name ? detail::now_ns() : 0)
+		{
+		}
+
+		~Span() {
+			if (m_name) {
+				detail::record(m_name, m_start_ns, detail::now_ns());
+			}
+		}
+
+		Span(const Span& other) = delete;
+		Span& operator=(const Span& other) = delete;
+
+	private:
+		const char* m_name;
+		int64_t m_start_ns;
+	};
+
+} //namespace mme::trace
+
+#define MME_TRACE_CONCAT_IMPL(a, b) a##b
+#define MME_TRACE_CONCAT(a, b) MME_TRACE_CONCAT_IMPL(a, b)
+
+#if defined(MME_TRACING_ENABLED)
+#define MME_TRACE_SCOPE(name) ::mme::trace::Span MME_TRACE_CONCAT(mme_trace_span_, __LINE__){ name }
+#else
+#define MME_TRACE_SCOPE(name)
+#endif
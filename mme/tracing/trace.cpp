@@ -0,0 +1,195 @@
+#include "mme/tracing/trace.h"
+#include <array>
+#include <memory>
+#include <new>
+#include <mutex>
+#include <vector>
+#include <fstream>
+#include <format>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+	struct Event {
+		const char* name;
+		int64_t start_ns;
+		int64_t stop_ns;
+		uint32_t thread_id;
+	};
+
+	//Written only by the thread holding it, read by write_chrome_trace. Events go into chunks allocated as they fill.
+	//When its thread exits the buffer is handed to the next new thread, which appends after the events already in it.
+	struct ThreadBuffer {
+		static constexpr size_t chunk_size = 1024;
+		static constexpr size_t num_chunks = 64;
+		static constexpr size_t capacity = chunk_size * num_chunks;
+
+		Event& operator[](size_t index) { return chunks[index / chunk_size][index % chunk_size]; }
+
+		std::array<std::unique_ptr<Event[]>, num_chunks> chunks;
+		std::atomic<size_t> count{ 0 };
+		std::atomic<size_t> dropped{ 0 };
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+		std::vector<ThreadBuffer*> free_buffers; //reserved to hold every buffer, so returning one never allocates
+		uint32_t next_thread_id{ 1 };
+		std::atomic<size_t> dropped_without_buffer{ 0 };
+	};
+
+	Registry& registry() {
+		//never destroyed, threads may still exit and return their buffers during static destruction
+		static Registry* s_registry = new Registry;
+		return *s_registry;
+	}
+
+	struct BufferLease {
+		ThreadBuffer* buffer{ nullptr };
+		uint32_t thread_id{ 0 };
+
+		BufferLease() noexcept {
+			auto& reg = registry();
+			try {
+				std::scoped_lock lock{ reg.mutex };
+				thread_id = reg.next_thread_id++;
+				reg.free_buffers.reserve(reg.buffers.size() + 1);
+				if (!reg.free_buffers.empty()) {
+					buffer = reg.free_buffers.back();
+					reg.free_buffers.pop_back();
+				}
+				else {
+					buffer = reg.buffers.emplace_back(std::make_unique<ThreadBuffer>()).get();
+				}
+			}
+			catch (...) {
+				//out of memory, this thread's spans are only counted
+			}
+		}
+
+		~BufferLease() {
+			if (buffer) {
+				auto& reg = registry();
+				std::scoped_lock lock{ reg.mutex };
+				reg.free_buffers.push_back(buffer);
+			}
+		}
+
+		BufferLease(const BufferLease& other) = delete;
+		BufferLease& operator=(const BufferLease& other) = delete;
+	};
+
+	BufferLease& this_thread_lease() noexcept {
+		thread_local BufferLease lease;
+		return lease;
+	}
+
+	void write_json_string(std::ostream& os, std::string_view str) {
+		os << '"';
+		for (char c : str) {
+			switch (c) {
+			case '"': os << "\\\""; break;
+			case '\\': os << "\\\\"; break;
+			case '\n': os << "\\n"; break;
+			default: os << c;
+			}
+		}
+		os << '"';
+	}
+}
+
+int64_t mme::trace::detail::now_ns()
+{
+	static const auto epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void mme::trace::detail::record(const char* name, int64_t start_ns, int64_t stop_ns) noexcept
+{
+	auto& lease = this_thread_lease();
+	if (!lease.buffer) {
+		registry().dropped_without_buffer.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	auto& buffer = *lease.buffer;
+	const auto index = buffer.count.load(std::memory_order_relaxed);
+	if (index >= ThreadBuffer::capacity) {
+		buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	auto& chunk = buffer.chunks[index / ThreadBuffer::chunk_size];
+	if (!chunk) {
+		chunk.reset(new (std::nothrow) Event[ThreadBuffer::chunk_size]);
+		if (!chunk) {
+			buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+	}
+	buffer[index] = Event{ name, start_ns, stop_ns, lease.thread_id };
+	buffer.count.store(index + 1, std::memory_order_release);
+}
+
+void mme::trace::enable()
+{
+	detail::s_enabled.store(true, std::memory_order_relaxed);
+}
+
+void mme::trace::disable()
+{
+	detail::s_enabled.store(false, std::memory_order_relaxed);
+}
+
+void mme::trace::clear()
+{
+	auto& reg = registry();
+	std::scoped_lock lock{ reg.mutex };
+	for (auto& buffer : reg.buffers) {
+		buffer->count.store(0, std::memory_order_relaxed);
+		buffer->dropped.store(0, std::memory_order_relaxed);
+	}
+	reg.dropped_without_buffer.store(0, std::memory_order_relaxed);
+}
+
+size_t mme::trace::num_dropped()
+{
+	auto& reg = registry();
+	std::scoped_lock lock{ reg.mutex };
+	size_t dropped = reg.dropped_without_buffer.load(std::memory_order_relaxed);
+	for (const auto& buffer : reg.buffers) {
+		dropped += buffer->dropped.load(std::memory_order_relaxed);
+	}
+	return dropped;
+}
+
+void mme::trace::write_chrome_trace(std::ostream& os)
+{
+	auto& reg = registry();
+	std::scoped_lock lock{ reg.mutex };
+
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (const auto& buffer : reg.buffers) {
+		const auto count = buffer->count.load(std::memory_order_acquire);
+		for (size_t i = 0; i < count; i++) {
+			const auto& event = (*buffer)[i];
+			os << (first ? "\n" : ",\n");
+			first = false;
+			os << "{\"name\":";
+			write_json_string(os, event.name);
+			os << std::format(",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+				event.thread_id, event.start_ns / 1000.0, (event.stop_ns - event.start_ns) / 1000.0);
+		}
+	}
+	os << "\n]}\n";
+}
+
+void mme::trace::write_chrome_trace(const std::filesystem::path& filename)
+{
+	std::ofstream file{ filename };
+	if (!file) {
+		throw std::runtime_error(std::format("Could not open trace file {}", filename.string()));
+	}
+	write_chrome_trace(file);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "mme/imaging/image.h"
+#include "mme/imaging/camera.h"
+#include "mme/imaging/framestatistics.h"
+#include <string>
+
+namespace mme {
+
+	//Xenics infrared camera through the Xeneth SDK. Frames are 16 bit grey, the sensor size is fixed.
+	class XenethCamera {
+	public:
+		XenethCamera(const std::string& url = "cam://0");
+
+		XenethCamera(const XenethCamera& other) = delete;
+		XenethCamera& operator=(const XenethCamera& other) = delete;
+
+		~XenethCamera();
+		XenethCamera(XenethCamera&& other) noexcept;
+		XenethCamera& operator=(XenethCamera&& other) noexcept;
+
+		Image<float> capture_single();
+		Image<uint16_t> capture_raw();
+		//statistics are gathered while the frame is converted to float, no extra pass over the image
+		FrameWithStatistics<float> capture_with_statistics(const StatisticsOptions& options = { .bit_depth = 16 });
+		ImageSize image_size() const;
+		Exposure exposure() const;
+
+		void set_exposure(Exposure exposure);
+
+	private:
+		static void close_handle(int handle);
+
+	private:
+		int m_camera_handle; //XCHANDLE, 0 when closed
+		ImageSize m_size;
+		Exposure m_exposure;
+	};
+
+}
@@ -0,0 +1,126 @@
+#include "mme/xeneth/xenethcamera.h"
+#include "mme/imaging/conversion.h"
+#include "mme/imaging/framestatistics.h"
+#include "XCamera.h"
+#include <format>
+#include <stdexcept>
+#include <utility>
+#include "mme/tracing/trace.h"
+
+static_assert(mme::Camera<mme::XenethCamera>);
+
+namespace {
+
+    std::string xeneth_error_message(ErrCode error) {
+        char message[256] = {};
+        XC_ErrorToString(error, message, sizeof(message));
+        return message;
+    }
+
+    void check_xeneth(ErrCode error, std::string_view what) {
+        if (error != I_OK) {
+            throw std::runtime_error(std::format("{}: {} ({})", what, xeneth_error_message(error), error));
+        }
+    }
+
+    constexpr double US_PER_MS = 1000.0; //IntegrationTime is in microseconds, Exposure in ms
+}
+
+mme::XenethCamera::XenethCamera(const std::string& url)
+    : m_camera_handle(0)
+{
+    XCHANDLE handle = XC_OpenCamera(url.c_str());
+    if (!XC_IsInitialised(handle)) {
+        XC_CloseCamera(handle);
+        throw std::runtime_error(std::format("Xeneth camera {} could not be opened, check if it is connected", url));
+    }
+    m_camera_handle = handle;
+
+    m_size = ImageSize{ XC_GetHeight(handle), XC_GetWidth(handle) };
+    double integration_time = 0.0;
+    check_xeneth(XC_GetPropertyValueF(handle, "IntegrationTime", &integration_time), "Could not read Xeneth integration time");
+    m_exposure = Exposure{ integration_time / US_PER_MS };
+
+    //free running from here on, XC_GetFrame blocks until the next frame is available
+    check_xeneth(XC_StartCapture(handle), "Could not start Xeneth capture");
+}
+
+mme::XenethCamera::~XenethCamera()
+{
+    if (m_camera_handle != 0) {
+        close_handle(m_camera_handle);
+    }
+}
+
+mme::XenethCamera::XenethCamera(XenethCamera&& other) noexcept
+    : m_camera_handle(std::exchange(other.m_camera_handle, 0))
+    , m_size(other.m_size)
+    , m_exposure(other.m_exposure)
+{
+}
+
+mme::XenethCamera& mme::XenethCamera::operator=(XenethCamera&& other) noexcept
+{
+    if (this != &other) {
+        if (m_camera_handle != 0) {
+            close_handle(m_camera_handle);
+        }
+        m_camera_handle = std::exchange(other.m_camera_handle, 0);
+        m_size = other.m_size;
+        m_exposure = other.m_exposure;
+    }
+    return *this;
+}
+
+mme::Image<float> mme::XenethCamera::capture_single()
+{
+    MME_TRACE_SCOPE("XenethCamera::capture_single");
+    auto raw = capture_raw();
+    Image<float> image(raw.size());
+    convert_pixels(std::as_const(raw).as_view(), image.as_view());
+    return image;
+}
+
+mme::FrameWithStatistics<float> mme::XenethCamera::capture_with_statistics(const StatisticsOptions& options)
+{
+    MME_TRACE_SCOPE("XenethCamera::capture_with_statistics");
+    auto raw = capture_raw();
+    Image<float> image(raw.size());
+    auto statistics = convert_with_statistics(std::as_const(raw).as_view(), image.as_view(), options);
+    return { std::move(image), std::move(statistics) };
+}
+
+mme::Image<uint16_t> mme::XenethCamera::capture_raw()
+{
+    MME_TRACE_SCOPE("XC_GetFrame");
+    Image<uint16_t> raw(m_size); //filled by the SDK
+    auto pixels = raw.pixels();
+    const auto error = XC_GetFrame(m_camera_handle, FT_16_BPP_GREY, XGF_Blocking, pixels.data(), static_cast<unsigned int>(pixels.size_bytes()));
+    check_xeneth(error, "Could not capture frame with Xeneth camera");
+    return raw;
+}
+
+mme::ImageSize mme::XenethCamera::image_size() const
+{
+    return m_size;
+}
+
+mme::Exposure mme::XenethCamera::exposure() const
+{
+    return m_exposure;
+}
+
+void mme::XenethCamera::set_exposure(Exposure exposure)
+{
+    MME_TRACE_SCOPE("XenethCamera::set_exposure");
+    check_xeneth(XC_SetPropertyValueF(m_camera_handle, "IntegrationTime", exposure.value * US_PER_MS, ""), "Failed to change exposure for Xeneth camera");
+    m_exposure = exposure;
+}
+
+void mme::XenethCamera::close_handle(int handle)
+{
+    if (XC_IsCapturing(handle)) {
+        XC_StopCapture(handle);
+    }
+    XC_CloseCamera(handle);
+}
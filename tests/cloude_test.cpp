@@ -0,0 +1,129 @@
+#include "testing.h"
+#include "mme/polarimetry/cloude.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+
+	using Mueller = std::array<float, mme::MUELLER_ELEMENTS>;
+
+	constexpr Mueller IDENTITY{
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	};
+
+	constexpr Mueller IDEAL_DEPOLARIZER{ 1.0f };
+
+	//coherency eigenvalues 1/2, 1/2, 1/2, -1/2
+	constexpr Mueller NOT_PHYSICAL{
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, -1.0f
+	};
+
+	//partial depolarizer diag(1, 0.8, 0.7, 0.6) behind a linear retarder, scaled by a transmittance
+	Mueller depolarizing_retarder(float retardance, float orientation) {
+		const float c = std::cos(2.0f * orientation);
+		const float s = std::sin(2.0f * orientation);
+		const float cd = std::cos(retardance);
+		const float sd = std::sin(retardance);
+		const std::array<float, 3> diagonal{ 0.8f, 0.7f, 0.6f };
+		const std::array<std::array<float, 3>, 3> retarder{ {
+			{ c * c + s * s * cd, c * s * (1.0f - cd), -s * sd },
+			{ c * s * (1.0f - cd), s * s + c * c * cd, c * sd },
+			{ s * sd, -c * sd, cd }
+		} };
+		Mueller m{};
+		m[0] = 0.6f;
+		for (size_t row = 0; row < 3; row++) {
+			for (size_t col = 0; col < 3; col++) {
+				m[(row + 1) * mme::MUELLER_SIZE + col + 1] = 0.6f * diagonal[row] * retarder[row][col];
+			}
+		}
+		return m;
+	}
+
+	//one matrix per pixel, odd pixel counts leave a partial eigensolver batch
+	mme::MuellerImage image_of(const std::vector<Mueller>& matrices) {
+		mme::MuellerImage image({ 1, matrices.size() });
+		for (size_t pixel = 0; pixel < matrices.size(); pixel++) {
+			for (size_t element = 0; element < mme::MUELLER_ELEMENTS; element++) {
+				image.plane(element).pixels()[pixel] = matrices[pixel][element];
+			}
+		}
+		return image;
+	}
+
+	Mueller pixel_of(const mme::MuellerImage& image, size_t pixel) {
+		Mueller m;
+		for (size_t element = 0; element < mme::MUELLER_ELEMENTS; element++) {
+			m[element] = image.plane(element).pixels()[pixel];
+		}
+		return m;
+	}
+
+	float max_difference(const Mueller& a, const Mueller& b) {
+		float difference = 0.0f;
+		for (size_t element = 0; element < mme::MUELLER_ELEMENTS; element++) {
+			difference = std::max(difference, std::abs(a[element] - b[element]));
+		}
+		return difference;
+	}
+
+	void physical_matrices_are_unchanged() {
+		std::vector<Mueller> matrices{ IDENTITY };
+		for (size_t i = 0; i < 10; i++) {
+			matrices.push_back(depolarizing_retarder(0.3f * i, 0.17f * i - 0.8f));
+		}
+		const auto result = mme::cloude_filter(image_of(matrices));
+		for (size_t pixel = 0; pixel < matrices.size(); pixel++) {
+			const float difference = max_difference(pixel_of(result.filtered, pixel), matrices[pixel]);
+			mme::test::check(difference < 1e-4f, std::format("pixel {} changed by {}", pixel, difference));
+		}
+	}
+
+	void entropy_and_purity_span_pure_to_depolarizing() {
+		const auto result = mme::cloude_filter(image_of({ IDENTITY, IDEAL_DEPOLARIZER, depolarizing_retarder(1.0f, 0.2f) }));
+		const auto entropy = result.entropy.pixels();
+		const auto purity = result.purity.pixels();
+		mme::test::check(std::abs(entropy[0]) < 1e-4f, std::format("identity entropy {}", entropy[0]));
+		mme::test::check(std::abs(purity[0] - 1.0f) < 1e-4f, std::format("identity purity {}", purity[0]));
+		mme::test::check(std::abs(entropy[1] - 1.0f) < 1e-4f, std::format("ideal depolarizer entropy {}", entropy[1]));
+		mme::test::check(std::abs(purity[1]) < 1e-3f, std::format("ideal depolarizer purity {}", purity[1]));
+		mme::test::check(entropy[2] > 0.0f && entropy[2] < 1.0f, std::format("partial depolarizer entropy {}", entropy[2]));
+		mme::test::check(purity[2] > 0.0f && purity[2] < 1.0f, std::format("partial depolarizer purity {}", purity[2]));
+	}
+
+	void negative_eigenvalues_are_clipped() {
+		const auto once = mme::cloude_filter(image_of({ NOT_PHYSICAL }));
+		const auto filtered = pixel_of(once.filtered, 0);
+		mme::test::check(max_difference(filtered, NOT_PHYSICAL) > 0.1f, "a non physical matrix is changed");
+		mme::test::check(std::isfinite(once.entropy.pixels()[0]), "a non physical matrix still has an entropy");
+
+		const auto twice = mme::cloude_filter(image_of({ filtered }));
+		mme::test::check(max_difference(pixel_of(twice.filtered, 0), filtered) < 1e-4f, "the filtered matrix is physical");
+	}
+
+	void non_finite_pixels_are_nan() {
+		auto broken = IDENTITY;
+		broken[9] = std::numeric_limits<float>::infinity();
+		const auto result = mme::cloude_filter(image_of({ IDENTITY, broken, IDENTITY }));
+		mme::test::check(std::isnan(pixel_of(result.filtered, 1)[0]) && std::isnan(result.entropy.pixels()[1]), "a non finite pixel comes out as NaN");
+		mme::test::check(max_difference(pixel_of(result.filtered, 2), IDENTITY) < 1e-4f, "its neighbours are unaffected");
+	}
+}
+
+int main() {
+	return mme::test::run({
+		{ "physical_matrices_are_unchanged", physical_matrices_are_unchanged },
+		{ "entropy_and_purity_span_pure_to_depolarizing", entropy_and_purity_span_pure_to_depolarizing },
+		{ "negative_eigenvalues_are_clipped", negative_eigenvalues_are_clipped },
+		{ "non_finite_pixels_are_nan", non_finite_pixels_are_nan },
+	});
+}
@@ -0,0 +1,155 @@
+#include "testing.h"
+#include "mme/polarimetry/decomposition.h"
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+	using Mueller = std::array<float, mme::MUELLER_ELEMENTS>;
+
+	struct Elements {
+		float diattenuation;
+		float diattenuation_azimuth;	//rad, of the diattenuation vector in the Q U plane
+		float retardance;
+		float orientation;
+		std::array<float, 3> depolarizer;	//diagonal of m_delta
+	};
+
+	Mueller multiply(const Mueller& a, const Mueller& b) {
+		Mueller result{};
+		for (size_t row = 0; row < mme::MUELLER_SIZE; row++) {
+			for (size_t col = 0; col < mme::MUELLER_SIZE; col++) {
+				for (size_t k = 0; k < mme::MUELLER_SIZE; k++) {
+					result[row * mme::MUELLER_SIZE + col] += a[row * mme::MUELLER_SIZE + k] * b[k * mme::MUELLER_SIZE + col];
+				}
+			}
+		}
+		return result;
+	}
+
+	Mueller diattenuator(float diattenuation, float azimuth) {
+		const std::array<float, 3> d{ diattenuation * std::cos(2.0f * azimuth), diattenuation * std::sin(2.0f * azimuth), 0.0f };
+		const float root = std::sqrt(1.0f - diattenuation * diattenuation);
+		Mueller m{};
+		m[0] = 1.0f;
+		for (size_t i = 0; i < 3; i++) {
+			m[i + 1] = d[i];
+			m[(i + 1) * mme::MUELLER_SIZE] = d[i];
+			for (size_t j = 0; j < 3; j++) {
+				const float outer = diattenuation > 0.0f ? d[i] * d[j] / (diattenuation * diattenuation) : 0.0f;
+				m[(i + 1) * mme::MUELLER_SIZE + j + 1] = (i == j ? root : 0.0f) + (1.0f - root) * outer;
+			}
+		}
+		return m;
+	}
+
+	//linear retarder, fast axis at orientation
+	Mueller retarder(float retardance, float orientation) {
+		const float c = std::cos(2.0f * orientation);
+		const float s = std::sin(2.0f * orientation);
+		const float cd = std::cos(retardance);
+		const float sd = std::sin(retardance);
+		return {
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, c * c + s * s * cd, c * s * (1.0f - cd), -s * sd,
+			0.0f, c * s * (1.0f - cd), s * s + c * c * cd, c * sd,
+			0.0f, s * sd, -c * sd, cd
+		};
+	}
+
+	Mueller depolarizer(const std::array<float, 3>& diagonal) {
+		Mueller m{};
+		m[0] = 1.0f;
+		for (size_t i = 0; i < 3; i++) {
+			m[(i + 1) * (mme::MUELLER_SIZE + 1)] = diagonal[i];
+		}
+		return m;
+	}
+
+	//M = M_delta M_R M_D, scaled by a transmittance lu_chipman has to normalize away
+	Mueller compose(const Elements& elements) {
+		auto m = multiply(depolarizer(elements.depolarizer), multiply(retarder(elements.retardance, elements.orientation),
+			diattenuator(elements.diattenuation, elements.diattenuation_azimuth)));
+		for (auto& value : m) {
+			value *= 0.7f;
+		}
+		return m;
+	}
+
+	float depolarization(const Elements& elements) {
+		return 1.0f - (std::abs(elements.depolarizer[0]) + std::abs(elements.depolarizer[1]) + std::abs(elements.depolarizer[2])) / 3.0f;
+	}
+
+	bool near(float value, float expected) {
+		return std::abs(value - expected) < 1e-4f;
+	}
+
+	constexpr std::array ELEMENTS{
+		Elements{ 0.0f, 0.0f, 0.5f, 0.3f, { 1.0f, 1.0f, 1.0f } },
+		Elements{ 0.4f, 0.2f, 1.1f, 0.4f, { 0.8f, 0.7f, 0.6f } },
+		Elements{ 0.9f, -0.6f, 2.5f, -0.7f, { 0.3f, 0.3f, 0.2f } },
+		Elements{ 0.2f, 1.3f, 0.05f, 1.2f, { 0.9f, 0.5f, 0.95f } },
+	};
+
+	void check_pixel(const mme::LuChipmanPixel& pixel, const Elements& expected, size_t index) {
+		mme::test::check(near(pixel.diattenuation, expected.diattenuation), std::format("element set {} diattenuation {} against {}", index, pixel.diattenuation, expected.diattenuation));
+		mme::test::check(near(pixel.retardance, expected.retardance), std::format("element set {} retardance {} against {}", index, pixel.retardance, expected.retardance));
+		mme::test::check(near(pixel.orientation, expected.orientation), std::format("element set {} orientation {} against {}", index, pixel.orientation, expected.orientation));
+		mme::test::check(near(pixel.depolarization, depolarization(expected)), std::format("element set {} depolarization {} against {}", index, pixel.depolarization, depolarization(expected)));
+	}
+
+	void composed_matrices_round_trip() {
+		for (size_t i = 0; i < ELEMENTS.size(); i++) {
+			check_pixel(mme::lu_chipman(compose(ELEMENTS[i])), ELEMENTS[i], i);
+		}
+	}
+
+	void images_match_single_pixels() {
+		//odd size so the last row tile and any vector batch are partial
+		mme::MuellerImage image({ 5, 7 });
+		const size_t num_pixels = image.size().height * image.size().width;
+		for (size_t pixel = 0; pixel < num_pixels; pixel++) {
+			const auto m = compose(ELEMENTS[pixel % ELEMENTS.size()]);
+			for (size_t element = 0; element < mme::MUELLER_ELEMENTS; element++) {
+				image.plane(element).pixels()[pixel] = m[element];
+			}
+		}
+		const auto maps = mme::lu_chipman(image);
+		for (size_t pixel = 0; pixel < num_pixels; pixel++) {
+			const mme::LuChipmanPixel result{
+				maps.diattenuation.pixels()[pixel],
+				maps.retardance.pixels()[pixel],
+				maps.orientation.pixels()[pixel],
+				maps.depolarization.pixels()[pixel]
+			};
+			check_pixel(result, ELEMENTS[pixel % ELEMENTS.size()], pixel);
+		}
+	}
+
+	void undefined_quantities_are_nan() {
+		Mueller dark{};
+		const auto dark_result = mme::lu_chipman(dark);
+		mme::test::check(std::isnan(dark_result.diattenuation) && std::isnan(dark_result.retardance) && std::isnan(dark_result.orientation)
+			&& std::isnan(dark_result.depolarization), "a dark pixel is all NaN");
+
+		auto broken = compose(ELEMENTS[1]);
+		broken[6] = std::numeric_limits<float>::quiet_NaN();
+		mme::test::check(std::isnan(mme::lu_chipman(broken).diattenuation), "a non finite element makes the pixel NaN");
+
+		const auto polarizer = mme::lu_chipman(diattenuator(1.0f, 0.0f));
+		mme::test::check(near(polarizer.diattenuation, 1.0f), "an ideal polarizer has diattenuation 1");
+		mme::test::check(std::isnan(polarizer.retardance) && std::isnan(polarizer.depolarization), "an ideal polarizer has no retardance or depolarization");
+
+		const auto clear = mme::lu_chipman(retarder(0.0f, 0.3f));
+		mme::test::check(near(clear.retardance, 0.0f) && std::isnan(clear.orientation), "without retardance there is no orientation");
+	}
+}
+
+int main() {
+	return mme::test::run({
+		{ "composed_matrices_round_trip", composed_matrices_round_trip },
+		{ "images_match_single_pixels", images_match_single_pixels },
+		{ "undefined_quantities_are_nan", undefined_quantities_are_nan },
+	});
+}
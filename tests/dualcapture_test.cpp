@@ -0,0 +1,131 @@
+#include "testing.h"
+#include "lucamstub.h"
+#include "xenethstub.h"
+#include "mme/imaging/synchronizedcapture.h"
+#include "mme/lumenera/lumeneracamera.h"
+#include "mme/xeneth/xenethcamera.h"
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <thread>
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+	using namespace std::chrono_literals;
+
+	double ms(Clock::duration duration) {
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	void xeneth_exposure_sets_the_frame_period() {
+		xeneth_stub::reset({ .width = 64, .height = 48, .integration_time_us = 2000.0, .readout = 1ms });
+		mme::XenethCamera camera{};
+		mme::test::check(camera.image_size() == mme::ImageSize{ 48, 64 }, "size from the SDK");
+		mme::test::check(camera.exposure() == mme::Exposure{ 2.0 }, "exposure read from IntegrationTime");
+
+		camera.set_exposure(mme::Exposure{ 4.0 });
+		camera.capture_raw(); //the first frame after a change is partly gone
+		const auto start = Clock::now();
+		uint16_t previous = 0;
+		for (size_t i = 0; i < 20; i++) {
+			const auto frame = camera.capture_raw();
+			const uint16_t number = frame.pixels()[0];
+			mme::test::check(i == 0 || number == previous + 1, "no frames lost while keeping up");
+			previous = number;
+		}
+		const double elapsed = ms(Clock::now() - start);
+		mme::test::check(elapsed > 95.0 && elapsed < 130.0, std::format("20 frames of 4 + 1 ms took {} ms", elapsed));
+	}
+
+	void lumenera_frames_take_exposure_and_readout() {
+		lucam_stub::reset({ .readout = 5ms });
+		mme::LumeneraCamera camera{ 1, { mme::ImageSize{ 64, 64 }, mme::Exposure{ 10.0 } } };
+		const auto start = Clock::now();
+		for (uint16_t i = 0; i < 5; i++) {
+			const auto frame = camera.capture_raw();
+			mme::test::check(frame.size() == mme::ImageSize{ 64, 64 }, "configured size");
+			mme::test::check(frame.pixels()[0] == i, "frames arrive in order, unpacked");
+		}
+		const double elapsed = ms(Clock::now() - start);
+		mme::test::check(elapsed > 74.0 && elapsed < 100.0, std::format("5 frames of 10 + 5 ms took {} ms", elapsed));
+	}
+
+	void lumenera_hardware_captures_wait_for_a_trigger() {
+		lucam_stub::reset({ .readout = 1ms });
+		mme::LumeneraCamera camera{ 1, { mme::ImageSize{ 64, 64 }, mme::Exposure{ 2.0 }, mme::TriggerMode::Hardware } };
+		camera.set_capture_timeout(50ms);
+		mme::test::check(camera.capture_timeout() == 50ms, "timeout kept");
+
+		const auto start = Clock::now();
+		bool timed_out = false;
+		try {
+			camera.capture_raw();
+		}
+		catch (const std::runtime_error&) {
+			timed_out = true;
+		}
+		const double waited = ms(Clock::now() - start);
+		mme::test::check(timed_out && waited > 45.0 && waited < 500.0, std::format("gave up on the missing trigger after {} ms", waited));
+
+		camera.set_capture_timeout(10s);
+		auto capture = std::async(std::launch::async, [&] { return camera.capture_raw(); });
+		std::this_thread::sleep_for(20ms);
+		camera.cancel_capture();
+		mme::test::check(capture.wait_for(1s) == std::future_status::ready, "cancelled capture returned");
+		bool cancelled = false;
+		try {
+			capture.get();
+		}
+		catch (const std::runtime_error&) {
+			cancelled = true;
+		}
+		mme::test::check(cancelled && lucam_stub::frames().empty(), "cancelled capture throws without a frame");
+
+		capture = std::async(std::launch::async, [&] { return camera.capture_raw(); });
+		std::this_thread::sleep_for(20ms);
+		lucam_stub::trigger();
+		mme::test::check(capture.get().pixels()[0] == 0, "triggered capture takes the frame");
+	}
+
+	void pairs_are_exposed_together() {
+		//visible at 25 ms a frame, infrared at 10 ms a frame
+		lucam_stub::reset({ .readout = 5ms });
+		xeneth_stub::reset({ .width = 64, .height = 48, .integration_time_us = 8000.0, .readout = 2ms });
+		mme::LumeneraCamera visible{ 1, { mme::ImageSize{ 64, 64 }, mme::Exposure{ 20.0 } } };
+		mme::XenethCamera infrared{};
+
+		std::vector<mme::FramePair> pairs;
+		{
+			mme::SynchronizedCapture capture{ visible, infrared, 5ms };
+			pairs = capture.capture(10);
+			mme::test::check(capture.num_unpaired() > 0, "the faster camera's extra frames go unpaired");
+		}
+
+		const auto visible_frames = lucam_stub::frames();
+		const auto infrared_frames = xeneth_stub::frames();
+		uint16_t previous_visible = 0;
+		for (size_t i = 0; i < pairs.size(); i++) {
+			const auto& [first, second] = pairs[i];
+			mme::test::check(pairs[i].skew() <= 5ms, "timestamps within the tolerance");
+			const uint16_t visible_number = first.frame.pixels()[0];
+			const uint16_t infrared_number = second.frame.pixels()[0];
+			mme::test::check(i == 0 || visible_number > previous_visible, "pairs in capture order");
+			previous_visible = visible_number;
+
+			const auto visible_exposure = visible_frames.at(visible_number);
+			const auto infrared_exposure = std::ranges::find(infrared_frames, infrared_number, [](const auto& frame) { return frame.first; })->second;
+			const bool overlap = visible_exposure.start < infrared_exposure.end && infrared_exposure.start < visible_exposure.end;
+			mme::test::check(overlap, std::format("pair {} was exposed {} ms apart", i, ms(infrared_exposure.start - visible_exposure.start)));
+		}
+	}
+}
+
+int main() {
+	return mme::test::run({
+		{ "xeneth_exposure_sets_the_frame_period", xeneth_exposure_sets_the_frame_period },
+		{ "lumenera_frames_take_exposure_and_readout", lumenera_frames_take_exposure_and_readout },
+		{ "lumenera_hardware_captures_wait_for_a_trigger", lumenera_hardware_captures_wait_for_a_trigger },
+		{ "pairs_are_exposed_together", pairs_are_exposed_together },
+	});
+}
@@ -0,0 +1,104 @@
+#include "testing.h"
+#include "mme/imaging/filters.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <vector>
+
+namespace {
+
+	//rows taller than a filter tile, images narrower than the window, odd sizes
+	constexpr std::array SIZES{ mme::ImageSize{ 1, 1 }, mme::ImageSize{ 2, 3 }, mme::ImageSize{ 5, 4 }, mme::ImageSize{ 37, 45 }, mme::ImageSize{ 70, 19 } };
+
+	//sorts every window, borders replicate the edge pixels
+	mme::Image<float> brute_force_median(mme::ImageView<const float> source, size_t radius) {
+		const auto size = source.size();
+		const auto r = static_cast<std::ptrdiff_t>(radius);
+		mme::Image<float> result(size);
+		std::vector<float> window;
+		for (size_t row = 0; row < size.height; row++) {
+			for (size_t col = 0; col < size.width; col++) {
+				window.clear();
+				for (std::ptrdiff_t dy = -r; dy <= r; dy++) {
+					for (std::ptrdiff_t dx = -r; dx <= r; dx++) {
+						const auto y = std::clamp<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(row) + dy, 0, static_cast<std::ptrdiff_t>(size.height) - 1);
+						const auto x = std::clamp<std::ptrdiff_t>(static_cast<std::ptrdiff_t>(col) + dx, 0, static_cast<std::ptrdiff_t>(size.width) - 1);
+						window.push_back(source.row(static_cast<size_t>(y))[static_cast<size_t>(x)]);
+					}
+				}
+				std::nth_element(window.begin(), window.begin() + window.size() / 2, window.end());
+				result.pixels()[row * size.width + col] = window[window.size() / 2];
+			}
+		}
+		return result;
+	}
+
+	//12 bit camera counts, which the histogram path filters exactly
+	mme::Image<float> counts_frame(mme::ImageSize size, std::mt19937& rng) {
+		std::uniform_int_distribution<int> value{ 0, 4095 };
+		mme::Image<float> frame(size);
+		for (auto& pixel : frame.pixels()) {
+			pixel = static_cast<float>(value(rng));
+		}
+		return frame;
+	}
+
+	mme::Image<float> float_frame(mme::ImageSize size, std::mt19937& rng) {
+		std::normal_distribution<float> value{ 0.0f, 10.0f };
+		mme::Image<float> frame(size);
+		for (auto& pixel : frame.pixels()) {
+			pixel = value(rng);
+		}
+		return frame;
+	}
+
+	void check_median(const mme::Image<float>& frame, size_t radius, std::string_view what) {
+		const auto filtered = mme::median_filter(frame.as_view(), radius);
+		const auto expected = brute_force_median(frame.as_view(), radius);
+		const auto mismatch = std::ranges::mismatch(filtered.pixels(), expected.pixels());
+		mme::test::check(mismatch.in1 == filtered.pixels().end(), std::format("radius {} median of {} {}x{} matches brute force", radius, what,
+			frame.size().height, frame.size().width));
+	}
+
+	void networks_match_brute_force() {
+		std::mt19937 rng{ 17 };
+		for (size_t radius : { 1, 2 }) {
+			for (auto size : SIZES) {
+				check_median(counts_frame(size, rng), radius, "counts");
+				check_median(float_frame(size, rng), radius, "floats");
+				//duplicates everywhere exercise the equal compares
+				check_median(mme::Image<float>(1.5f, size), radius, "a constant frame");
+			}
+		}
+	}
+
+	void histogram_matches_brute_force() {
+		std::mt19937 rng{ 19 };
+		for (auto size : SIZES) {
+			check_median(counts_frame(size, rng), 3, "counts");
+			check_median(mme::Image<float>(1.5f, size), 3, "a constant frame");
+		}
+	}
+
+	void histogram_rounds_floats_to_its_levels() {
+		std::mt19937 rng{ 23 };
+		const auto frame = float_frame({ 37, 45 }, rng);
+		const auto [low, high] = std::ranges::minmax(frame.pixels());
+		const float step = (high - low) / 4095.0f;
+		const auto filtered = mme::median_filter(frame.as_view(), 3);
+		const auto expected = brute_force_median(frame.as_view(), 3);
+		float error = 0.0f;
+		for (size_t i = 0; i < filtered.pixels().size(); i++) {
+			error = std::max(error, std::abs(filtered.pixels()[i] - expected.pixels()[i]));
+		}
+		mme::test::check(error <= step, std::format("radius 3 float median within a level, off by {} with levels of {}", error, step));
+	}
+}
+
+int main() {
+	return mme::test::run({
+		{ "networks_match_brute_force", networks_match_brute_force },
+		{ "histogram_matches_brute_force", histogram_matches_brute_force },
+		{ "histogram_rounds_floats_to_its_levels", histogram_rounds_floats_to_its_levels },
+	});
+}
@@ -0,0 +1,183 @@
+#include "testing.h"
+#include "mme/imaging/framecodec.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+	constexpr std::array CODECS{ mme::FrameCodec::Packed12, mme::FrameCodec::DeltaBitPacked };
+	//odd widths, rows shorter and longer than a delta block, a last block that is not full
+	constexpr std::array SIZES{ mme::ImageSize{ 1, 1 }, mme::ImageSize{ 3, 5 }, mme::ImageSize{ 7, 129 }, mme::ImageSize{ 33, 255 }, mme::ImageSize{ 64, 2048 } };
+
+	mme::Image<uint16_t> noise_frame(mme::ImageSize size, std::mt19937& rng) {
+		std::uniform_int_distribution<int> value{ 0, mme::MAX_12BIT_VALUE };
+		mme::Image<uint16_t> frame(size);
+		for (auto& pixel : frame.pixels()) {
+			pixel = static_cast<uint16_t>(value(rng));
+		}
+		return frame;
+	}
+
+	//a smooth gradient with a little noise, what the delta codec is for
+	mme::Image<uint16_t> camera_frame(mme::ImageSize size, std::mt19937& rng) {
+		std::normal_distribution<float> noise{ 0.0f, 3.0f };
+		mme::Image<uint16_t> frame(size);
+		for (size_t row = 0; row < size.height; row++) {
+			for (size_t col = 0; col < size.width; col++) {
+				const float signal = 500.0f + 3000.0f * (row + col) / (size.height + size.width);
+				frame.pixels()[row * size.width + col] = static_cast<uint16_t>(std::clamp(signal + noise(rng), 0.0f, 4095.0f));
+			}
+		}
+		return frame;
+	}
+
+	void check_round_trip(const mme::Image<uint16_t>& frame, mme::FrameCodec codec, std::string_view what) {
+		const auto encoded = mme::encode_frame(frame.as_view(), codec);
+		const auto decoded = mme::decode_frame(encoded);
+		mme::test::check(decoded.size() == frame.size(), std::format("{} keeps its size", what));
+		mme::test::check(std::ranges::equal(decoded.pixels(), frame.pixels()), std::format("{} {}x{} codec {} round trips", what,
+			frame.size().height, frame.size().width, static_cast<int>(codec)));
+	}
+
+	void frames_round_trip() {
+		std::mt19937 rng{ 7 };
+		for (auto codec : CODECS) {
+			for (auto size : SIZES) {
+				check_round_trip(mme::Image<uint16_t>(uint16_t{ 0 }, size), codec, "all zero frame");
+				check_round_trip(mme::Image<uint16_t>(mme::MAX_12BIT_VALUE, size), codec, "saturated frame");
+				check_round_trip(noise_frame(size, rng), codec, "12 bit noise");
+				check_round_trip(camera_frame(size, rng), codec, "camera frame");
+			}
+		}
+	}
+
+	void delta_codec_compresses_smooth_frames() {
+		std::mt19937 rng{ 3 };
+		const auto frame = camera_frame({ 256, 256 }, rng);
+		const auto delta = mme::encode_frame(frame.as_view(), mme::FrameCodec::DeltaBitPacked);
+		const auto packed = mme::encode_frame(frame.as_view(), mme::FrameCodec::Packed12);
+		mme::test::check(delta.data.size() < packed.data.size() / 2, std::format("{} delta bytes against {} packed", delta.data.size(), packed.data.size()));
+
+		const auto zeros = mme::encode_frame(mme::Image<uint16_t>(uint16_t{ 0 }, { 256, 256 }).as_view(), mme::FrameCodec::DeltaBitPacked);
+		mme::test::check(zeros.data.size() == 256 * 256 / 128, "an all zero frame is one bit width byte per block");
+	}
+
+	void values_above_12_bits_are_rejected() {
+		for (auto codec : CODECS) {
+			mme::Image<uint16_t> frame(uint16_t{ 0 }, { 5, 301 });
+			frame.pixels()[777] = 0x1000;
+			bool rejected = false;
+			try {
+				mme::encode_frame(frame.as_view(), codec);
+			}
+			catch (const std::invalid_argument&) {
+				rejected = true;
+			}
+			mme::test::check(rejected, std::format("codec {} rejects a 13 bit value", static_cast<int>(codec)));
+		}
+	}
+
+	void truncated_data_is_rejected() {
+		std::mt19937 rng{ 11 };
+		const auto frame = noise_frame({ 9, 131 }, rng);
+		for (auto codec : CODECS) {
+			auto encoded = mme::encode_frame(frame.as_view(), codec);
+			encoded.data.pop_back();
+			bool rejected = false;
+			try {
+				mme::decode_frame(encoded);
+			}
+			catch (const std::runtime_error&) {
+				rejected = true;
+			}
+			mme::test::check(rejected, std::format("codec {} rejects a short payload", static_cast<int>(codec)));
+		}
+	}
+
+	std::vector<uint8_t> read_file(const std::filesystem::path& file) {
+		std::ifstream in(file, std::ios::binary);
+		return { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+	}
+
+	void write_file(const std::filesystem::path& file, const std::vector<uint8_t>& bytes) {
+		std::ofstream out(file, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+	}
+
+	bool load_fails(const std::filesystem::path& file) {
+		try {
+			mme::load_compressed_frames(file.string());
+		}
+		catch (const std::runtime_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	void frame_files_round_trip_and_reject_corruption() {
+		const auto file = std::filesystem::temp_directory_path() / "mme_framecodec_test.mmef";
+		std::mt19937 rng{ 5 };
+		std::vector<mme::Image<uint16_t>> frames;
+		frames.push_back(camera_frame({ 31, 77 }, rng));
+		frames.push_back(noise_frame({ 31, 77 }, rng));
+		{
+			mme::CompressedFrameWriter writer(file.string(), mme::FrameCodec::DeltaBitPacked);
+			for (const auto& frame : frames) {
+				writer.write(frame.as_view());
+			}
+		}
+		const auto loaded = mme::load_compressed_frames(file.string());
+		mme::test::check(loaded.size() == frames.size(), "every frame loaded");
+		for (size_t i = 0; i < frames.size(); i++) {
+			mme::test::check(std::ranges::equal(loaded[i].pixels(), frames[i].pixels()), std::format("frame {} loaded as written", i));
+		}
+
+		const auto bytes = read_file(file);
+		auto corrupt = bytes;
+		corrupt[5] = 7;
+		write_file(file, corrupt);
+		mme::test::check(load_fails(file), "an unknown codec is rejected");
+
+		corrupt = bytes;
+		const uint64_t huge_payload = uint64_t{ 1 } << 60;
+		std::memcpy(corrupt.data() + 16, &huge_payload, sizeof(huge_payload));
+		write_file(file, corrupt);
+		mme::test::check(load_fails(file), "a payload past the end of the file is rejected");
+
+		corrupt = bytes;
+		const uint32_t huge_side = 1u << 30;
+		std::memcpy(corrupt.data() + 8, &huge_side, sizeof(huge_side));
+		std::memcpy(corrupt.data() + 12, &huge_side, sizeof(huge_side));
+		write_file(file, corrupt);
+		mme::test::check(load_fails(file), "a frame size the payload cannot hold is rejected");
+
+		corrupt = bytes;
+		corrupt.resize(bytes.size() - 10);
+		write_file(file, corrupt);
+		mme::test::check(load_fails(file), "a truncated payload is rejected");
+
+		uint64_t first_payload = 0;
+		std::memcpy(&first_payload, bytes.data() + 16, sizeof(first_payload));
+		corrupt.resize(32 + first_payload + 12);
+		write_file(file, corrupt);
+		mme::test::check(load_fails(file), "a truncated header is rejected");
+		std::filesystem::remove(file);
+	}
+}
+
+int main() {
+	return mme::test::run({
+		{ "frames_round_trip", frames_round_trip },
+		{ "delta_codec_compresses_smooth_frames", delta_codec_compresses_smooth_frames },
+		{ "values_above_12_bits_are_rejected", values_above_12_bits_are_rejected },
+		{ "truncated_data_is_rejected", truncated_data_is_rejected },
+		{ "frame_files_round_trip_and_reject_corruption", frame_files_round_trip_and_reject_corruption },
+	});
+}
@@ -0,0 +1,109 @@
+#include "testing.h"
+#include "mme/sharedring/framering.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+	//unique per process so parallel test runs do not share a ring
+	std::string ring_name(std::string_view test) {
+		return std::format("/mme_framering_test_{}_{}", test, ::getpid());
+	}
+
+	mme::Image<uint16_t> numbered_frame(mme::ImageSize size, uint16_t first) {
+		mme::Image<uint16_t> frame(size);
+		for (size_t i = 0; i < frame.pixels().size(); i++) {
+			frame.pixels()[i] = static_cast<uint16_t>(first + i);
+		}
+		return frame;
+	}
+
+	bool holds_frame(const mme::RingRecord& record, const mme::Image<uint16_t>& frame) {
+		return record.info.kind == mme::RingRecordKind::Frame && record.info.element_type == mme::RingElementType::UInt16
+			&& record.info.rows == frame.size().height && record.info.cols == frame.size().width
+			&& record.payload.size() == frame.pixels().size_bytes()
+			&& std::memcmp(record.payload.data(), frame.pixels().data(), record.payload.size()) == 0;
+	}
+
+	void published_records_read_back() {
+		mme::FrameRingPublisher publisher(ring_name("read_back"), 4, 1024);
+		mme::FrameRingReader reader(publisher.name());
+		mme::test::check(reader.num_slots() == 4, "the reader sees the slot count");
+		mme::test::check(reader.last_sequence() == 0 && !reader.read_latest(), "nothing is published yet");
+
+		const auto frame = numbered_frame({ 5, 7 }, 100);
+		const uint64_t frame_sequence = publisher.publish(frame.as_view());
+		const std::vector<double> samples{ 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+		const uint64_t samples_sequence = publisher.publish_samples(samples, 2);
+		mme::test::check(frame_sequence == 1 && samples_sequence == 2 && reader.last_sequence() == 2, "sequence numbers count from 1");
+
+		const auto frame_record = reader.read(frame_sequence);
+		mme::test::check(frame_record && holds_frame(*frame_record, frame), "the frame reads back as published");
+		mme::test::check(frame_record && frame_record->info.timestamp_ns > 0, "the frame has a publish time");
+
+		const auto samples_record = reader.read_latest();
+		mme::test::check(samples_record && samples_record->info.sequence == samples_sequence, "the latest record is the sample block");
+		mme::test::check(samples_record && samples_record->info.kind == mme::RingRecordKind::Samples && samples_record->info.rows == 2
+			&& samples_record->info.cols == 3 && std::memcmp(samples_record->payload.data(), samples.data(), sizeof(double) * samples.size()) == 0,
+			"the sample block reads back as two channels of three samples");
+		mme::test::check(!reader.read(3), "an unpublished record is not in the ring");
+	}
+
+	void overwritten_records_are_detected() {
+		mme::FrameRingPublisher publisher(ring_name("overwrite"), 3, 256);
+		mme::FrameRingReader reader(publisher.name());
+		for (uint16_t i = 0; i < 5; i++) {
+			publisher.publish(numbered_frame({ 2, 3 }, i).as_view());
+		}
+		mme::test::check(!reader.read(1) && !reader.read(2), "the oldest records are overwritten");
+		for (uint16_t sequence = 3; sequence <= 5; sequence++) {
+			const auto record = reader.read(sequence);
+			mme::test::check(record && holds_frame(*record, numbered_frame({ 2, 3 }, static_cast<uint16_t>(sequence - 1))), std::format("record {} is still in the ring", sequence));
+		}
+
+		//the publisher laps the reader while it is looking at the slot
+		bool called = false;
+		const bool valid = reader.view(3, [&](const mme::RingRecordInfo& info, std::span<const std::byte>) {
+			called = info.sequence == 3;
+			publisher.publish(numbered_frame({ 2, 3 }, 50).as_view());
+		});
+		mme::test::check(called && !valid, "a record overwritten during view is reported invalid");
+		mme::test::check(reader.view(4, [](const mme::RingRecordInfo&, std::span<const std::byte>) {}), "an untouched record is valid");
+		mme::test::check(reader.read_latest()->info.sequence == 6, "the latest record is the one that lapped the reader");
+	}
+
+	void oversized_records_are_rejected() {
+		mme::FrameRingPublisher publisher(ring_name("oversized"), 2, 16);
+		bool rejected = false;
+		try {
+			publisher.publish(numbered_frame({ 3, 3 }, 0).as_view());
+		}
+		catch (const std::invalid_argument&) {
+			rejected = true;
+		}
+		mme::test::check(rejected && publisher.last_sequence() == 0, "a frame larger than a slot is rejected without publishing");
+	}
+
+	void missing_rings_fail_to_open() {
+		bool failed = false;
+		try {
+			mme::FrameRingReader reader(ring_name("missing"));
+		}
+		catch (const std::runtime_error&) {
+			failed = true;
+		}
+		mme::test::check(failed, "opening a ring nobody published fails");
+	}
+}
+
+int main() {
+	return mme::test::run({
+		{ "published_records_read_back", published_records_read_back },
+		{ "overwritten_records_are_detected", overwritten_records_are_detected },
+		{ "oversized_records_are_rejected", oversized_records_are_rejected },
+		{ "missing_rings_fail_to_open", missing_rings_fail_to_open },
+	});
+}
@@ -0,0 +1,113 @@
+#include "testing.h"
+#include "fwxcstub.h"
+#include "mme/fwxc/fwxc.h"
+#include "mme/fwxc/fwxcqueue.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	using Clock = std::chrono::steady_clock;
+	using namespace std::chrono_literals;
+
+	void shortest_rotation_is_taken() {
+		fwxc_stub::reset({ .num_positions = 6, .position = 1, .per_slot = 0ms });
+		mme::Fwxc filter_wheel{};
+		mme::test::check(filter_wheel.change_filter_position(6), "move succeeds");
+		mme::test::check(fwxc_stub::moves() == std::vector{ -1 }, "1 to 6 turns one slot backward");
+		mme::test::check(filter_wheel.last_rotation() == mme::Rotation::Backward, "backward reported");
+		mme::test::check(filter_wheel.change_filter_position(2), "move succeeds");
+		mme::test::check(fwxc_stub::moves() == std::vector{ -1, 2 }, "6 to 2 turns two slots forward");
+	}
+
+	void half_turns_go_forward() {
+		//the stub turns half a turn backward when left to itself
+		fwxc_stub::reset({ .num_positions = 6, .position = 1, .per_slot = 0ms });
+		mme::Fwxc filter_wheel{};
+		mme::test::check(filter_wheel.change_filter_position(4), "move succeeds");
+		mme::test::check(fwxc_stub::moves() == std::vector{ 2, 1 }, "half turn split into forward legs");
+		mme::test::check(fwxc_stub::position() == 4 && filter_wheel.current_filter_position() == 4, "wheel at 4");
+		mme::test::check(filter_wheel.last_rotation() == mme::Rotation::Forward, "forward reported");
+	}
+
+	void pending_position_is_shared() {
+		fwxc_stub::reset({ .num_positions = 6, .position = 1, .per_slot = 10ms });
+		mme::FwxcQueue queue{ mme::Fwxc{} };
+		auto first = queue.change_filter_position(3);
+		auto second = queue.change_filter_position(3);
+		mme::test::check(first.get() && second.get(), "both handles resolve");
+		mme::test::check(fwxc_stub::moves().size() == 1, "one move for both requests");
+		mme::test::check(queue.current_filter_position() == 3, "wheel at 3");
+	}
+
+	void failed_move_keeps_the_stopped_position() {
+		//1 to 4 is split at 3, the leg to 4 fails
+		fwxc_stub::reset({ .num_positions = 6, .position = 1, .per_slot = 1ms, .failing_move = 2 });
+		mme::FwxcQueue queue{ mme::Fwxc{} };
+		mme::test::check(!queue.change_filter_position(4).get(), "move fails");
+		mme::test::check(queue.current_filter_position() == 3, std::format("wheel stopped at 3, not {}", queue.current_filter_position()));
+		mme::test::check(queue.change_filter_position(2).get(), "next move succeeds");
+		mme::test::check(fwxc_stub::moves() == std::vector{ 2, -1 }, "next move plans from 3");
+	}
+
+	void prefetch_hides_travel_time() {
+		constexpr auto per_slot = 30ms;
+		constexpr auto exposure = 60ms;
+		constexpr std::array<size_t, 4> filters{ 3, 5, 1, 3 };
+
+		//blocking: every move adds to the exposures
+		fwxc_stub::reset({ .num_positions = 6, .position = 1, .per_slot = per_slot });
+		mme::Fwxc filter_wheel{};
+		auto start = Clock::now();
+		for (auto filter : filters) {
+			mme::test::check(filter_wheel.change_filter_position(filter), "blocking move succeeds");
+			std::this_thread::sleep_for(exposure);
+		}
+		const auto blocking = Clock::now() - start;
+
+		//queued: the move to the next filter overlaps the exposure on the current one
+		fwxc_stub::reset({ .num_positions = 6, .position = 1, .per_slot = per_slot });
+		mme::FwxcQueue queue{ mme::Fwxc{}, mme::FilterTiming{ per_slot } };
+		start = Clock::now();
+		auto change = queue.change_filter_position(filters[0]);
+		for (size_t i = 0; i < filters.size(); i++) {
+			mme::test::check(change.get(), "queued move succeeds");
+			if (i + 1 < filters.size()) {
+				change = queue.change_filter_position(filters[i + 1]);
+			}
+			std::this_thread::sleep_for(exposure);
+		}
+		const auto queued = Clock::now() - start;
+
+		//6 of the 8 slots turned overlap an exposure
+		mme::test::check(blocking - queued > 4 * per_slot, std::format("queued {} s is not faster than blocking {} s",
+			std::chrono::duration<double>(queued).count(), std::chrono::duration<double>(blocking).count()));
+	}
+
+	void visit_order_follows_the_wheel() {
+		const std::vector<size_t> positions{ 1, 4, 6, 2 };
+		const auto order = mme::shortest_visit_order(5, positions, 6);
+		mme::test::check(std::ranges::is_permutation(order, positions), "every position visited once");
+		size_t slots = 0;
+		size_t current = 5;
+		for (auto position : order) {
+			slots += mme::shortest_filter_move(current, position, 6).slots;
+			current = position;
+		}
+		mme::test::check(slots == 5, std::format("visiting takes 5 slots, not {}", slots));
+	}
+}
+
+int main() {
+	return mme::test::run({
+		{ "shortest_rotation_is_taken", shortest_rotation_is_taken },
+		{ "half_turns_go_forward", half_turns_go_forward },
+		{ "pending_position_is_shared", pending_position_is_shared },
+		{ "failed_move_keeps_the_stopped_position", failed_move_keeps_the_stopped_position },
+		{ "prefetch_hides_travel_time", prefetch_hides_travel_time },
+		{ "visit_order_follows_the_wheel", visit_order_follows_the_wheel },
+	});
+}
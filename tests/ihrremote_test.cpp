@@ -0,0 +1,123 @@
+#include "testing.h"
+#include "mme/ihr/ihr.h"
+#include "mme/ihrremote/ihrremote.h"
+#include "mme/ihrremote/ihrserver.h"
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	using namespace std::chrono_literals;
+
+	//records what arrives, so a test sees the commands the server really made
+	struct StandInMonochromator {
+		std::mutex mutex;
+		std::vector<std::string> commands;
+		double current_wavelength = 0.0;
+
+		void record(std::string command) {
+			std::scoped_lock lock{ mutex };
+			commands.push_back(std::move(command));
+		}
+		void initialize(bool forced) { record(std::format("initialize {}", forced)); }
+		void change_wavelength(double wavelength) {
+			if (wavelength < 0.0 || wavelength > 1500.0) {
+				throw std::out_of_range(std::format("{} nm is out of range", wavelength));
+			}
+			record(std::format("wavelength {}", wavelength));
+			std::scoped_lock lock{ mutex };
+			current_wavelength = wavelength;
+		}
+		double wavelength() {
+			std::scoped_lock lock{ mutex };
+			return current_wavelength;
+		}
+		void change_slit(double width, mme::PortLocation loc) { record(std::format("slit {} {}", width, static_cast<int>(loc))); }
+		void change_grating(size_t grating) { record(std::format("grating {}", grating)); }
+		void open_port(mme::PortLocation loc) { record(std::format("open {}", static_cast<int>(loc))); }
+		void close_port(mme::PortLocation loc) { record(std::format("close {}", static_cast<int>(loc))); }
+	};
+	static_assert(mme::Monochromator<StandInMonochromator>);
+
+	//a server on an ephemeral loopback port, run on its own thread for the lifetime of the object
+	struct LocalServer {
+		StandInMonochromator monochromator;
+		mme::Ihr550Server server{ monochromator, 0 };
+		std::jthread thread{ [this] { server.run(); } };
+
+		~LocalServer() {
+			server.stop();
+		}
+		std::string device() const { return "127.0.0.1:" + std::to_string(server.port()); }
+	};
+
+	void commands_reach_the_device() {
+		LocalServer local;
+		mme::Ihr550Remote remote{ local.device() };
+		remote.initialize(true);
+		remote.change_wavelength(532.5);
+		remote.change_slit(0.25, mme::PortLocation::FrontEntrance);
+		remote.change_grating(2);
+		remote.open_port(mme::PortLocation::SideExit);
+		remote.close_port(mme::PortLocation::FrontExit);
+		mme::test::check(remote.wavelength() == 532.5, "wavelength read back from the device");
+		const std::vector<std::string> expected{ "initialize true", "wavelength 532.5", "slit 0.25 0", "grating 2", "open 3", "close 1" };
+		mme::test::check(local.monochromator.commands == expected, "commands arrive unchanged and in order");
+	}
+
+	void pipelined_requests_keep_their_order() {
+		LocalServer local;
+		mme::Ihr550Remote remote{ local.device() };
+		std::vector<std::future<void>> changes;
+		for (int i = 0; i < 200; i++) {
+			changes.push_back(remote.change_wavelength_async(400.0 + i));
+		}
+		auto wavelength = remote.wavelength_async();
+		for (auto& change : changes) {
+			change.get();
+		}
+		mme::test::check(wavelength.get() == 599.0, "the read sees every change queued before it");
+		mme::test::check(local.monochromator.commands.size() == 200 && local.monochromator.commands.back() == "wavelength 599", "every change made once, in order");
+	}
+
+	void device_errors_reach_the_client() {
+		LocalServer local;
+		mme::Ihr550Remote remote{ local.device() };
+		bool threw = false;
+		try {
+			remote.change_wavelength(-5.0);
+		}
+		catch (const std::runtime_error& e) {
+			threw = std::string(e.what()).find("out of range") != std::string::npos;
+		}
+		mme::test::check(threw, "the device error is thrown by the remote call");
+		remote.change_wavelength(600.0);
+		mme::test::check(remote.wavelength() == 600.0, "the connection survives a failed call");
+	}
+
+	void closed_connections_are_released() {
+		LocalServer local;
+		for (int i = 0; i < 50; i++) {
+			mme::Ihr550Remote remote{ local.device() };
+			remote.change_wavelength(500.0 + i);
+		}
+		const auto deadline = std::chrono::steady_clock::now() + 2s;
+		while (local.server.num_connections() > 0 && std::chrono::steady_clock::now() < deadline) {
+			std::this_thread::sleep_for(10ms);
+		}
+		mme::test::check(local.server.num_connections() == 0, "readers of closed connections are joined");
+	}
+}
+
+int main() {
+	return mme::test::run({
+		{ "commands_reach_the_device", commands_reach_the_device },
+		{ "pipelined_requests_keep_their_order", pipelined_requests_keep_their_order },
+		{ "device_errors_reach_the_client", device_errors_reach_the_client },
+		{ "closed_connections_are_released", closed_connections_are_released },
+	});
+}
@@ -0,0 +1,144 @@
+#include "testing.h"
+#include "mme/registration/fft.h"
+#include "mme/registration/registration.h"
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <vector>
+
+namespace {
+
+	constexpr size_t SIZE = 256;
+
+	//Random scene blurred by a gaussian, kept as its spectrum so frames can be shifted exactly by a phase ramp
+	struct Scene {
+		std::vector<float> re;
+		std::vector<float> im;
+	};
+
+	double frequency(size_t index) {
+		return (index < SIZE / 2 ? static_cast<double>(index) : static_cast<double>(index) - static_cast<double>(SIZE)) / static_cast<double>(SIZE);
+	}
+
+	Scene make_scene(double blur_px, std::mt19937& rng) {
+		std::normal_distribution<float> gauss;
+		Scene scene{ std::vector<float>(SIZE * SIZE), std::vector<float>(SIZE * SIZE) };
+		for (size_t u = 0; u < SIZE; u++) {
+			for (size_t v = 0; v < SIZE; v++) {
+				const double f2 = frequency(u) * frequency(u) + frequency(v) * frequency(v);
+				const auto envelope = static_cast<float>(std::exp(-2.0 * std::numbers::pi * std::numbers::pi * blur_px * blur_px * f2));
+				scene.re[u * SIZE + v] = gauss(rng) * envelope;
+				scene.im[u * SIZE + v] = gauss(rng) * envelope;
+			}
+		}
+		return scene;
+	}
+
+	//the scene moved by shift with unit standard deviation, plus white noise of noise standard deviations
+	mme::Image<float> render(const Scene& scene, mme::Translation shift, float noise, std::mt19937& rng) {
+		std::vector<float> re(SIZE * SIZE);
+		std::vector<float> im(SIZE * SIZE);
+		for (size_t u = 0; u < SIZE; u++) {
+			for (size_t v = 0; v < SIZE; v++) {
+				const double phase = -2.0 * std::numbers::pi * (frequency(u) * shift.row + frequency(v) * shift.col);
+				const auto c = static_cast<float>(std::cos(phase));
+				const auto s = static_cast<float>(std::sin(phase));
+				const size_t k = u * SIZE + v;
+				re[k] = scene.re[k] * c - scene.im[k] * s;
+				im[k] = scene.re[k] * s + scene.im[k] * c;
+			}
+		}
+		mme::FftPlan2d({ SIZE, SIZE }).inverse(re, im);
+		double sum_squares = 0.0;
+		for (float value : re) {
+			sum_squares += value * value;
+		}
+		const auto scale = static_cast<float>(1.0 / std::sqrt(sum_squares / static_cast<double>(re.size())));
+
+		std::normal_distribution<float> gauss;
+		mme::Image<float> frame({ SIZE, SIZE });
+		for (size_t r = 0; r < SIZE; r++) {
+			auto row = frame.as_view().row(r);
+			for (size_t c = 0; c < SIZE; c++) {
+				row[c] = re[r * SIZE + c] * scale + noise * gauss(rng);
+			}
+		}
+		return frame;
+	}
+
+	double error(mme::Translation estimate, mme::Translation truth) {
+		return std::hypot(estimate.row - truth.row, estimate.col - truth.col);
+	}
+
+	void noisy_frames_register_to_a_small_fraction_of_a_pixel() {
+		std::mt19937 rng(44);
+		const auto scene = make_scene(1.0, rng);
+		const auto reference = render(scene, {}, 0.1f, rng);
+		std::vector<mme::Translation> truths;
+		std::vector<mme::Image<float>> frames;
+		for (size_t i = 0; i < 8; i++) {
+			truths.push_back({ 2.0 + 0.125 * static_cast<double>(i), 3.0 - 0.25 * static_cast<double>(i % 4) });
+			frames.push_back(render(scene, truths.back(), 0.1f, rng));
+		}
+		std::vector<mme::ImageView<const float>> views;
+		for (const auto& frame : frames) {
+			views.push_back(frame.as_view());
+		}
+
+		const mme::PhaseCorrelator correlator(reference.as_view());
+		const auto shifts = correlator.estimate(views);
+		for (size_t i = 0; i < frames.size(); i++) {
+			mme::test::check(error(shifts[i], truths[i]) < 0.05, std::format("frame {} at ({}, {}) estimated ({}, {})", i, truths[i].row, truths[i].col, shifts[i].row, shifts[i].col));
+			mme::test::check(error(correlator.estimate(views[i]), shifts[i]) < 1e-3, std::format("frame {} alone agrees with its pair", i));
+		}
+	}
+
+	void unshifted_frames_report_zero() {
+		std::mt19937 rng(7);
+		const auto scene = make_scene(1.0, rng);
+		const auto reference = render(scene, {}, 0.1f, rng);
+		const auto unshifted = render(scene, {}, 0.1f, rng);
+		const auto moved = render(scene, { -1.5, 0.5 }, 0.1f, rng);
+		const mme::PhaseCorrelator correlator(reference.as_view());
+
+		//either half of a pair and unpaired, the reference itself and a frame with noise of its own
+		const std::vector<mme::ImageView<const float>> views{ reference.as_view(), moved.as_view(), moved.as_view(), unshifted.as_view(), unshifted.as_view() };
+		const auto shifts = correlator.estimate(views);
+		mme::test::check(error(shifts[0], {}) < 1e-3, std::format("reference estimated ({}, {})", shifts[0].row, shifts[0].col));
+		mme::test::check(error(shifts[1], { -1.5, 0.5 }) < 0.05, std::format("moved frame estimated ({}, {})", shifts[1].row, shifts[1].col));
+		mme::test::check(error(shifts[3], {}) < 0.02, std::format("second of a pair estimated ({}, {})", shifts[3].row, shifts[3].col));
+		mme::test::check(error(shifts[4], {}) < 0.02, std::format("unpaired frame estimated ({}, {})", shifts[4].row, shifts[4].col));
+		const auto alone = correlator.estimate(reference.as_view());
+		mme::test::check(error(alone, {}) < 1e-3, std::format("reference alone estimated ({}, {})", alone.row, alone.col));
+	}
+
+	void registered_frames_match_the_reference() {
+		std::mt19937 rng(3);
+		const auto scene = make_scene(2.0, rng);
+		const auto reference = render(scene, {}, 0.0f, rng);
+		const auto moved = render(scene, { 1.25, -2.75 }, 0.0f, rng);
+		const std::vector<mme::ImageView<const float>> views{ reference.as_view(), moved.as_view() };
+
+		const auto registered = mme::register_frames(views);
+		double sum_squares = 0.0;
+		size_t count = 0;
+		for (size_t r = 8; r + 8 < SIZE; r++) {
+			for (size_t c = 8; c + 8 < SIZE; c++) {
+				const double difference = registered[1].as_view().row(r)[c] - reference.as_view().row(r)[c];
+				sum_squares += difference * difference;
+				count++;
+			}
+		}
+		const double rms = std::sqrt(sum_squares / static_cast<double>(count));
+		mme::test::check(rms < 0.05, std::format("registered frame differs by {} rms", rms));
+	}
+}
+
+int main()
+{
+	return mme::test::run({
+		{ "noisy frames register to a small fraction of a pixel", noisy_frames_register_to_a_small_fraction_of_a_pixel },
+		{ "unshifted frames report zero", unshifted_frames_report_zero },
+		{ "registered frames match the reference", registered_frames_match_the_reference },
+	});
+}
@@ -0,0 +1,161 @@
+#include "testing.h"
+#include "mme/session/recording.h"
+#include "mme/session/replay.h"
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+	//what RecordingCamera forwards to, frames change with every capture so replies cannot be mixed up
+	class FakeCamera {
+	public:
+		mme::Image<uint16_t> capture_raw() {
+			if (fail_next) {
+				fail_next = false;
+				throw std::runtime_error("Fake camera timed out");
+			}
+			return raw_frame(m_captures++);
+		}
+
+		mme::Image<float> capture_single() {
+			mme::Image<float> frame(m_size);
+			for (size_t i = 0; i < frame.pixels().size(); i++) {
+				frame.pixels()[i] = 0.25f * static_cast<float>(i) + static_cast<float>(m_captures);
+			}
+			m_captures++;
+			return frame;
+		}
+
+		mme::ImageSize image_size() const { return m_size; }
+		mme::Exposure exposure() const { return m_exposure; }
+		void set_exposure(mme::Exposure exposure) { m_exposure = exposure; }
+
+		//12 bit, so the session stores it delta bit packed
+		static mme::Image<uint16_t> raw_frame(size_t capture) {
+			mme::Image<uint16_t> frame(SIZE);
+			for (size_t i = 0; i < frame.pixels().size(); i++) {
+				frame.pixels()[i] = static_cast<uint16_t>((i * 7 + capture * 131) % 4096);
+			}
+			return frame;
+		}
+
+		static constexpr mme::ImageSize SIZE{ 6, 9 };
+		bool fail_next = false;
+
+	private:
+		mme::ImageSize m_size = SIZE;
+		mme::Exposure m_exposure{ 1.0 };
+		size_t m_captures = 0;
+	};
+
+	struct RecordedSession {
+		std::filesystem::path file;
+		std::vector<mme::Image<uint16_t>> raw_frames;
+		mme::Image<float> single_frame{ mme::ImageSize{ 0, 0 } };
+	};
+
+	RecordedSession record_session() {
+		RecordedSession session;
+		session.file = std::filesystem::temp_directory_path() / "mme_session_test.mmes";
+		mme::SessionWriter writer(session.file);
+		FakeCamera camera;
+		mme::RecordingCamera recording(camera, writer);
+		recording.set_exposure({ 12.5 });
+		for (size_t i = 0; i < 3; i++) {
+			session.raw_frames.push_back(recording.capture_raw());
+		}
+		session.single_frame = recording.capture_single();
+		mme::test::check(recording.exposure() == mme::Exposure{ 12.5 }, "the recording forwards to the camera");
+		mme::test::check(recording.image_size() == FakeCamera::SIZE, "the recording forwards queries");
+		camera.fail_next = true;
+		try {
+			recording.capture_raw();
+		}
+		catch (const std::runtime_error&) {
+		}
+		recording.set_exposure({ 20.0 });
+		return session;
+	}
+
+	template<typename T>
+	bool same_frame(const mme::Image<T>& a, const mme::Image<T>& b) {
+		return a.size() == b.size() && std::ranges::equal(a.pixels(), b.pixels());
+	}
+
+	void sessions_replay_as_recorded() {
+		const auto session = record_session();
+		mme::SessionPlayer player(session.file);
+		mme::test::check(player.device_names() == std::vector<std::string>{ "camera" } && player.device_type(player.device("camera")) == "camera",
+			"the session declares the camera");
+
+		mme::ReplayCamera camera(player);
+		camera.set_exposure({ 12.5 });
+		for (size_t i = 0; i < session.raw_frames.size(); i++) {
+			const auto frame = camera.capture_raw();
+			mme::test::check(same_frame(frame, session.raw_frames[i]) && same_frame(frame, FakeCamera::raw_frame(i)), std::format("raw frame {} replays as captured", i));
+		}
+		mme::test::check(same_frame(camera.capture_single(), session.single_frame), "the float frame replays as captured");
+		mme::test::check(camera.exposure() == mme::Exposure{ 12.5 } && camera.exposure() == mme::Exposure{ 12.5 }, "queries repeat their last reply");
+		mme::test::check(camera.image_size() == FakeCamera::SIZE, "the image size replays");
+
+		std::string message;
+		try {
+			camera.capture_raw();
+		}
+		catch (const std::runtime_error& e) {
+			message = e.what();
+		}
+		mme::test::check(message == "Fake camera timed out", std::format("the recorded failure is rethrown, got '{}'", message));
+		camera.set_exposure({ 20.0 });
+		std::filesystem::remove(session.file);
+	}
+
+	bool diverges(const std::function<void()>& func) {
+		try {
+			func();
+		}
+		catch (const std::runtime_error&) {
+			return true;
+		}
+		return false;
+	}
+
+	void divergence_is_detected() {
+		const auto session = record_session();
+		mme::SessionPlayer player(session.file);
+		mme::ReplayCamera camera(player);
+		mme::test::check(diverges([&] { camera.set_exposure({ 13.0 }); }), "a setter with other arguments than recorded throws");
+
+		player.restart();
+		camera.set_exposure({ 12.5 });
+		for (size_t i = 0; i < 3; i++) {
+			camera.capture_raw();
+		}
+		mme::test::check(diverges([&] { camera.capture_raw(); }), "the recorded failure is replayed");
+		mme::test::check(diverges([&] { camera.capture_raw(); }), "capturing more frames than recorded throws");
+		mme::test::check(diverges([&] { camera.set_binning({ 2 }); }), "a call that was never recorded throws");
+		mme::test::check(diverges([] {
+			mme::SessionPlayer other(std::filesystem::temp_directory_path() / "mme_session_test_missing.mmes");
+		}), "a missing session file throws");
+		bool no_device = false;
+		try {
+			mme::ReplayAdc adc(player);
+		}
+		catch (const std::invalid_argument&) {
+			no_device = true;
+		}
+		mme::test::check(no_device, "a device that was not recorded is rejected");
+		std::filesystem::remove(session.file);
+	}
+}
+
+int main() {
+	return mme::test::run({
+		{ "sessions_replay_as_recorded", sessions_replay_as_recorded },
+		{ "divergence_is_detected", divergence_is_detected },
+	});
+}
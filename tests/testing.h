@@ -0,0 +1,42 @@
+#pragma once
+#include <format>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <source_location>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+//Minimal test runner: every test is a function, a failed check throws and the runner reports it and carries on
+
+namespace mme::test {
+
+	struct TestCase {
+		std::string_view name;
+		std::function<void()> run;
+	};
+
+	inline void check(bool condition, std::string_view what, std::source_location location = std::source_location::current()) {
+		if (!condition) {
+			throw std::runtime_error(std::format("{}:{}: check failed: {}", location.file_name(), location.line(), what));
+		}
+	}
+
+	//returns the exit code for main, 0 when every test passed
+	inline int run(std::initializer_list<TestCase> tests) {
+		int failed = 0;
+		for (const auto& test : tests) {
+			try {
+				test.run();
+				std::cout << "passed: " << test.name << std::endl;
+			}
+			catch (const std::exception& e) {
+				std::cout << "FAILED: " << test.name << "\n  " << e.what() << std::endl;
+				failed++;
+			}
+		}
+		return failed == 0 ? 0 : 1;
+	}
+
+}
@@ -0,0 +1,166 @@
+#include "testing.h"
+#include "mme/tiling/tilestream.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+	std::filesystem::path temp_file(std::string_view name) {
+		return std::filesystem::temp_directory_path() / std::format("mme_tilestream_test_{}.npy", name);
+	}
+
+	float input_value(size_t plane, size_t row, size_t col) {
+		return static_cast<float>(plane * 1000 + row * 10 + col);
+	}
+
+	//planes of input_value, written a row at a time
+	void write_input(const std::filesystem::path& file, mme::ImageSize size, size_t num_planes, mme::NpyElementType element_type) {
+		mme::NpyRowWriter writer(file, size, num_planes, element_type);
+		mme::Image<float> row({ 1, size.width });
+		for (size_t plane = 0; plane < num_planes; plane++) {
+			for (size_t r = 0; r < size.height; r++) {
+				for (size_t c = 0; c < size.width; c++) {
+					row.pixels()[c] = input_value(plane, r, c);
+				}
+				writer.write_rows(plane, r, std::as_const(row).as_view());
+			}
+		}
+	}
+
+	//version 1.0 header of a 2D float32 array, without any data
+	void write_empty_npy(const std::filesystem::path& file, size_t height, size_t width) {
+		std::string dict = std::format("{{'descr': '<f4', 'fortran_order': False, 'shape': ({}, {}), }}", height, width);
+		dict.append((64 - (10 + dict.size() + 1) % 64) % 64, ' ');
+		dict += '\n';
+		std::ofstream out(file, std::ios::binary | std::ios::trunc);
+		out.write("\x93NUMPY\x01\x00", 8);
+		const char size_bytes[2] = { static_cast<char>(dict.size() & 0xff), static_cast<char>(dict.size() >> 8) };
+		out.write(size_bytes, 2);
+		out.write(dict.data(), dict.size());
+	}
+
+	template<typename Exception>
+	bool throws(const std::function<void()>& func) {
+		try {
+			func();
+		}
+		catch (const Exception&) {
+			return true;
+		}
+		return false;
+	}
+
+	void tiles_cover_every_row() {
+		const mme::ImageSize size{ 10, 7 };
+		const auto counts_file = temp_file("counts");
+		const auto planes_file = temp_file("planes");
+		const auto output_file = temp_file("output");
+		write_input(counts_file, size, 1, mme::NpyElementType::UInt16);
+		write_input(planes_file, size, 2, mme::NpyElementType::Float32);
+		{
+			mme::NpyRowReader counts(counts_file);
+			mme::NpyRowReader planes(planes_file);
+			mme::NpyRowWriter output(output_file, size, 2);
+			const std::vector<mme::TileInput> inputs{ { &counts, 0 }, { &planes, 1 } };
+			const std::vector<mme::TileOutput> outputs{ { &output, 1 }, { &output, 0 } };
+
+			std::vector<size_t> row_starts;
+			mme::TileStreamOptions options;
+			options.max_tile_rows = 3;
+			const auto report = mme::stream_tiles(inputs, outputs, [&](const mme::Tile& tile) {
+				row_starts.push_back(tile.row_start);
+				auto sums = tile.outputs[0];
+				auto tile_starts = tile.outputs[1];
+				for (size_t i = 0; i < tile.num_rows * size.width; i++) {
+					sums.pixels()[i] = tile.inputs[0].pixels()[i] + tile.inputs[1].pixels()[i];
+					tile_starts.pixels()[i] = static_cast<float>(tile.row_start);
+				}
+			}, options);
+
+			mme::test::check(report.size == size && report.tile_rows == 3 && report.num_tiles == 4, std::format("{} tiles of {} rows", report.num_tiles, report.tile_rows));
+			mme::test::check(row_starts == std::vector<size_t>{ 0, 3, 6, 9 }, "tiles are processed in order, the last one partial");
+			mme::test::check(report.buffer_bytes == 2 * 4 * 3 * size.width * sizeof(float), std::format("{} bytes of tile buffers", report.buffer_bytes));
+		}
+
+		mme::NpyRowReader output(output_file);
+		mme::Image<float> sums(size);
+		mme::Image<float> row_starts(size);
+		output.read_rows(1, 0, sums.as_view());
+		output.read_rows(0, 0, row_starts.as_view());
+		bool sums_match = true;
+		bool row_starts_match = true;
+		for (size_t r = 0; r < size.height; r++) {
+			for (size_t c = 0; c < size.width; c++) {
+				sums_match = sums_match && sums.pixels()[r * size.width + c] == input_value(0, r, c) + input_value(1, r, c);
+				row_starts_match = row_starts_match && row_starts.pixels()[r * size.width + c] == static_cast<float>(r / 3 * 3);
+			}
+		}
+		mme::test::check(sums_match, "every output row holds the sum of its input rows");
+		mme::test::check(row_starts_match, "every row was written by its own tile");
+		for (const auto& file : { counts_file, planes_file, output_file }) {
+			std::filesystem::remove(file);
+		}
+	}
+
+	void budgets_limit_the_tile_height() {
+		const size_t width = 100;
+		mme::TileStreamOptions options;
+		options.memory_budget = 2 * 3 * width * sizeof(float) * 5;
+		mme::test::check(mme::tile_rows_for_budget(width, 2, 1, options) == 5, "the budget holds five double buffered rows");
+		options.max_tile_rows = 2;
+		mme::test::check(mme::tile_rows_for_budget(width, 2, 1, options) == 2, "the tile height is capped");
+		options.memory_budget = 10;
+		mme::test::check(throws<std::invalid_argument>([&] { mme::tile_rows_for_budget(width, 2, 1, options); }), "a budget below one row throws");
+	}
+
+	void invalid_streams_are_rejected() {
+		const auto empty_file = temp_file("empty");
+		const auto input_file = temp_file("input");
+		const auto other_file = temp_file("other");
+		write_empty_npy(empty_file, 0, 7);
+		write_input(input_file, { 4, 7 }, 1, mme::NpyElementType::Float32);
+		write_input(other_file, { 5, 7 }, 1, mme::NpyElementType::Float32);
+		auto nothing = [](const mme::Tile&) {};
+		{
+			mme::NpyRowReader empty(empty_file);
+			const std::vector<mme::TileInput> inputs{ { &empty, 0 } };
+			mme::test::check(throws<std::invalid_argument>([&] { mme::stream_tiles(inputs, {}, nothing); }), "an input without rows is rejected");
+		}
+		{
+			mme::NpyRowReader input(input_file);
+			mme::NpyRowReader other(other_file);
+			const std::vector<mme::TileInput> inputs{ { &input, 0 }, { &other, 0 } };
+			mme::test::check(throws<std::invalid_argument>([&] { mme::stream_tiles(inputs, {}, nothing); }), "planes of different sizes are rejected");
+			mme::test::check(throws<std::invalid_argument>([&] { mme::stream_tiles({}, {}, nothing); }), "a stream without planes is rejected");
+
+			const std::vector<mme::TileInput> single{ { &input, 0 } };
+			mme::TileStreamOptions options;
+			options.max_tile_rows = 1;
+			size_t calls = 0;
+			mme::test::check(throws<std::runtime_error>([&] {
+				mme::stream_tiles(single, {}, [&](const mme::Tile&) {
+					if (++calls == 2) {
+						throw std::runtime_error("process failed");
+					}
+				}, options);
+			}) && calls == 2, "an exception from process ends the stream");
+		}
+		for (const auto& file : { empty_file, input_file, other_file }) {
+			std::filesystem::remove(file);
+		}
+	}
+}
+
+int main() {
+	return mme::test::run({
+		{ "tiles_cover_every_row", tiles_cover_every_row },
+		{ "budgets_limit_the_tile_height", budgets_limit_the_tile_height },
+		{ "invalid_streams_are_rejected", invalid_streams_are_rejected },
+	});
+}